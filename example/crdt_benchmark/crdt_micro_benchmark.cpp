@@ -0,0 +1,554 @@
+#include <crdt/crdt_datastore.hpp>
+#include <crdt/crdt_heads.hpp>
+#include <crdt/crdt_set.hpp>
+#include <storage/rocksdb/rocksdb.hpp>
+#include <ipfs_lite/ipfs/merkledag/impl/merkledag_service_impl.hpp>
+#include <ipfs_lite/ipfs/impl/in_memory_datastore.hpp>
+#include <libp2p/multi/multihash.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <thread>
+
+namespace
+{
+  using sgns::base::Buffer;
+  using sgns::crdt::Broadcaster;
+  using sgns::crdt::CrdtDatastore;
+  using sgns::crdt::CrdtHeads;
+  using sgns::crdt::CrdtOptions;
+  using sgns::crdt::CrdtSet;
+  using sgns::crdt::DAGSyncer;
+  using sgns::crdt::HierarchicalKey;
+  using sgns::CID;
+  using sgns::storage::rocksdb;
+  using ipfs_lite::ipfs::InMemoryDatastore;
+  using ipfs_lite::ipld::IPLDNode;
+  using libp2p::multi::HashType;
+  using libp2p::multi::Multihash;
+
+  namespace fs = boost::filesystem;
+
+  struct Options
+  {
+    size_t propagatedKeyCount = 20;
+    size_t transactionKeyCount = 100000;
+    uint32_t headCount = 10000;
+    size_t historySize = 300;
+    size_t catchUpHistorySize = 10000;
+    size_t mergedDeltaCount = 5000;
+  };
+
+  /** DAG syncer of a replica that shares a node storage with other replicas.
+  * Nodes added by other replicas can be fetched but are not known blocks of the replica.
+  * Fetching can be delayed to simulate network latency
+  */
+  class ReplicaDagSyncer : public DAGSyncer
+  {
+  public:
+    using MerkleDagServiceImpl = ipfs_lite::ipfs::merkledag::MerkleDagServiceImpl;
+    using Leaf = ipfs_lite::ipfs::merkledag::Leaf;
+
+    ReplicaDagSyncer(std::shared_ptr<ipfs_lite::ipfs::IpfsDatastore> aService)
+      : dagService_(aService)
+    {
+    }
+
+    outcome::result<bool> HasBlock(const CID& aCid) const override
+    {
+      std::lock_guard lock(this->mutex_);
+      return this->knownBlocks_.count(aCid.toString().value()) > 0;
+    }
+
+    outcome::result<void> addNode(std::shared_ptr<const IPLDNode> aNode) override
+    {
+      {
+        std::lock_guard lock(this->mutex_);
+        this->knownBlocks_.insert(aNode->getCID().toString().value());
+      }
+      return this->dagService_.addNode(aNode);
+    }
+
+    outcome::result<std::shared_ptr<IPLDNode>> getNode(const CID& aCid) const override
+    {
+      ++this->fetchedNodeCount_;
+      if (this->fetchLatency_.count() > 0)
+      {
+        std::this_thread::sleep_for(this->fetchLatency_);
+      }
+      return this->dagService_.getNode(aCid);
+    }
+
+    outcome::result<void> removeNode(const CID& aCid) override
+    {
+      return this->dagService_.removeNode(aCid);
+    }
+
+    outcome::result<size_t> select(
+      gsl::span<const uint8_t> aRootCid,
+      gsl::span<const uint8_t> aSelector,
+      std::function<bool(std::shared_ptr<const IPLDNode> node)> aHandler) const override
+    {
+      return this->dagService_.select(aRootCid, aSelector, aHandler);
+    }
+
+    outcome::result<std::shared_ptr<Leaf>> fetchGraph(const CID& aCid) const override
+    {
+      return this->dagService_.fetchGraph(aCid);
+    }
+
+    outcome::result<std::shared_ptr<Leaf>> fetchGraphOnDepth(const CID& aCid, uint64_t aDepth) const override
+    {
+      return this->dagService_.fetchGraphOnDepth(aCid, aDepth);
+    }
+
+    /** Number of nodes fetched by the replica */
+    mutable std::atomic<size_t> fetchedNodeCount_ = 0;
+
+    /** Delay of each node fetch */
+    std::chrono::microseconds fetchLatency_ = std::chrono::microseconds(0);
+
+  private:
+    MerkleDagServiceImpl dagService_;
+    std::set<std::string> knownBlocks_;
+    mutable std::mutex mutex_;
+  };
+
+  /** Broadcaster that delivers broadcasts to a connected replica in the same process
+  */
+  class LoopbackBroadcaster : public Broadcaster
+  {
+  public:
+    void Connect(const std::shared_ptr<LoopbackBroadcaster>& aPeer)
+    {
+      this->peer_ = aPeer;
+    }
+
+    outcome::result<void> Broadcast(const Buffer& aBuff) override
+    {
+      auto peer = this->peer_.lock();
+      if (peer != nullptr && !aBuff.empty())
+      {
+        peer->Receive(std::string(aBuff.toString()));
+      }
+      return outcome::success();
+    }
+
+    outcome::result<Buffer> Next() override
+    {
+      std::lock_guard lock(this->mutex_);
+      if (this->receivedBroadcasts_.empty())
+      {
+        return outcome::failure(boost::system::error_code{});
+      }
+
+      Buffer buffer;
+      buffer.put(this->receivedBroadcasts_.front());
+      this->receivedBroadcasts_.pop();
+      return buffer;
+    }
+
+    void SetNewBroadcastHandler(std::function<void()> aHandler) override
+    {
+      std::lock_guard lock(this->mutex_);
+      this->newBroadcastHandler_ = std::move(aHandler);
+    }
+
+  private:
+    void Receive(const std::string& aData)
+    {
+      std::lock_guard lock(this->mutex_);
+      this->receivedBroadcasts_.push(aData);
+      if (this->newBroadcastHandler_)
+      {
+        this->newBroadcastHandler_();
+      }
+    }
+
+    std::weak_ptr<LoopbackBroadcaster> peer_;
+    std::queue<std::string> receivedBroadcasts_;
+    std::function<void()> newBroadcastHandler_;
+    std::mutex mutex_;
+  };
+
+  std::shared_ptr<rocksdb> CreateReplicaDataStore(const std::string& aDatabasePath)
+  {
+    fs::remove_all(aDatabasePath);
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    return rocksdb::create(aDatabasePath, options).value();
+  }
+
+  /** Pair of replicas connected by loopback broadcasters and sharing a node storage
+  */
+  struct ReplicaPair
+  {
+    explicit ReplicaPair(const std::string& aDatabasePrefix)
+    {
+      this->nodeStorage = std::make_shared<InMemoryDatastore>();
+      this->sourceBroadcaster = std::make_shared<LoopbackBroadcaster>();
+      this->source = std::make_shared<CrdtDatastore>(CreateReplicaDataStore(aDatabasePrefix + "_0"),
+        HierarchicalKey("/namespace"), std::make_shared<ReplicaDagSyncer>(this->nodeStorage),
+        this->sourceBroadcaster, CrdtOptions::DefaultOptions());
+    }
+
+    /** Creates the second replica and connects it to the first one
+    */
+    void Join(const std::string& aDatabasePrefix, const std::shared_ptr<CrdtOptions>& aOptions)
+    {
+      this->joinDataStore = CreateReplicaDataStore(aDatabasePrefix + "_1");
+      this->joinBroadcaster = std::make_shared<LoopbackBroadcaster>();
+      this->joinDagSyncer = std::make_shared<ReplicaDagSyncer>(this->nodeStorage);
+      this->join = std::make_shared<CrdtDatastore>(this->joinDataStore, HierarchicalKey("/namespace"),
+        this->joinDagSyncer, this->joinBroadcaster, aOptions);
+      this->sourceBroadcaster->Connect(this->joinBroadcaster);
+      this->joinBroadcaster->Connect(this->sourceBroadcaster);
+    }
+
+    /** Waits until the second replica stores a head, which happens when its walk of the DAG reaches the bottom
+    * @return false if the replica does not join within the timeout
+    */
+    bool WaitForJoin(std::chrono::steady_clock::duration aTimeout)
+    {
+      Buffer headsPrefix;
+      headsPrefix.put("/namespace/h/");
+      auto startTime = std::chrono::steady_clock::now();
+      while (std::chrono::steady_clock::now() - startTime < aTimeout)
+      {
+        auto headsResult = this->joinDataStore->query(headsPrefix);
+        if (!headsResult.has_failure() && !headsResult.value().empty())
+        {
+          return true;
+        }
+        std::this_thread::yield();
+      }
+      return false;
+    }
+
+    /** Waits until a key is visible on the second replica
+    * @return false if the key is not propagated within the timeout
+    */
+    bool WaitForKey(const HierarchicalKey& aKey, std::chrono::steady_clock::duration aTimeout)
+    {
+      auto startTime = std::chrono::steady_clock::now();
+      while (std::chrono::steady_clock::now() - startTime < aTimeout)
+      {
+        auto hasKeyResult = this->join->HasKey(aKey);
+        if (!hasKeyResult.has_failure() && hasKeyResult.value())
+        {
+          return true;
+        }
+        std::this_thread::yield();
+      }
+      return false;
+    }
+
+    std::shared_ptr<InMemoryDatastore> nodeStorage;
+    std::shared_ptr<LoopbackBroadcaster> sourceBroadcaster;
+    std::shared_ptr<CrdtDatastore> source;
+    std::shared_ptr<rocksdb> joinDataStore;
+    std::shared_ptr<LoopbackBroadcaster> joinBroadcaster;
+    std::shared_ptr<ReplicaDagSyncer> joinDagSyncer;
+    std::shared_ptr<CrdtDatastore> join;
+  };
+
+  /** Prints median and maximal latencies from a put start on one replica
+  * until the key is visible on another one
+  * @param aKeyCount - number of propagated keys
+  */
+  void MeasurePropagationLatency(size_t aKeyCount)
+  {
+    ReplicaPair replicas("crdt_micro_benchmark_propagation");
+    replicas.Join("crdt_micro_benchmark_propagation", CrdtOptions::DefaultOptions());
+
+    std::vector<std::chrono::microseconds> latencies;
+    for (size_t keyIdx = 0; keyIdx < aKeyCount; ++keyIdx)
+    {
+      auto key = HierarchicalKey("Key" + std::to_string(keyIdx));
+      Buffer buffer;
+      buffer.put("Data" + std::to_string(keyIdx));
+
+      auto startTime = std::chrono::steady_clock::now();
+      if (replicas.source->PutKey(key, buffer).has_failure() || !replicas.WaitForKey(key, std::chrono::seconds(5)))
+      {
+        std::cerr << "Key is not propagated: " << key.GetKey() << "\n";
+        return;
+      }
+      latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime));
+    }
+
+    if (latencies.empty())
+    {
+      return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "propagation_latency_median_us=" << latencies[latencies.size() / 2].count() << "\n";
+    std::cout << "propagation_latency_max_us=" << latencies.back().count() << "\n";
+  }
+
+  /** Prints build times of transactions of a tenth of the keys and of all keys.
+  * Linear building takes about ten times longer for all keys
+  * @param aKeyCount - number of keys put to the larger transaction
+  */
+  void MeasureTransactionBuildTime(size_t aKeyCount)
+  {
+    ReplicaPair replicas("crdt_micro_benchmark_transaction");
+    Buffer buffer;
+    buffer.put(std::string(100, 'v'));
+
+    for (auto keyCount : { aKeyCount / 10, aKeyCount })
+    {
+      auto transaction = replicas.source->BeginTransaction();
+      auto startTime = std::chrono::steady_clock::now();
+      for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+      {
+        if (transaction->AddToDelta(HierarchicalKey("/key/" + std::to_string(keyIdx)), buffer).has_failure())
+        {
+          std::cerr << "Transaction is not built\n";
+          return;
+        }
+      }
+      std::cout << "transaction_build_ms_" << keyCount << "="
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << "\n";
+    }
+  }
+
+  /** Prints lookup times of heads in sets of a tenth of the heads and of all heads.
+  * Lookups in cached heads do not depend on the number of heads
+  * @param aHeadCount - number of heads in the larger set
+  */
+  void MeasureHeadLookupTime(uint32_t aHeadCount)
+  {
+    auto createCid = [](uint32_t aIndex)
+    {
+      std::vector<uint8_t> digest(32, 0);
+      for (size_t byteIdx = 0; byteIdx < sizeof(aIndex); ++byteIdx)
+      {
+        digest[byteIdx] = static_cast<uint8_t>(aIndex >> (8 * byteIdx));
+      }
+      return CID(CID::Version::V1, CID::Multicodec::SHA2_256, Multihash::create(HashType::sha256, digest).value());
+    };
+
+    for (auto headCount : { std::max(aHeadCount / 10, 1u), std::max(aHeadCount, 1u) })
+    {
+      CrdtHeads crdtHeads(CreateReplicaDataStore("crdt_micro_benchmark_heads"), HierarchicalKey("/namespace"));
+      std::vector<CID> cids;
+      for (uint32_t headIdx = 0; headIdx < headCount; ++headIdx)
+      {
+        cids.push_back(createCid(headIdx));
+        if (crdtHeads.Add(cids.back(), headIdx).has_failure())
+        {
+          std::cerr << "Head is not added\n";
+          return;
+        }
+      }
+
+      const size_t lookupCount = 100000;
+      auto startTime = std::chrono::steady_clock::now();
+      for (size_t lookupIdx = 0; lookupIdx < lookupCount; ++lookupIdx)
+      {
+        const auto& cid = cids[(lookupIdx * 7919) % cids.size()];
+        if (crdtHeads.IsHead(cid).has_failure() || crdtHeads.GetHeadHeight(cid).has_failure())
+        {
+          std::cerr << "Head is not found\n";
+          return;
+        }
+      }
+      std::cout << "head_lookup_ns_" << headCount << "="
+        << std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / lookupCount
+        << "\n";
+    }
+  }
+
+  /** Prints join times of a new replica and numbers of nodes it fetches
+  * with the full history and with the history compacted into a snapshot
+  * @param aHistorySize - number of updates made before the replica joins
+  */
+  void MeasureSnapshotJoinTime(size_t aHistorySize)
+  {
+    for (bool isCompacted : { false, true })
+    {
+      ReplicaPair replicas("crdt_micro_benchmark_snapshot");
+      for (size_t updateIdx = 0; updateIdx < aHistorySize; ++updateIdx)
+      {
+        Buffer buffer;
+        buffer.put("Data" + std::to_string(updateIdx));
+        if (replicas.source->PutKey(HierarchicalKey("Key" + std::to_string(updateIdx % 50)), buffer).has_failure())
+        {
+          std::cerr << "History is not created\n";
+          return;
+        }
+      }
+
+      if (isCompacted && replicas.source->CompactDAG(true).has_failure())
+      {
+        std::cerr << "History is not compacted\n";
+        return;
+      }
+
+      replicas.Join("crdt_micro_benchmark_snapshot", CrdtOptions::DefaultOptions());
+      auto startTime = std::chrono::steady_clock::now();
+      Buffer lastBuffer;
+      lastBuffer.put("LastData");
+      if (replicas.source->PutKey(HierarchicalKey("LastKey"), lastBuffer).has_failure()
+        || !replicas.WaitForJoin(std::chrono::seconds(30)))
+      {
+        std::cerr << "Replica is not joined\n";
+        return;
+      }
+
+      const std::string joinName = isCompacted ? "snapshot" : "history";
+      std::cout << "join_ms_" << joinName << "="
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << "\n";
+      std::cout << "join_fetched_nodes_" << joinName << "=" << replicas.joinDagSyncer->fetchedNodeCount_.load() << "\n";
+    }
+  }
+
+  /** Prints numbers of deltas per second processed by new replicas catching up with a history,
+  * fetching nodes one by one and fetching them in parallel and ahead of the walk
+  * @param aHistorySize - number of updates made before the replicas join
+  */
+  void MeasureCatchUpThroughput(size_t aHistorySize)
+  {
+    auto sequentialOptions = CrdtOptions::DefaultOptions();
+    sequentialOptions->numFetchWorkers = 1;
+    sequentialOptions->prefetchDepth = 0;
+
+    for (bool isParallel : { false, true })
+    {
+      ReplicaPair replicas("crdt_micro_benchmark_catch_up");
+      for (size_t updateIdx = 0; updateIdx < aHistorySize; ++updateIdx)
+      {
+        Buffer buffer;
+        buffer.put("Data" + std::to_string(updateIdx));
+        if (replicas.source->PutKey(HierarchicalKey("Key" + std::to_string(updateIdx % 100)), buffer).has_failure())
+        {
+          std::cerr << "History is not created\n";
+          return;
+        }
+      }
+
+      replicas.Join("crdt_micro_benchmark_catch_up", isParallel ? CrdtOptions::DefaultOptions() : sequentialOptions);
+      replicas.joinDagSyncer->fetchLatency_ = std::chrono::microseconds(200);
+      auto startTime = std::chrono::steady_clock::now();
+      Buffer lastBuffer;
+      lastBuffer.put("LastData");
+      if (replicas.source->PutKey(HierarchicalKey("LastKey"), lastBuffer).has_failure()
+        || !replicas.WaitForJoin(std::chrono::seconds(120)))
+      {
+        std::cerr << "Replica is not caught up\n";
+        return;
+      }
+
+      auto catchUpTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+      std::cout << "catch_up_deltas_per_s_" << (isParallel ? "parallel" : "sequential") << "="
+        << aHistorySize / catchUpTime << "\n";
+    }
+  }
+
+  /** Prints numbers of deltas per second merged into a set one by one and in groups with one write batch
+  * @param aDeltaCount - number of merged deltas
+  */
+  void MeasureMergeThroughput(size_t aDeltaCount)
+  {
+    const size_t keyCount = 100;
+    const size_t groupSize = 64;
+
+    std::vector<std::pair<std::shared_ptr<CrdtSet::Delta>, std::string>> deltas;
+    for (size_t deltaIdx = 0; deltaIdx < aDeltaCount; ++deltaIdx)
+    {
+      auto delta = std::make_shared<CrdtSet::Delta>();
+      delta->set_priority(deltaIdx / 200 + 1);
+      auto element = delta->add_elements();
+      element->set_key("key" + std::to_string(deltaIdx % keyCount));
+      element->set_value("value" + std::to_string(deltaIdx));
+      deltas.emplace_back(delta, "ID" + std::to_string(deltaIdx));
+    }
+
+    for (auto mergeGroupSize : { size_t(1), groupSize })
+    {
+      auto crdtSet = CrdtSet(CreateReplicaDataStore("crdt_micro_benchmark_merge"), HierarchicalKey("/namespace"));
+      auto startTime = std::chrono::steady_clock::now();
+      for (size_t deltaIdx = 0; deltaIdx < deltas.size(); deltaIdx += mergeGroupSize)
+      {
+        std::vector<std::pair<std::shared_ptr<CrdtSet::Delta>, std::string>> group(deltas.begin() + deltaIdx,
+          deltas.begin() + std::min(deltaIdx + mergeGroupSize, deltas.size()));
+        auto mergeResult = mergeGroupSize == 1 ?
+          crdtSet.Merge(group.front().first, group.front().second) : crdtSet.MergeDeltas(group);
+        if (mergeResult.has_failure())
+        {
+          std::cerr << "Deltas are not merged\n";
+          return;
+        }
+      }
+
+      auto mergeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+      std::cout << "merge_deltas_per_s_group_" << mergeGroupSize << "=" << deltas.size() / mergeTime << "\n";
+    }
+  }
+
+  boost::optional<Options> ParseCommandLine(int aArgc, char** aArgv)
+  {
+    namespace po = boost::program_options;
+    try
+    {
+      Options o;
+
+      po::options_description desc("CRDT micro benchmark options");
+      desc.add_options()("help,h", "print usage message")
+        ("propagatedkeys", po::value(&o.propagatedKeyCount), "number of keys which propagation latency is measured")
+        ("transactionkeys", po::value(&o.transactionKeyCount), "number of keys put to a transaction which build time is measured")
+        ("heads", po::value(&o.headCount), "number of heads in a set which lookup time is measured")
+        ("historysize", po::value(&o.historySize), "number of updates made before a replica joins with and without a snapshot")
+        ("catchuphistorysize", po::value(&o.catchUpHistorySize), "number of updates which catch-up throughput is measured")
+        ("mergeddeltas", po::value(&o.mergedDeltaCount), "number of deltas which merge throughput into a set is measured");
+
+      po::variables_map vm;
+      po::store(parse_command_line(aArgc, aArgv, desc), vm);
+      po::notify(vm);
+
+      if (vm.count("help") != 0)
+      {
+        std::cerr << desc << "\n";
+        return boost::none;
+      }
+      return o;
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << e.what() << std::endl;
+    }
+    return boost::none;
+  }
+}
+
+/** Measures CRDT datastore costs that are too noisy to be checked by unit tests.
+* The report is printed as key=value lines.
+*/
+int main(int argc, char* argv[])
+{
+  auto options = ParseCommandLine(argc, argv);
+  if (!options)
+  {
+    return 1;
+  }
+
+  MeasurePropagationLatency(options->propagatedKeyCount);
+  MeasureTransactionBuildTime(options->transactionKeyCount);
+  MeasureHeadLookupTime(options->headCount);
+  MeasureSnapshotJoinTime(options->historySize);
+  MeasureCatchUpThroughput(options->catchUpHistorySize);
+  MeasureMergeThroughput(options->mergedDeltaCount);
+  std::cout << std::flush;
+  return 0;
+}
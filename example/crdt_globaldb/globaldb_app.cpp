@@ -176,20 +176,17 @@ int main(int argc, char** argv)
       }
       else if (command == "list")
       {
-        auto queryResult = globalDB.QueryKeyValues("");
+        auto queryResult = globalDB.QueryKeyValues("",
+          [](const Buffer& key, const Buffer& value)
+          {
+            // key name: /crdt/s/k/<key>/v
+            std::cout << "[" << key.toString() << "] -> " << value.toString() << std::endl;
+            return true;
+          });
         if (queryResult.has_failure())
         {
           std::cout << "Unable list keys from CRDT datastore" << std::endl;
         }
-        else
-        {
-          for (const auto& element : queryResult.value())
-          {
-            // key name: /crdt/s/k/<key>/v
-            auto strKey = std::string(element.first.toString());
-            std::cout << "[" << strKey << "] -> " << element.second.toString() << std::endl;
-          }
-        }
       }
       else if (command.rfind("get") == 0)
       {
@@ -0,0 +1,704 @@
+#include <processing/processing_service.hpp>
+#include <processing/processing_subtask_enqueuer_impl.hpp>
+#include <processing/processing_thread_pool_executor.hpp>
+
+#include <libp2p/log/configurator.hpp>
+#include <libp2p/log/logger.hpp>
+
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace sgns::processing;
+
+namespace
+{
+    class SubTaskStateStorageImpl : public SubTaskStateStorage
+    {
+    public:
+        void ChangeSubTaskState(const std::string& subTaskId, SGProcessing::SubTaskState::Type state) override {}
+        std::optional<SGProcessing::SubTaskState> GetSubTaskState(const std::string& subTaskId) override
+        {
+            return std::nullopt;
+        }
+        void SaveQueueCheckpoint(
+            const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint) override {}
+        std::optional<SGProcessing::SubTaskQueueCheckpoint> LoadQueueCheckpoint(const std::string& queueId) override
+        {
+            return std::nullopt;
+        }
+    };
+
+    /** Result storage shared by all services, a stand-in for the replicated results database
+    */
+    class SubTaskResultStorageImpl : public SubTaskResultStorage
+    {
+    public:
+        void AddSubTaskResult(const SGProcessing::SubTaskResult& subTaskResult) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_results[subTaskResult.subtaskid()] = subTaskResult;
+        }
+
+        void RemoveSubTaskResult(const std::string& subTaskId) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_results.erase(subTaskId);
+        }
+
+        void GetSubTaskResults(
+            const std::set<std::string>& subTaskIds,
+            std::vector<SGProcessing::SubTaskResult>& results) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            for (const auto& subTaskId : subTaskIds)
+            {
+                auto it = m_results.find(subTaskId);
+                if (it != m_results.end())
+                {
+                    results.push_back(it->second);
+                }
+            }
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::map<std::string, SGProcessing::SubTaskResult> m_results;
+    };
+
+    /** Processing core with a tunable subtask cost.
+    * The cost of each subtask is derived from its id, so runs with the same options are repeatable.
+    */
+    class SyntheticProcessingCore : public ProcessingCore
+    {
+    public:
+        SyntheticProcessingCore(size_t subTaskCostMicrosec, double costJitter, bool isBusyWaiting)
+            : m_subTaskCostMicrosec(subTaskCostMicrosec)
+            , m_costJitter(costJitter)
+            , m_isBusyWaiting(isBusyWaiting)
+            , m_executedSubTaskCount(0)
+        {
+        }
+
+        void ProcessSubTask(
+            const SGProcessing::SubTask& subTask, SGProcessing::SubTaskResult& result,
+            uint32_t initialHashCode) override
+        {
+            std::seed_seq seed(subTask.subtaskid().begin(), subTask.subtaskid().end());
+            std::mt19937 generator(seed);
+            std::uniform_real_distribution<double> jitter(-m_costJitter, m_costJitter);
+            auto cost = std::chrono::microseconds(
+                static_cast<int64_t>(m_subTaskCostMicrosec * std::max(0.0, 1.0 + jitter(generator))));
+
+            if (m_isBusyWaiting)
+            {
+                auto finishTime = std::chrono::steady_clock::now() + cost;
+                while (std::chrono::steady_clock::now() < finishTime)
+                {
+                }
+            }
+            else
+            {
+                std::this_thread::sleep_for(cost);
+            }
+
+            // Chunk hashes are the same on all nodes so that results pass the validation
+            for (const auto& chunk : subTask.chunkstoprocess())
+            {
+                result.add_chunk_hashes(static_cast<uint32_t>(std::hash<std::string>()(chunk.chunkid())));
+            }
+            result.set_ipfs_results_data_id((boost::format("RESULT_%s") % subTask.subtaskid()).str());
+            ++m_executedSubTaskCount;
+        }
+
+        /** Returns a number of subtask executions including speculative duplicates
+        */
+        size_t GetExecutedSubTaskCount() const
+        {
+            return m_executedSubTaskCount;
+        }
+
+    private:
+        size_t m_subTaskCostMicrosec;
+        double m_costJitter;
+        bool m_isBusyWaiting;
+        std::atomic<size_t> m_executedSubTaskCount;
+    };
+
+    /** Task queue that is shared by all services of the benchmark
+    */
+    class BenchmarkTaskQueue : public ProcessingTaskQueue
+    {
+    public:
+        void EnqueueTask(
+            const SGProcessing::Task& task,
+            const std::list<SGProcessing::SubTask>& subTasks) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_tasks.push_back(task);
+            if (task.enqueue_timestamp() == 0)
+            {
+                m_tasks.back().set_enqueue_timestamp(std::chrono::system_clock::now().time_since_epoch().count());
+            }
+            m_subTasks.emplace(task.ipfs_block_id(), subTasks);
+        }
+
+        bool GetSubTasks(
+            const std::string& taskId,
+            std::list<SGProcessing::SubTask>& subTasks) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            auto it = m_subTasks.find(taskId);
+            if (it == m_subTasks.end())
+            {
+                return false;
+            }
+            subTasks = it->second;
+            return true;
+        }
+
+        bool GrabTask(std::string& taskKey, SGProcessing::Task& task) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (m_tasks.empty())
+            {
+                return false;
+            }
+            // Tasks are grabbed in the arrival order
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            taskKey = task.ipfs_block_id();
+            return true;
+        }
+
+        bool GetAvailableTasks(
+            size_t maxTaskCount,
+            std::list<std::pair<std::string, SGProcessing::Task>>& tasks) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            for (auto it = m_tasks.begin(); (it != m_tasks.end()) && (tasks.size() < maxTaskCount); ++it)
+            {
+                tasks.emplace_back(it->ipfs_block_id(), *it);
+            }
+            return !tasks.empty();
+        }
+
+        bool GrabTaskById(const std::string& taskKey, SGProcessing::Task& task) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            auto it = std::find_if(m_tasks.begin(), m_tasks.end(),
+                [&taskKey](const SGProcessing::Task& queuedTask) { return queuedTask.ipfs_block_id() == taskKey; });
+            if (it == m_tasks.end())
+            {
+                return false;
+            }
+            task = std::move(*it);
+            m_tasks.erase(it);
+            return true;
+        }
+
+        bool CompleteTask(const std::string& taskKey, const SGProcessing::TaskResult& task) override
+        {
+            return true;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::list<SGProcessing::Task> m_tasks;
+        std::map<std::string, std::list<SGProcessing::SubTask>> m_subTasks;
+    };
+
+    /** Passive grid participant that listens to all benchmark channels.
+    * Each published message is received once, so the observer counts published bytes,
+    * queue ownership changes and subtask results without changes in the processing code.
+    */
+    class GridObserver
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        GridObserver(std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub> gossipPubSub, size_t subTaskCount)
+            : m_gossipPubSub(std::move(gossipPubSub))
+            , m_subTaskCount(subTaskCount)
+        {
+        }
+
+        void ObserveGridChannel(const std::string& gridChannelId)
+        {
+            Subscribe(gridChannelId, [this](const sgns::ipfs_pubsub::GossipPubSub::Message& message) {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_gridBytes += message.data.size();
+                ++m_messageCount;
+            });
+        }
+
+        void ObserveTask(const std::string& taskId)
+        {
+            Subscribe(taskId, [this, taskId](const sgns::ipfs_pubsub::GossipPubSub::Message& message) {
+                OnQueueChannelMessage(taskId, message);
+            });
+            Subscribe(taskId + "_RESULTS", [this, taskId](const sgns::ipfs_pubsub::GossipPubSub::Message& message) {
+                OnResultChannelMessage(taskId, message);
+            });
+        }
+
+        void SetTaskArrivalTime(const std::string& taskId, Clock::time_point arrivalTime)
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_tasks[taskId].arrivalTime = arrivalTime;
+        }
+
+        size_t GetCompletedTaskCount() const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            return m_completedTaskCount;
+        }
+
+        /** Returns latencies of completed tasks in milliseconds sorted in ascending order
+        */
+        std::vector<double> GetTaskLatencies() const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            std::vector<double> latencies;
+            for (const auto& [taskId, task] : m_tasks)
+            {
+                if (task.completionTime)
+                {
+                    latencies.push_back(
+                        std::chrono::duration<double, std::milli>(*task.completionTime - task.arrivalTime).count());
+                }
+            }
+            std::sort(latencies.begin(), latencies.end());
+            return latencies;
+        }
+
+        size_t GetProcessedSubTaskCount() const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            size_t processedSubTaskCount = 0;
+            for (const auto& [taskId, task] : m_tasks)
+            {
+                processedSubTaskCount += task.processedSubTaskIds.size();
+            }
+            return processedSubTaskCount;
+        }
+
+        size_t GetOwnershipTransferCount() const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            return m_ownershipTransferCount;
+        }
+
+        void GetPublishedBytes(size_t& gridBytes, size_t& queueBytes, size_t& resultBytes, size_t& messageCount) const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            gridBytes = m_gridBytes;
+            queueBytes = m_queueBytes;
+            resultBytes = m_resultBytes;
+            messageCount = m_messageCount;
+        }
+
+    private:
+        struct TaskState
+        {
+            Clock::time_point arrivalTime;
+            std::optional<Clock::time_point> completionTime;
+            std::string ownerNodeId;
+            std::set<std::string> processedSubTaskIds;
+        };
+
+        void Subscribe(const std::string& channelId, std::function<void(const sgns::ipfs_pubsub::GossipPubSub::Message&)> handler)
+        {
+            auto topic = std::make_shared<sgns::ipfs_pubsub::GossipPubSubTopic>(m_gossipPubSub, channelId);
+            topic->Subscribe([handler](boost::optional<const sgns::ipfs_pubsub::GossipPubSub::Message&> message) {
+                if (message)
+                {
+                    handler(*message);
+                }
+            });
+            m_topics.push_back(std::move(topic));
+        }
+
+        void OnQueueChannelMessage(const std::string& taskId, const sgns::ipfs_pubsub::GossipPubSub::Message& message)
+        {
+            SGProcessing::ProcessingChannelMessage channelMessage;
+            if (!channelMessage.ParseFromArray(message.data.data(), static_cast<int>(message.data.size())))
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_queueBytes += message.data.size();
+            ++m_messageCount;
+
+            std::string ownerNodeId;
+            if (channelMessage.has_subtask_queue())
+            {
+                ownerNodeId = channelMessage.subtask_queue().processing_queue().owner_node_id();
+            }
+            else if (channelMessage.has_subtask_queue_delta())
+            {
+                ownerNodeId = channelMessage.subtask_queue_delta().owner_node_id();
+            }
+            else
+            {
+                return;
+            }
+
+            auto& task = m_tasks[taskId];
+            if (!task.ownerNodeId.empty() && (task.ownerNodeId != ownerNodeId))
+            {
+                ++m_ownershipTransferCount;
+            }
+            task.ownerNodeId = ownerNodeId;
+        }
+
+        void OnResultChannelMessage(const std::string& taskId, const sgns::ipfs_pubsub::GossipPubSub::Message& message)
+        {
+            SGProcessing::SubTaskResultBatch resultBatch;
+            if (!resultBatch.ParseFromArray(message.data.data(), static_cast<int>(message.data.size())))
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_resultBytes += message.data.size();
+            ++m_messageCount;
+
+            auto& task = m_tasks[taskId];
+            for (const auto& result : resultBatch.results())
+            {
+                task.processedSubTaskIds.insert(result.subtaskid());
+            }
+
+            if (!task.completionTime && (task.processedSubTaskIds.size() >= m_subTaskCount))
+            {
+                task.completionTime = Clock::now();
+                ++m_completedTaskCount;
+            }
+        }
+
+        std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub> m_gossipPubSub;
+        size_t m_subTaskCount;
+        std::list<std::shared_ptr<sgns::ipfs_pubsub::GossipPubSubTopic>> m_topics;
+
+        mutable std::mutex m_mutex;
+        std::map<std::string, TaskState> m_tasks;
+        size_t m_completedTaskCount = 0;
+        size_t m_ownershipTransferCount = 0;
+        size_t m_gridBytes = 0;
+        size_t m_queueBytes = 0;
+        size_t m_resultBytes = 0;
+        size_t m_messageCount = 0;
+    };
+
+    double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+    {
+        if (sortedValues.empty())
+        {
+            return 0;
+        }
+        // Nearest-rank method
+        auto rank = static_cast<size_t>(std::ceil(percentile / 100 * sortedValues.size()));
+        return sortedValues[std::max<size_t>(rank, 1) - 1];
+    }
+
+    // cmd line options
+    struct Options
+    {
+        size_t serviceCount = 4;
+        size_t workerCount = 2; // executor threads per service
+        size_t maximalNodesCount = 4; // processing nodes per service
+        size_t taskCount = 16;
+        size_t tenantCount = 1; // tasks are assigned to tenants round-robin
+        size_t subTaskCount = 8;
+        size_t chunkCount = 1; // chunks per subtask
+        size_t subTaskCost = 20000; // us
+        double costJitter = 0;
+        bool isBusyWaiting = false;
+        size_t taskInterval = 0; // ms
+        size_t subTaskPrefetchDepth = 0;
+        size_t maximalInFlightSubTaskCount = 1;
+        size_t duplicationBudget = 0;
+        bool isDeltaReplicationEnabled = false;
+        size_t loadReportInterval = 1000; // ms
+        size_t channelListRequestTimeout = 200; // ms
+        size_t warmupTime = 1000; // ms
+        size_t timeout = 120; // s
+        size_t port = 41001;
+        double minimalThroughput = 0; // subtasks/s
+        double maximalP99Latency = 0; // ms
+        bool isVerbose = false;
+    };
+
+    boost::optional<Options> parseCommandLine(int argc, char** argv) {
+        namespace po = boost::program_options;
+        try
+        {
+            Options o;
+
+            po::options_description desc("processing benchmark options");
+            desc.add_options()("help,h", "print usage message")
+                ("services,s", po::value(&o.serviceCount), "number of processing services")
+                ("workers,w", po::value(&o.workerCount), "executor threads per service")
+                ("maxnodes,m", po::value(&o.maximalNodesCount), "maximal number of processing nodes per service")
+                ("tasks,t", po::value(&o.taskCount), "number of tasks")
+                ("tenants", po::value(&o.tenantCount), "number of tenants that tasks are assigned to")
+                ("subtasks,n", po::value(&o.subTaskCount), "number of subtasks per task")
+                ("chunks,c", po::value(&o.chunkCount), "number of chunks per subtask")
+                ("cost,p", po::value(&o.subTaskCost), "subtask processing cost (us)")
+                ("jitter", po::value(&o.costJitter), "relative subtask cost deviation [0, 1]")
+                ("busy", po::bool_switch(&o.isBusyWaiting), "burn CPU instead of sleeping while processing a subtask")
+                ("taskinterval", po::value(&o.taskInterval), "interval between task arrivals (ms), 0 enqueues all tasks at once")
+                ("prefetch", po::value(&o.subTaskPrefetchDepth), "subtask prefetch depth per node")
+                ("inflight", po::value(&o.maximalInFlightSubTaskCount), "maximal number of in-flight subtasks per node")
+                ("duplicates", po::value(&o.duplicationBudget), "speculative execution budget per node")
+                ("deltas", po::bool_switch(&o.isDeltaReplicationEnabled), "replicate subtask queues with deltas")
+                ("loadreport", po::value(&o.loadReportInterval), "load report interval (ms), 0 disables load-aware routing")
+                ("channellisttimeout", po::value(&o.channelListRequestTimeout), "channel list request timeout (ms)")
+                ("warmup", po::value(&o.warmupTime), "time to wait for pubsub subscriptions before the run (ms)")
+                ("timeout", po::value(&o.timeout), "run timeout (s)")
+                ("port", po::value(&o.port), "first pubsub port, services use consecutive ports")
+                ("minthroughput", po::value(&o.minimalThroughput), "fail if throughput is below the value (subtasks/s)")
+                ("maxp99", po::value(&o.maximalP99Latency), "fail if p99 task latency exceeds the value (ms)")
+                ("verbose,v", po::bool_switch(&o.isVerbose), "print processing logs");
+
+            po::variables_map vm;
+            po::store(parse_command_line(argc, argv, desc), vm);
+            po::notify(vm);
+
+            if (vm.count("help") != 0)
+            {
+                std::cerr << desc << "\n";
+                return boost::none;
+            }
+
+            if ((o.serviceCount == 0) || (o.taskCount == 0) || (o.subTaskCount == 0) || (o.tenantCount == 0))
+            {
+                std::cerr << "Number of services, tasks, subtasks and tenants should be > 0\n";
+                return boost::none;
+            }
+
+            return o;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+        return boost::none;
+    }
+}
+
+/** Runs several processing services in a single process and reports grid metrics.
+* The report is printed as key=value lines. The exit code is 2 if the run did not complete
+* or a threshold passed in options is violated, so that the benchmark can be used as a regression check.
+*/
+int main(int argc, char* argv[])
+{
+    auto options = parseCommandLine(argc, argv);
+    if (!options)
+    {
+        return 1;
+    }
+
+    auto processingLogLevel = options->isVerbose ? spdlog::level::debug : spdlog::level::err;
+    for (auto loggerName : {
+        "GossipPubSub", "ProcessingService", "ProcessingEngine", "ProcessingSubTaskQueueManager",
+        "ProcessingSubTaskQueue", "ProcessingSubTaskQueueAccessorImpl", "ProcessingSubTaskQueueChannelPubSub",
+        "ProcessingValidationCore", "ProcessingThreadPoolExecutor", "SubTaskEnqueuerImpl" })
+    {
+        sgns::base::createLogger(loggerName)->set_level(processingLogLevel);
+    }
+
+    const std::string logger_config(R"(
+    # ----------------
+    sinks:
+      - name: console
+        type: console
+        color: true
+    groups:
+      - name: processing_benchmark
+        sink: console
+        level: error
+        children:
+          - name: libp2p
+          - name: Gossip
+    # ----------------
+    )");
+
+    // prepare log system
+    auto logging_system = std::make_shared<soralog::LoggingSystem>(
+        std::make_shared<soralog::ConfiguratorFromYAML>(
+            // Original LibP2P logging config
+            std::make_shared<libp2p::log::Configurator>(),
+            // Additional logging config for application
+            logger_config));
+    logging_system->configure();
+
+    libp2p::log::setLoggingSystem(logging_system);
+
+    const std::string processingGridChannel = "BENCHMARK_GRID_CHANNEL_ID";
+
+    // All services are connected to the observer
+    auto observerPubs = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();
+    observerPubs->Start(static_cast<int>(options->port), {});
+
+    std::vector<std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub>> servicePubs;
+    for (size_t serviceIdx = 0; serviceIdx < options->serviceCount; ++serviceIdx)
+    {
+        auto pubs = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();
+        pubs->Start(static_cast<int>(options->port + 1 + serviceIdx), { observerPubs->GetLocalAddress() });
+        servicePubs.push_back(std::move(pubs));
+    }
+
+    std::vector<std::string> taskIds;
+    GridObserver observer(observerPubs, options->subTaskCount);
+    observer.ObserveGridChannel(processingGridChannel);
+    for (size_t taskIdx = 0; taskIdx < options->taskCount; ++taskIdx)
+    {
+        taskIds.push_back((boost::format("BENCHMARK_TASK_%d") % taskIdx).str());
+        observer.ObserveTask(taskIds.back());
+    }
+
+    auto taskQueue = std::make_shared<BenchmarkTaskQueue>();
+    auto enqueuer = std::make_shared<SubTaskEnqueuerImpl>(taskQueue);
+    auto processingCore = std::make_shared<SyntheticProcessingCore>(
+        options->subTaskCost, options->costJitter, options->isBusyWaiting);
+
+    auto resultStorage = std::make_shared<SubTaskResultStorageImpl>();
+
+    std::vector<std::unique_ptr<ProcessingServiceImpl>> services;
+    for (auto& pubs : servicePubs)
+    {
+        auto service = std::make_unique<ProcessingServiceImpl>(
+            pubs,
+            options->maximalNodesCount,
+            enqueuer,
+            std::make_shared<SubTaskStateStorageImpl>(),
+            resultStorage,
+            processingCore,
+            std::make_shared<ProcessingThreadPoolExecutor>(options->workerCount));
+        service->SetChannelListRequestTimeout(boost::posix_time::milliseconds(options->channelListRequestTimeout));
+        service->SetSubTaskPrefetchDepth(options->subTaskPrefetchDepth);
+        service->SetMaximalInFlightSubTaskCount(options->maximalInFlightSubTaskCount);
+        service->SetSpeculativeExecutionBudget(options->duplicationBudget);
+        service->SetDeltaReplicationEnabled(options->isDeltaReplicationEnabled);
+        service->SetLoadReportInterval(boost::posix_time::milliseconds(options->loadReportInterval));
+        services.push_back(std::move(service));
+    }
+
+    // Let subscriptions propagate over the grid
+    std::this_thread::sleep_for(std::chrono::milliseconds(options->warmupTime));
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto timeoutTime = startTime + std::chrono::seconds(options->timeout);
+    for (auto& service : services)
+    {
+        service->StartProcessing(processingGridChannel);
+    }
+
+    for (size_t taskIdx = 0; taskIdx < options->taskCount; ++taskIdx)
+    {
+        auto arrivalTime = startTime + std::chrono::milliseconds(options->taskInterval * taskIdx);
+        std::this_thread::sleep_until(arrivalTime);
+
+        SGProcessing::Task task;
+        task.set_ipfs_block_id(taskIds[taskIdx]);
+        task.set_results_channel(taskIds[taskIdx] + "_RESULTS");
+        task.set_tenant_id((boost::format("TENANT_%d") % (taskIdx % options->tenantCount)).str());
+        std::list<SGProcessing::SubTask> subTasks;
+        for (size_t subTaskIdx = 0; subTaskIdx < options->subTaskCount; ++subTaskIdx)
+        {
+            SGProcessing::SubTask subTask;
+            subTask.set_ipfsblock(task.ipfs_block_id());
+            subTask.set_subtaskid((boost::format("%s_SUBTASK_%d") % taskIds[taskIdx] % subTaskIdx).str());
+            for (size_t chunkIdx = 0; chunkIdx < options->chunkCount; ++chunkIdx)
+            {
+                auto chunk = subTask.add_chunkstoprocess();
+                chunk->set_chunkid((boost::format("%s_CHUNK_%d") % subTask.subtaskid() % chunkIdx).str());
+            }
+            subTasks.push_back(std::move(subTask));
+        }
+        observer.SetTaskArrivalTime(taskIds[taskIdx], std::chrono::steady_clock::now());
+        taskQueue->EnqueueTask(task, subTasks);
+    }
+
+    while ((observer.GetCompletedTaskCount() < options->taskCount)
+        && (std::chrono::steady_clock::now() < timeoutTime))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    for (auto& pubs : servicePubs)
+    {
+        pubs->Stop();
+    }
+    for (auto& service : services)
+    {
+        service->StopProcessing();
+    }
+    observerPubs->Stop();
+
+    auto latencies = observer.GetTaskLatencies();
+    auto processedSubTaskCount = observer.GetProcessedSubTaskCount();
+    size_t gridBytes, queueBytes, resultBytes, messageCount;
+    observer.GetPublishedBytes(gridBytes, queueBytes, resultBytes, messageCount);
+    auto throughput = processedSubTaskCount / duration;
+    auto p99Latency = GetPercentile(latencies, 99);
+    auto perSubTask = [processedSubTaskCount](size_t value) {
+        return (processedSubTaskCount > 0) ? static_cast<double>(value) / processedSubTaskCount : 0.0;
+    };
+
+    std::cout << "services=" << options->serviceCount << "\n"
+        << "workers_per_service=" << options->workerCount << "\n"
+        << "tasks=" << options->taskCount << "\n"
+        << "subtasks_per_task=" << options->subTaskCount << "\n"
+        << "completed_tasks=" << observer.GetCompletedTaskCount() << "\n"
+        << "processed_subtasks=" << processedSubTaskCount << "\n"
+        << "executed_subtasks=" << processingCore->GetExecutedSubTaskCount() << "\n"
+        << "duration_s=" << duration << "\n"
+        << "subtasks_per_s=" << throughput << "\n"
+        << "task_latency_p50_ms=" << GetPercentile(latencies, 50) << "\n"
+        << "task_latency_p90_ms=" << GetPercentile(latencies, 90) << "\n"
+        << "task_latency_p99_ms=" << p99Latency << "\n"
+        << "task_latency_max_ms=" << (latencies.empty() ? 0 : latencies.back()) << "\n"
+        << "ownership_transfers_per_subtask=" << perSubTask(observer.GetOwnershipTransferCount()) << "\n"
+        << "messages_per_subtask=" << perSubTask(messageCount) << "\n"
+        << "bytes_per_subtask=" << perSubTask(gridBytes + queueBytes + resultBytes) << "\n"
+        << "grid_bytes_per_subtask=" << perSubTask(gridBytes) << "\n"
+        << "queue_bytes_per_subtask=" << perSubTask(queueBytes) << "\n"
+        << "result_bytes_per_subtask=" << perSubTask(resultBytes) << "\n";
+    for (const auto& [tenantId, statistics] : enqueuer->GetTenantStatistics())
+    {
+        std::cout << tenantId << "_grabbed_tasks=" << statistics.grabbedTaskCount << "\n"
+            << tenantId << "_grabbed_subtasks_per_s=" << statistics.GetSubTaskThroughput() << "\n"
+            << tenantId << "_wait_avg_ms=" << std::chrono::duration<double, std::milli>(
+                statistics.GetAverageWaitTime()).count() << "\n"
+            << tenantId << "_wait_max_ms=" << std::chrono::duration<double, std::milli>(
+                statistics.maxWaitTime).count() << "\n";
+    }
+    std::cout << std::flush;
+
+    bool passed = (observer.GetCompletedTaskCount() == options->taskCount);
+    if (!passed)
+    {
+        std::cerr << "Benchmark timed out" << std::endl;
+    }
+    if ((options->minimalThroughput > 0) && (throughput < options->minimalThroughput))
+    {
+        std::cerr << "Throughput is below " << options->minimalThroughput << " subtasks/s" << std::endl;
+        passed = false;
+    }
+    if ((options->maximalP99Latency > 0) && (p99Latency > options->maximalP99Latency))
+    {
+        std::cerr << "p99 task latency exceeds " << options->maximalP99Latency << "ms" << std::endl;
+        passed = false;
+    }
+    return passed ? 0 : 2;
+}
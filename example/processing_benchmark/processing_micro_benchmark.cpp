@@ -0,0 +1,285 @@
+#include <processing/processing_strided_hash_core.hpp>
+#include <processing/processing_subtask_queue.hpp>
+#include <processing/processing_task_queue_index.hpp>
+#include <processing/processing_validation_core.hpp>
+
+#include <boost/program_options.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+using namespace sgns::processing;
+
+namespace
+{
+    struct Options
+    {
+        std::vector<size_t> itemCounts = { 2000, 64000 };
+        size_t grabbedItemCount = 1000;
+        std::vector<size_t> taskCounts = { 1000, 100000 };
+        size_t validatedSubTaskCount = 2000;
+        std::vector<size_t> validationThreadCounts = { 1, 4 };
+        uint32_t hashedImageHeight = 16384;
+    };
+
+    /** Returns an average time of a single subtask queue item grabbing in nanoseconds
+    * @param itemCount - number of queue items
+    * @param grabbedItemCount - number of measured grabs, the other items are locked before the measurement
+    */
+    double MeasureSubTaskGrabbingTime(size_t itemCount, size_t grabbedItemCount)
+    {
+        SGProcessing::ProcessingQueue queue;
+        for (size_t itemIdx = 0; itemIdx < itemCount; ++itemIdx)
+        {
+            queue.add_items();
+        }
+
+        std::vector<int> enabledItemIndices(itemCount);
+        std::iota(enabledItemIndices.begin(), enabledItemIndices.end(), 0);
+
+        ProcessingSubTaskQueue processingQueue("NODE1_ID");
+        processingQueue.CreateQueue(&queue, enabledItemIndices);
+
+        // Lock all items except the last ones that are grabbed under the measurement
+        size_t itemIdx;
+        for (size_t lockIdx = 0; lockIdx + grabbedItemCount < itemCount; ++lockIdx)
+        {
+            processingQueue.GrabItem(itemIdx);
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (size_t lockIdx = 0; lockIdx < grabbedItemCount; ++lockIdx)
+        {
+            processingQueue.GrabItem(itemIdx);
+        }
+        auto duration = std::chrono::steady_clock::now() - startTime;
+
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count())
+            / grabbedItemCount;
+    }
+
+    /** Returns an average time of a single task grabbing from a task queue index in nanoseconds.
+    * Grabbing includes a search of the next unlocked task and its locking.
+    * @param taskCount - number of indexed tasks
+    * @param grabbedTaskCount - number of measured grabs, the other tasks are locked or completed before the measurement
+    */
+    double MeasureTaskGrabbingTime(size_t taskCount, size_t grabbedTaskCount)
+    {
+        grabbedTaskCount = std::min(grabbedTaskCount, taskCount);
+        ProcessingTaskQueueIndex index(0x5A5A5A5A5A5A5A5Aull);
+        for (size_t taskIdx = 0; taskIdx < taskCount; ++taskIdx)
+        {
+            index.AddPendingTask("IPFS_BLOCK_ID_" + std::to_string(taskIdx));
+        }
+
+        std::string taskId;
+        for (size_t taskIdx = 0; taskIdx < taskCount - grabbedTaskCount; ++taskIdx)
+        {
+            index.GetNextUnlockedTask(taskId);
+            if (taskIdx % 2 == 0)
+            {
+                index.CompleteTask(taskId);
+            }
+            else
+            {
+                index.LockTask(taskId, static_cast<ProcessingTaskQueueIndex::Timestamp>(taskIdx));
+            }
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (size_t lockIdx = 0; lockIdx < grabbedTaskCount; ++lockIdx)
+        {
+            index.ExpireLocks(-1);
+            index.GetNextUnlockedTask(taskId);
+            index.LockTask(taskId, static_cast<ProcessingTaskQueueIndex::Timestamp>(taskCount + lockIdx));
+        }
+        auto duration = std::chrono::steady_clock::now() - startTime;
+
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count())
+            / std::max<size_t>(grabbedTaskCount, 1);
+    }
+
+    /** Returns a time of validation of subtask results in microseconds
+    * @param subTaskCount - number of subtasks, each chunk is processed by 2 subtasks
+    * @param threadCount - number of validation threads
+    */
+    double MeasureValidationTime(size_t subTaskCount, size_t threadCount)
+    {
+        const size_t chunksPerSubTask = 10;
+        SGProcessing::SubTaskCollection subTasks;
+        std::map<std::string, SGProcessing::SubTaskResult> results;
+        for (size_t subTaskIdx = 0; subTaskIdx < subTaskCount; ++subTaskIdx)
+        {
+            auto subTask = subTasks.add_items();
+            subTask->set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx));
+
+            SGProcessing::SubTaskResult result;
+            result.set_subtaskid(subTask->subtaskid());
+            for (size_t idx = 0; idx < chunksPerSubTask; ++idx)
+            {
+                // Neighbour subtasks share their chunks
+                size_t chunkIdx = (subTaskIdx / 2) * chunksPerSubTask + idx;
+                auto chunk = subTask->add_chunkstoprocess();
+                chunk->set_chunkid("CHUNK_" + std::to_string(chunkIdx));
+                chunk->set_offset(chunkIdx);
+                chunk->set_subchunk_width(10);
+                chunk->set_subchunk_height(10);
+                result.add_chunk_hashes(chunkIdx);
+            }
+            results.emplace(result.subtaskid(), std::move(result));
+        }
+
+        ProcessingValidationCore validationCore(threadCount);
+        std::set<std::string> invalidSubTaskIds;
+        auto startTime = std::chrono::steady_clock::now();
+        validationCore.ValidateResults(subTasks, results, invalidSubTaskIds);
+        auto duration = std::chrono::steady_clock::now() - startTime;
+
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+
+    SGProcessing::ProcessingChunk CreateStridedChunk(
+        uint32_t offset, uint32_t width, uint32_t height, uint32_t lineStride, uint32_t stride, uint32_t subChunkCount)
+    {
+        SGProcessing::ProcessingChunk chunk;
+        chunk.set_chunkid("CHUNK_" + std::to_string(offset));
+        chunk.set_offset(offset);
+        chunk.set_subchunk_width(width);
+        chunk.set_subchunk_height(height);
+        chunk.set_line_stride(lineStride);
+        chunk.set_stride(stride);
+        chunk.set_n_subchunks(subChunkCount);
+        return chunk;
+    }
+
+    /** Prints hash kernel throughputs in GB/s for typical chunk layouts of a 4096 bytes wide image
+    * @param imageHeight - image height, should be a multiple of 64
+    */
+    void MeasureHashingThroughput(uint32_t imageHeight)
+    {
+        const uint32_t imageWidth = 4096;
+        std::mt19937 generator(42);
+        std::vector<uint8_t> data(static_cast<size_t>(imageWidth) * imageHeight);
+        for (auto& value : data)
+        {
+            value = static_cast<uint8_t>(generator());
+        }
+
+        std::vector<std::pair<std::string, std::vector<SGProcessing::ProcessingChunk>>> layouts(3);
+        // Contiguous lines
+        layouts[0].first = "contiguous";
+        layouts[0].second.push_back(CreateStridedChunk(0, imageWidth, imageHeight, imageWidth, 0, 1));
+        // Columns of 64x64 tiles
+        layouts[1].first = "tiles_64x64";
+        for (uint32_t columnIdx = 0; columnIdx < imageWidth / 64; ++columnIdx)
+        {
+            layouts[1].second.push_back(
+                CreateStridedChunk(columnIdx * 64, 64, 64, imageWidth, 64 * imageWidth, imageHeight / 64));
+        }
+        // 16 bytes wide columns
+        layouts[2].first = "columns_16";
+        for (uint32_t columnIdx = 0; columnIdx < imageWidth / 16; ++columnIdx)
+        {
+            layouts[2].second.push_back(CreateStridedChunk(columnIdx * 16, 16, imageHeight, imageWidth, 0, 1));
+        }
+
+        std::cout << "hash_kernel=" << ProcessingStridedHashCore::GetKernelName() << "\n";
+        for (auto& [layoutName, chunks] : layouts)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            for (auto& chunk : chunks)
+            {
+                ProcessingStridedHashCore::HashChunk(data.data(), data.size(), chunk);
+            }
+            auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime);
+
+            std::cout << "hash_gbps_" << layoutName << "="
+                << data.size() / duration.count() / (1024. * 1024. * 1024.) << "\n";
+        }
+    }
+
+    boost::optional<Options> parseCommandLine(int argc, char** argv) {
+        namespace po = boost::program_options;
+        try
+        {
+            Options o;
+
+            po::options_description desc("processing micro benchmark options");
+            desc.add_options()("help,h", "print usage message")
+                ("items,i", po::value(&o.itemCounts)->multitoken(), "queue sizes to measure")
+                ("grabs,g", po::value(&o.grabbedItemCount), "number of measured grabs per queue")
+                ("tasks,t", po::value(&o.taskCounts)->multitoken(), "task queue index sizes to measure")
+                ("validatedsubtasks", po::value(&o.validatedSubTaskCount), "number of subtasks which results are validated")
+                ("validationthreads", po::value(&o.validationThreadCounts)->multitoken(), "validation thread counts to measure")
+                ("hashedheight", po::value(&o.hashedImageHeight), "height of a hashed 4096 bytes wide image");
+
+            po::variables_map vm;
+            po::store(parse_command_line(argc, argv, desc), vm);
+            po::notify(vm);
+
+            if (vm.count("help") != 0)
+            {
+                std::cerr << desc << "\n";
+                return boost::none;
+            }
+
+            if (o.grabbedItemCount == 0)
+            {
+                std::cerr << "Number of measured grabs should be > 0\n";
+                return boost::none;
+            }
+
+            return o;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+        return boost::none;
+    }
+}
+
+/** Measures costs of single processing operations that are too noisy to be checked by unit tests.
+* The report is printed as key=value lines.
+* A flat per-grab cost for growing queue sizes means that grabbing does not scan the queue.
+*/
+int main(int argc, char* argv[])
+{
+    auto options = parseCommandLine(argc, argv);
+    if (!options)
+    {
+        return 1;
+    }
+
+    for (auto loggerName : { "ProcessingSubTaskQueue", "ProcessingValidationCore" })
+    {
+        sgns::base::createLogger(loggerName)->set_level(spdlog::level::err);
+    }
+
+    for (auto itemCount : options->itemCounts)
+    {
+        auto grabbedItemCount = std::min(itemCount, options->grabbedItemCount);
+        std::cout << "subtask_queue_grab_ns_" << itemCount << "="
+            << MeasureSubTaskGrabbingTime(itemCount, grabbedItemCount) << "\n";
+    }
+
+    for (auto taskCount : options->taskCounts)
+    {
+        std::cout << "task_index_grab_ns_" << taskCount << "="
+            << MeasureTaskGrabbingTime(taskCount, options->grabbedItemCount) << "\n";
+    }
+
+    for (auto threadCount : options->validationThreadCounts)
+    {
+        std::cout << "validation_us_" << threadCount << "_threads="
+            << MeasureValidationTime(options->validatedSubTaskCount, threadCount) << "\n";
+    }
+
+    MeasureHashingThroughput(options->hashedImageHeight);
+    std::cout << std::flush;
+    return 0;
+}
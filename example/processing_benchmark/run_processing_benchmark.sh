@@ -0,0 +1,30 @@
+#!/bin/bash
+# Runs processing_benchmark with emulated network latency and packet loss.
+# Benchmark services communicate over the loopback interface, the conditions are applied to it with tc netem
+# that requires CAP_NET_ADMIN. The loopback queueing discipline is restored on exit.
+#
+# Usage: run_processing_benchmark.sh [--latency <ms>] [--loss <percent>] [--binary <path>] [-- <benchmark options>]
+# Example: run_processing_benchmark.sh --latency 5 --loss 0.5 -- --services 8 --tasks 64 --minthroughput 200
+
+latency=0
+loss=0
+binary="$(dirname "$0")/processing_benchmark"
+
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        --latency) latency="$2"; shift 2 ;;
+        --loss) loss="$2"; shift 2 ;;
+        --binary) binary="$2"; shift 2 ;;
+        --) shift; break ;;
+        *) break ;;
+    esac
+done
+
+if [[ "$latency" != "0" || "$loss" != "0" ]]; then
+    tc qdisc add dev lo root netem delay "${latency}ms" loss "${loss}%" || exit 1
+    trap 'tc qdisc del dev lo root' EXIT
+fi
+
+echo "latency_ms=${latency}"
+echo "loss_percent=${loss}"
+"$binary" "$@"
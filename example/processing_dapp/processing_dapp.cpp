@@ -1,4 +1,5 @@
-#include "processing_task_queue_impl.hpp"
+#include <processing/processing_task_queue_globaldb.hpp>
+
 
 #include <crdt/globaldb/globaldb.hpp>
 #include <crdt/globaldb/keypair_file_storage.hpp>
@@ -239,7 +240,7 @@ int main(int argc, char* argv[])
 
     std::thread iothread([io]() { io->run(); });
 
-    auto taskQueue = std::make_shared<ProcessingTaskQueueImpl>(globalDB);
+    auto taskQueue = std::make_shared<ProcessingTaskQueueGlobalDB>(globalDB);
 
     TaskSplitter taskSplitter(
         options->nSubTasks,
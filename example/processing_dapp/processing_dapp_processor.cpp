@@ -1,8 +1,9 @@
-#include "processing_task_queue_impl.hpp"
 #include "processing_subtask_result_storage_impl.hpp"
+#include "processing_subtask_state_storage_impl.hpp"
 
 #include <processing/processing_service.hpp>
 #include <processing/processing_subtask_enqueuer_impl.hpp>
+#include <processing/processing_task_queue_globaldb.hpp>
 
 #include <crdt/globaldb/keypair_file_storage.hpp>
 #include <crdt/globaldb/globaldb.hpp>
@@ -19,16 +20,6 @@ using namespace sgns::processing;
 
 namespace
 {
-    class SubTaskStateStorageImpl : public SubTaskStateStorage
-    {
-    public:
-        void ChangeSubTaskState(const std::string& subTaskId, SGProcessing::SubTaskState::Type state) override {}
-        std::optional<SGProcessing::SubTaskState> GetSubTaskState(const std::string& subTaskId) override
-        {
-            return std::nullopt;
-        }
-    };
-
     class ProcessingCoreImpl : public ProcessingCore
     {
     public:
@@ -224,7 +215,7 @@ int main(int argc, char* argv[])
     auto loggerProcessingService = sgns::base::createLogger("ProcessingService");
     loggerProcessingService->set_level(spdlog::level::trace);
 
-    auto loggerProcessingTaskQueue = sgns::base::createLogger("ProcessingTaskQueueImpl");
+    auto loggerProcessingTaskQueue = sgns::base::createLogger("ProcessingTaskQueueGlobalDB");
     loggerProcessingTaskQueue->set_level(spdlog::level::debug);
 
     auto loggerProcessingSubTaskQueueManager = sgns::base::createLogger("ProcessingSubTaskQueueManager");
@@ -290,7 +281,7 @@ int main(int argc, char* argv[])
 
     std::thread iothread([io]() { io->run(); });
 
-    auto taskQueue = std::make_shared<ProcessingTaskQueueImpl>(globalDB);
+    auto taskQueue = std::make_shared<ProcessingTaskQueueGlobalDB>(globalDB);
 
     auto processingCore = std::make_shared<ProcessingCoreImpl>(
         globalDB,
@@ -305,7 +296,7 @@ int main(int argc, char* argv[])
         pubs,
         maximalNodesCount,
         enqueuer,
-        std::make_shared<SubTaskStateStorageImpl>(),
+        std::make_shared<SubTaskStateStorageImpl>(globalDB),
         std::make_shared<SubTaskResultStorageImpl>(globalDB),
         processingCore);
 
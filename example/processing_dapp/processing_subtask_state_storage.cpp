@@ -0,0 +1,70 @@
+#include "processing_subtask_state_storage_impl.hpp"
+#include <boost/format.hpp>
+
+#include <chrono>
+
+namespace sgns::processing
+{
+SubTaskStateStorageImpl::SubTaskStateStorageImpl(std::shared_ptr<sgns::crdt::GlobalDB> db)
+    : m_db(db)
+{
+}
+
+void SubTaskStateStorageImpl::ChangeSubTaskState(
+    const std::string& subTaskId, SGProcessing::SubTaskState::Type state)
+{
+    SGProcessing::SubTaskState subTaskState;
+    subTaskState.set_state(state);
+    subTaskState.set_timestamp(std::chrono::system_clock::now().time_since_epoch().count());
+
+    sgns::crdt::GlobalDB::Buffer data;
+    data.put(subTaskState.SerializeAsString());
+
+    m_db->Put(
+        sgns::crdt::HierarchicalKey((boost::format("subtask_states/%s") % subTaskId).str().c_str()),
+        data);
+}
+
+std::optional<SGProcessing::SubTaskState> SubTaskStateStorageImpl::GetSubTaskState(const std::string& subTaskId)
+{
+    auto data = m_db->Get(
+        sgns::crdt::HierarchicalKey((boost::format("subtask_states/%s") % subTaskId).str().c_str()));
+    if (data)
+    {
+        SGProcessing::SubTaskState subTaskState;
+        if (subTaskState.ParseFromArray(data.value().data(), data.value().size()))
+        {
+            return subTaskState;
+        }
+    }
+    return std::nullopt;
+}
+
+void SubTaskStateStorageImpl::SaveQueueCheckpoint(
+    const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint)
+{
+    sgns::crdt::GlobalDB::Buffer data;
+    data.put(checkpoint.SerializeAsString());
+
+    m_db->Put(
+        sgns::crdt::HierarchicalKey((boost::format("queue_checkpoints/%s") % queueId).str().c_str()),
+        data);
+}
+
+std::optional<SGProcessing::SubTaskQueueCheckpoint> SubTaskStateStorageImpl::LoadQueueCheckpoint(
+    const std::string& queueId)
+{
+    auto data = m_db->Get(
+        sgns::crdt::HierarchicalKey((boost::format("queue_checkpoints/%s") % queueId).str().c_str()));
+    if (data)
+    {
+        SGProcessing::SubTaskQueueCheckpoint checkpoint;
+        if (checkpoint.ParseFromArray(data.value().data(), data.value().size()))
+        {
+            return checkpoint;
+        }
+    }
+    return std::nullopt;
+}
+
+}
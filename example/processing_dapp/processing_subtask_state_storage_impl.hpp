@@ -0,0 +1,33 @@
+/**
+* Header file for subtask states storage implementation over CRDT
+*/
+
+#ifndef GRPC_FOR_SUPERGENIUS_PROCESSING_SUBTASK_STATE_STORAGE_IMPL_HPP
+#define GRPC_FOR_SUPERGENIUS_PROCESSING_SUBTASK_STATE_STORAGE_IMPL_HPP
+
+#include <processing/processing_subtask_state_storage.hpp>
+#include <crdt/globaldb/globaldb.hpp>
+
+namespace sgns::processing
+{
+/** Handles subtask states and queue checkpoints storage
+*/
+    class SubTaskStateStorageImpl : public SubTaskStateStorage
+    {
+    public:
+        SubTaskStateStorageImpl(std::shared_ptr<sgns::crdt::GlobalDB> db);
+
+        /** SubTaskStateStorage overrides
+        */
+        void ChangeSubTaskState(const std::string& subTaskId, SGProcessing::SubTaskState::Type state) override;
+        std::optional<SGProcessing::SubTaskState> GetSubTaskState(const std::string& subTaskId) override;
+        void SaveQueueCheckpoint(
+            const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint) override;
+        std::optional<SGProcessing::SubTaskQueueCheckpoint> LoadQueueCheckpoint(const std::string& queueId) override;
+
+    private:
+        std::shared_ptr<sgns::crdt::GlobalDB> m_db;
+    };
+}
+
+#endif // GRPC_FOR_SUPERGENIUS_PROCESSING_SUBTASK_STATE_STORAGE_IMPL_HPP
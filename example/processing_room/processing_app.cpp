@@ -20,6 +20,12 @@ namespace
         {
             return std::nullopt;
         }
+        void SaveQueueCheckpoint(
+            const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint) override {}
+        std::optional<SGProcessing::SubTaskQueueCheckpoint> LoadQueueCheckpoint(const std::string& queueId) override
+        {
+            return std::nullopt;
+        }
     };
 
     class SubTaskResultStorageImpl : public SubTaskResultStorage
@@ -123,6 +129,31 @@ namespace
             return true;
         };
 
+        bool GetAvailableTasks(
+            size_t maxTaskCount,
+            std::list<std::pair<std::string, SGProcessing::Task>>& tasks) override
+        {
+            // Only the task that GrabTask returns next is available
+            if (m_tasks.empty() || (maxTaskCount == 0))
+            {
+                return false;
+            }
+
+            tasks.emplace_back((boost::format("TASK_%d") % (m_tasks.size() - 1)).str(), m_tasks.back());
+            return true;
+        }
+
+        bool GrabTaskById(const std::string& taskKey, SGProcessing::Task& task) override
+        {
+            if (m_tasks.empty() || (taskKey != (boost::format("TASK_%d") % (m_tasks.size() - 1)).str()))
+            {
+                return false;
+            }
+
+            std::string grabbedTaskKey;
+            return GrabTask(grabbedTaskKey, task);
+        }
+
         bool CompleteTask(const std::string& taskKey, const SGProcessing::TaskResult& task) override
         {
             return false;
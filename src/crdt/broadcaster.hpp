@@ -3,6 +3,7 @@
 #define SUPERGENIUS_BROADCASTER_HPP
 
 #include <base/buffer.hpp>
+#include <functional>
 
 namespace sgns::crdt
 {
@@ -32,6 +33,13 @@ namespace sgns::crdt
     * @return buffer value or outcome::failure on error 
     */
     virtual outcome::result<base::Buffer> Next() = 0;
+
+    /**
+    * Sets {@param handler} that is called when a new payload is received and can be obtained by Next().
+    * The handler is called from a network thread and should not block. No calls are made
+    * after the handler is reset to nullptr.
+    */
+    virtual void SetNewBroadcastHandler(std::function<void()> handler) = 0;
   };
 }  // namespace sgns::crdt 
 
@@ -13,9 +13,12 @@
 #include <primitives/cid/cid.hpp>
 #include <ipfs_lite/ipld/ipld_node.hpp>
 #include <shared_mutex>
+#include <condition_variable>
 #include <future>
 #include <chrono>
 #include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace sgns::crdt
 {
@@ -65,21 +68,46 @@ namespace sgns::crdt
       * To satisfy datastore semantics, we need to remove elements from the current
       * batch if they were added.
       * @param aKey HierarchicalKey for delta
-      * @param aDelta pointer to delta to merge
+      * @param aDelta pointer to delta to merge, its tombstones are moved to the current delta
       */
       int UpdateDeltaWithRemove(const HierarchicalKey& aKey, const std::shared_ptr<Delta>& aDelta);
 
       /** UpdateDelta updates current delta by merging input delta
-      * @param aDelta pointer to Delta to merge
+      * @param aDelta pointer to Delta to merge, its elements and tombstones are moved to the current delta
       * @return the size of current delta just merged
       *
       */
       int UpdateDelta(const std::shared_ptr<Delta>& aDelta);
 
+      /** Moves elements and tombstones of a delta to the current delta.
+      * Elements of keys that are already in the current delta replace the previous ones.
+      * @param aDelta delta to merge
+      */
+      void MergeToCurrentDelta(Delta& aDelta);
+
+      /** Removes an element of the key from the current delta if it was added
+      * @param aKey key of element
+      */
+      void RemoveFromCurrentDelta(const std::string& aKey);
+
+      /** Returns serialized size of the current delta without walking it
+      */
+      int GetCurrentDeltaSize() const;
+
+      /** Drops the current delta and its indices
+      */
+      void ResetCurrentDelta();
+
       std::shared_ptr<CrdtDatastore> datastore_;
 
       std::mutex currentDeltaMutex_;
       std::shared_ptr<Delta> currentDelta_;
+      /** Positions of the current delta elements by key */
+      std::unordered_map<std::string, int> elementIndices_;
+      /** Key and id pairs of the current delta tombstones */
+      std::unordered_set<std::string> tombstoneIds_;
+      /** Serialized size of the current delta elements and tombstones */
+      size_t currentDeltaEntriesSize_ = 0;
   };
 
   /** @brief CrdtDatastore provides a replicated go-datastore (key-value store)
@@ -101,6 +129,7 @@ namespace sgns::crdt
     using Logger = base::Logger;
     using DataStore = storage::rocksdb;
     using QueryResult = DataStore::QueryResult;
+    using QueryCallback = CrdtSet::QueryCallback;
     using Delta = pb::Delta;
     using Element = pb::Element;
     using Node = ipfs_lite::ipld::IPLDNode;
@@ -132,6 +161,12 @@ namespace sgns::crdt
     */
     static std::shared_ptr<Delta> DeltaMerge(const std::shared_ptr<Delta>& aDelta1, const std::shared_ptr<Delta>& aDelta2);
 
+    /** Static function to get the options the datastore falls back to if it is constructed
+    * without options or with invalid ones, e.g. to set hooks and keep the fallback values
+    * @return pointer to new fallback options without hooks
+    */
+    static std::shared_ptr<CrdtOptions> FallbackOptions();
+
     /** Get the value of an element not tombstoned from the CRDT set by key
     * @param aKey Hierarchical key to get
     * @return value as a Buffer
@@ -144,6 +179,16 @@ namespace sgns::crdt
     */
     outcome::result<QueryResult> QueryKeyValues(const std::string& aPrefix);
 
+    /** Stream CRDT set key-value pairs by prefix, elements that are tombstoned are skipped
+    * @param aPrefix prefix to search, if empty string, return all
+    * @param aCallback receives matched key-value pairs, the query is stopped if it returns false
+    * @param aOffset number of matched pairs to skip
+    * @param aLimit maximum number of pairs to pass to the callback, 0 means no limit
+    * @return outcome::failure on error or success otherwise
+    */
+    outcome::result<void> QueryKeyValues(const std::string& aPrefix, const QueryCallback& aCallback,
+      size_t aOffset = 0, size_t aLimit = 0);
+
     /** Get key prefix used in set, e.g. /namespace/s/k/
     * @return key prefix
     */
@@ -208,6 +253,32 @@ namespace sgns::crdt
     */
     outcome::result<std::shared_ptr<Delta>> CreateDeltaToRemove(const std::string& key);
 
+    /** CompactDAG publishes a snapshot node that holds the current set state and links to the current heads.
+    * Replicas that process the snapshot do not walk the nodes below it, so new replicas fetch
+    * the snapshot and only the deltas above it.
+    * @param aRemoveCompactedNodes if true, nodes below the heads linked by the snapshot are marked as compacted
+    * and removed from the DAGSyncer, so walks of concurrent branches stop at them instead of fetching them.
+    * The heads themselves are kept so the snapshot can be fetched with its links
+    * @return snapshot CID or outcome::failure on error or if a DAG walk or a local update is in progress
+    */
+    outcome::result<CID> CompactDAG(bool aRemoveCompactedNodes = false);
+
+    /** Get height of the latest snapshot processed by the datastore
+    * @return snapshot height or 0 if there were no snapshots
+    */
+    uint64_t GetSnapshotHeight() const;
+
+    /** Get lookup statistics of the in-memory key filter and value cache of the set
+    * @return cache statistics
+    */
+    CrdtSet::CacheStatistics GetCacheStatistics() const;
+
+    /** Get number of nodes requested for fetching that are not taken by a DAG walk yet.
+    * Nodes fetched ahead of branches that stopped early are evicted when the last walk ends.
+    * @return number of requested nodes
+    */
+    size_t GetFetchRequestCount();
+
   protected:
 
     /** DAG jobs structure used by DAG worker threads to send new jobs
@@ -220,6 +291,17 @@ namespace sgns::crdt
       std::shared_ptr<Node> node_; /*> pointer to node */
     };
 
+    /** DAG node fetched by fetch workers, its delta is decoded once
+    */
+    struct FetchedNode
+    {
+      std::shared_ptr<Node> node_; /*> pointer to node */
+      std::shared_ptr<Delta> delta_; /*> pointer to delta */
+      uint64_t prefetchDepth_ = 0; /*> number of levels below the node to fetch ahead */
+      bool isFetched_ = false; /*> false while the node is being fetched */
+      bool hasFailed_ = false; /*> true if the node cannot be fetched or decoded */
+    };
+
     /** DAG worker structure to keep track of worker threads
     */
     struct DagWorker
@@ -229,21 +311,57 @@ namespace sgns::crdt
     };
 
     /** Worker thread to handle jobs broadcasted from the network.
-    * @param aCrdtDatastore pointer to CRDT datastore
+    * The thread sleeps until the broadcaster signals new broadcasts.
     */
     void HandleNext();
 
+    /** Signals HandleNext thread that new broadcasts can be obtained from the broadcaster
+    */
+    void OnNewBroadcast();
+
     /** Worker thread to rebroadcast heads
-    * @param aCrdtDatastore pointer to CRDT datastore
+    * The thread sleeps for the rebroadcast interval or until the datastore is closed.
     */
     void Rebroadcast();
 
     /** Worker thread to send jobs
-    * @param aCrdtDatastore pointer to CRDT datastore
+    * The thread sleeps until a job is added to the DAG worker job list.
     * @param dagWorker pointer to DAG worker structure
     */
     void SendJobWorker(std::shared_ptr<DagWorker> dagWorker);
 
+    /** Worker thread to fetch DAG nodes
+    * The thread sleeps until a node is added to the fetch queue.
+    * Links of a fetched node are requested before the node is passed to the DAG walk.
+    */
+    void FetchWorker();
+
+    /** Requests to fetch a node and to fetch nodes below it ahead of the DAG walk.
+    * A node that is fetched already or being fetched is not requested again,
+    * its prefetch depth is increased instead, so the lookahead moves with the walk.
+    * @param aCid CID of the node
+    * @param aPrefetchDepth number of levels below the node to fetch ahead
+    * @param aIsPrefetch true if the node is fetched ahead, such nodes are not requested if the cache is full
+    * @param aFetchGeneration fetch generation the prefetch was started in, ignored if the node is not fetched ahead
+    */
+    void RequestFetch(const CID& aCid, uint64_t aPrefetchDepth, bool aIsPrefetch, uint64_t aFetchGeneration);
+
+    /** Requests to fetch links of a fetched node that are not known yet
+    * @param aNode fetched node
+    * @param aDelta delta of the node, links of snapshots are not fetched
+    * @param aPrefetchDepth number of levels below the node to fetch ahead
+    * @param aFetchGeneration fetch generation the node was fetched in, links are not requested after eviction
+    */
+    void PrefetchLinks(const std::shared_ptr<Node>& aNode, const std::shared_ptr<Delta>& aDelta, uint64_t aPrefetchDepth,
+      uint64_t aFetchGeneration);
+
+    /** Waits until a requested node is fetched and takes it from the fetched nodes
+    * @param aCid CID of the node
+    * @param aPrefetchDepth number of levels below the node to fetch ahead if the node has to be requested again
+    * @return fetched node or outcome::failure on error
+    */
+    outcome::result<FetchedNode> TakeFetchedNode(const CID& aCid, uint64_t aPrefetchDepth);
+
     /** SendNewJobs calls getDeltas with the given children and sends each response to the workers.
     * @param aRootCID root CID
     * @param aRootPriority root priority
@@ -297,6 +415,22 @@ namespace sgns::crdt
     */
     outcome::result<std::vector<CID>> ProcessNode(const CID& aRoot, const uint64_t& aRootPrio, const std::shared_ptr<Delta>& aDelta, const std::shared_ptr<Node>& aNode);
 
+    /** ProcessLinks walks links of a merged node, updates heads and returns children to walk
+    * @param aRoot Root CID
+    * @param aRootPrio Root priority
+    * @param aDelta Delta of the node
+    * @param aNode node to process
+    * @return list of CIDs or outcome::failure on error
+    * \sa ProcessNode
+    */
+    outcome::result<std::vector<CID>> ProcessLinks(const CID& aRoot, const uint64_t& aRootPrio, const std::shared_ptr<Delta>& aDelta, const std::shared_ptr<Node>& aNode);
+
+    /** MergeDeltas merges deltas of a group of DAG jobs with one write batch
+    * @param aDagJobs DAG jobs to merge
+    * @return outcome::failure on error, in which case the jobs are processed one by one
+    */
+    outcome::result<void> MergeDeltas(const std::vector<DagJob>& aDagJobs);
+
     /** PutBlock add block node to DAGSyncer
     * @param aHeads list of CIDs to add to node as IPLD links
     * @param aHeight priority set to Delta
@@ -317,6 +451,43 @@ namespace sgns::crdt
     */
     void Close();
 
+    /** Creates a snapshot when the heads are at least compaction height interval above the latest snapshot
+    * \sa CrdtOptions::compactionHeightInterval
+    */
+    void CompactDAGIfNeeded();
+
+    /** Checks if DAG jobs are queued or processed, or nodes are queued for fetching.
+    * Heads do not cover all merged nodes until the walks finish.
+    * @return true if a DAG walk is in progress
+    */
+    bool IsDAGWalkInProgress();
+
+    /** Ends walk steps and evicts fetched nodes if no walk is in progress anymore
+    * @param aStepCount number of ended walk steps
+    */
+    void EndWalkSteps(size_t aStepCount);
+
+    /** Remembers CIDs as compacted, walks of DAG branches are stopped at them
+    * @param aCompactedHeads CIDs linked by the snapshot or nodes below them
+    * @param aSnapshotHeight snapshot height
+    * @return returns outcome::success on success or outcome::failure otherwise
+    */
+    outcome::result<void> MarkCompacted(const std::vector<CID>& aCompactedHeads, uint64_t aSnapshotHeight);
+
+    /** Checks if a CID is linked by a processed snapshot or was removed below a created one
+    * @param aCid CID to check
+    * @return true if the CID is compacted or outcome::failure on error
+    */
+    outcome::result<bool> IsCompacted(const CID& aCid);
+
+    /** Marks nodes below the compacted heads as compacted and removes them from the DAGSyncer, the heads are kept.
+    * Nodes are marked before they are removed, so branches that link below the heads are not walked into them
+    * @param aCompactedHeads CIDs linked by a snapshot
+    * @param aSnapshotHeight snapshot height
+    * @return number of removed nodes or outcome::failure if the nodes cannot be marked
+    */
+    outcome::result<size_t> RemoveCompactedNodes(const std::vector<CID>& aCompactedHeads, uint64_t aSnapshotHeight);
+
     /** SyncDatastore sync heads and set datastore
     * TODO: Need to see if needed, not fully implemented
     * @return returns outcome::success on success or outcome::failure otherwise
@@ -346,29 +517,70 @@ namespace sgns::crdt
     std::shared_ptr<CrdtSet> set_ = nullptr;
     std::shared_ptr<CrdtHeads> heads_ = nullptr;
 
+    /** Heads received from other replicas with the rebroadcast generation when they were seen.
+    * Heads seen in the current generation are not rebroadcast, the generation is advanced
+    * by each rebroadcast instead of clearing the set.
+    */
     std::shared_mutex seenHeadsMutex_;
-    std::vector<CID> seenHeads_;
+    std::unordered_map<CID, uint64_t, CIDHash> seenHeads_;
+    uint64_t seenHeadsGeneration_ = 0;
+
+    /** Copy of heads used by the rebroadcast thread, refreshed when the heads version changes */
+    std::vector<CID> rebroadcastHeads_;
+    uint64_t rebroadcastHeadsVersion_ = 0;
+    bool hasRebroadcastHeads_ = false;
 
     std::shared_ptr<Broadcaster> broadcaster_ = nullptr;
     std::shared_ptr<DAGSyncer> dagSyncer_ = nullptr;
     Logger logger_;
 
-    static const std::chrono::milliseconds threadSleepTimeInMilliseconds_;
+    static const std::chrono::milliseconds defaultRebroadcastInterval_;
     static const std::string headsNamespace_; // "h"
     static const std::string setsNamespace_; // "s"
+    static const std::string compactedNamespace_; // "c" -> compacted CIDs /namespace/c/<cid>
 
     PutHookPtr putHookFunc_ = nullptr;
     DeleteHookPtr deleteHookFunc_ = nullptr;
 
     std::future<void> handleNextFuture_;
     std::atomic<bool> handleNextThreadRunning_ = false;
+    std::mutex handleNextMutex_;
+    std::condition_variable handleNextCondition_;
+    bool hasNewBroadcasts_ = true; /*> Guarded by handleNextMutex_ */
 
     std::future<void> rebroadcastFuture_;
     std::atomic<bool> rebroadcastThreadRunning_ = false;
+    std::mutex rebroadcastMutex_;
+    std::condition_variable rebroadcastCondition_;
+
+    /** Walk steps and local updates hold it shared, compaction holds it exclusively */
+    std::shared_mutex walkMutex_;
+    std::atomic<uint64_t> snapshotHeight_ = 0;
+
+    /** Nodes requested by the DAG walk and fetched ahead of it, they are removed when the walk takes them.
+    * Nodes that are not taken because their branch stopped early are evicted when the last walk ends,
+    * the fetch generation is increased then so in-flight prefetches of evicted nodes are dropped.
+    */
+    std::vector<std::future<void>> fetchWorkerFutures_;
+    std::mutex fetchMutex_;
+    std::condition_variable fetchQueueCondition_;
+    std::condition_variable fetchedCondition_;
+    std::unordered_map<CID, FetchedNode, CIDHash> fetchedNodes_; /*> Guarded by fetchMutex_ */
+    std::queue<CID> fetchQueue_; /*> Guarded by fetchMutex_ */
+    bool fetchWorkersRunning_ = false; /*> Guarded by fetchMutex_ */
+    uint64_t fetchGeneration_ = 0; /*> Guarded by fetchMutex_ */
+    uint64_t prefetchDepth_ = 0;
+    size_t maxPrefetchedNodes_ = 0;
+
+    size_t mergeBatchSize_ = 1;
+    bool syncMergeBatches_ = false;
 
     std::vector<std::shared_ptr<DagWorker>> dagWorkers_;
     std::shared_mutex dagWorkerMutex_;
     std::queue<DagJob> dagWorkerJobList;
+    size_t activeWalkSteps_ = 0; /*> Walk steps taken from or adding to dagWorkerJobList, guarded by dagWorkerJobListMutex_ */
+    std::mutex dagWorkerJobListMutex_;
+    std::condition_variable dagWorkerJobListCondition_;
   };
 
 } // namespace sgns::crdt
@@ -5,9 +5,23 @@
 #include <storage/rocksdb/rocksdb.hpp>
 #include <crdt/hierarchical_key.hpp>
 #include <primitives/cid/cid.hpp>
+#include <boost/functional/hash.hpp>
+#include <unordered_map>
 
 namespace sgns::crdt
 {
+  /** @brief Hash function to keep CIDs in unordered containers.
+  * The multihash digest is already uniformly distributed, so it is hashed as is.
+  */
+  struct CIDHash
+  {
+    size_t operator()(const CID& aCid) const
+    {
+      auto digest = aCid.content_address.getHash();
+      return boost::hash_range(digest.begin(), digest.end());
+    }
+  };
+
   /** @brief CrdtHeads manages the current Merkle-CRDT heads.
   */
   class CrdtHeads
@@ -94,6 +108,12 @@ namespace sgns::crdt
     */
     outcome::result<void> GetList(std::vector<CID>& aHeads, uint64_t& aMaxHeight);
 
+    /** Returns a version of the heads set that is changed by every Add and Replace,
+    * so a caller can keep a copy of the list and refresh it only when the heads change.
+    * @return heads set version
+    */
+    uint64_t GetVersion();
+
   protected:
 
     /** Write data to datastore in batch mode
@@ -120,8 +140,23 @@ namespace sgns::crdt
 
     CrdtHeads() = default;
 
+    /** Sets a head height in the cache, the caller should hold the mutex
+    * @param aCid Content identifier of head
+    * @param aHeight height of head
+    */
+    void SetCachedHead(const CID& aCid, uint64_t aHeight);
+
+    /** Removes a head from the cache, the caller should hold the mutex
+    * @param aCid Content identifier of head
+    */
+    void RemoveCachedHead(const CID& aCid);
+
     std::shared_ptr<DataStore> dataStore_;
-    std::map<CID, uint64_t> cache_;
+    std::unordered_map<CID, uint64_t, CIDHash> cache_;
+    /** Maximum height of cached heads, it is recalculated lazily when the highest head is removed */
+    uint64_t maxHeight_ = 0;
+    bool isMaxHeightOutdated_ = false;
+    uint64_t version_ = 0;
     HierarchicalKey namespaceKey_;
     std::recursive_mutex mutex_;
 
@@ -31,6 +31,45 @@ namespace sgns::crdt
     /** NumWorkers specifies the number of workers ready to walk DAGs */
     int numWorkers = 0;
 
+    /** NumFetchWorkers specifies the number of workers fetching DAG nodes concurrently */
+    int numFetchWorkers = 0;
+
+    /** PrefetchDepth specifies how many DAG levels below the walked nodes are fetched ahead.
+    * Set to 0 to fetch only the nodes that are walked.
+    */
+    int prefetchDepth = 0;
+
+    /** MergeBatchSize specifies how many pending deltas a DAG worker merges with one write batch */
+    int mergeBatchSize = 0;
+
+    /** SyncMergeBatches specifies if write batches of merged deltas are synced to disk on commit */
+    bool syncMergeBatches = false;
+
+    /** KeyFilterBitCount specifies the size in bits of the in-memory filter of added keys
+    * that answers lookups of missing keys without reading the datastore. Set to 0 to disable.
+    * The filter is filled by a scan of the stored keys when the datastore is created and is not resized,
+    * so it stays useful up to about KeyFilterBitCount / 16 keys, more keys saturate it and
+    * missing keys are read from the datastore again.
+    */
+    uint64_t keyFilterBitCount = 0;
+
+    /** ValueCacheSize specifies how many values of live keys are kept in the LRU cache.
+    * Set to 0 to disable.
+    */
+    uint64_t valueCacheSize = 0;
+
+    /** CompactionHeightInterval specifies how many DAG heights are added between
+    * snapshots of the set state. The interval is checked on each rebroadcast.
+    * Set to 0 to disable automatic compaction.
+    */
+    uint64_t compactionHeightInterval = 0;
+
+    /** RemoveCompactedNodes specifies if DAG nodes below a created snapshot are removed
+    * from the DAGSyncer. The removed nodes are marked as compacted, so walks of concurrent branches
+    * on this replica stop at them. Replicas that lag behind the snapshot cannot fetch them afterwards.
+    */
+    bool removeCompactedNodes = false;
+
     /** The PutHook function is triggered whenever an element
     * is successfully added to the datastore (either by a local
     * or remote update), and only when that addition is considered the
@@ -55,6 +94,9 @@ namespace sgns::crdt
       LoggerUndefinied, // the Logger is undefined
       BadNumberOfNumWorkers, // bad number of NumWorkers
       InvalidDAGSyncerTimeout, // invalid DAGSyncerTimeout
+      BadNumberOfFetchWorkers, // bad number of NumFetchWorkers
+      InvalidPrefetchDepth, // invalid PrefetchDepth
+      BadMergeBatchSize, // bad MergeBatchSize
     };
 
     static std::shared_ptr<CrdtOptions> DefaultOptions()
@@ -64,6 +106,12 @@ namespace sgns::crdt
       options->rebroadcastIntervalMilliseconds = 10000; // 10s
       options->dagSyncerTimeoutSec = 300; // 5 mins
       options->numWorkers = 5;
+      options->numFetchWorkers = 8;
+      options->prefetchDepth = 4;
+      options->mergeBatchSize = 64;
+      // The filter and the cache are opt-in, the filter scans all stored keys when the datastore is created
+      options->keyFilterBitCount = 0;
+      options->valueCacheSize = 0;
       return options;
     }
 
@@ -82,6 +130,18 @@ namespace sgns::crdt
       {
         return VerifyErrorCode::InvalidDAGSyncerTimeout;
       }
+      if (numFetchWorkers <= 0)
+      {
+        return VerifyErrorCode::BadNumberOfFetchWorkers;
+      }
+      if (prefetchDepth < 0)
+      {
+        return VerifyErrorCode::InvalidPrefetchDepth;
+      }
+      if (mergeBatchSize <= 0)
+      {
+        return VerifyErrorCode::BadMergeBatchSize;
+      }
       return VerifyErrorCode::Success;
     }
 
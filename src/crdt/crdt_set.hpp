@@ -2,6 +2,9 @@
 #define SUPERGENIUS_CRDT_SET_HPP
 
 #include <mutex>
+#include <list>
+#include <optional>
+#include <unordered_map>
 #include <storage/rocksdb/rocksdb.hpp>
 #include <crdt/hierarchical_key.hpp>
 #include <crdt/proto/delta.pb.h>
@@ -24,6 +27,11 @@ namespace sgns::crdt
     using DataStore = storage::rocksdb;
     using QueryResult = DataStore::QueryResult;
 
+    /** Callback that receives query results one by one in the key order
+    * @return true to continue the query, false to stop it
+    */
+    using QueryCallback = std::function<bool(const Buffer& k, const Buffer& v)>;
+
     enum class QuerySuffix
     {
       QUERY_ALL,
@@ -42,6 +50,19 @@ namespace sgns::crdt
     */
     using DeleteHookPtr = std::function<void(const std::string& k)>;
 
+    /** Lookup statistics of the in-memory key filter and value cache
+    */
+    struct CacheStatistics
+    {
+      size_t lookupCount = 0; /*> number of key lookups */
+      size_t filterNegativeCount = 0; /*> lookups of keys that were never added answered by the key filter */
+      size_t cacheHitCount = 0; /*> lookups answered by the value cache */
+
+      /** Returns share of lookups that did not read the datastore
+      */
+      double GetHitRate() const;
+    };
+
     /** Constructor
     * @param aDatastore Pointer to datastore
     * @param aNamespace Namespce key (e.g "/namespace")
@@ -100,6 +121,14 @@ namespace sgns::crdt
     */
     outcome::result<std::shared_ptr<Delta>> CreateDeltaToRemove(const std::string& aKey);
 
+    /** Returns a snapshot delta that materializes the current set state.
+    * Elements that are not tombstoned keep their IDs and get values and priorities of their keys,
+    * as values are read from the keys namespace while any element of a key is not tombstoned.
+    * all tombstones are kept so replicas with a partial history remove the same elements.
+    * @return pointer to snapshot delta or outcome::failure on error
+    */
+    outcome::result<std::shared_ptr<Delta>> CreateSnapshotDelta();
+
     /** Get the value of an element from the CRDT set /namespace/k/<key>/v
     * @param aKey Key name
     * @return buffer value or outcome::failure on error
@@ -114,6 +143,19 @@ namespace sgns::crdt
     */
     outcome::result<QueryResult> QueryElements(const std::string& aPrefix, const QuerySuffix& aSuffix = QuerySuffix::QUERY_ALL);
 
+    /** Streams datastore key-value pairs by prefix in one pass over the keys namespace.
+    * Elements and tombstones are checked with cursors that are opened once per query.
+    * @param aPrefix prefix to search, if empty string, return all
+    * @param aSuffix suffix to search
+    * @param aCallback receives matched key-value pairs, the query is stopped if it returns false
+    * @param aOffset number of matched pairs to skip
+    * @param aLimit maximum number of pairs to pass to the callback, 0 means no limit
+    * @return outcome::failure on error or success otherwise
+    * \sa QuerySuffix
+    */
+    outcome::result<void> QueryElements(const std::string& aPrefix, const QuerySuffix& aSuffix,
+      const QueryCallback& aCallback, size_t aOffset = 0, size_t aLimit = 0);
+
     // TODO: Need to implement query with prefix from datastore
     //func (s *set) Elements(q query.Query) (query.Results, error) {
 
@@ -124,6 +166,20 @@ namespace sgns::crdt
     */
     outcome::result<bool> IsValueInSet(const std::string& aKey);
 
+    /** Enables the in-memory filter of added keys and the LRU cache of live values.
+    * The filter answers lookups of keys that were never added without reading the datastore,
+    * it is filled with keys stored in the datastore. Both are updated by merges of elements and tombstones.
+    * Should be called before elements are merged concurrently.
+    * @param aKeyFilterBitCount filter size in bits, 0 disables the filter
+    * @param aValueCacheSize maximum number of cached values, 0 disables the cache
+    * @return outcome::failure on error
+    */
+    outcome::result<void> EnableCache(size_t aKeyFilterBitCount, size_t aValueCacheSize);
+
+    /** Returns lookup statistics of the key filter and value cache
+    */
+    CacheStatistics GetCacheStatistics() const;
+
     /** Returns in we have a key/block combinations in the
     * elements set that has not been tombstoned.
     * @param aKey key name
@@ -186,6 +242,15 @@ namespace sgns::crdt
     */
     outcome::result<void> SetPriority(const std::string& aKey, const uint64_t& aPriority);
 
+    /** Set priority for a key and put into datastore batch
+    * @param aDataStore datastore batch
+    * @param aKey key string
+    * @param aPriority priority to save
+    * @return outcome::success on success or outcome::failure otherwise
+    */
+    outcome::result<void> SetPriority(const std::unique_ptr<storage::BufferBatch>& aDataStore, const std::string& aKey,
+      const uint64_t& aPriority);
+
     /** Sets a value to datastore if priority is higher. When equal, it sets if the
     * value is lexicographically higher than the current value.
     * @param aKey key string
@@ -230,13 +295,33 @@ namespace sgns::crdt
     */
     outcome::result<void> PutTombs(const std::vector<Element>& aTombs);
 
-    /** Merge elems and tombs from delta into datastore
+    /** PutSnapshotElems adds snapshot elements to the "elems" set with their own IDs and priorities.
+    * Elements that are already known or tombstoned are skipped.
+    * @param aElems list of snapshot elems to put into datastore
+    * @return outcome::success on success or outcome::failure otherwise
+    */
+    outcome::result<void> PutSnapshotElems(const std::vector<Element>& aElems);
+
+    /** Merge elems and tombs from delta into datastore.
+    * Only elems and tombs that are new to the datastore are merged from snapshot deltas.
     * @param aDelta delta with elems and tombs to save into datastore
     * @param aID tomb key ID
     * @return outcome::success on success or outcome::failure otherwise
     */
     outcome::result<void> Merge(const std::shared_ptr<CrdtSet::Delta>& aDelta, const std::string& aID);
 
+    /** Merge elems and tombs from a group of deltas into datastore with one write batch.
+    * Priorities and values set by the group are kept in memory, so a key repeated in the group
+    * is read from the datastore once. Hooks are triggered after the batch is committed.
+    * Snapshot deltas are merged one by one before the group.
+    * @param aDeltas deltas with their tomb key IDs in the merge order
+    * @param aSync true to sync the batch to disk on commit
+    * @return outcome::success on success or outcome::failure otherwise, in which case
+    * no delta of the group except snapshots is merged
+    */
+    outcome::result<void> MergeDeltas(const std::vector<std::pair<std::shared_ptr<Delta>, std::string>>& aDeltas,
+      bool aSync = false);
+
     /** Check if key is tombstoned with tomb ID and found in datastore
     * @param aKey key string
     * @param aID tomb key ID
@@ -266,12 +351,70 @@ namespace sgns::crdt
   private:
     CrdtSet() = default;
 
+    /** Checks if a key has an element that is not tombstoned using cursors opened by the caller.
+    * The cursors are only repositioned, so one pair of them serves all keys of a query.
+    * Each cursor should cover the key range of its namespace for the key.
+    * @param aKey key name
+    * @param aElemsCursor cursor over the elements namespace
+    * @param aTombsCursor cursor over the tombstones namespace
+    * @return true if the key has not been tombstoned, false otherwise or outcome::failure on error
+    */
+    outcome::result<bool> InElemsNotTombstoned(const std::string& aKey,
+      DataStore::Cursor& aElemsCursor, DataStore::Cursor& aTombsCursor);
+
+    /** Result of a key lookup in the key filter and value cache
+    */
+    struct CacheLookup
+    {
+      bool isFilteredOut_ = false; /*> true if the key was never added */
+      std::optional<Buffer> value_; /*> cached value of the key */
+      uint64_t cacheGeneration_ = 0; /*> generation to pass to CacheValue after reading the datastore */
+    };
+
+    /** Looks a key up in the key filter and value cache and counts the lookup
+    * @param aKey key name
+    * @return lookup result
+    */
+    CacheLookup LookupCache(const std::string& aKey);
+
+    /** Caches a live value read from the datastore unless keys were invalidated since the lookup
+    * @param aKey key name
+    * @param aValue value of the key
+    * @param aCacheGeneration generation returned by LookupCache before the datastore was read
+    */
+    void CacheValue(const std::string& aKey, const Buffer& aValue, uint64_t aCacheGeneration);
+
+    /** Adds a key to the key filter before its value is written
+    * @param aKey key name
+    */
+    void AddToKeyFilter(const std::string& aKey);
+
+    /** Removes cached values of keys after their elements or tombstones are written
+    * @param aKeys key names
+    */
+    void InvalidateCachedValues(const std::vector<std::string>& aKeys);
+
+    /** Returns bit positions of a key in the key filter
+    * @param aKey key name
+    * @param aKeyFilterBitCount filter size in bits
+    * @return bit positions
+    */
+    static std::vector<size_t> GetKeyFilterBits(const std::string& aKey, size_t aKeyFilterBitCount);
+
     std::shared_ptr<DataStore> dataStore_ = nullptr;
     HierarchicalKey namespaceKey_;
     std::mutex mutex_;
     PutHookPtr putHookFunc_ = nullptr;
     DeleteHookPtr deleteHookFunc_ = nullptr;
 
+    mutable std::mutex cacheMutex_;
+    std::vector<uint64_t> keyFilterBits_; /*> empty if the filter is disabled */
+    size_t valueCacheSize_ = 0;
+    std::list<std::pair<std::string, Buffer>> cachedValues_; /*> most recently used first */
+    std::unordered_map<std::string, std::list<std::pair<std::string, Buffer>>::iterator> cachedValueIndex_;
+    uint64_t cacheGeneration_ = 0; /*> incremented by each invalidation */
+    CacheStatistics cacheStatistics_;
+
     static const std::string elemsNamespace_; // "s" -> elements namespace /set/s/<key>/<block>
     static const std::string tombsNamespace_; // "t" -> tombstones namespace /set/t/<key>/<block>
     static const std::string keysNamespace_; // "k" -> keys namespace /set/k/<key>/{v,p}
@@ -41,11 +41,44 @@ GlobalDB::GlobalDB(
     , m_databasePath(std::move(databasePath))
     , m_dagSyncPort(dagSyncPort)
     , m_broadcastChannel(std::move(broadcastChannel))
+    , m_changeFeed(std::make_shared<KeyChangeFeed>(m_context))
 {
 }
 
 outcome::result<void> GlobalDB::Init(std::shared_ptr<CrdtOptions> crdtOptions)
 {
+    // Hooks of the options are chained with the change feed of watch subscriptions.
+    // The datastore ignores invalid options with their hooks, so its fallback options are used instead
+    auto options = CrdtDatastore::FallbackOptions();
+    if (crdtOptions && !crdtOptions->Verify().has_failure()
+        && crdtOptions->Verify().value() == CrdtOptions::VerifyErrorCode::Success)
+    {
+        options = std::make_shared<CrdtOptions>(*crdtOptions);
+    }
+    std::weak_ptr<KeyChangeFeed> changeFeed = m_changeFeed;
+    options->putHookFunc = [changeFeed, putHook = options->putHookFunc](const std::string& key, const Buffer& value)
+    {
+        if (putHook)
+        {
+            putHook(key, value);
+        }
+        if (auto feed = changeFeed.lock())
+        {
+            feed->OnKeyChanged(key, &value);
+        }
+    };
+    options->deleteHookFunc = [changeFeed, deleteHook = options->deleteHookFunc](const std::string& key)
+    {
+        if (deleteHook)
+        {
+            deleteHook(key);
+        }
+        if (auto feed = changeFeed.lock())
+        {
+            feed->OnKeyChanged(key, nullptr);
+        }
+    };
+
     std::shared_ptr<RocksDB> dataStore = nullptr;
     auto databasePathAbsolute = boost::filesystem::absolute(m_databasePath).string();
 
@@ -111,7 +144,7 @@ outcome::result<void> GlobalDB::Init(std::shared_ptr<CrdtOptions> crdtOptions)
     broadcaster->SetLogger(m_logger);
 
     m_crdtDatastore = std::make_shared<CrdtDatastore>(
-        dataStore, HierarchicalKey("crdt"), dagSyncer, broadcaster, crdtOptions);
+        dataStore, HierarchicalKey("crdt"), dagSyncer, broadcaster, options);
     if (m_crdtDatastore == nullptr)
     {
         m_logger->error("Unable to create CRDT datastore");
@@ -183,6 +216,18 @@ outcome::result<GlobalDB::QueryResult> GlobalDB::QueryKeyValues(const std::strin
     return m_crdtDatastore->QueryKeyValues(keyPrefix);
 }
 
+outcome::result<void> GlobalDB::QueryKeyValues(const std::string& keyPrefix, const QueryCallback& callback,
+    size_t offset, size_t limit)
+{
+    if (!m_crdtDatastore)
+    {
+        m_logger->error("CRDT datastore is not initialized yet");
+        return outcome::failure(boost::system::error_code{});
+    }
+
+    return m_crdtDatastore->QueryKeyValues(keyPrefix, callback, offset, limit);
+}
+
 outcome::result<std::string> GlobalDB::KeyToString(const Buffer& key) const
 {
     // @todo cache the prefix and suffix
@@ -220,4 +265,15 @@ std::shared_ptr<CrdtDataStoreTransaction> GlobalDB::BeginTransaction()
     return m_crdtDatastore->BeginTransaction();
 }
 
+uint64_t GlobalDB::Watch(const std::string& keyPrefix, WatchHandler handler,
+    uint64_t resumeToken, size_t maxPendingChanges)
+{
+    return m_changeFeed->Watch(keyPrefix, std::move(handler), resumeToken, maxPendingChanges);
+}
+
+void GlobalDB::Unwatch(uint64_t watchId)
+{
+    m_changeFeed->Unwatch(watchId);
+}
+
 }
\ No newline at end of file
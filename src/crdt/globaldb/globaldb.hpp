@@ -6,6 +6,7 @@
 
 #include <ipfs_pubsub/gossip_pubsub_topic.hpp>
 #include <crdt/crdt_datastore.hpp>
+#include <crdt/globaldb/key_change_feed.hpp>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/filesystem/path.hpp>
@@ -17,6 +18,9 @@ class GlobalDB
 public:
     using Buffer = base::Buffer;
     using QueryResult = CrdtDatastore::QueryResult;
+    using QueryCallback = CrdtDatastore::QueryCallback;
+    using KeyChange = KeyChangeFeed::KeyChange;
+    using WatchHandler = KeyChangeFeed::WatchHandler;
 
     GlobalDB(
         std::shared_ptr<boost::asio::io_context> context,
@@ -51,6 +55,16 @@ public:
     */
     outcome::result<QueryResult> QueryKeyValues(const std::string& keyPrefix);
 
+    /** Streams CRDT key-value pairs by prefix without collecting them. Elements that were tombstoned are skipped
+    * @param prefix - keys prefix to match. An empty prefix matches any key.
+    * @param callback - receives matched key-value pairs in the key order, the query is stopped if it returns false
+    * @param offset - number of matched pairs to skip
+    * @param limit - maximum number of pairs to pass to the callback, 0 means no limit
+    * @return outcome::failure on error or success otherwise
+    */
+    outcome::result<void> QueryKeyValues(const std::string& keyPrefix, const QueryCallback& callback,
+        size_t offset = 0, size_t limit = 0);
+
     /** Converts a unique key part to a string representation
     * @param key - binary key to convert
     * @return string represenation of a unique key part
@@ -62,12 +76,30 @@ public:
     */
     std::shared_ptr<CrdtDataStoreTransaction> BeginTransaction();
 
+    /** Subscribes to local and remote changes of keys that start with a prefix instead of polling QueryKeyValues.
+    * Changes are delivered by the asio context in batches, a subscriber that does not keep up
+    * receives a truncated batch and should query current values.
+    * @param keyPrefix - keys prefix to match as in QueryKeyValues. An empty prefix matches any key.
+    * @param handler - receives batches of changes
+    * @param resumeToken - token of the last processed change to resume after it, 0 to receive new changes only
+    * @param maxPendingChanges - maximum number of changes waiting for delivery
+    * @return subscription id
+    */
+    uint64_t Watch(const std::string& keyPrefix, WatchHandler handler,
+        uint64_t resumeToken = 0, size_t maxPendingChanges = 1024);
+
+    /** Cancels a subscription
+    * @param watchId - subscription id returned by Watch
+    */
+    void Unwatch(uint64_t watchId);
+
 private:
     std::shared_ptr<boost::asio::io_context> m_context;
     std::string m_databasePath;
     int m_dagSyncPort;
     std::shared_ptr<sgns::ipfs_pubsub::GossipPubSubTopic> m_broadcastChannel;
 
+    std::shared_ptr<KeyChangeFeed> m_changeFeed;
     std::shared_ptr<CrdtDatastore> m_crdtDatastore;
 
     sgns::base::Logger m_logger = sgns::base::createLogger("GlobalDB");
@@ -0,0 +1,159 @@
+#include <crdt/globaldb/key_change_feed.hpp>
+#include <crdt/hierarchical_key.hpp>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace sgns::crdt
+{
+KeyChangeFeed::KeyChangeFeed(std::shared_ptr<boost::asio::io_context> context, size_t journalSize)
+    : m_context(std::move(context))
+    , m_journalSize(journalSize)
+    , m_lastWatchId(0)
+    , m_lastResumeToken(0)
+{
+}
+
+uint64_t KeyChangeFeed::Watch(const std::string& keyPrefix, WatchHandler handler,
+    uint64_t resumeToken, size_t maxPendingChanges)
+{
+    auto subscription = std::make_shared<WatchSubscription>();
+    // Keys are matched as by prefix queries, i.e. "tasks" matches "/tasks/1" and "/tasks2"
+    subscription->keyPrefix = HierarchicalKey(keyPrefix).GetKey();
+    subscription->handler = std::move(handler);
+    subscription->maxPendingChanges = std::max<size_t>(maxPendingChanges, 1);
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto watchId = ++m_lastWatchId;
+    m_subscriptions[watchId] = subscription;
+
+    if (resumeToken > 0)
+    {
+        // Changes that left the journal or were made before a restart cannot be replayed
+        auto firstJournaledToken = m_journal.empty() ? m_lastResumeToken + 1 : m_journal.front().resumeToken;
+        if ((resumeToken + 1 < firstJournaledToken) || (resumeToken > m_lastResumeToken))
+        {
+            subscription->isTruncated = true;
+            ScheduleDelivery(subscription);
+        }
+
+        for (const auto& change : m_journal)
+        {
+            if ((change.resumeToken > resumeToken) && boost::algorithm::starts_with(change.key, subscription->keyPrefix))
+            {
+                QueueChange(subscription, change);
+            }
+        }
+    }
+    return watchId;
+}
+
+void KeyChangeFeed::Unwatch(uint64_t watchId)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto it = m_subscriptions.find(watchId);
+    if (it != m_subscriptions.end())
+    {
+        it->second->isActive = false;
+        it->second->pendingChanges.clear();
+        m_subscriptions.erase(it);
+    }
+}
+
+void KeyChangeFeed::OnKeyChanged(const std::string& key, const Buffer* value)
+{
+    KeyChange change;
+    change.key = HierarchicalKey(key).GetKey();
+    change.isRemoved = (value == nullptr);
+    if (value != nullptr)
+    {
+        change.value = *value;
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    change.resumeToken = ++m_lastResumeToken;
+    if (m_journalSize > 0)
+    {
+        m_journal.push_back(change);
+        if (m_journal.size() > m_journalSize)
+        {
+            m_journal.pop_front();
+        }
+    }
+
+    for (const auto& [watchId, subscription] : m_subscriptions)
+    {
+        if (boost::algorithm::starts_with(change.key, subscription->keyPrefix))
+        {
+            QueueChange(subscription, change);
+        }
+    }
+}
+
+uint64_t KeyChangeFeed::GetLastResumeToken() const
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_lastResumeToken;
+}
+
+void KeyChangeFeed::QueueChange(const std::shared_ptr<WatchSubscription>& subscription, const KeyChange& change)
+{
+    subscription->pendingChanges.push_back(change);
+    if (subscription->pendingChanges.size() > subscription->maxPendingChanges)
+    {
+        // The subscriber does not keep up with producers, producers are not blocked
+        subscription->pendingChanges.pop_front();
+        subscription->isTruncated = true;
+    }
+    ScheduleDelivery(subscription);
+}
+
+void KeyChangeFeed::ScheduleDelivery(const std::shared_ptr<WatchSubscription>& subscription)
+{
+    if (subscription->isDeliveryScheduled)
+    {
+        return;
+    }
+
+    subscription->isDeliveryScheduled = true;
+    // The feed is kept alive until scheduled deliveries are done
+    boost::asio::post(*m_context, [self = shared_from_this(), subscription]()
+        {
+            self->DeliverChanges(subscription);
+        });
+}
+
+void KeyChangeFeed::DeliverChanges(const std::shared_ptr<WatchSubscription>& subscription)
+{
+    std::vector<KeyChange> changes;
+    bool isTruncated = false;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (!subscription->isActive)
+        {
+            return;
+        }
+
+        changes.assign(
+            std::make_move_iterator(subscription->pendingChanges.begin()),
+            std::make_move_iterator(subscription->pendingChanges.end()));
+        subscription->pendingChanges.clear();
+        isTruncated = subscription->isTruncated;
+        subscription->isTruncated = false;
+    }
+
+    // The handler is called without the lock, so it can query the database or unsubscribe.
+    // Changes queued meanwhile wait for the next delivery, so the handler is not called concurrently
+    subscription->handler(changes, isTruncated);
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    subscription->isDeliveryScheduled = false;
+    if (subscription->isActive && (!subscription->pendingChanges.empty() || subscription->isTruncated))
+    {
+        ScheduleDelivery(subscription);
+    }
+}
+}
@@ -0,0 +1,113 @@
+#ifndef SUPERGENIUS_CRDT_KEY_CHANGE_FEED_HPP
+#define SUPERGENIUS_CRDT_KEY_CHANGE_FEED_HPP
+
+#include <base/buffer.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sgns::crdt
+{
+/** Feed of key changes made by local and remote updates.
+* Changes are reported by CRDT hooks and delivered to prefix-scoped subscriptions by an asio context.
+* Recent changes are kept in a journal to resume subscriptions after a known change.
+*/
+class KeyChangeFeed : public std::enable_shared_from_this<KeyChangeFeed>
+{
+public:
+    using Buffer = base::Buffer;
+
+    /** Change of a key
+    */
+    struct KeyChange
+    {
+        uint64_t resumeToken = 0; /*> sequence number of the change, pass it to Watch to resume after the change */
+        std::string key; /*> changed key */
+        Buffer value; /*> new value, empty if the key was removed */
+        bool isRemoved = false; /*> true if the key was removed */
+    };
+
+    /** Receives changes of watched keys in the change order
+    * @param changes - batch of changes
+    * @param isTruncated - true if earlier changes were dropped because the subscriber did not keep up
+    * or its resume token is too old. Current values should be queried then.
+    */
+    using WatchHandler = std::function<void(const std::vector<KeyChange>& changes, bool isTruncated)>;
+
+    /** Creates a feed
+    * @param context - asio context that calls subscription handlers
+    * @param journalSize - number of recent changes kept to resume subscriptions
+    */
+    KeyChangeFeed(std::shared_ptr<boost::asio::io_context> context, size_t journalSize = 4096);
+
+    /** Subscribes to changes of keys that start with a prefix.
+    * Changes are delivered one batch at a time, so a slow handler receives larger batches.
+    * Pending changes above the limit are dropped and the next batch is marked truncated.
+    * @param keyPrefix - keys prefix to match. An empty prefix matches any key.
+    * @param handler - receives batches of changes
+    * @param resumeToken - token of the last processed change to deliver journaled changes after it,
+    * 0 to receive new changes only
+    * @param maxPendingChanges - maximum number of changes waiting for delivery
+    * @return subscription id
+    */
+    uint64_t Watch(const std::string& keyPrefix, WatchHandler handler,
+        uint64_t resumeToken = 0, size_t maxPendingChanges = 1024);
+
+    /** Cancels a subscription. A batch that is being delivered is still passed to the handler
+    * @param watchId - subscription id returned by Watch
+    */
+    void Unwatch(uint64_t watchId);
+
+    /** Records a change and queues it to matching subscriptions
+    * @param key - changed key
+    * @param value - new value, nullptr if the key was removed
+    */
+    void OnKeyChanged(const std::string& key, const Buffer* value);
+
+    /** Returns the token of the last recorded change
+    */
+    uint64_t GetLastResumeToken() const;
+
+private:
+    struct WatchSubscription
+    {
+        std::string keyPrefix;
+        WatchHandler handler;
+        size_t maxPendingChanges = 0;
+        std::deque<KeyChange> pendingChanges;
+        bool isTruncated = false;
+        bool isDeliveryScheduled = false;
+        bool isActive = true;
+    };
+
+    /** Queues a change to a subscription and schedules a delivery. m_mutex should be locked
+    */
+    void QueueChange(const std::shared_ptr<WatchSubscription>& subscription, const KeyChange& change);
+
+    /** Schedules a delivery of pending changes if it is not scheduled yet. m_mutex should be locked
+    */
+    void ScheduleDelivery(const std::shared_ptr<WatchSubscription>& subscription);
+
+    /** Delivers pending changes of a subscription and schedules the next delivery if changes are left
+    */
+    void DeliverChanges(const std::shared_ptr<WatchSubscription>& subscription);
+
+    std::shared_ptr<boost::asio::io_context> m_context;
+    size_t m_journalSize;
+
+    mutable std::mutex m_mutex;
+    uint64_t m_lastWatchId;
+    uint64_t m_lastResumeToken;
+    std::map<uint64_t, std::shared_ptr<WatchSubscription>> m_subscriptions;
+    std::deque<KeyChange> m_journal;
+};
+}
+
+#endif // SUPERGENIUS_CRDT_KEY_CHANGE_FEED_HPP
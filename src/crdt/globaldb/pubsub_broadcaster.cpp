@@ -17,6 +17,10 @@ PubSubBroadcaster::PubSubBroadcaster(const std::shared_ptr<GossipPubSubTopic>& p
                 {
                     std::scoped_lock lock(mutex_);
                     listOfMessages_.push(std::make_tuple(std::move(peerId.value()), std::move(cid)));
+                    if (newBroadcastHandler_)
+                    {
+                        newBroadcastHandler_();
+                    }
                 }
             }
         });
@@ -28,6 +32,13 @@ void PubSubBroadcaster::SetLogger(const sgns::base::Logger& logger)
     logger_ = logger; 
 }
 
+void PubSubBroadcaster::SetNewBroadcastHandler(std::function<void()> handler)
+{
+    // The handler is replaced under the lock so it is not called after it is reset
+    std::scoped_lock lock(mutex_);
+    newBroadcastHandler_ = std::move(handler);
+}
+
 outcome::result<void> PubSubBroadcaster::Broadcast(const base::Buffer& buff)
 {
     if (this->gossipPubSubTopic_ == nullptr)
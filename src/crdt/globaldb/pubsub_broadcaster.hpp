@@ -28,10 +28,16 @@ public:
     * @return buffer value or outcome::failure on error
     */
         outcome::result<base::Buffer> Next() override;
+
+    /**
+    * Sets {@param handler} that is called when a new payload is received.
+    */
+    void SetNewBroadcastHandler(std::function<void()> handler) override;
 private:
     std::shared_ptr<GossipPubSubTopic> gossipPubSubTopic_;
     std::queue<std::tuple<libp2p::peer::PeerId, std::string>> listOfMessages_;
     sgns::base::Logger logger_ = nullptr;
+    std::function<void()> newBroadcastHandler_;
     std::mutex mutex_;
 };
 }
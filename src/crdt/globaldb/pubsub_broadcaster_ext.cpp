@@ -79,6 +79,10 @@ void PubSubBroadcasterExt::OnMessage(boost::optional<const GossipPubSub::Message
                     }
                 }
                 messageQueue_.push(std::make_tuple(std::move(peerId.value()), bmsg.data()));
+                if (newBroadcastHandler_)
+                {
+                    newBroadcastHandler_();
+                }
             }
         }
     }
@@ -94,6 +98,13 @@ void PubSubBroadcasterExt::SetCrdtDataStore(CrdtDatastore* dataStore)
     dataStore_ = dataStore;
 }
 
+void PubSubBroadcasterExt::SetNewBroadcastHandler(std::function<void()> handler)
+{
+    // The handler is replaced under the lock so it is not called after it is reset
+    std::scoped_lock lock(mutex_);
+    newBroadcastHandler_ = std::move(handler);
+}
+
 outcome::result<void> PubSubBroadcasterExt::Broadcast(const base::Buffer& buff)
 {
     if (this->gossipPubSubTopic_ == nullptr)
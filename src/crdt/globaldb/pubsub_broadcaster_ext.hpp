@@ -34,6 +34,11 @@ public:
     * @return buffer value or outcome::failure on error
     */
     outcome::result<base::Buffer> Next() override;
+
+    /**
+    * Sets {@param handler} that is called when a new payload is received.
+    */
+    void SetNewBroadcastHandler(std::function<void()> handler) override;
 private:
     void OnMessage(boost::optional<const GossipPubSub::Message&> message);
 
@@ -43,6 +48,7 @@ private:
     libp2p::multi::Multiaddress dagSyncerMultiaddress_;
     std::queue<std::tuple<libp2p::peer::PeerId, std::string>> messageQueue_;
     sgns::base::Logger logger_ = nullptr;
+    std::function<void()> newBroadcastHandler_;
     std::mutex mutex_;
 
     sgns::base::Logger m_logger = sgns::base::createLogger("PubSubBroadcasterExt");
@@ -3,10 +3,23 @@
 #include <iostream>
 #include <crdt/proto/bcast.pb.h>
 #include <google/protobuf/unknown_field_set.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <ipfs_lite/ipld/impl/ipld_node_impl.hpp>
+#include <boost/lexical_cast.hpp>
+#include <optional>
 
 namespace sgns::crdt
 {
+  namespace
+  {
+    /** Returns a size of a serialized delta entry: a one byte tag, a varint length and the element
+    */
+    size_t GetSerializedEntrySize(const pb::Element& aElement)
+    {
+      size_t elementSize = aElement.ByteSizeLong();
+      return 1 + google::protobuf::io::CodedOutputStream::VarintSize64(elementSize) + elementSize;
+    }
+  }
 
 #define LOG_INFO(msg) \
   if (this->logger_ != nullptr) \
@@ -32,9 +45,10 @@ namespace sgns::crdt
 
   using CRDTBroadcast = pb::CRDTBroadcast;
 
-  const std::chrono::milliseconds CrdtDatastore::threadSleepTimeInMilliseconds_ = std::chrono::milliseconds(100); // ms
+  const std::chrono::milliseconds CrdtDatastore::defaultRebroadcastInterval_ = std::chrono::milliseconds(100); // ms
   const std::string CrdtDatastore::headsNamespace_ = "h";
   const std::string CrdtDatastore::setsNamespace_ = "s";
+  const std::string CrdtDatastore::compactedNamespace_ = "c";
 
   CrdtDatastore::CrdtDatastore(const std::shared_ptr<DataStore>& aDatastore, const HierarchicalKey& aKey,
     const std::shared_ptr<DAGSyncer>& aDagSyncer, const std::shared_ptr<Broadcaster>& aBroadcaster,
@@ -47,7 +61,13 @@ namespace sgns::crdt
     // <namespace>/h
     auto fullHeadsNs = aKey.ChildString(headsNamespace_);
 
-    int numberOfDagWorkers = 5;
+    auto fallbackOptions = FallbackOptions();
+    int numberOfDagWorkers = fallbackOptions->numWorkers;
+    int numberOfFetchWorkers = fallbackOptions->numFetchWorkers;
+    this->prefetchDepth_ = fallbackOptions->prefetchDepth;
+    this->mergeBatchSize_ = fallbackOptions->mergeBatchSize;
+    uint64_t keyFilterBitCount = fallbackOptions->keyFilterBitCount;
+    uint64_t valueCacheSize = fallbackOptions->valueCacheSize;
     if (aOptions != nullptr && !aOptions->Verify().has_failure() &&
       aOptions->Verify().value() == CrdtOptions::VerifyErrorCode::Success)
     {
@@ -56,7 +76,15 @@ namespace sgns::crdt
       this->deleteHookFunc_ = options_->deleteHookFunc;
       this->logger_ = options_->logger;
       numberOfDagWorkers = options_->numWorkers;
+      numberOfFetchWorkers = options_->numFetchWorkers;
+      this->prefetchDepth_ = options_->prefetchDepth;
+      this->mergeBatchSize_ = options_->mergeBatchSize;
+      this->syncMergeBatches_ = options_->syncMergeBatches;
+      keyFilterBitCount = options_->keyFilterBitCount;
+      valueCacheSize = options_->valueCacheSize;
     }
+    // Nodes fetched ahead of the DAG walk are bounded so wide DAGs do not fill the memory
+    this->maxPrefetchedNodes_ = numberOfFetchWorkers * 64;
 
     this->dataStore_ = aDatastore;
 
@@ -64,6 +92,12 @@ namespace sgns::crdt
     this->broadcaster_ = aBroadcaster;
 
     this->set_ = std::make_shared<CrdtSet>(CrdtSet(aDatastore, fullSetNs, this->putHookFunc_, this->deleteHookFunc_));
+    // The cache is enabled before DAG workers merge into the set
+    auto enableCacheResult = this->set_->EnableCache(keyFilterBitCount, valueCacheSize);
+    if (enableCacheResult.has_failure())
+    {
+      LOG_ERROR("crdt Datastore: failed to enable set cache");
+    }
     this->heads_ = std::make_shared<CrdtHeads>(CrdtHeads(aDatastore, fullHeadsNs));
 
     int numberOfHeads = 0;
@@ -78,19 +112,59 @@ namespace sgns::crdt
       }
     }
 
-    LOG_INFO("crdt Datastore created. Number of heads: " << numberOfHeads << " Current max-height: " << maxHeight);
+    // The latest snapshot height is restored from heights stored with compacted CIDs
+    if (this->dataStore_ != nullptr)
+    {
+      Buffer compactedPrefixBuffer;
+      compactedPrefixBuffer.put(aKey.ChildString(compactedNamespace_).GetKey() + "/");
+      auto queryResult = this->dataStore_->query(compactedPrefixBuffer,
+        [this](gsl::span<const uint8_t>, gsl::span<const uint8_t> aValue)
+        {
+          uint64_t snapshotHeight = 0;
+          if (boost::conversion::try_lexical_convert(std::string(aValue.begin(), aValue.end()), snapshotHeight)
+            && snapshotHeight > this->snapshotHeight_)
+          {
+            this->snapshotHeight_ = snapshotHeight;
+          }
+          return true;
+        });
+      if (queryResult.has_failure())
+      {
+        LOG_ERROR("crdt Datastore: failed to query compacted CIDs");
+      }
+    }
+
+    LOG_INFO("crdt Datastore created. Number of heads: " << numberOfHeads << " Current max-height: " << maxHeight
+      << " Snapshot height: " << this->snapshotHeight_.load());
+
+    // Running flags are set before threads start so that Close() waits for threads
+    // even if it is called before they are scheduled
+
+    // Starting fetch worker threads before threads that walk the DAG
+    this->fetchWorkersRunning_ = true;
+    for (int i = 0; i < numberOfFetchWorkers; ++i)
+    {
+      this->fetchWorkerFutures_.push_back(std::async(std::launch::async, std::bind(&CrdtDatastore::FetchWorker, this)));
+    }
 
     // Starting HandleNext worker thread
-    this->handleNextFuture_ = std::async(std::bind(&CrdtDatastore::HandleNext, this));
+    if (this->broadcaster_ != nullptr)
+    {
+      this->handleNextThreadRunning_ = true;
+      this->broadcaster_->SetNewBroadcastHandler(std::bind(&CrdtDatastore::OnNewBroadcast, this));
+      this->handleNextFuture_ = std::async(std::launch::async, std::bind(&CrdtDatastore::HandleNext, this));
+    }
 
     // Starting Rebroadcast worker thread
-    this->rebroadcastFuture_ = std::async(std::bind(&CrdtDatastore::Rebroadcast, this));
+    this->rebroadcastThreadRunning_ = true;
+    this->rebroadcastFuture_ = std::async(std::launch::async, std::bind(&CrdtDatastore::Rebroadcast, this));
 
     // Starting DAG worker threads 
     for (int i = 0; i < numberOfDagWorkers; ++i)
     {
       auto dagWorker = std::make_shared<DagWorker>();
-      dagWorker->dagWorkerFuture_ = std::async(std::bind(&CrdtDatastore::SendJobWorker, this, dagWorker));
+      dagWorker->dagWorkerThreadRunning_ = true;
+      dagWorker->dagWorkerFuture_ = std::async(std::launch::async, std::bind(&CrdtDatastore::SendJobWorker, this, dagWorker));
       this->dagWorkers_.push_back(dagWorker);
     }
   }
@@ -100,10 +174,22 @@ namespace sgns::crdt
     this->Close();
   }
 
+  //static
+  std::shared_ptr<CrdtOptions> CrdtDatastore::FallbackOptions()
+  {
+    auto options = CrdtOptions::DefaultOptions();
+    options->rebroadcastIntervalMilliseconds = defaultRebroadcastInterval_.count();
+    return options;
+  }
+
   //static 
   std::shared_ptr<CrdtDatastore::Delta> CrdtDatastore::DeltaMerge(const std::shared_ptr<Delta>& aDelta1, const std::shared_ptr<Delta>& aDelta2)
   {
     auto result = std::make_shared<CrdtDatastore::Delta>();
+    result->mutable_elements()->Reserve(
+      (aDelta1 != nullptr ? aDelta1->elements_size() : 0) + (aDelta2 != nullptr ? aDelta2->elements_size() : 0));
+    result->mutable_tombstones()->Reserve(
+      (aDelta1 != nullptr ? aDelta1->tombstones_size() : 0) + (aDelta2 != nullptr ? aDelta2->tombstones_size() : 0));
     if (aDelta1 != nullptr)
     {
       for (const auto& elem : aDelta1->elements())
@@ -141,73 +227,120 @@ namespace sgns::crdt
 
   void CrdtDatastore::Close()
   {
+    // Flags are reset under the mutexes that guard waiting conditions so that wakeups are not lost
     if (handleNextThreadRunning_)
     {
-      this->handleNextThreadRunning_ = false;
+      this->broadcaster_->SetNewBroadcastHandler(nullptr);
+      {
+        std::lock_guard lock(this->handleNextMutex_);
+        this->handleNextThreadRunning_ = false;
+      }
+      this->handleNextCondition_.notify_all();
       this->handleNextFuture_.wait();
     }
 
     if (this->rebroadcastThreadRunning_)
     {
-      this->rebroadcastThreadRunning_ = false;
+      {
+        std::lock_guard lock(this->rebroadcastMutex_);
+        this->rebroadcastThreadRunning_ = false;
+      }
+      this->rebroadcastCondition_.notify_all();
       this->rebroadcastFuture_.wait();
     }
 
+    // Fetch workers are stopped before DAG workers because DAG workers wait for fetched nodes
+    {
+      std::lock_guard lock(this->fetchMutex_);
+      this->fetchWorkersRunning_ = false;
+    }
+    this->fetchQueueCondition_.notify_all();
+    this->fetchedCondition_.notify_all();
+    for (const auto& fetchWorkerFuture : this->fetchWorkerFutures_)
+    {
+      fetchWorkerFuture.wait();
+    }
+
+    {
+      std::lock_guard lock(this->dagWorkerJobListMutex_);
+      for (const auto& dagWorker : this->dagWorkers_)
+      {
+        dagWorker->dagWorkerThreadRunning_ = false;
+      }
+    }
+    this->dagWorkerJobListCondition_.notify_all();
     for (const auto& dagWorker : this->dagWorkers_)
     {
-      dagWorker->dagWorkerThreadRunning_ = false;
       dagWorker->dagWorkerFuture_.wait();
     }
 
   }
 
-  void CrdtDatastore::HandleNext()
+  void CrdtDatastore::OnNewBroadcast()
   {
-  
-    if (broadcaster_ == nullptr)
     {
-      // offline
-      return;
+      std::lock_guard lock(this->handleNextMutex_);
+      this->hasNewBroadcasts_ = true;
     }
+    this->handleNextCondition_.notify_one();
+  }
 
-    handleNextThreadRunning_ = true;
-
+  void CrdtDatastore::HandleNext()
+  {
     LogDebug("HandleNext thread started");
     while (handleNextThreadRunning_)
     {
-      std::this_thread::sleep_for(threadSleepTimeInMilliseconds_);
-
-      auto broadcasterNextResult = broadcaster_->Next();
-      if (broadcasterNextResult.has_failure())
       {
-        if (broadcasterNextResult.error().value() != (int)Broadcaster::ErrorCode::ErrNoMoreBroadcast)
-        {
-          LogDebug("Failed to get next broadcaster (error code " + 
-            std::to_string(broadcasterNextResult.error().value()) + ")");
-        }
-        continue;
+        std::unique_lock lock(handleNextMutex_);
+        handleNextCondition_.wait(lock, [this] { return hasNewBroadcasts_ || !handleNextThreadRunning_; });
+        // Broadcasts received after this point signal again
+        hasNewBroadcasts_ = false;
       }
 
-      auto decodeResult = DecodeBroadcast(broadcasterNextResult.value());
-      if (decodeResult.has_failure())
+      // Drain all broadcasts received so far
+      while (handleNextThreadRunning_)
       {
-        LogError("Broadcaster: Unable to decode broadcast (error code " + 
-          std::to_string(broadcasterNextResult.error().value()) + ")");
-        continue;
-      }
+        auto broadcasterNextResult = broadcaster_->Next();
+        if (broadcasterNextResult.has_failure())
+        {
+          if (broadcasterNextResult.error().value() != (int)Broadcaster::ErrorCode::ErrNoMoreBroadcast)
+          {
+            LogDebug("Failed to get next broadcaster (error code " + 
+              std::to_string(broadcasterNextResult.error().value()) + ")");
+          }
+          break;
+        }
 
-      // For each head, we process it.
-      for (const auto& bCastHeadCID : decodeResult.value())
-      {
-        auto handleBlockResult = HandleBlock(bCastHeadCID);
-        if (handleBlockResult.has_failure())
+        auto decodeResult = DecodeBroadcast(broadcasterNextResult.value());
+        if (decodeResult.has_failure())
         {
-          LogError("Broadcaster: Unable to handle block (error code " + 
-            std::to_string(handleBlockResult.error().value()) + ")");
+          LogError("Broadcaster: Unable to decode broadcast (error code " + 
+            std::to_string(decodeResult.error().value()) + ")");
           continue;
         }
-        std::unique_lock lock(seenHeadsMutex_);
-        seenHeads_.push_back(bCastHeadCID);
+
+        // For each head, we process it.
+        std::vector<CID> handledHeads;
+        for (const auto& bCastHeadCID : decodeResult.value())
+        {
+          auto handleBlockResult = HandleBlock(bCastHeadCID);
+          if (handleBlockResult.has_failure())
+          {
+            LogError("Broadcaster: Unable to handle block (error code " + 
+              std::to_string(handleBlockResult.error().value()) + ")");
+            continue;
+          }
+          handledHeads.push_back(bCastHeadCID);
+        }
+
+        if (!handledHeads.empty())
+        {
+          std::unique_lock lock(seenHeadsMutex_);
+          for (const auto& head : handledHeads)
+          {
+            seenHeads_[head] = seenHeadsGeneration_;
+          }
+        }
       }
 
       // We should store trusted-peer signatures associated to
@@ -223,23 +356,24 @@ namespace sgns::crdt
   void CrdtDatastore::Rebroadcast()
   {
     LogDebug("Rebroadcast thread started");
-    std::chrono::milliseconds rebroadcastIntervalMilliseconds = std::chrono::milliseconds(threadSleepTimeInMilliseconds_);
+    std::chrono::milliseconds rebroadcastIntervalMilliseconds = defaultRebroadcastInterval_;
     if (options_ != nullptr)
     {
       rebroadcastIntervalMilliseconds = std::chrono::milliseconds(options_->rebroadcastIntervalMilliseconds);
     }
 
-    std::chrono::milliseconds elapsedTimeMilliseconds = std::chrono::milliseconds(0);
-    rebroadcastThreadRunning_ = true;
+    std::unique_lock lock(rebroadcastMutex_);
     while (rebroadcastThreadRunning_)
     {
-      if (elapsedTimeMilliseconds >= rebroadcastIntervalMilliseconds)
+      // The wait is interrupted only by Close()
+      if (!rebroadcastCondition_.wait_for(lock, rebroadcastIntervalMilliseconds,
+        [this] { return !rebroadcastThreadRunning_; }))
       {
+        lock.unlock();
         RebroadcastHeads();
-        elapsedTimeMilliseconds = std::chrono::milliseconds(0);
+        CompactDAGIfNeeded();
+        lock.lock();
       }
-      std::this_thread::sleep_for(threadSleepTimeInMilliseconds_);
-      elapsedTimeMilliseconds += threadSleepTimeInMilliseconds_;
     }
     LogDebug("Rebroadcast thread finished");
   }
@@ -252,33 +386,52 @@ namespace sgns::crdt
     }
 
     LogDebug("SendJobWorker thread started");
-    DagJob dagJob;
-    dagWorker->dagWorkerThreadRunning_ = true;
+    std::vector<DagJob> dagJobs;
     while (dagWorker->dagWorkerThreadRunning_)
     {
-      std::this_thread::sleep_for(threadSleepTimeInMilliseconds_);
-
+      dagJobs.clear();
       {
-        std::unique_lock lock(dagWorkerMutex_);
-        if (dagWorkerJobList.empty())
+        std::unique_lock lock(dagWorkerJobListMutex_);
+        dagWorkerJobListCondition_.wait(lock, [this, &dagWorker] {
+          return !dagWorkerJobList.empty() || !dagWorker->dagWorkerThreadRunning_; });
+        if (!dagWorker->dagWorkerThreadRunning_)
         {
-          continue;
+          break;
+        }
+        // Pending jobs are taken together to merge their deltas with one write batch
+        while (!dagWorkerJobList.empty() && dagJobs.size() < mergeBatchSize_)
+        {
+          dagJobs.push_back(std::move(dagWorkerJobList.front()));
+          dagWorkerJobList.pop();
         }
-        dagJob = dagWorkerJobList.front();
-        dagWorkerJobList.pop();
+        // The walk stays in progress until children of the taken jobs are queued
+        activeWalkSteps_ += dagJobs.size();
       }
-      LogInfo("SendJobWorker CID=" + dagJob.rootCid_.toString().value() + " priority=" + std::to_string(dagJob.rootPriority_));
 
-      auto childrenResult = ProcessNode(dagJob.rootCid_, dagJob.rootPriority_, dagJob.delta_, dagJob.node_);
-      if (childrenResult.has_failure())
       {
-        LogError("SendNewJobs: failed to process node:" + dagJob.rootCid_.toString().value());
-      }
-      else
-      {
-        SendNewJobs(dagJob.rootCid_, dagJob.rootPriority_, childrenResult.value());
+        std::shared_lock walkLock(walkMutex_);
+
+        // If the group cannot be merged, its nodes are processed one by one so only failed nodes are skipped
+        bool isMerged = !MergeDeltas(dagJobs).has_failure();
+        for (const auto& dagJob : dagJobs)
+        {
+          LogInfo("SendJobWorker CID=" + dagJob.rootCid_.toString().value() + " priority=" + std::to_string(dagJob.rootPriority_));
+
+          auto childrenResult = isMerged ?
+            ProcessLinks(dagJob.rootCid_, dagJob.rootPriority_, dagJob.delta_, dagJob.node_) :
+            ProcessNode(dagJob.rootCid_, dagJob.rootPriority_, dagJob.delta_, dagJob.node_);
+          if (childrenResult.has_failure())
+          {
+            LogError("SendNewJobs: failed to process node:" + dagJob.rootCid_.toString().value());
+          }
+          else
+          {
+            SendNewJobs(dagJob.rootCid_, dagJob.rootPriority_, childrenResult.value());
+          }
+        }
       }
 
+      EndWalkSteps(dagJobs.size());
     }
     LogDebug("SendJobWorker thread finished");
   }
@@ -348,28 +501,43 @@ namespace sgns::crdt
 
   void CrdtDatastore::RebroadcastHeads()
   {
-    uint64_t maxHeight = 0;
-    std::vector<CID> heads;
     if (this->heads_ != nullptr)
     {
-      auto getListResult = this->heads_->GetList(heads, maxHeight);
-      if (getListResult.has_failure())
+      // Heads are copied only when they were changed since the last rebroadcast
+      auto headsVersion = this->heads_->GetVersion();
+      if (!hasRebroadcastHeads_ || headsVersion != rebroadcastHeadsVersion_)
       {
-        LOG_ERROR("RebroadcastHeads: Failed to get list of heads (error code " << getListResult.error() << ")");
-        return;
+        uint64_t maxHeight = 0;
+        auto getListResult = this->heads_->GetList(rebroadcastHeads_, maxHeight);
+        if (getListResult.has_failure())
+        {
+          LOG_ERROR("RebroadcastHeads: Failed to get list of heads (error code " << getListResult.error() << ")");
+          return;
+        }
+        rebroadcastHeadsVersion_ = headsVersion;
+        hasRebroadcastHeads_ = true;
       }
     }
 
     std::vector<CID> headsToBroadcast;
     {
-      std::shared_lock lock(this->seenHeadsMutex_);
-      for (const auto& head : heads)
+      std::unique_lock lock(this->seenHeadsMutex_);
+      for (const auto& head : rebroadcastHeads_)
       {
-        if (std::find(seenHeads_.begin(), seenHeads_.end(), head) == seenHeads_.end())
+        auto itSeenHead = seenHeads_.find(head);
+        if (itSeenHead == seenHeads_.end() || itSeenHead->second != seenHeadsGeneration_)
         {
           headsToBroadcast.push_back(head);
         }
       }
+
+      // Heads seen before are forgotten by advancing the generation.
+      // Stale entries are dropped once they outnumber the current heads, so the cost is amortized
+      ++seenHeadsGeneration_;
+      if (seenHeads_.size() > 2 * rebroadcastHeads_.size())
+      {
+        seenHeads_.clear();
+      }
     }
 
     auto broadcastResult = this->Broadcast(headsToBroadcast);
@@ -377,10 +545,6 @@ namespace sgns::crdt
     {
       LOG_ERROR("Broadcast failed");
     }
-
-    // Reset the map
-    std::unique_lock lock(this->seenHeadsMutex_);
-    this->seenHeads_.clear();
   }
 
   outcome::result<void> CrdtDatastore::HandleBlock(const CID& aCid)
@@ -406,14 +570,33 @@ namespace sgns::crdt
       return outcome::success();
     }
 
+    // Rebroadcasts of heads that were compacted into a snapshot would walk the compacted history
+    auto isCompactedResult = this->IsCompacted(aCid);
+    if (isCompactedResult.has_failure())
+    {
+      return outcome::failure(isCompactedResult.error());
+    }
+
+    if (isCompactedResult.value())
+    {
+      return outcome::success();
+    }
+
+    // The walk is in progress while its root is fetched, before the root job is queued
+    {
+      std::lock_guard lock(this->dagWorkerJobListMutex_);
+      ++this->activeWalkSteps_;
+    }
+
     std::vector<CID> children;
     children.push_back(aCid);
     SendNewJobs(aCid, 0, children);
 
+    this->EndWalkSteps(1);
     return outcome::success();
   }
 
-    void CrdtDatastore::SendNewJobs(const CID& aRootCID, const uint64_t& aRootPriority, const std::vector<CID>& aChildren)
+  void CrdtDatastore::SendNewJobs(const CID& aRootCID, const uint64_t& aRootPriority, const std::vector<CID>& aChildren)
   {
     // sendNewJobs calls getDeltas with the given
     // children and sends each response to the workers. 
@@ -430,72 +613,256 @@ namespace sgns::crdt
       dagSyncerTimeoutSec = std::chrono::seconds(options_->dagSyncerTimeoutSec);
     }
 
+    // Children are fetched concurrently by fetch workers, nodes below them are fetched ahead
+    // while the children are processed
+    for (const auto& cid : aChildren)
+    {
+      this->RequestFetch(cid, this->prefetchDepth_, false, 0);
+    }
+
     uint64_t rootPriority = aRootPriority;
-    if (rootPriority == 0)
+    for (const auto& cid : aChildren)
     {
-      std::shared_lock lock(dagWorkerMutex_);
-      auto getNodeResult = dagSyncer_->getNode(aChildren[0]);
-      if (getNodeResult.has_failure())
+      auto fetchResult = this->TakeFetchedNode(cid, this->prefetchDepth_);
+      if (fetchResult.has_failure())
       {
-        return;
+        LOG_ERROR("SendNewJobs: error fetching graph for CID:" << cid.toString().value());
+        continue;
       }
-      auto node = getNodeResult.value();
-      auto nodeBuffer = node->content();
 
-      auto delta = std::make_shared<Delta>();
+      auto& fetchedNode = fetchResult.value();
+      if (rootPriority == 0)
+      {
+        rootPriority = fetchedNode.delta_->priority();
+      }
 
-      if (!delta->ParseFromArray(nodeBuffer.data(), nodeBuffer.size()))
+      DagJob dagJob;
+      dagJob.rootCid_ = aRootCID;
+      dagJob.rootPriority_ = rootPriority;
+      dagJob.delta_ = fetchedNode.delta_;
+      dagJob.node_ = fetchedNode.node_;
       {
-        return;
+        std::lock_guard lock(dagWorkerJobListMutex_);
+        dagWorkerJobList.push(std::move(dagJob));
       }
+      dagWorkerJobListCondition_.notify_one();
+    }
+  }
 
-      if (rootPriority == 0)
+  void CrdtDatastore::FetchWorker()
+  {
+    LogDebug("FetchWorker thread started");
+    while (true)
+    {
+      std::optional<CID> queuedCid;
+      uint64_t prefetchDepth = 0;
+      uint64_t fetchGeneration = 0;
+      {
+        std::unique_lock lock(fetchMutex_);
+        fetchQueueCondition_.wait(lock, [this] { return !fetchQueue_.empty() || !fetchWorkersRunning_; });
+        if (!fetchWorkersRunning_)
+        {
+          break;
+        }
+        queuedCid = fetchQueue_.front();
+        fetchQueue_.pop();
+        fetchGeneration = fetchGeneration_;
+        auto itNode = fetchedNodes_.find(*queuedCid);
+        if (itNode != fetchedNodes_.end())
+        {
+          prefetchDepth = itNode->second.prefetchDepth_;
+        }
+      }
+
+      const auto& cid = *queuedCid;
+      FetchedNode fetchedNode;
+      fetchedNode.isFetched_ = true;
       {
-        rootPriority = delta->priority();
+        std::shared_lock lock(dagWorkerMutex_);
+        auto getNodeResult = dagSyncer_->getNode(cid);
+        if (!getNodeResult.has_failure())
+        {
+          auto node = getNodeResult.value();
+          auto nodeBuffer = node->content();
+          auto delta = std::make_shared<Delta>();
+          if (delta->ParseFromArray(nodeBuffer.data(), nodeBuffer.size()))
+          {
+            fetchedNode.node_ = node;
+            fetchedNode.delta_ = delta;
+          }
+        }
+      }
+      fetchedNode.hasFailed_ = (fetchedNode.delta_ == nullptr);
+      if (fetchedNode.hasFailed_)
+      {
+        LOG_ERROR("FetchWorker: error fetching node for CID:" << cid.toString().value());
+      }
+
+      // Links are requested before the node is passed to the walk,
+      // so they are not requested again after the walk has taken them
+      if (!fetchedNode.hasFailed_)
+      {
+        PrefetchLinks(fetchedNode.node_, fetchedNode.delta_, prefetchDepth, fetchGeneration);
+      }
+
+      uint64_t updatedPrefetchDepth = prefetchDepth;
+      {
+        std::lock_guard lock(fetchMutex_);
+        auto itNode = fetchedNodes_.find(cid);
+        if (itNode != fetchedNodes_.end())
+        {
+          updatedPrefetchDepth = itNode->second.prefetchDepth_;
+          fetchedNode.prefetchDepth_ = updatedPrefetchDepth;
+          itNode->second = fetchedNode;
+        }
+      }
+      fetchedCondition_.notify_all();
+
+      if (!fetchedNode.hasFailed_ && updatedPrefetchDepth > prefetchDepth)
+      {
+        PrefetchLinks(fetchedNode.node_, fetchedNode.delta_, updatedPrefetchDepth, fetchGeneration);
       }
     }
+    LogDebug("FetchWorker thread finished");
+  }
 
-    for (const auto& cid : aChildren)
+  void CrdtDatastore::RequestFetch(const CID& aCid, uint64_t aPrefetchDepth, bool aIsPrefetch,
+    uint64_t aFetchGeneration)
+  {
+    std::shared_ptr<Node> node;
+    std::shared_ptr<Delta> delta;
+    uint64_t fetchGeneration = 0;
     {
-      //Fetch only root node with all children, but without children of their children
-      dagWorkerMutex_.lock_shared();
-      auto graphResult = dagSyncer_->fetchGraphOnDepth(cid, 1); 
-      dagWorkerMutex_.unlock_shared();
-      if (graphResult.has_failure())
+      std::lock_guard lock(this->fetchMutex_);
+      // Nodes fetched ahead of a walk that has ended would never be taken
+      if (aIsPrefetch && aFetchGeneration != this->fetchGeneration_)
       {
-        LOG_ERROR("SendNewJobs: error fetching graph for CID:" << cid.toString().value());
-        continue;
+        return;
       }
+      fetchGeneration = this->fetchGeneration_;
 
-      auto leaf = graphResult.value();
-      auto nodeBuffer = leaf->content();
+      auto itNode = this->fetchedNodes_.find(aCid);
+      if (itNode == this->fetchedNodes_.end())
+      {
+        if (aIsPrefetch && this->fetchedNodes_.size() >= this->maxPrefetchedNodes_)
+        {
+          return;
+        }
 
-      // @todo Check if it is OK that the node has only content and doesn't have links
-      auto nodeResult = ipfs_lite::ipld::IPLDNodeImpl::createFromRawBytes(nodeBuffer);
-      if (nodeResult.has_failure())
+        FetchedNode fetchedNode;
+        fetchedNode.prefetchDepth_ = aPrefetchDepth;
+        this->fetchedNodes_.emplace(aCid, std::move(fetchedNode));
+        this->fetchQueue_.push(aCid);
+      }
+      else
       {
-        continue;
+        auto& fetchedNode = itNode->second;
+        if (fetchedNode.prefetchDepth_ >= aPrefetchDepth)
+        {
+          return;
+        }
+
+        // A node that is being fetched is prefetched with the increased depth by the fetch worker
+        fetchedNode.prefetchDepth_ = aPrefetchDepth;
+        if (!fetchedNode.isFetched_ || fetchedNode.hasFailed_)
+        {
+          return;
+        }
+        node = fetchedNode.node_;
+        delta = fetchedNode.delta_;
       }
-      auto node = nodeResult.value();
+    }
 
-      auto delta = std::make_shared<Delta>();
-      if (!delta->ParseFromArray(nodeBuffer.data(), nodeBuffer.size()))
+    if (node == nullptr)
+    {
+      this->fetchQueueCondition_.notify_one();
+      return;
+    }
+    this->PrefetchLinks(node, delta, aPrefetchDepth, fetchGeneration);
+  }
+
+  void CrdtDatastore::PrefetchLinks(const std::shared_ptr<Node>& aNode, const std::shared_ptr<Delta>& aDelta,
+    uint64_t aPrefetchDepth, uint64_t aFetchGeneration)
+  {
+    // Nodes below snapshots are not walked
+    if (aPrefetchDepth == 0 || aNode == nullptr || aDelta == nullptr || aDelta->snapshot())
+    {
+      return;
+    }
+
+    for (const auto& link : aNode->getLinks())
+    {
+      auto child = link.get().getCID();
+      bool isRequested = false;
       {
-        continue;
+        std::lock_guard lock(this->fetchMutex_);
+        if (aFetchGeneration != this->fetchGeneration_)
+        {
+          return;
+        }
+        isRequested = this->fetchedNodes_.count(child) > 0;
       }
 
-      DagJob dagJob;
-      dagJob.rootCid_ = aRootCID;
-      dagJob.rootPriority_ = rootPriority;
-      dagJob.delta_ = delta;
-      dagJob.node_ = node;
+      if (!isRequested)
       {
-        std::unique_lock lock(dagWorkerMutex_);
-        dagWorkerJobList.push(dagJob);
+        // The walk stops at heads, known and compacted nodes, so they are not fetched ahead
+        auto isHeadResult = this->heads_->IsHead(child);
+        if (isHeadResult.has_failure() || isHeadResult.value())
+        {
+          continue;
+        }
+
+        auto hasBlockResult = this->dagSyncer_->HasBlock(child);
+        if (hasBlockResult.has_failure() || hasBlockResult.value())
+        {
+          continue;
+        }
+
+        auto isCompactedResult = this->IsCompacted(child);
+        if (isCompactedResult.has_failure() || isCompactedResult.value())
+        {
+          continue;
+        }
       }
+
+      this->RequestFetch(child, aPrefetchDepth - 1, true, aFetchGeneration);
     }
   }
 
+  outcome::result<CrdtDatastore::FetchedNode> CrdtDatastore::TakeFetchedNode(const CID& aCid, uint64_t aPrefetchDepth)
+  {
+    std::unique_lock lock(this->fetchMutex_);
+    auto itNode = this->fetchedNodes_.find(aCid);
+    if (itNode == this->fetchedNodes_.end())
+    {
+      // The node was taken by a concurrent walk of another branch
+      FetchedNode fetchedNode;
+      fetchedNode.prefetchDepth_ = aPrefetchDepth;
+      itNode = this->fetchedNodes_.emplace(aCid, std::move(fetchedNode)).first;
+      this->fetchQueue_.push(aCid);
+      this->fetchQueueCondition_.notify_one();
+    }
+
+    this->fetchedCondition_.wait(lock, [this, &aCid, &itNode]
+      {
+        itNode = this->fetchedNodes_.find(aCid);
+        return itNode == this->fetchedNodes_.end() || itNode->second.isFetched_ || !this->fetchWorkersRunning_;
+      });
+
+    if (itNode == this->fetchedNodes_.end() || !itNode->second.isFetched_)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    auto fetchedNode = std::move(itNode->second);
+    this->fetchedNodes_.erase(itNode);
+    if (fetchedNode.hasFailed_)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+    return fetchedNode;
+  }
+
   outcome::result<CrdtDatastore::Buffer> CrdtDatastore::GetKey(const HierarchicalKey& aKey)
   {
     if (this->set_ == nullptr)
@@ -532,6 +899,16 @@ namespace sgns::crdt
     return this->set_->QueryElements(aPrefix, CrdtSet::QuerySuffix::QUERY_VALUESUFFIX);
   }
 
+  outcome::result<void> CrdtDatastore::QueryKeyValues(const std::string& aPrefix, const QueryCallback& aCallback,
+    size_t aOffset /*= 0*/, size_t aLimit /*= 0*/)
+  {
+    if (this->set_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+    return this->set_->QueryElements(aPrefix, CrdtSet::QuerySuffix::QUERY_VALUESUFFIX, aCallback, aOffset, aLimit);
+  }
+
   outcome::result<bool> CrdtDatastore::HasKey(const HierarchicalKey& aKey)
   {
     if (this->set_ == nullptr)
@@ -605,58 +982,120 @@ namespace sgns::crdt
 
   int CrdtDataStoreTransaction::UpdateDeltaWithRemove(const HierarchicalKey& aKey, const std::shared_ptr<Delta>& aDelta)
   {
-    int deltaSize = 0;
-    std::vector<Element> elems;
     std::lock_guard lg(this->currentDeltaMutex_);
-    std::shared_ptr<Delta> deltaToMerge = std::make_shared<Delta>();
-    if (this->currentDelta_ != nullptr)
+    this->RemoveFromCurrentDelta(aKey.GetKey());
+    if (aDelta != nullptr)
+    {
+      this->MergeToCurrentDelta(*aDelta);
+    }
+    return this->GetCurrentDeltaSize();
+  }
+
+  int CrdtDataStoreTransaction::UpdateDelta(const std::shared_ptr<Delta>& aDelta)
+  {
+    std::lock_guard lg(this->currentDeltaMutex_);
+    if (aDelta != nullptr)
     {
-      for (const auto& elem : this->currentDelta_->elements())
+      this->MergeToCurrentDelta(*aDelta);
+    }
+    return this->GetCurrentDeltaSize();
+  }
+
+  void CrdtDataStoreTransaction::MergeToCurrentDelta(Delta& aDelta)
+  {
+    // Entries are appended to the current delta in place, so building a transaction is linear
+    // in the number of its entries. Input deltas are created for a single update and can be moved from.
+    if (this->currentDelta_ == nullptr)
+    {
+      this->currentDelta_ = std::make_shared<Delta>();
+    }
+
+    for (auto& elem : *aDelta.mutable_elements())
+    {
+      Element* currentElem = nullptr;
+      auto itIndex = this->elementIndices_.find(elem.key());
+      if (itIndex != this->elementIndices_.end())
       {
-        if (elem.key() != aKey.GetKey())
-        {
-          elems.push_back(elem);
-        }
+        // The last value put in the transaction wins
+        currentElem = this->currentDelta_->mutable_elements(itIndex->second);
+        this->currentDeltaEntriesSize_ -= GetSerializedEntrySize(*currentElem);
       }
-
-      auto tombs = this->currentDelta_->tombstones();
-      auto priority = this->currentDelta_->priority();
-      for (const auto& elem : elems)
+      else
       {
-        auto newElem = deltaToMerge->add_elements();
-        newElem->CopyFrom(elem);
+        this->elementIndices_.emplace(elem.key(), this->currentDelta_->elements_size());
+        currentElem = this->currentDelta_->add_elements();
       }
-      for (const auto& tomb : tombs)
+      *currentElem = std::move(elem);
+      this->currentDeltaEntriesSize_ += GetSerializedEntrySize(*currentElem);
+    }
+
+    for (auto& tomb : *aDelta.mutable_tombstones())
+    {
+      if (this->tombstoneIds_.insert(tomb.key() + "/" + tomb.id()).second)
       {
-        auto newTomb = deltaToMerge->add_tombstones();
-        newTomb->CopyFrom(tomb);
+        auto currentTomb = this->currentDelta_->add_tombstones();
+        *currentTomb = std::move(tomb);
+        this->currentDeltaEntriesSize_ += GetSerializedEntrySize(*currentTomb);
       }
-      deltaToMerge->set_priority(priority);
     }
 
-    currentDelta_ = CrdtDatastore::DeltaMerge(deltaToMerge, aDelta);
-    deltaSize = this->currentDelta_->ByteSizeLong();
-    return deltaSize;
+    if (aDelta.priority() > this->currentDelta_->priority())
+    {
+      this->currentDelta_->set_priority(aDelta.priority());
+    }
   }
 
-  int CrdtDataStoreTransaction::UpdateDelta(const std::shared_ptr<Delta>& aDelta)
+  void CrdtDataStoreTransaction::RemoveFromCurrentDelta(const std::string& aKey)
   {
-    int deltaSize = 0;
-    std::lock_guard lg(this->currentDeltaMutex_);
-    currentDelta_ = CrdtDatastore::DeltaMerge(this->currentDelta_, aDelta);
-    deltaSize = this->currentDelta_->ByteSizeLong();
-    return deltaSize;
+    auto itIndex = this->elementIndices_.find(aKey);
+    if (itIndex == this->elementIndices_.end())
+    {
+      return;
+    }
+
+    int index = itIndex->second;
+    this->elementIndices_.erase(itIndex);
+
+    auto elements = this->currentDelta_->mutable_elements();
+    this->currentDeltaEntriesSize_ -= GetSerializedEntrySize(elements->Get(index));
+    // The element is replaced with the last one, elements order does not matter as keys are unique
+    int lastIndex = elements->size() - 1;
+    if (index != lastIndex)
+    {
+      elements->SwapElements(index, lastIndex);
+      this->elementIndices_[elements->Get(index).key()] = index;
+    }
+    elements->RemoveLast();
+  }
+
+  int CrdtDataStoreTransaction::GetCurrentDeltaSize() const
+  {
+    size_t deltaSize = this->currentDeltaEntriesSize_;
+    if (this->currentDelta_ != nullptr && this->currentDelta_->priority() != 0)
+    {
+      deltaSize += 1 + google::protobuf::io::CodedOutputStream::VarintSize64(this->currentDelta_->priority());
+    }
+    return static_cast<int>(deltaSize);
+  }
+
+  void CrdtDataStoreTransaction::ResetCurrentDelta()
+  {
+    this->currentDelta_ = nullptr;
+    this->elementIndices_.clear();
+    this->tombstoneIds_.clear();
+    this->currentDeltaEntriesSize_ = 0;
   }
 
   outcome::result<void> CrdtDataStoreTransaction::PublishDelta()
   {
     std::lock_guard lg(this->currentDeltaMutex_);
+    // The accumulated delta is passed as is, its entries are not copied
     auto publishResult = datastore_->Publish(currentDelta_);
     if (publishResult.has_failure())
     {
       return outcome::failure(publishResult.error());
     }
-    this->currentDelta_ = nullptr;
+    this->ResetCurrentDelta();
     return outcome::success();
   }
 
@@ -770,9 +1209,69 @@ namespace sgns::crdt
     {
       LOG_INFO("ProcessNode: merged delta from " << strCidResult.value() << " (priority: " << priority << ")");
     }
- 
+
+    return this->ProcessLinks(aRoot, aRootPrio, aDelta, aNode);
+  }
+
+  outcome::result<std::vector<CID>> CrdtDatastore::ProcessLinks(const CID& aRoot, const uint64_t& aRootPrio, 
+    const std::shared_ptr<Delta>& aDelta, const std::shared_ptr<Node>& aNode)
+  {
+    if (this->heads_ == nullptr || this->dagSyncer_ == nullptr || aDelta == nullptr || aNode == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    auto priority = aDelta->priority();
     std::vector<CID> children;
     auto links = aNode->getLinks();
+    if (aDelta->snapshot())
+    {
+      // The snapshot holds the state of all nodes below it, so they are not walked.
+      // Its links are remembered to stop walks of concurrent branches at them.
+      std::vector<CID> compactedHeads;
+      bool isHeadReplaced = false;
+      for (const auto& link : links)
+      {
+        auto child = link.get().getCID();
+        compactedHeads.push_back(child);
+        auto isHeadResult = this->heads_->IsHead(child);
+        if (isHeadResult.has_failure())
+        {
+          LOG_ERROR("ProcessNode: error checking if " << child.toString().value() << " is head");
+          return outcome::failure(isHeadResult.error());
+        }
+
+        if (isHeadResult.value() == true)
+        {
+          auto replaceResult = this->heads_->Replace(child, aRoot, aRootPrio);
+          if (replaceResult.has_failure())
+          {
+            LOG_ERROR("ProcessNode: error replacing head " << child.toString().value() << " -> " << aRoot.toString().value());
+            return outcome::failure(replaceResult.error());
+          }
+          isHeadReplaced = true;
+        }
+      }
+
+      auto markResult = this->MarkCompacted(compactedHeads, priority);
+      if (markResult.has_failure())
+      {
+        LOG_ERROR("ProcessNode: error marking compacted heads of snapshot " << aNode->getCID().toString().value());
+        return outcome::failure(markResult.error());
+      }
+
+      if (!isHeadReplaced)
+      {
+        auto addHeadResult = this->heads_->Add(aRoot, aRootPrio);
+        if (addHeadResult.has_failure())
+        {
+          LOG_ERROR("ProcessNode: error adding head " << aRoot.toString().value());
+          return outcome::failure(addHeadResult.error());
+        }
+      }
+      return outcome::success(children);
+    }
+
     if (links.empty())
     {
       // we reached the bottom, we are a leaf.
@@ -810,6 +1309,13 @@ namespace sgns::crdt
         continue;
       }
 
+      // Nodes fetched ahead are stored by the DAGSyncer before they are processed
+      bool isFetchRequested = false;
+      {
+        std::lock_guard fetchLock(this->fetchMutex_);
+        isFetchRequested = this->fetchedNodes_.count(child) > 0;
+      }
+
       std::shared_lock lock(this->dagWorkerMutex_);
       auto knowBlockResult = this->dagSyncer_->HasBlock(child);
       if (knowBlockResult.has_failure())
@@ -818,7 +1324,15 @@ namespace sgns::crdt
         return outcome::failure(knowBlockResult.error());
       }
 
-      if (knowBlockResult.value() == true)
+      // Nodes compacted into a snapshot are known even if they were removed from the DAGSyncer
+      auto isCompactedResult = this->IsCompacted(child);
+      if (isCompactedResult.has_failure())
+      {
+        LOG_ERROR("ProcessNode: error checking for compacted block " << child.toString().value());
+        return outcome::failure(isCompactedResult.error());
+      }
+
+      if ((knowBlockResult.value() == true && !isFetchRequested) || isCompactedResult.value() == true)
       {
         // we reached a non-head node in the known tree.
         // This means our root block is a new head.
@@ -838,6 +1352,41 @@ namespace sgns::crdt
   }
 
 
+  outcome::result<void> CrdtDatastore::MergeDeltas(const std::vector<DagJob>& aDagJobs)
+  {
+    if (this->set_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    std::vector<std::pair<std::shared_ptr<Delta>, std::string>> deltas;
+    deltas.reserve(aDagJobs.size());
+    for (const auto& dagJob : aDagJobs)
+    {
+      if (dagJob.delta_ == nullptr || dagJob.node_ == nullptr)
+      {
+        return outcome::failure(boost::system::error_code{});
+      }
+
+      auto strCidResult = dagJob.node_->getCID().toString();
+      if (strCidResult.has_failure())
+      {
+        return outcome::failure(strCidResult.error());
+      }
+      deltas.emplace_back(dagJob.delta_, HierarchicalKey(strCidResult.value()).GetKey());
+    }
+
+    std::shared_lock lock(this->dagWorkerMutex_);
+    auto mergeResult = this->set_->MergeDeltas(deltas, this->syncMergeBatches_);
+    if (mergeResult.has_failure())
+    {
+      LOG_ERROR("MergeDeltas: error merging " << deltas.size() << " deltas");
+      return outcome::failure(mergeResult.error());
+    }
+    LOG_DEBUG("MergeDeltas: merged " << deltas.size() << " deltas");
+    return outcome::success();
+  }
+
   outcome::result<CID> CrdtDatastore::AddDAGNode(const std::shared_ptr<Delta>& aDelta)
   {
     if (this->heads_ == nullptr)
@@ -845,6 +1394,9 @@ namespace sgns::crdt
       return outcome::failure(boost::system::error_code{});
     }
 
+    // The node links to the current heads, which are not replaced by a snapshot meanwhile
+    std::shared_lock walkLock(this->walkMutex_);
+
     uint64_t height = 0;
     std::vector<CID> heads;
     auto getListResult = this->heads_->GetList(heads, height);
@@ -885,6 +1437,292 @@ namespace sgns::crdt
     return node->getCID();
   }
 
+  outcome::result<CID> CrdtDatastore::CompactDAG(bool aRemoveCompactedNodes /*= false*/)
+  {
+    if (this->set_ == nullptr || this->heads_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    // A walk makes its root a head as soon as one branch reaches known nodes, while other branches
+    // below the root may still be pending. Heads cover all nodes below them only when no walk is in progress.
+    // Walk steps and local updates hold the walk lock shared, so the heads and the set state
+    // do not change until the snapshot is processed. Compaction is retried on the next rebroadcast.
+    std::unique_lock walkLock(this->walkMutex_, std::try_to_lock);
+    if (!walkLock.owns_lock() || this->IsDAGWalkInProgress())
+    {
+      LOG_DEBUG("CompactDAG: DAG walk is in progress, compaction is postponed");
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    uint64_t height = 0;
+    std::vector<CID> heads;
+    auto getListResult = this->heads_->GetList(heads, height);
+    if (getListResult.has_failure())
+    {
+      return outcome::failure(getListResult.error());
+    }
+
+    if (heads.empty())
+    {
+      // Nothing to compact
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    auto snapshotResult = this->set_->CreateSnapshotDelta();
+    if (snapshotResult.has_failure())
+    {
+      return outcome::failure(snapshotResult.error());
+    }
+    auto snapshot = snapshotResult.value();
+
+    height = height + 1;
+    auto putBlockResult = this->PutBlock(heads, height, snapshot);
+    if (putBlockResult.has_failure())
+    {
+      return outcome::failure(putBlockResult.error());
+    }
+
+    auto node = putBlockResult.value();
+    LOG_INFO("CompactDAG: Processing snapshot block " << node->getCID().toString().value() << " (height: " << height
+      << ", elements: " << snapshot->elements_size() << ", tombstones: " << snapshot->tombstones_size() << ")");
+
+    auto processNodeResult = this->ProcessNode(node->getCID(), height, snapshot, node);
+    if (processNodeResult.has_failure())
+    {
+      LOG_ERROR("CompactDAG: error processing snapshot block");
+      return outcome::failure(processNodeResult.error());
+    }
+
+    if (aRemoveCompactedNodes)
+    {
+      auto removeResult = this->RemoveCompactedNodes(heads, height);
+      if (removeResult.has_failure())
+      {
+        LOG_ERROR("CompactDAG: error marking compacted nodes, they are not removed");
+      }
+      else
+      {
+        LOG_INFO("CompactDAG: removed " << removeResult.value() << " compacted nodes");
+      }
+    }
+
+    std::vector<CID> cids;
+    cids.push_back(node->getCID());
+    auto broadcastResult = this->Broadcast(cids);
+    if (broadcastResult.has_failure())
+    {
+      return outcome::failure(broadcastResult.error());
+    }
+    return node->getCID();
+  }
+
+  uint64_t CrdtDatastore::GetSnapshotHeight() const
+  {
+    return this->snapshotHeight_;
+  }
+
+  CrdtSet::CacheStatistics CrdtDatastore::GetCacheStatistics() const
+  {
+    if (this->set_ == nullptr)
+    {
+      return CrdtSet::CacheStatistics();
+    }
+    return this->set_->GetCacheStatistics();
+  }
+
+  size_t CrdtDatastore::GetFetchRequestCount()
+  {
+    std::lock_guard lock(this->fetchMutex_);
+    return this->fetchedNodes_.size();
+  }
+
+  void CrdtDatastore::CompactDAGIfNeeded()
+  {
+    if (this->options_ == nullptr || this->options_->compactionHeightInterval == 0 || this->heads_ == nullptr)
+    {
+      return;
+    }
+
+    uint64_t maxHeight = 0;
+    std::vector<CID> heads;
+    auto getListResult = this->heads_->GetList(heads, maxHeight);
+    if (getListResult.has_failure() || maxHeight < this->snapshotHeight_ + this->options_->compactionHeightInterval)
+    {
+      return;
+    }
+
+    auto compactResult = this->CompactDAG(this->options_->removeCompactedNodes);
+    if (compactResult.has_failure())
+    {
+      LOG_ERROR("CompactDAGIfNeeded: failed to compact DAG at height " << maxHeight);
+    }
+  }
+
+  bool CrdtDatastore::IsDAGWalkInProgress()
+  {
+    {
+      std::lock_guard lock(this->dagWorkerJobListMutex_);
+      if (!this->dagWorkerJobList.empty() || this->activeWalkSteps_ > 0)
+      {
+        return true;
+      }
+    }
+
+    std::lock_guard lock(this->fetchMutex_);
+    return !this->fetchQueue_.empty();
+  }
+
+  void CrdtDatastore::EndWalkSteps(size_t aStepCount)
+  {
+    std::lock_guard lock(this->dagWorkerJobListMutex_);
+    this->activeWalkSteps_ -= aStepCount;
+    if (this->activeWalkSteps_ > 0 || !this->dagWorkerJobList.empty())
+    {
+      return;
+    }
+
+    // No walk takes the nodes that are left, they were fetched ahead of branches that stopped
+    // at heads or compacted nodes before reaching them
+    std::lock_guard fetchLock(this->fetchMutex_);
+    if (!this->fetchedNodes_.empty())
+    {
+      LOG_DEBUG("EndWalkSteps: evicting " << this->fetchedNodes_.size() << " fetched nodes");
+    }
+    this->fetchedNodes_.clear();
+    this->fetchQueue_ = std::queue<CID>();
+    ++this->fetchGeneration_;
+  }
+
+  outcome::result<void> CrdtDatastore::MarkCompacted(const std::vector<CID>& aCompactedHeads, uint64_t aSnapshotHeight)
+  {
+    if (this->dataStore_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    auto batchDatastore = this->dataStore_->batch();
+    Buffer keyBuffer;
+    Buffer valueBuffer;
+    valueBuffer.put(std::to_string(aSnapshotHeight));
+    for (const auto& cid : aCompactedHeads)
+    {
+      auto strCidResult = cid.toString();
+      if (strCidResult.has_failure())
+      {
+        return outcome::failure(strCidResult.error());
+      }
+
+      // /namespace/c/<cid>
+      keyBuffer.clear();
+      keyBuffer.put(this->namespaceKey_.ChildString(compactedNamespace_).ChildString(strCidResult.value()).GetKey());
+      auto putResult = batchDatastore->put(keyBuffer, valueBuffer);
+      if (putResult.has_failure())
+      {
+        return outcome::failure(putResult.error());
+      }
+    }
+
+    auto commitResult = batchDatastore->commit();
+    if (commitResult.has_failure())
+    {
+      return outcome::failure(commitResult.error());
+    }
+
+    // Concurrent snapshots can be processed in any order
+    uint64_t snapshotHeight = this->snapshotHeight_;
+    while (aSnapshotHeight > snapshotHeight && !this->snapshotHeight_.compare_exchange_weak(snapshotHeight, aSnapshotHeight))
+    {
+    }
+    return outcome::success();
+  }
+
+  outcome::result<bool> CrdtDatastore::IsCompacted(const CID& aCid)
+  {
+    if (this->dataStore_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    auto strCidResult = aCid.toString();
+    if (strCidResult.has_failure())
+    {
+      return outcome::failure(strCidResult.error());
+    }
+
+    // /namespace/c/<cid>
+    Buffer keyBuffer;
+    keyBuffer.put(this->namespaceKey_.ChildString(compactedNamespace_).ChildString(strCidResult.value()).GetKey());
+    return this->dataStore_->contains(keyBuffer);
+  }
+
+  outcome::result<size_t> CrdtDatastore::RemoveCompactedNodes(const std::vector<CID>& aCompactedHeads,
+    uint64_t aSnapshotHeight)
+  {
+    if (this->dagSyncer_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    // The heads are kept, so the snapshot can still be fetched with its links
+    std::unordered_set<CID, CIDHash> visitedNodes(aCompactedHeads.begin(), aCompactedHeads.end());
+    std::vector<CID> nodesToVisit;
+    for (const auto& head : aCompactedHeads)
+    {
+      auto getNodeResult = this->dagSyncer_->getNode(head);
+      if (getNodeResult.has_failure())
+      {
+        continue;
+      }
+
+      for (const auto& link : getNodeResult.value()->getLinks())
+      {
+        nodesToVisit.push_back(link.get().getCID());
+      }
+    }
+
+    std::vector<CID> compactedNodes;
+    while (!nodesToVisit.empty())
+    {
+      auto cid = nodesToVisit.back();
+      nodesToVisit.pop_back();
+      if (!visitedNodes.insert(cid).second)
+      {
+        continue;
+      }
+
+      auto getNodeResult = this->dagSyncer_->getNode(cid);
+      if (getNodeResult.has_failure())
+      {
+        // The node was removed by a previous compaction or it was never fetched
+        continue;
+      }
+
+      for (const auto& link : getNodeResult.value()->getLinks())
+      {
+        nodesToVisit.push_back(link.get().getCID());
+      }
+      compactedNodes.push_back(cid);
+    }
+
+    // A concurrent branch can link any of the nodes, once they are removed it could not fetch them
+    auto markResult = this->MarkCompacted(compactedNodes, aSnapshotHeight);
+    if (markResult.has_failure())
+    {
+      return outcome::failure(markResult.error());
+    }
+
+    size_t removedNodeCount = 0;
+    for (const auto& cid : compactedNodes)
+    {
+      if (!this->dagSyncer_->removeNode(cid).has_failure())
+      {
+        ++removedNodeCount;
+      }
+    }
+    return removedNodeCount;
+  }
+
   outcome::result<void> CrdtDatastore::PrintDAG()
   {
     if (this->heads_ == nullptr)
@@ -1,4 +1,5 @@
 #include <crdt/crdt_heads.hpp>
+#include <storage/rocksdb/rocksdb_cursor.hpp>
 #include <storage/database_error.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/system/error_code.hpp>
@@ -26,6 +27,9 @@ namespace sgns::crdt
       this->dataStore_ = aHeads.dataStore_;
       this->namespaceKey_ = aHeads.namespaceKey_;
       this->cache_ = aHeads.cache_;
+      this->maxHeight_ = aHeads.maxHeight_;
+      this->isMaxHeightOutdated_ = aHeads.isMaxHeightOutdated_;
+      this->version_ = aHeads.version_;
     }
     return *this;
   }
@@ -160,7 +164,7 @@ namespace sgns::crdt
     }
 
     std::lock_guard lg(this->mutex_);
-    this->cache_[aCid] = aHeight;
+    this->SetCachedHead(aCid, aHeight);
     return outcome::success();
   }
 
@@ -191,40 +195,86 @@ namespace sgns::crdt
     }
 
     std::lock_guard lg(this->mutex_);
-    this->cache_.erase(aCidHead);
-    this->cache_[aNewHeadCid] = aHeight;
+    this->RemoveCachedHead(aCidHead);
+    this->SetCachedHead(aNewHeadCid, aHeight);
     return outcome::success();
   }
 
   outcome::result<void> CrdtHeads::GetList(std::vector<CID>& aHeads, uint64_t& aMaxHeight)
   {
     std::lock_guard lg(this->mutex_);
-    aMaxHeight = 0;
     aHeads.clear(); 
+    aHeads.reserve(this->cache_.size());
     for (auto it = this->cache_.begin(); it != this->cache_.end(); ++it)
     {
       aHeads.push_back(it->first);
-      aMaxHeight = std::max(aMaxHeight, it->second);
     }
+
+    if (this->isMaxHeightOutdated_)
+    {
+      this->maxHeight_ = 0;
+      for (const auto& [cid, height] : this->cache_)
+      {
+        this->maxHeight_ = std::max(this->maxHeight_, height);
+      }
+      this->isMaxHeightOutdated_ = false;
+    }
+    aMaxHeight = this->maxHeight_;
     return outcome::success();
   }
 
+  uint64_t CrdtHeads::GetVersion()
+  {
+    std::lock_guard lg(this->mutex_);
+    return this->version_;
+  }
+
+  void CrdtHeads::SetCachedHead(const CID& aCid, uint64_t aHeight)
+  {
+    // A height of existing head is replaced
+    this->RemoveCachedHead(aCid);
+    this->cache_.emplace(aCid, aHeight);
+    if (aHeight >= this->maxHeight_)
+    {
+      // The stored maximum is not less than any actual height, so the new head is the highest one
+      this->maxHeight_ = aHeight;
+      this->isMaxHeightOutdated_ = false;
+    }
+    ++this->version_;
+  }
+
+  void CrdtHeads::RemoveCachedHead(const CID& aCid)
+  {
+    auto itHead = this->cache_.find(aCid);
+    if (itHead == this->cache_.end())
+    {
+      return;
+    }
+    if (itHead->second == this->maxHeight_)
+    {
+      this->isMaxHeightOutdated_ = true;
+    }
+    this->cache_.erase(itHead);
+    ++this->version_;
+  }
+
   outcome::result<void> CrdtHeads::PrimeCache()
   {
     // builds the heads cache based on what's in storage
     const auto strNamespace = this->namespaceKey_.GetKey();
     Buffer keyPrefixBuffer;
     keyPrefixBuffer.put(strNamespace);
-    auto queryResult = this->dataStore_->query(keyPrefixBuffer);
-    if (queryResult.has_failure())
-    {
-      return outcome::failure(queryResult.error());
-    }
-    
-    for (const auto& bufferKeyAndValue : queryResult.value())
+
+    // Heads are read with a cursor, so the namespace is not loaded into memory at once
+    auto cursor = this->dataStore_->prefixCursor(keyPrefixBuffer);
+    for (; cursor->isValid(); cursor->next())
     {
-      std::string keyWithNamespace = std::string(bufferKeyAndValue.first.toString());
-      std::string strCid = keyWithNamespace.erase(0, strNamespace.size() + 1);
+      auto keyView = cursor->keyView();
+      if (static_cast<size_t>(keyView.size()) <= strNamespace.size() + 1)
+      {
+        continue;
+      }
+      std::string strCid(keyView.begin() + strNamespace.size() + 1, keyView.end());
 
       auto cidResult = CID::fromString(strCid);
       if (cidResult.has_failure())
@@ -236,14 +286,15 @@ namespace sgns::crdt
       uint64_t height = 0;
       try
       {
-        height = boost::lexical_cast<uint64_t>(bufferKeyAndValue.second.toString());
+        auto valueView = cursor->valueView();
+        height = boost::lexical_cast<uint64_t>(std::string(valueView.begin(), valueView.end()));
       }
       catch (boost::bad_lexical_cast&)
       {
         return outcome::failure(boost::system::error_code{});
       }
 
-      this->cache_[cid] = height;
+      this->SetCachedHead(cid, height);
     }
     return outcome::success();
   }
@@ -1,11 +1,56 @@
 #include <crdt/crdt_set.hpp>
+#include <storage/rocksdb/rocksdb_cursor.hpp>
 #include <storage/database_error.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/lexical_cast.hpp>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace sgns::crdt
 {
+  namespace
+  {
+    /** Number of bits set in the key filter for each key */
+    constexpr size_t keyFilterHashCount = 4;
+
+    /** Checks if a key view returned by a cursor starts with a prefix without copying the key
+    */
+    bool StartsWith(gsl::span<const uint8_t> aKeyView, const std::string& aPrefix)
+    {
+      return (static_cast<size_t>(aKeyView.size()) >= aPrefix.size())
+        && (std::memcmp(aKeyView.data(), aPrefix.data(), aPrefix.size()) == 0);
+    }
+
+    /** Splits a key view /namespace/<s|t>/<key>/<id> into the element key and ID
+    * @param aKeyView key view returned by a cursor
+    * @param aNamespace elements or tombstones namespace, e.g. /namespace/s
+    * @param aKey returned element key
+    * @param aID returned element ID
+    * @return false if the key view does not hold a key and an ID
+    */
+    bool SplitElementKey(gsl::span<const uint8_t> aKeyView, const std::string& aNamespace,
+      std::string& aKey, std::string& aID)
+    {
+      if (!StartsWith(aKeyView, aNamespace + "/"))
+      {
+        return false;
+      }
+
+      std::string keyWithID(aKeyView.begin() + aNamespace.size(), aKeyView.end());
+      auto idPos = keyWithID.rfind('/');
+      if (idPos == std::string::npos || idPos == 0)
+      {
+        return false;
+      }
+      aKey = keyWithID.substr(0, idPos);
+      aID = keyWithID.substr(idPos + 1);
+      return true;
+    }
+  }
+
   const std::string CrdtSet::elemsNamespace_ = "s";
   const std::string CrdtSet::tombsNamespace_ = "t";
   const std::string CrdtSet::keysNamespace_ = "k";
@@ -85,22 +130,16 @@ namespace sgns::crdt
   outcome::result<std::shared_ptr<CrdtSet::Delta>> CrdtSet::CreateDeltaToRemove(const std::string& aKey)
   {
     auto delta = std::make_shared<CrdtSet::Delta>();
-    // /namespace/s/<key>
-    auto prefix = this->ElemsPrefix(aKey);
-    auto strElemsPrefix = prefix.GetKey();
+    // /namespace/s/<key>/
+    auto strElemsPrefix = this->ElemsPrefix(aKey).GetKey() + "/";
 
     Buffer keyPrefixBuffer;
     keyPrefixBuffer.put(strElemsPrefix);
-    auto queryResult = this->dataStore_->query(keyPrefixBuffer);
-    if (queryResult.has_failure())
-    {
-      return outcome::failure(queryResult.error());
-    }
-
-    for (const auto& bufferKeyAndValue : queryResult.value())
+    auto cursor = this->dataStore_->prefixCursor(keyPrefixBuffer);
+    for (; cursor->isValid(); cursor->next())
     {
-      std::string keyWithPrefix = std::string(bufferKeyAndValue.first.toString());
-      std::string id = keyWithPrefix.erase(0, strElemsPrefix.size());
+      auto keyView = cursor->keyView();
+      std::string id(keyView.begin() + strElemsPrefix.size(), keyView.end());
 
       auto hId = HierarchicalKey(id);
 
@@ -123,6 +162,105 @@ namespace sgns::crdt
     return delta;
   }
 
+  outcome::result<std::shared_ptr<CrdtSet::Delta>> CrdtSet::CreateSnapshotDelta()
+  {
+    if (this->dataStore_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    auto delta = std::make_shared<CrdtSet::Delta>();
+    delta->set_snapshot(true);
+
+    // /namespace/s
+    auto strElemsNamespace = this->ElemsPrefix("").GetKey();
+    Buffer elemsPrefixBuffer;
+    elemsPrefixBuffer.put(strElemsNamespace + "/");
+    auto elemsCursor = this->dataStore_->prefixCursor(elemsPrefixBuffer);
+
+    // /namespace/t
+    auto strTombsNamespace = this->TombsPrefix("").GetKey();
+    Buffer tombsPrefixBuffer;
+    tombsPrefixBuffer.put(strTombsNamespace + "/");
+    auto tombsCursor = this->dataStore_->prefixCursor(tombsPrefixBuffer);
+
+    // The value of a key is read from the keys namespace while any of its elements is not tombstoned,
+    // so each element gets the value and priority of its key, which reproduces the set state.
+    // Elements of a key are adjacent, so the key value and priority are read once
+    std::string key;
+    std::string id;
+    std::string lastKey;
+    std::string lastValue;
+    uint64_t lastPriority = 0;
+    bool hasLastValue = false;
+    Buffer tombKeyBuffer;
+    for (; elemsCursor->isValid(); elemsCursor->next())
+    {
+      if (!SplitElementKey(elemsCursor->keyView(), strElemsNamespace, key, id))
+      {
+        continue;
+      }
+
+      // /namespace/t/<key>/<id>
+      tombKeyBuffer.clear();
+      tombKeyBuffer.put(this->TombsPrefix(key).ChildString(id).GetKey());
+      auto seekResult = tombsCursor->seek(tombKeyBuffer);
+      if (seekResult.has_failure())
+      {
+        return outcome::failure(seekResult.error());
+      }
+
+      if (tombsCursor->isValid() && (tombKeyBuffer == tombsCursor->keyView()))
+      {
+        continue;
+      }
+
+      if (key != lastKey)
+      {
+        lastKey = key;
+        auto valueResult = this->GetValueFromDatastore(this->ValueKey(key));
+        auto priorityResult = this->GetPriority(key);
+        hasLastValue = !valueResult.has_failure() && !priorityResult.has_failure();
+        if (hasLastValue)
+        {
+          lastValue = valueResult.value();
+          lastPriority = priorityResult.value();
+        }
+      }
+
+      if (!hasLastValue)
+      {
+        continue;
+      }
+
+      auto element = delta->add_elements();
+      element->set_key(key);
+      element->set_id(id);
+      element->set_value(lastValue);
+      element->set_priority(lastPriority);
+    }
+
+    auto seekResult = tombsCursor->seek(tombsPrefixBuffer);
+    if (seekResult.has_failure())
+    {
+      return outcome::failure(seekResult.error());
+    }
+
+    for (; tombsCursor->isValid(); tombsCursor->next())
+    {
+      if (!SplitElementKey(tombsCursor->keyView(), strTombsNamespace, key, id))
+      {
+        continue;
+      }
+
+      auto tombstone = delta->add_tombstones();
+      tombstone->set_key(key);
+      tombstone->set_id(id);
+    }
+
+    return delta;
+  }
+
   outcome::result<CrdtSet::Buffer> CrdtSet::GetElement(const std::string& aKey)
   {
     // We can only GET an element if it's part of the Set (in
@@ -135,6 +273,17 @@ namespace sgns::crdt
     // * If the key does not have a value in the store:
     //   -> It was either never added
 
+    auto cacheLookup = this->LookupCache(aKey);
+    if (cacheLookup.isFilteredOut_)
+    {
+      return outcome::failure(storage::DatabaseError::NOT_FOUND);
+    }
+
+    if (cacheLookup.value_.has_value())
+    {
+      return cacheLookup.value_.value();
+    }
+
     auto valueK = this->ValueKey(aKey);
     auto valueResult = this->GetValueFromDatastore(valueK);
 
@@ -163,10 +312,29 @@ namespace sgns::crdt
     Buffer bufferValue;
     bufferValue.put(valueResult.value());
 
+    this->CacheValue(aKey, bufferValue, cacheLookup.cacheGeneration_);
     return bufferValue;
   }
 
   outcome::result<CrdtSet::QueryResult> CrdtSet::QueryElements(const std::string& aPrefix, const QuerySuffix& aSuffix /*=QuerySuffix::QUERY_ALL*/)
+  {
+    QueryResult elements;
+    auto queryResult = this->QueryElements(aPrefix, aSuffix,
+      [&elements](const Buffer& aKey, const Buffer& aValue)
+      {
+        elements.emplace(aKey, aValue);
+        return true;
+      });
+    if (queryResult.has_failure())
+    {
+      return outcome::failure(queryResult.error());
+    }
+
+    return elements;
+  }
+
+  outcome::result<void> CrdtSet::QueryElements(const std::string& aPrefix, const QuerySuffix& aSuffix,
+    const QueryCallback& aCallback, size_t aOffset /*= 0*/, size_t aLimit /*= 0*/)
   {
     if (this->dataStore_ == nullptr)
     {
@@ -183,51 +351,89 @@ namespace sgns::crdt
     // * If the key does not have a value in the store:
     //   -> It was either never added
 
+    // /namespace/k/
+    auto keysNamespacePrefix = this->KeysKey("").GetKey() + "/";
     // /namespace/k/<prefix>
-    auto prefixKeysKey = this->KeysKey(aPrefix);
+    auto prefixKeysKey = this->KeysKey(aPrefix).GetKey();
 
+    // The keys namespace is walked once in the key order. Elements and tombstones
+    // of each key are found by repositioning cursors which are opened once per query.
+    // Cursors are bounded by their namespaces, so rocksdb does not read keys beyond them.
     Buffer keyPrefixBuffer;
-    keyPrefixBuffer.put(prefixKeysKey.GetKey());
-    auto queryResult = this->dataStore_->query(keyPrefixBuffer);
-    if (queryResult.has_failure())
+    keyPrefixBuffer.put(prefixKeysKey);
+    auto keysCursor = this->dataStore_->prefixCursor(keyPrefixBuffer);
+
+    Buffer elemsPrefixBuffer;
+    elemsPrefixBuffer.put(this->ElemsPrefix("").GetKey() + "/");
+    auto elemsCursor = this->dataStore_->prefixCursor(elemsPrefixBuffer);
+
+    Buffer tombsPrefixBuffer;
+    tombsPrefixBuffer.put(this->TombsPrefix("").GetKey() + "/");
+    auto tombsCursor = this->dataStore_->prefixCursor(tombsPrefixBuffer);
+
+    // Value and priority entries of a key are checked for tombstones once
+    std::string lastKey;
+    bool hasLastKey = false;
+    bool isLastKeyInSet = false;
+    size_t matchedCount = 0;
+    size_t passedCount = 0;
+    for (; keysCursor->isValid(); keysCursor->next())
     {
-      return outcome::failure(queryResult.error());
-    }
+      // /namespace/k/<key>/{v,p}
+      auto keyView = keysCursor->keyView();
+      std::string keyWithPrefix(keyView.begin(), keyView.end());
 
-    QueryResult elements;
-    // Check if elements tombstoned.
-    for (const auto& element : queryResult.value())
-    {
-      auto inSetResult = this->InElemsNotTombstoned(std::string(element.first.toString()));
-      if (inSetResult.has_failure() || !inSetResult.value())
+      auto suffixPos = keyWithPrefix.rfind('/');
+      if (!boost::algorithm::starts_with(keyWithPrefix, keysNamespacePrefix) || suffixPos < keysNamespacePrefix.size())
       {
         continue;
       }
 
-      std::string key = std::string(element.first.toString());
+      auto suffix = keyWithPrefix.substr(suffixPos + 1);
       switch (aSuffix)
       {
       case QuerySuffix::QUERY_ALL:
-        elements.insert(element);
         break;
       case QuerySuffix::QUERY_PRIORITYSUFFIX:
-        if (boost::algorithm::ends_with(key, "/" + this->prioritySuffix_))
+        if (suffix != this->prioritySuffix_)
         {
-          elements.insert(element);
+          continue;
         }
         break;
       case QuerySuffix::QUERY_VALUESUFFIX:
-        if (boost::algorithm::ends_with(key, "/" + this->valueSuffix_))
+        if (suffix != this->valueSuffix_)
         {
-          elements.insert(element);
+          continue;
         }
         break;
-      default: 
-        return outcome::failure(queryResult.error());
+      default:
+        return outcome::failure(boost::system::error_code{});
+      }
+
+      auto key = keyWithPrefix.substr(keysNamespacePrefix.size(), suffixPos - keysNamespacePrefix.size());
+      if (!hasLastKey || key != lastKey)
+      {
+        // Check if element tombstoned.
+        auto inSetResult = this->InElemsNotTombstoned(key, *elemsCursor, *tombsCursor);
+        lastKey = key;
+        hasLastKey = true;
+        isLastKeyInSet = inSetResult.has_value() && inSetResult.value();
+      }
+
+      if (!isLastKeyInSet || (matchedCount++ < aOffset))
+      {
+        continue;
+      }
+
+      // Only returned pairs are copied
+      ++passedCount;
+      if (!aCallback(Buffer(keyView), Buffer(keysCursor->valueView())) || (aLimit > 0 && passedCount >= aLimit))
+      {
+        break;
       }
     }
 
-    return elements;
+    return outcome::success();
   }
 
   outcome::result<bool> CrdtSet::IsValueInSet(const std::string& aKey)
@@ -237,6 +443,12 @@ namespace sgns::crdt
       return outcome::failure(boost::system::error_code{});
     }
 
+    auto cacheLookup = this->LookupCache(aKey);
+    if (cacheLookup.isFilteredOut_ || cacheLookup.value_.has_value())
+    {
+      return !cacheLookup.isFilteredOut_;
+    }
+
     // Optimization: if we do not have a value
     // this key was never added.
     auto valueK = this->ValueKey(aKey);
@@ -261,29 +473,50 @@ namespace sgns::crdt
 
   outcome::result<bool> CrdtSet::InElemsNotTombstoned(const std::string& aKey)
   {
-    // /namespace/elems/<key>
-    auto prefix = this->ElemsPrefix(aKey);
-    auto strElemsPrefix = prefix.GetKey();
+    if (this->dataStore_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    // /namespace/s/<key>/
+    Buffer elemsPrefixBuffer;
+    elemsPrefixBuffer.put(this->ElemsPrefix(aKey).GetKey() + "/");
+    auto elemsCursor = this->dataStore_->prefixCursor(elemsPrefixBuffer);
+
+    // /namespace/t/<key>/
+    Buffer tombsPrefixBuffer;
+    tombsPrefixBuffer.put(this->TombsPrefix(aKey).GetKey() + "/");
+    auto tombsCursor = this->dataStore_->prefixCursor(tombsPrefixBuffer);
+
+    return this->InElemsNotTombstoned(aKey, *elemsCursor, *tombsCursor);
+  }
+
+  outcome::result<bool> CrdtSet::InElemsNotTombstoned(const std::string& aKey,
+    DataStore::Cursor& aElemsCursor, DataStore::Cursor& aTombsCursor)
+  {
+    // /namespace/s/<key>/
+    auto strElemsPrefix = this->ElemsPrefix(aKey).GetKey() + "/";
 
     Buffer keyPrefixBuffer;
     keyPrefixBuffer.put(strElemsPrefix);
-    auto queryResult = this->dataStore_->query(keyPrefixBuffer);
-    if (queryResult.has_failure())
+    auto seekResult = aElemsCursor.seek(keyPrefixBuffer);
+    if (seekResult.has_failure())
     {
-      return outcome::failure(queryResult.error());
+      return outcome::failure(seekResult.error());
     }
 
-    if (queryResult.value().empty())
+    bool hasElements = false;
+    for (; aElemsCursor.isValid(); aElemsCursor.next())
     {
-      return true;
-    }
+      auto keyView = aElemsCursor.keyView();
+      if (!StartsWith(keyView, strElemsPrefix))
+      {
+        break;
+      }
+      hasElements = true;
 
-    for (const auto& bufferKeyAndValue : queryResult.value())
-    {
-      std::string keyWithPrefix = std::string(bufferKeyAndValue.first.toString());
-      std::string id = keyWithPrefix.erase(0, strElemsPrefix.size());
-      auto hId = HierarchicalKey(id);
-      if (!hId.IsTopLevel())
+      std::string id(keyView.begin() + strElemsPrefix.size(), keyView.end());
+      if (id.find('/') != std::string::npos)
       {
         // our prefix matches blocks from other keys i.e. our
         // prefix is "hello" and we have a different key like
@@ -292,15 +525,23 @@ namespace sgns::crdt
         // should be the block id only.
         continue;
       }
+
       // if not tombstoned, we have it
-      auto inTombResult = this->InTombsKeyID(aKey, hId.GetKey());
-      if (inTombResult.has_value() && !inTombResult.value())
+      Buffer tombKeyBuffer;
+      tombKeyBuffer.put(this->TombsPrefix(aKey).ChildString(id).GetKey());
+      seekResult = aTombsCursor.seek(tombKeyBuffer);
+      if (seekResult.has_failure())
+      {
+        return outcome::failure(seekResult.error());
+      }
+
+      if (!aTombsCursor.isValid() || !(tombKeyBuffer == aTombsCursor.keyView()))
       {
         return true;
       }
     }
 
-    return false;
+    return !hasElements;
   }
 
   HierarchicalKey CrdtSet::KeyPrefix(const std::string& aKey)
@@ -391,6 +632,33 @@ namespace sgns::crdt
     return this->dataStore_->put(keyBuffer, valueBuffer);
   }
 
+  outcome::result<void> CrdtSet::SetPriority(const std::unique_ptr<storage::BufferBatch>& aDataStore, const std::string& aKey,
+    const uint64_t& aPriority)
+  {
+    if (aDataStore == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    std::string strPriority;
+    try
+    {
+      strPriority = boost::lexical_cast<std::string>(aPriority + 1);
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    Buffer keyBuffer;
+    keyBuffer.put(this->PriorityKey(aKey).GetKey());
+
+    Buffer valueBuffer;
+    valueBuffer.put(strPriority);
+
+    return aDataStore->put(keyBuffer, valueBuffer);
+  }
+
   outcome::result<void> CrdtSet::SetValue(const std::string& aKey, const std::string& aID, const Buffer& aValue, 
     const uint64_t& aPriority)
   {
@@ -411,6 +679,7 @@ namespace sgns::crdt
     {
       return outcome::failure(commitResult.error());
     }
+    this->InvalidateCachedValues({ aKey });
 
     return outcome::success();
   }
@@ -460,6 +729,7 @@ namespace sgns::crdt
     }
 
     // store value
+    this->AddToKeyFilter(aKey);
     Buffer valueKeyBuffer;
     valueKeyBuffer.put(valueK.GetKey());
 
@@ -503,6 +773,7 @@ namespace sgns::crdt
 
     Buffer keyBuffer;
     Buffer valueBuffer;
+    std::vector<std::string> keys;
     for(auto& elem : aElems)
     {
       // overwrite the identifier as it would come unset
@@ -514,7 +785,7 @@ namespace sgns::crdt
       keyBuffer.clear();
       keyBuffer.put(kNamespace.GetKey());
 
-      auto putResult = batchDatastore->put(keyBuffer, Buffer());  
+      auto putResult = batchDatastore->put(keyBuffer, Buffer());
       if (putResult.has_error())
       {
         return outcome::failure(putResult.error());
@@ -530,12 +801,14 @@ namespace sgns::crdt
       {
         return outcome::failure(setValueResult.error());
       }
+      keys.push_back(key);
     }
     auto commitResult = batchDatastore->commit();
     if (commitResult.has_failure())
     {
       return outcome::failure(commitResult.error());
     }
+    this->InvalidateCachedValues(keys);
 
     return outcome::success();
   }
@@ -582,6 +855,7 @@ namespace sgns::crdt
     {
       return outcome::failure(commitResult.error());
     }
+    this->InvalidateCachedValues(deletedKeys);
 
     if (deleteHookFunc_ != nullptr)
     {
@@ -594,6 +868,89 @@ namespace sgns::crdt
     return outcome::success();
   }
 
+  outcome::result<void> CrdtSet::PutSnapshotElems(const std::vector<Element>& aElems)
+  {
+    if (aElems.empty())
+    {
+      return outcome::success();
+    }
+
+    if (this->dataStore_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    std::lock_guard lg(this->mutex_);
+
+    auto batchDatastore = this->dataStore_->batch();
+
+    // Values put to the batch are not visible to SetValue before commit,
+    // so each key is set once from its new element with the highest priority and value
+    std::unordered_map<std::string, const Element*> keyElements;
+    Buffer keyBuffer;
+    for (const auto& elem : aElems)
+    {
+      // /namespace/s/<key>/<id>
+      auto kNamespace = this->ElemsPrefix(elem.key()).ChildString(elem.id());
+      keyBuffer.clear();
+      keyBuffer.put(kNamespace.GetKey());
+
+      // A snapshot applied on top of the history it was created from changes nothing
+      if (this->dataStore_->contains(keyBuffer))
+      {
+        continue;
+      }
+
+      auto isDeletedResult = this->InTombsKeyID(elem.key(), elem.id());
+      if (isDeletedResult.has_failure())
+      {
+        return outcome::failure(isDeletedResult.error());
+      }
+
+      if (isDeletedResult.value())
+      {
+        continue;
+      }
+
+      auto putResult = batchDatastore->put(keyBuffer, Buffer());
+      if (putResult.has_error())
+      {
+        return outcome::failure(putResult.error());
+      }
+
+      auto& keyElement = keyElements[elem.key()];
+      if (keyElement == nullptr || elem.priority() > keyElement->priority() ||
+        (elem.priority() == keyElement->priority() && keyElement->value() < elem.value()))
+      {
+        keyElement = &elem;
+      }
+    }
+
+    Buffer valueBuffer;
+    std::vector<std::string> keys;
+    keys.reserve(keyElements.size());
+    for (const auto& [key, elem] : keyElements)
+    {
+      valueBuffer.clear();
+      valueBuffer.put(elem->value());
+      auto setValueResult = this->SetValue(batchDatastore, key, elem->id(), valueBuffer, elem->priority());
+      if (setValueResult.has_failure())
+      {
+        return outcome::failure(setValueResult.error());
+      }
+      keys.push_back(key);
+    }
+
+    auto commitResult = batchDatastore->commit();
+    if (commitResult.has_failure())
+    {
+      return outcome::failure(commitResult.error());
+    }
+    this->InvalidateCachedValues(keys);
+
+    return outcome::success();
+  }
+
   outcome::result<void> CrdtSet::Merge(const std::shared_ptr<CrdtSet::Delta>& aDelta, const std::string& aID)
   {
     if (aDelta == nullptr)
@@ -601,6 +958,34 @@ namespace sgns::crdt
       return outcome::failure(boost::system::error_code{});
     }
 
+    if (aDelta->snapshot())
+    {
+      // Known tombstones are skipped so the delete hook is not triggered again for keys removed long ago
+      std::vector<Element> snapshotTombstones;
+      for (const auto& tomb : aDelta->tombstones())
+      {
+        auto isDeletedResult = this->InTombsKeyID(tomb.key(), tomb.id());
+        if (isDeletedResult.has_failure())
+        {
+          return outcome::failure(isDeletedResult.error());
+        }
+
+        if (!isDeletedResult.value())
+        {
+          snapshotTombstones.push_back(tomb);
+        }
+      }
+
+      auto putTombsResult = this->PutTombs(snapshotTombstones);
+      if (putTombsResult.has_failure())
+      {
+        return outcome::failure(putTombsResult.error());
+      }
+
+      std::vector<Element> snapshotElements(aDelta->elements().begin(), aDelta->elements().end());
+      return this->PutSnapshotElems(snapshotElements);
+    }
+
     std::vector<Element> tombstones(aDelta->tombstones().begin(), aDelta->tombstones().end());
     auto putTombsResult = this->PutTombs(tombstones);
     if (putTombsResult.has_failure())
@@ -612,6 +997,203 @@ namespace sgns::crdt
     return this->PutElems(elements, aID, aDelta->priority());
   }
 
+  outcome::result<void> CrdtSet::MergeDeltas(const std::vector<std::pair<std::shared_ptr<Delta>, std::string>>& aDeltas,
+    bool aSync)
+  {
+    if (this->dataStore_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    // Snapshots skip elements known to the datastore, so they are merged before the group
+    bool hasDeltas = false;
+    for (const auto& [delta, id] : aDeltas)
+    {
+      if (delta == nullptr)
+      {
+        return outcome::failure(boost::system::error_code{});
+      }
+
+      if (!delta->snapshot())
+      {
+        hasDeltas = true;
+        continue;
+      }
+
+      auto mergeResult = this->Merge(delta, id);
+      if (mergeResult.has_failure())
+      {
+        return outcome::failure(mergeResult.error());
+      }
+    }
+
+    if (!hasDeltas)
+    {
+      return outcome::success();
+    }
+
+    DataStore::WriteOptions writeOptions;
+    writeOptions.sync = aSync;
+    auto batchDatastore = this->dataStore_->batch(writeOptions);
+
+    // Priorities and values of keys written to the batch, values are read only when priorities are equal
+    struct KeyState
+    {
+      uint64_t priority_ = 0;
+      std::string value_;
+      bool isValueRead_ = false;
+    };
+    std::unordered_map<std::string, KeyState> keyStates;
+    std::unordered_set<std::string> tombKeys;
+
+    // Hooks in the merge order, a key without a value is deleted
+    std::vector<std::pair<std::string, std::optional<Buffer>>> hookCalls;
+
+    std::lock_guard lg(this->mutex_);
+
+    Buffer keyBuffer;
+    Buffer valueBuffer;
+    for (const auto& [delta, id] : aDeltas)
+    {
+      if (delta->snapshot())
+      {
+        continue;
+      }
+
+      for (const auto& tomb : delta->tombstones())
+      {
+        // /namespace/t/<key>/<id>
+        auto kNamespace = this->TombsPrefix(tomb.key()).ChildString(tomb.id());
+        keyBuffer.clear();
+        keyBuffer.put(kNamespace.GetKey());
+
+        auto putResult = batchDatastore->put(keyBuffer, Buffer());
+        if (putResult.has_error())
+        {
+          return outcome::failure(putResult.error());
+        }
+        tombKeys.insert(kNamespace.GetKey());
+        hookCalls.emplace_back(tomb.key(), std::nullopt);
+      }
+
+      for (const auto& elem : delta->elements())
+      {
+        const auto& key = elem.key();
+
+        // /namespace/s/<key>/<id>
+        keyBuffer.clear();
+        keyBuffer.put(this->ElemsPrefix(key).ChildString(id).GetKey());
+        auto putResult = batchDatastore->put(keyBuffer, Buffer());
+        if (putResult.has_error())
+        {
+          return outcome::failure(putResult.error());
+        }
+
+        // Elements tombstoned before they are added fail the merge, like in PutElems
+        if (tombKeys.count(this->TombsPrefix(key).ChildString(id).GetKey()) > 0)
+        {
+          return outcome::failure(boost::system::error_code{});
+        }
+
+        auto isDeletedResult = this->InTombsKeyID(key, id);
+        if (isDeletedResult.has_failure() || isDeletedResult.value() == true)
+        {
+          return outcome::failure(boost::system::error_code{});
+        }
+
+        auto itKeyState = keyStates.find(key);
+        if (itKeyState == keyStates.end())
+        {
+          auto priorityResult = this->GetPriority(key);
+          if (priorityResult.has_failure())
+          {
+            return outcome::failure(priorityResult.error());
+          }
+
+          KeyState keyState;
+          keyState.priority_ = priorityResult.value();
+          itKeyState = keyStates.emplace(key, std::move(keyState)).first;
+        }
+
+        auto& keyState = itKeyState->second;
+        if (delta->priority() < keyState.priority_)
+        {
+          continue;
+        }
+
+        if (delta->priority() == keyState.priority_)
+        {
+          if (!keyState.isValueRead_)
+          {
+            auto valueResult = this->GetValueFromDatastore(this->ValueKey(key));
+            if (valueResult.has_failure())
+            {
+              return outcome::failure(valueResult.error());
+            }
+            keyState.value_ = valueResult.value();
+            keyState.isValueRead_ = true;
+          }
+
+          // comparing two data lexicographically, current value >= elem value, no need to store value
+          if (!boost::lexicographical_compare<std::string, std::string>(keyState.value_, elem.value()))
+          {
+            continue;
+          }
+        }
+
+        this->AddToKeyFilter(key);
+        keyBuffer.clear();
+        keyBuffer.put(this->ValueKey(key).GetKey());
+        valueBuffer.clear();
+        valueBuffer.put(elem.value());
+        putResult = batchDatastore->put(keyBuffer, valueBuffer);
+        if (putResult.has_error())
+        {
+          return outcome::failure(putResult.error());
+        }
+
+        auto setPriorityResult = this->SetPriority(batchDatastore, key, delta->priority());
+        if (setPriorityResult.has_failure())
+        {
+          return outcome::failure(setPriorityResult.error());
+        }
+
+        keyState.priority_ = delta->priority();
+        keyState.value_ = elem.value();
+        keyState.isValueRead_ = true;
+        hookCalls.emplace_back(key, valueBuffer);
+      }
+    }
+
+    auto commitResult = batchDatastore->commit();
+    if (commitResult.has_failure())
+    {
+      return outcome::failure(commitResult.error());
+    }
+
+    std::vector<std::string> changedKeys;
+    changedKeys.reserve(hookCalls.size());
+    for (const auto& hookCall : hookCalls)
+    {
+      changedKeys.push_back(hookCall.first);
+    }
+    this->InvalidateCachedValues(changedKeys);
+
+    for (const auto& [key, value] : hookCalls)
+    {
+      if (value.has_value() && this->putHookFunc_ != nullptr)
+      {
+        this->putHookFunc_(key, value.value());
+      }
+      else if (!value.has_value() && this->deleteHookFunc_ != nullptr)
+      {
+        this->deleteHookFunc_(key);
+      }
+    }
+
+    return outcome::success();
+  }
+
   outcome::result<bool> CrdtSet::InTombsKeyID(const std::string& aKey, const std::string& aID)
   {
     if (this->dataStore_ == nullptr)
@@ -625,6 +1207,168 @@ namespace sgns::crdt
     return this->dataStore_->contains(keyBuffer);
   }
 
+  double CrdtSet::CacheStatistics::GetHitRate() const
+  {
+    if (lookupCount == 0)
+    {
+      return 0;
+    }
+    return static_cast<double>(filterNegativeCount + cacheHitCount) / lookupCount;
+  }
+
+  outcome::result<void> CrdtSet::EnableCache(size_t aKeyFilterBitCount, size_t aValueCacheSize)
+  {
+    if (this->dataStore_ == nullptr)
+    {
+      return outcome::failure(boost::system::error_code{});
+    }
+
+    {
+      std::lock_guard lock(this->cacheMutex_);
+      this->keyFilterBits_.clear();
+      this->valueCacheSize_ = aValueCacheSize;
+      this->cachedValues_.clear();
+      this->cachedValueIndex_.clear();
+      ++this->cacheGeneration_;
+    }
+
+    if (aKeyFilterBitCount == 0)
+    {
+      return outcome::success();
+    }
+
+    // The filter is filled before it is used, so the set should not be merged into meanwhile
+    std::vector<uint64_t> keyFilterBits((aKeyFilterBitCount + 63) / 64, 0);
+    size_t keyFilterBitCount = keyFilterBits.size() * 64;
+
+    // /namespace/k/<key>/{v,p}
+    auto keysNamespacePrefix = this->KeysKey("").GetKey() + "/";
+    Buffer keyPrefixBuffer;
+    keyPrefixBuffer.put(keysNamespacePrefix);
+    auto keysCursor = this->dataStore_->prefixCursor(keyPrefixBuffer);
+    for (; keysCursor->isValid(); keysCursor->next())
+    {
+      auto keyView = keysCursor->keyView();
+      std::string keyWithPrefix(keyView.begin() + keysNamespacePrefix.size(), keyView.end());
+      auto suffixPos = keyWithPrefix.rfind('/');
+      if (suffixPos == std::string::npos || keyWithPrefix.substr(suffixPos + 1) != this->valueSuffix_)
+      {
+        continue;
+      }
+
+      for (auto bit : GetKeyFilterBits(keyWithPrefix.substr(0, suffixPos), keyFilterBitCount))
+      {
+        keyFilterBits[bit / 64] |= (uint64_t(1) << (bit % 64));
+      }
+    }
+
+    std::lock_guard lock(this->cacheMutex_);
+    this->keyFilterBits_ = std::move(keyFilterBits);
+    return outcome::success();
+  }
+
+  CrdtSet::CacheStatistics CrdtSet::GetCacheStatistics() const
+  {
+    std::lock_guard lock(this->cacheMutex_);
+    return this->cacheStatistics_;
+  }
+
+  CrdtSet::CacheLookup CrdtSet::LookupCache(const std::string& aKey)
+  {
+    CacheLookup cacheLookup;
+    std::lock_guard lock(this->cacheMutex_);
+    ++this->cacheStatistics_.lookupCount;
+    cacheLookup.cacheGeneration_ = this->cacheGeneration_;
+
+    if (!this->keyFilterBits_.empty())
+    {
+      for (auto bit : GetKeyFilterBits(aKey, this->keyFilterBits_.size() * 64))
+      {
+        if ((this->keyFilterBits_[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+        {
+          ++this->cacheStatistics_.filterNegativeCount;
+          cacheLookup.isFilteredOut_ = true;
+          return cacheLookup;
+        }
+      }
+    }
+
+    auto itCachedValue = this->cachedValueIndex_.find(aKey);
+    if (itCachedValue != this->cachedValueIndex_.end())
+    {
+      ++this->cacheStatistics_.cacheHitCount;
+      this->cachedValues_.splice(this->cachedValues_.begin(), this->cachedValues_, itCachedValue->second);
+      cacheLookup.value_ = itCachedValue->second->second;
+    }
+    return cacheLookup;
+  }
+
+  void CrdtSet::CacheValue(const std::string& aKey, const Buffer& aValue, uint64_t aCacheGeneration)
+  {
+    std::lock_guard lock(this->cacheMutex_);
+    // A value read before an invalidation may be stale
+    if (this->valueCacheSize_ == 0 || aCacheGeneration != this->cacheGeneration_ ||
+      this->cachedValueIndex_.count(aKey) > 0)
+    {
+      return;
+    }
+
+    this->cachedValues_.emplace_front(aKey, aValue);
+    this->cachedValueIndex_[aKey] = this->cachedValues_.begin();
+    if (this->cachedValues_.size() > this->valueCacheSize_)
+    {
+      this->cachedValueIndex_.erase(this->cachedValues_.back().first);
+      this->cachedValues_.pop_back();
+    }
+  }
+
+  void CrdtSet::AddToKeyFilter(const std::string& aKey)
+  {
+    std::lock_guard lock(this->cacheMutex_);
+    if (this->keyFilterBits_.empty())
+    {
+      return;
+    }
+
+    for (auto bit : GetKeyFilterBits(aKey, this->keyFilterBits_.size() * 64))
+    {
+      this->keyFilterBits_[bit / 64] |= (uint64_t(1) << (bit % 64));
+    }
+  }
+
+  void CrdtSet::InvalidateCachedValues(const std::vector<std::string>& aKeys)
+  {
+    if (aKeys.empty())
+    {
+      return;
+    }
+
+    std::lock_guard lock(this->cacheMutex_);
+    ++this->cacheGeneration_;
+    for (const auto& key : aKeys)
+    {
+      auto itCachedValue = this->cachedValueIndex_.find(key);
+      if (itCachedValue != this->cachedValueIndex_.end())
+      {
+        this->cachedValues_.erase(itCachedValue->second);
+        this->cachedValueIndex_.erase(itCachedValue);
+      }
+    }
+  }
+
+  std::vector<size_t> CrdtSet::GetKeyFilterBits(const std::string& aKey, size_t aKeyFilterBitCount)
+  {
+    // Bit positions are derived from one hash by double hashing
+    auto keyHash = std::hash<std::string>{}(aKey);
+    std::vector<size_t> bits;
+    bits.reserve(keyFilterHashCount);
+    for (size_t hashIdx = 0; hashIdx < keyFilterHashCount; ++hashIdx)
+    {
+      bits.push_back((keyHash + hashIdx * ((keyHash >> 17) | 1)) % aKeyFilterBitCount);
+    }
+    return bits;
+  }
+
   void CrdtSet::SetPutHook(const PutHookPtr& putHookPtr)
   {
     this->putHookFunc_ = putHookPtr;
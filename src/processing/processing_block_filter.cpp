@@ -0,0 +1,118 @@
+#include "processing_block_filter.hpp"
+
+#include <algorithm>
+
+namespace sgns::processing
+{
+namespace
+{
+    /** FNV-1a hash of a string with a seed
+    */
+    uint64_t HashBlockId(const std::string& blockId, uint64_t seed)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull ^ seed;
+        for (auto ch : blockId)
+        {
+            hash ^= static_cast<uint8_t>(ch);
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ProcessingBlockFilter::ProcessingBlockFilter(size_t bitCount, size_t hashCount)
+    : m_bits(std::min((std::max<size_t>(bitCount, 1) + 7) / 8, MAX_BYTE_COUNT), 0)
+    , m_hashCount(std::clamp<size_t>(hashCount, 1, MAX_HASH_COUNT))
+    , m_addedBlockCount(0)
+{
+}
+
+ProcessingBlockFilter::ProcessingBlockFilter(const SGProcessing::BlockFilter& filter)
+    : m_hashCount(std::min<size_t>(filter.hash_count(), MAX_HASH_COUNT))
+    , m_addedBlockCount(0)
+{
+    // Checking fewer bits for a block id can only add false positives,
+    // so a clamped hash count is still consistent with the received bits.
+    // A filter with all bits set matches any block and carries no locality information.
+    const auto& bits = filter.bits();
+    bool isSaturated = std::all_of(bits.begin(), bits.end(), [](char bits) { return static_cast<uint8_t>(bits) == 0xFF; });
+    if (bits.empty() || (bits.size() > MAX_BYTE_COUNT) || (m_hashCount == 0) || isSaturated)
+    {
+        // Rejected filters are considered as empty
+        m_bits.assign(1, 0);
+        m_hashCount = 1;
+        return;
+    }
+
+    m_bits.assign(bits.begin(), bits.end());
+    if (std::any_of(m_bits.begin(), m_bits.end(), [](uint8_t bits) { return bits != 0; }))
+    {
+        // The exact number of blocks is unknown for received filters
+        m_addedBlockCount = 1;
+    }
+}
+
+void ProcessingBlockFilter::Add(const std::string& blockId)
+{
+    // Double hashing is used to get hashCount bit positions from 2 hashes
+    auto hash1 = HashBlockId(blockId, 0);
+    auto hash2 = HashBlockId(blockId, hash1) | 1;
+    auto bitCount = m_bits.size() * 8;
+    for (size_t hashIdx = 0; hashIdx < m_hashCount; ++hashIdx)
+    {
+        auto bitIdx = (hash1 + hashIdx * hash2) % bitCount;
+        m_bits[bitIdx / 8] |= static_cast<uint8_t>(1 << (bitIdx % 8));
+    }
+    ++m_addedBlockCount;
+}
+
+bool ProcessingBlockFilter::MayContain(const std::string& blockId) const
+{
+    if (m_addedBlockCount == 0)
+    {
+        return false;
+    }
+
+    auto hash1 = HashBlockId(blockId, 0);
+    auto hash2 = HashBlockId(blockId, hash1) | 1;
+    auto bitCount = m_bits.size() * 8;
+    for (size_t hashIdx = 0; hashIdx < m_hashCount; ++hashIdx)
+    {
+        auto bitIdx = (hash1 + hashIdx * hash2) % bitCount;
+        if ((m_bits[bitIdx / 8] & (1 << (bitIdx % 8))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProcessingBlockFilter::IsEmpty() const
+{
+    return (m_addedBlockCount == 0);
+}
+
+bool ProcessingBlockFilter::operator==(const ProcessingBlockFilter& other) const
+{
+    if (IsEmpty() || other.IsEmpty())
+    {
+        return (IsEmpty() == other.IsEmpty());
+    }
+    return (m_hashCount == other.m_hashCount) && (m_bits == other.m_bits);
+}
+
+void ProcessingBlockFilter::ToMessage(SGProcessing::BlockFilter& filter) const
+{
+    if (IsEmpty())
+    {
+        filter.Clear();
+        return;
+    }
+    filter.set_bits(m_bits.data(), m_bits.size());
+    filter.set_hash_count(static_cast<uint32_t>(m_hashCount));
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
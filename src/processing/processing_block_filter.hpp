@@ -0,0 +1,71 @@
+/**
+* Header file for the filter of locally available blocks
+*/
+
+#ifndef SUPERGENIUS_PROCESSING_BLOCK_FILTER_HPP
+#define SUPERGENIUS_PROCESSING_BLOCK_FILTER_HPP
+
+#include <processing/proto/SGProcessing.pb.h>
+
+#include <string>
+#include <vector>
+
+namespace sgns::processing
+{
+/** Bloom filter of block ids that are cached by a processing node.
+* The filter is advertised in queue requests and lets the queue owner prefer subtasks
+* which input blocks are available on a node without fetching.
+* Bit positions are calculated by a platform independent hash so that filters created
+* on different nodes are interpreted in the same way.
+*/
+class ProcessingBlockFilter
+{
+public:
+    /** Maximal number of bits that are checked for a block id */
+    static constexpr size_t MAX_HASH_COUNT = 16;
+    /** Maximal filter size in bytes */
+    static constexpr size_t MAX_BYTE_COUNT = 64 * 1024;
+
+    /** Creates an empty filter
+    * @param bitCount - filter size in bits, rounded up to whole bytes and limited by MAX_BYTE_COUNT
+    * @param hashCount - number of bits that are set for each block id, limited by MAX_HASH_COUNT
+    */
+    ProcessingBlockFilter(size_t bitCount = 8192, size_t hashCount = 4);
+
+    /** Creates a filter from a received message.
+    * The hash count is clamped to MAX_HASH_COUNT. Filters without bits, larger than MAX_BYTE_COUNT
+    * or with all bits set are rejected and treated as empty.
+    * @param filter - filter message
+    */
+    explicit ProcessingBlockFilter(const SGProcessing::BlockFilter& filter);
+
+    /** Adds a block id to the filter
+    * @param blockId - block id
+    */
+    void Add(const std::string& blockId);
+
+    /** Checks if a block id was possibly added to the filter
+    * @param blockId - block id
+    * @return false if the block id is definitely not in the filter
+    */
+    bool MayContain(const std::string& blockId) const;
+
+    /** Checks if no block ids were added to the filter
+    */
+    bool IsEmpty() const;
+
+    bool operator==(const ProcessingBlockFilter& other) const;
+
+    /** Serializes the filter to a message
+    * @param filter - filter message
+    */
+    void ToMessage(SGProcessing::BlockFilter& filter) const;
+
+private:
+    std::vector<uint8_t> m_bits;
+    size_t m_hashCount;
+    size_t m_addedBlockCount;
+};
+}
+
+#endif // SUPERGENIUS_PROCESSING_BLOCK_FILTER_HPP
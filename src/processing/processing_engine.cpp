@@ -1,17 +1,57 @@
 #include "processing_engine.hpp"
 
+#include <functional>
 #include <thread>
 #include <memory>
 #include "processing_subtask_queue_manager.hpp"
+#include "processing_thread_pool_executor.hpp"
 
 namespace sgns::processing
 {
+namespace
+{
+    // An engine which subtask is executed by the current thread
+    thread_local const ProcessingEngine* currentThreadEngine = nullptr;
+
+    // Calls a function when a scope is left either normally or by an exception
+    class ScopeExitGuard
+    {
+    public:
+        explicit ScopeExitGuard(std::function<void()> onExit)
+            : m_onExit(std::move(onExit))
+        {
+        }
+
+        ~ScopeExitGuard()
+        {
+            m_onExit();
+        }
+
+        ScopeExitGuard(const ScopeExitGuard&) = delete;
+        ScopeExitGuard& operator=(const ScopeExitGuard&) = delete;
+
+    private:
+        std::function<void()> m_onExit;
+    };
+}
+
 ProcessingEngine::ProcessingEngine(
     std::string nodeId,
-    std::shared_ptr<ProcessingCore> processingCore)
+    std::shared_ptr<ProcessingCore> processingCore,
+    std::shared_ptr<ProcessingExecutor> executor)
     : m_nodeId(std::move(nodeId))
     , m_processingCore(processingCore)
+    , m_executor(std::move(executor))
+    , m_maximalInFlightSubTaskCount(1)
+    , m_subTaskPrefetchDepth(0)
+    , m_requestedSubTaskCount(0)
+    , m_processingSubTaskCount(0)
+    , m_inFlightSubTaskCount(0)
 {
+    if (!m_executor)
+    {
+        m_executor = std::make_shared<ProcessingThreadPoolExecutor>(1);
+    }
 }
 
 ProcessingEngine::~ProcessingEngine()
@@ -24,22 +64,34 @@ void ProcessingEngine::StartQueueProcessing(
 {
     std::lock_guard<std::mutex> queueGuard(m_mutexSubTaskQueue);
     m_subTaskQueueAccessor = subTaskQueueAccessor;
-
-    m_subTaskQueueAccessor->GrabSubTask(
-        [weakThis(weak_from_this())](boost::optional<const SGProcessing::SubTask&> subTask) {
-            auto _this = weakThis.lock();
-            if (!_this)
-            {
-                return;
-            }
-            _this->OnSubTaskGrabbed(subTask);
-        });
+    {
+        std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+        m_prefetchedSubTasks.clear();
+        m_requestedSubTaskCount = 0;
+        m_processingSubTaskCount = 0;
+    }
+    GrabSubTasks();
 }
 
 void ProcessingEngine::StopQueueProcessing()
 {
-    std::lock_guard<std::mutex> queueGuard(m_mutexSubTaskQueue);
-    m_subTaskQueueAccessor.reset();
+    {
+        std::lock_guard<std::mutex> queueGuard(m_mutexSubTaskQueue);
+        m_subTaskQueueAccessor.reset();
+    }
+
+    {
+        // Locks of dropped subtasks are released by the queue once the processing timeout is expired
+        std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+        m_prefetchedSubTasks.clear();
+    }
+
+    // A subtask that stops the processing cannot wait for itself
+    if (currentThreadEngine != this)
+    {
+        std::unique_lock<std::mutex> lock(m_mutexInFlight);
+        m_cvInFlight.wait(lock, [this]() { return m_inFlightSubTaskCount == 0; });
+    }
     m_logger->debug("[PROCESSING_STOPPED] this: {}", reinterpret_cast<size_t>(this));
 }
 
@@ -49,15 +101,71 @@ bool ProcessingEngine::IsQueueProcessingStarted() const
     return (m_subTaskQueueAccessor.get() != nullptr);
 }
 
+void ProcessingEngine::GrabSubTasks()
+{
+    // The method has to be called in scoped lock of queue mutex
+    size_t subTaskCount = 0;
+    {
+        std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+        auto heldSubTaskCount = m_processingSubTaskCount + m_prefetchedSubTasks.size() + m_requestedSubTaskCount;
+        auto subTaskCapacity = m_maximalInFlightSubTaskCount + m_subTaskPrefetchDepth;
+        if (heldSubTaskCount >= subTaskCapacity)
+        {
+            return;
+        }
+        subTaskCount = subTaskCapacity - heldSubTaskCount;
+        // The counter is changed before the request because subtasks can be received synchronously
+        m_requestedSubTaskCount += subTaskCount;
+    }
+
+    m_subTaskQueueAccessor->GrabSubTasks(
+        subTaskCount,
+        [weakThis(weak_from_this())](boost::optional<const SGProcessing::SubTask&> subTask) {
+            auto _this = weakThis.lock();
+            if (!_this)
+            {
+                return;
+            }
+            _this->OnSubTaskGrabbed(subTask);
+        });
+}
+
 void ProcessingEngine::OnSubTaskGrabbed(boost::optional<const SGProcessing::SubTask&> subTask)
 {
-    if (subTask)
+    bool isSlotAvailable = false;
+    {
+        std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+        if (m_requestedSubTaskCount > 0)
+        {
+            --m_requestedSubTaskCount;
+        }
+
+        // When results for all subtasks are available, no subtask is received (optnull).
+        if (!subTask)
+        {
+            return;
+        }
+
+        isSlotAvailable = (m_processingSubTaskCount < m_maximalInFlightSubTaskCount);
+        if (isSlotAvailable)
+        {
+            ++m_processingSubTaskCount;
+        }
+        else
+        {
+            m_prefetchedSubTasks.push_back(*subTask);
+        }
+    }
+
+    if (isSlotAvailable)
     {
         m_logger->debug("[GRABBED]. ({}).", subTask->subtaskid());
         ProcessSubTask(*subTask);
     }
-
-    // When results for all subtasks are available, no subtask is received (optnull).
+    else
+    {
+        m_logger->debug("[PREFETCHED]. ({}).", subTask->subtaskid());
+    }
 }
 
 void ProcessingEngine::SetProcessingErrorSink(std::function<void(const std::string&)> processingErrorSink)
@@ -65,45 +173,154 @@ void ProcessingEngine::SetProcessingErrorSink(std::function<void(const std::stri
     m_processingErrorSink = processingErrorSink;
 }
 
+void ProcessingEngine::SetMaximalInFlightSubTaskCount(size_t maximalInFlightSubTaskCount)
+{
+    std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+    m_maximalInFlightSubTaskCount = std::max<size_t>(maximalInFlightSubTaskCount, 1);
+}
+
+void ProcessingEngine::SetSubTaskPrefetchDepth(size_t subTaskPrefetchDepth)
+{
+    std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+    m_subTaskPrefetchDepth = subTaskPrefetchDepth;
+}
+
+size_t ProcessingEngine::GetInFlightSubTaskCount() const
+{
+    std::lock_guard<std::mutex> guard(m_mutexInFlight);
+    return m_inFlightSubTaskCount;
+}
+
+size_t ProcessingEngine::GetPrefetchedSubTaskCount() const
+{
+    std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+    return m_prefetchedSubTasks.size();
+}
+
 void ProcessingEngine::ProcessSubTask(SGProcessing::SubTask subTask)
 {
     m_logger->debug("[PROCESSING_STARTED]. ({}).", subTask.subtaskid());
-    std::thread thread([subTask(std::move(subTask)), _this(shared_from_this())]()
     {
-        try
+        std::lock_guard<std::mutex> guard(m_mutexInFlight);
+        ++m_inFlightSubTaskCount;
+    }
+
+    auto subTaskId = subTask.subtaskid();
+    bool isSubmitted = m_executor->Submit([subTask(std::move(subTask)), _this(shared_from_this())]()
+    {
+        _this->ExecuteSubTask(subTask);
+        _this->OnSubTaskExecuted();
+    });
+
+    if (!isSubmitted)
+    {
+        // The executor is stopped, so the slot is not passed to other subtasks
+        m_logger->error("[SUBTASK_REJECTED]. ({}).", subTaskId);
         {
-            SGProcessing::SubTaskResult result;
-            // @todo set initial hash code that depends on node id
-            _this->m_processingCore->ProcessSubTask(
-                subTask, result, std::hash<std::string>{}(_this->m_nodeId));
-            // @todo replace results_channel with subtaskid
-            result.set_subtaskid(subTask.subtaskid());
-            _this->m_logger->debug("[PROCESSED]. ({}).", subTask.subtaskid());
-            std::lock_guard<std::mutex> queueGuard(_this->m_mutexSubTaskQueue);
-            if (_this->m_subTaskQueueAccessor)
+            std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+            if (m_processingSubTaskCount > 0)
             {
-                _this->m_subTaskQueueAccessor->CompleteSubTask(subTask.subtaskid(), result);
-                // @todo Should a new subtask be grabbed once the perivious one is processed?
-                _this->m_subTaskQueueAccessor->GrabSubTask(
-                    [weakThis(std::weak_ptr<sgns::processing::ProcessingEngine>(_this))](boost::optional<const SGProcessing::SubTask&> subTask) {
-                    auto _this = weakThis.lock();
-                    if (!_this)
-                    {
-                        return;
-                    }
-                    _this->OnSubTaskGrabbed(subTask);
-                });
+                --m_processingSubTaskCount;
             }
         }
-        catch (std::exception& ex)
+        OnSubTaskExecuted();
+    }
+}
+
+void ProcessingEngine::ExecuteSubTask(const SGProcessing::SubTask& subTask)
+{
+    currentThreadEngine = this;
+    // The processing slot is released on every exit path, so failed subtasks do not reduce the engine capacity
+    ScopeExitGuard slotGuard([this]() {
+        ReleaseProcessingSlot();
+        currentThreadEngine = nullptr;
+    });
+
+    {
+        std::lock_guard<std::mutex> queueGuard(m_mutexSubTaskQueue);
+        if (!m_subTaskQueueAccessor)
+        {
+            // The processing was stopped while the subtask was waiting for a worker
+            m_logger->debug("[SKIPPED]. ({}).", subTask.subtaskid());
+            return;
+        }
+    }
+
+    try
+    {
+        SGProcessing::SubTaskResult result;
+        // @todo set initial hash code that depends on node id
+        m_processingCore->ProcessSubTask(
+            subTask, result, std::hash<std::string>{}(m_nodeId));
+        // @todo replace results_channel with subtaskid
+        result.set_subtaskid(subTask.subtaskid());
+        m_logger->debug("[PROCESSED]. ({}).", subTask.subtaskid());
+        std::lock_guard<std::mutex> queueGuard(m_mutexSubTaskQueue);
+        if (m_subTaskQueueAccessor)
         {
-            if (_this->m_processingErrorSink)
-            {
-                _this->m_processingErrorSink(ex.what());
-            }
+            m_subTaskQueueAccessor->CompleteSubTask(subTask.subtaskid(), result);
         }
-    });
-    thread.detach();
+    }
+    catch (std::exception& ex)
+    {
+        if (m_processingErrorSink)
+        {
+            m_processingErrorSink(ex.what());
+        }
+    }
+}
+
+void ProcessingEngine::ReleaseProcessingSlot()
+{
+    std::lock_guard<std::mutex> queueGuard(m_mutexSubTaskQueue);
+
+    // The released slot is taken by a prefetched subtask if any
+    boost::optional<SGProcessing::SubTask> nextSubTask;
+    {
+        std::lock_guard<std::mutex> guard(m_mutexPrefetch);
+        if (m_subTaskQueueAccessor && !m_prefetchedSubTasks.empty())
+        {
+            nextSubTask = std::move(m_prefetchedSubTasks.front());
+            m_prefetchedSubTasks.pop_front();
+        }
+        else if (m_processingSubTaskCount > 0)
+        {
+            --m_processingSubTaskCount;
+        }
+    }
+
+    if (!m_subTaskQueueAccessor)
+    {
+        return;
+    }
+
+    try
+    {
+        if (nextSubTask)
+        {
+            m_logger->debug("[PREFETCHED_STARTED]. ({}).", nextSubTask->subtaskid());
+            ProcessSubTask(std::move(*nextSubTask));
+        }
+        // @todo Should a new subtask be grabbed once the perivious one is processed?
+        GrabSubTasks();
+    }
+    catch (std::exception& ex)
+    {
+        // The method is called from a scope guard destructor, so exceptions are not propagated
+        if (m_processingErrorSink)
+        {
+            m_processingErrorSink(ex.what());
+        }
+    }
+}
+
+void ProcessingEngine::OnSubTaskExecuted()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutexInFlight);
+        --m_inFlightSubTaskCount;
+    }
+    m_cvInFlight.notify_all();
 }
 
 }
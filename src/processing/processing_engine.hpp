@@ -8,8 +8,12 @@
 
 #include <processing/processing_core.hpp>
 #include <processing/processing_subtask_queue_accessor.hpp>
+#include <processing/processing_executor.hpp>
 #include <base/logger.hpp>
 
+#include <condition_variable>
+#include <deque>
+
 namespace sgns::processing
 {
 /** Handles subtask processing and processing results accumulation
@@ -20,35 +24,88 @@ public:
     /** Create a processing engine object
     * @param nodeId - current processing node ID
     * @param processingCore specific processing core that process a subtask using specific algorithm
+    * @param executor - executor that runs subtasks. If not set a single-threaded executor is created
     */
     ProcessingEngine(
         std::string nodeId,
-        std::shared_ptr<ProcessingCore> processingCore);
+        std::shared_ptr<ProcessingCore> processingCore,
+        std::shared_ptr<ProcessingExecutor> executor = nullptr);
     ~ProcessingEngine();
 
     // @todo rename to StartProcessing
     void StartQueueProcessing(std::shared_ptr<SubTaskQueueAccessor> subTaskQueueAccessor);
 
+    /** Stops subtasks grabbing and waits for subtasks that are being processed.
+    * Results of the subtasks that are finished after the call are not published
+    */
     void StopQueueProcessing();
     bool IsQueueProcessingStarted() const;
 
     void SetProcessingErrorSink(std::function<void(const std::string&)> processingErrorSink);
 
+    /** Sets a maximal number of subtasks that are grabbed and processed simultaneously by the engine
+    * @param maximalInFlightSubTaskCount - number of subtasks, 1 by default
+    */
+    void SetMaximalInFlightSubTaskCount(size_t maximalInFlightSubTaskCount);
+
+    /** Sets a number of subtasks that are grabbed in advance and held locally
+    * while other subtasks are processed. Prefetched subtasks are locked by the local node
+    * and are started without a queue access once a processing slot is released.
+    * @param subTaskPrefetchDepth - number of prefetched subtasks, 0 by default
+    */
+    void SetSubTaskPrefetchDepth(size_t subTaskPrefetchDepth);
+
+    /** Returns a number of subtasks that are submitted to the executor and not finished yet
+    */
+    size_t GetInFlightSubTaskCount() const;
+
+    /** Returns a number of grabbed subtasks that wait for a processing slot
+    */
+    size_t GetPrefetchedSubTaskCount() const;
+
 private:
     void OnSubTaskGrabbed(boost::optional<const SGProcessing::SubTask&> subTask);
 
-    /** Processes a subtask and send the processing result to corresponding result channel
+    /** Requests subtasks from the queue to fill processing slots and the prefetch buffer.
+    * The method has to be called in scoped lock of queue mutex
+    */
+    void GrabSubTasks();
+
+    /** Submits a subtask to the executor
     * @param subTask - subtask that should be processed
     */
     void ProcessSubTask(SGProcessing::SubTask subTask);
 
+    /** Processes a subtask and send the processing result to corresponding result channel
+    * @param subTask - subtask that should be processed
+    */
+    void ExecuteSubTask(const SGProcessing::SubTask& subTask);
+
+    void OnSubTaskExecuted();
+
+    /** Passes a released processing slot to a prefetched subtask or frees it and grabs new subtasks
+    */
+    void ReleaseProcessingSlot();
+
     std::string m_nodeId;
     std::shared_ptr<ProcessingCore> m_processingCore;
     std::function<void(const std::string&)> m_processingErrorSink;
+    std::shared_ptr<ProcessingExecutor> m_executor;
 
     std::shared_ptr<SubTaskQueueAccessor> m_subTaskQueueAccessor;
 
     mutable std::mutex m_mutexSubTaskQueue;
+
+    size_t m_maximalInFlightSubTaskCount;
+    size_t m_subTaskPrefetchDepth;
+    std::deque<SGProcessing::SubTask> m_prefetchedSubTasks;
+    size_t m_requestedSubTaskCount;
+    size_t m_processingSubTaskCount;
+    mutable std::mutex m_mutexPrefetch;
+
+    size_t m_inFlightSubTaskCount;
+    mutable std::mutex m_mutexInFlight;
+    std::condition_variable m_cvInFlight;
     
     base::Logger m_logger = base::createLogger("ProcessingEngine");
 };
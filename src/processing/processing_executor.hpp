@@ -0,0 +1,58 @@
+/**
+* Header file for subtask executor interface
+*/
+
+#ifndef SUPERGENIUS_PROCESSING_EXECUTOR_HPP
+#define SUPERGENIUS_PROCESSING_EXECUTOR_HPP
+
+#include <functional>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace sgns::processing
+{
+/** Executor interface which is used by processing engines to run subtasks.
+* An implementation defines a concurrency model and limits the number of subtasks executed in parallel
+*/
+class ProcessingExecutor
+{
+public:
+    typedef std::function<void()> Task;
+
+    /** Worker statistics snapshot
+    */
+    struct WorkerStatistics
+    {
+        uint64_t executedTaskCount = 0; /*> number of tasks executed by the worker */
+        double utilization = 0.0; /*> busy time to uptime ratio in range [0, 1] */
+    };
+
+    virtual ~ProcessingExecutor() = default;
+
+    /** Schedules a task execution
+    * @param task - task to execute
+    * @return false if the task cannot be accepted (the executor is stopped)
+    */
+    virtual bool Submit(Task task) = 0;
+
+    /** Blocks until all submitted tasks are executed
+    * The method returns immediately when it is called from a worker thread
+    */
+    virtual void Drain() = 0;
+
+    /** Returns the maximal number of tasks that can be executed in parallel
+    */
+    virtual size_t GetConcurrencyLimit() const = 0;
+
+    /** Returns a number of tasks that are submitted but not started yet
+    */
+    virtual size_t GetQueueDepth() const = 0;
+
+    /** Returns per-worker statistics
+    */
+    virtual std::vector<WorkerStatistics> GetWorkerStatistics() const = 0;
+};
+}
+
+#endif // SUPERGENIUS_PROCESSING_EXECUTOR_HPP
@@ -11,10 +11,17 @@ ProcessingNode::ProcessingNode(
     std::shared_ptr<SubTaskResultStorage> subTaskResultStorage,
     std::shared_ptr<ProcessingCore> processingCore,
     std::function<void(const SGProcessing::TaskResult&)> taskResultProcessingSink,
-    std::function<void(const std::string&)> processingErrorSink)
+    std::function<void(const std::string&)> processingErrorSink,
+    std::shared_ptr<ProcessingExecutor> executor)
     : m_gossipPubSub(std::move(gossipPubSub))
     , m_nodeId(m_gossipPubSub->GetLocalAddress())
     , m_processingCore(processingCore)
+    , m_executor(std::move(executor))
+    , m_maximalInFlightSubTaskCount(1)
+    , m_subTaskPrefetchDepth(0)
+    , m_duplicationBudget(0)
+    , m_checkpointInterval(std::chrono::seconds(1))
+    , m_isDeltaReplicationEnabled(false)
     , m_subTaskStateStorage(subTaskStateStorage)
     , m_subTaskResultStorage(subTaskResultStorage)
     , m_taskResultProcessingSink(taskResultProcessingSink)
@@ -34,12 +41,20 @@ void ProcessingNode::Initialize(const std::string& processingQueueChannelId, siz
     m_subtaskQueueManager = std::make_shared<ProcessingSubTaskQueueManager>(
         processingQueueChannel, m_gossipPubSub->GetAsioContext(), m_nodeId);
 
+    // If enabled, subtasks are published once, lock and ownership changes are published as deltas
+    m_subtaskQueueManager->SetDeltaReplicationEnabled(m_isDeltaReplicationEnabled);
+    m_subtaskQueueManager->SetLocalBlockFilter(m_localBlockFilter);
+    m_subtaskQueueManager->SetSpeculativeExecutionBudget(m_duplicationBudget);
+    m_subtaskQueueManager->SetCheckpointStorage(m_subTaskStateStorage, processingQueueChannelId, m_checkpointInterval);
+
     m_subTaskQueueAccessor = std::make_shared<SubTaskQueueAccessorImpl>(
         m_gossipPubSub,
         m_subtaskQueueManager,
         m_subTaskStateStorage,
         m_subTaskResultStorage,
-        m_taskResultProcessingSink);
+        m_taskResultProcessingSink,
+        // Each queue uses its own result channel
+        processingQueueChannelId + "_RESULTS");
 
     processingQueueChannel->SetQueueRequestSink(
         [qmWeak(std::weak_ptr<ProcessingSubTaskQueueManager>(m_subtaskQueueManager))] (
@@ -62,10 +77,34 @@ void ProcessingNode::Initialize(const std::string& processingQueueChannelId, siz
             }
             return false;
         });
-      
-    m_processingEngine = std::make_shared<ProcessingEngine>(m_nodeId, m_processingCore);
+
+    processingQueueChannel->SetQueueDeltaSink(
+        [qmWeak(std::weak_ptr<ProcessingSubTaskQueueManager>(m_subtaskQueueManager))](
+            const SGProcessing::SubTaskQueueDelta& delta) {
+            auto qm = qmWeak.lock();
+            if (qm)
+            {
+                return qm->ProcessSubTaskQueueDeltaMessage(delta);
+            }
+            return false;
+        });
+
+    processingQueueChannel->SetQueueSnapshotRequestSink(
+        [qmWeak(std::weak_ptr<ProcessingSubTaskQueueManager>(m_subtaskQueueManager))](
+            const SGProcessing::SubTaskQueueSnapshotRequest& request) {
+            auto qm = qmWeak.lock();
+            if (qm)
+            {
+                return qm->ProcessSubTaskQueueSnapshotRequestMessage(request);
+            }
+            return false;
+        });
+
+    m_processingEngine = std::make_shared<ProcessingEngine>(m_nodeId, m_processingCore, m_executor);
 
     m_processingEngine->SetProcessingErrorSink(m_processingErrorSink);
+    m_processingEngine->SetMaximalInFlightSubTaskCount(m_maximalInFlightSubTaskCount);
+    m_processingEngine->SetSubTaskPrefetchDepth(m_subTaskPrefetchDepth);
 
     // Run messages processing once all dependent object are created
     processingQueueChannel->Listen(msSubscriptionWaitingDuration);
@@ -118,5 +157,49 @@ bool ProcessingNode::HasQueueOwnership() const
     return (m_subtaskQueueManager && m_subtaskQueueManager->HasOwnership());
 }
 
+size_t ProcessingNode::GetInFlightSubTaskCount() const
+{
+    if (!m_processingEngine)
+    {
+        return 0;
+    }
+    return m_processingEngine->GetInFlightSubTaskCount() + m_processingEngine->GetPrefetchedSubTaskCount();
+}
+
+void ProcessingNode::SetMaximalInFlightSubTaskCount(size_t maximalInFlightSubTaskCount)
+{
+    m_maximalInFlightSubTaskCount = maximalInFlightSubTaskCount;
+}
+
+void ProcessingNode::SetSubTaskPrefetchDepth(size_t subTaskPrefetchDepth)
+{
+    m_subTaskPrefetchDepth = subTaskPrefetchDepth;
+}
+
+void ProcessingNode::SetSpeculativeExecutionBudget(size_t duplicationBudget)
+{
+    m_duplicationBudget = duplicationBudget;
+}
+
+void ProcessingNode::SetLocalBlockFilter(const ProcessingBlockFilter& localBlockFilter)
+{
+    m_localBlockFilter = localBlockFilter;
+    if (m_subtaskQueueManager)
+    {
+        // The filter is updated when the node caches new blocks
+        m_subtaskQueueManager->SetLocalBlockFilter(m_localBlockFilter);
+    }
+}
+
+void ProcessingNode::SetQueueCheckpointInterval(std::chrono::milliseconds checkpointInterval)
+{
+    m_checkpointInterval = checkpointInterval;
+}
+
+void ProcessingNode::SetDeltaReplicationEnabled(bool isEnabled)
+{
+    m_isDeltaReplicationEnabled = isEnabled;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 }
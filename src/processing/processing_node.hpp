@@ -25,6 +25,7 @@ class ProcessingNode
 public:
     /** Constructs a processing node
     * @param gossipPubSub - pubsub service
+    * @param executor - executor that runs subtasks, if not set the processing engine creates its own one
     */
     ProcessingNode(
         std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub> gossipPubSub,
@@ -32,7 +33,8 @@ public:
         std::shared_ptr<SubTaskResultStorage> subTaskResultStorage,
         std::shared_ptr<ProcessingCore> processingCore,
         std::function<void(const SGProcessing::TaskResult&)> taskResultProcessingSink,
-        std::function<void(const std::string&)> processingErrorSink);
+        std::function<void(const std::string&)> processingErrorSink,
+        std::shared_ptr<ProcessingExecutor> executor = nullptr);
 
     ~ProcessingNode();
 
@@ -48,6 +50,46 @@ public:
 
     bool HasQueueOwnership() const;
 
+    /** Returns a number of subtasks that are processed or held in the prefetch buffer by the node
+    */
+    size_t GetInFlightSubTaskCount() const;
+
+    /** Sets a maximal number of subtasks that are processed by the node simultaneously
+    * The method should be called before the node is attached to a processing channel
+    */
+    void SetMaximalInFlightSubTaskCount(size_t maximalInFlightSubTaskCount);
+
+    /** Sets a number of subtasks that are grabbed in advance while other subtasks are processed
+    * The method should be called before the node is attached to a processing channel
+    */
+    void SetSubTaskPrefetchDepth(size_t subTaskPrefetchDepth);
+
+    /** Sets a number of subtask duplicates that the node may grab from the queue tail
+    * The method should be called before the node is attached to a processing channel
+    */
+    void SetSpeculativeExecutionBudget(size_t duplicationBudget);
+
+    /** Sets a filter of blocks that are cached by the node.
+    * Subtasks which blocks are cached locally are grabbed first.
+    * @param localBlockFilter - filter of locally cached block ids
+    */
+    void SetLocalBlockFilter(const ProcessingBlockFilter& localBlockFilter);
+
+    /** Sets a maximal delay of saving queue changes to the subtask state storage.
+    * Queue checkpoints allow to resume a half-finished queue without reprocessing completed subtasks.
+    * The method should be called before the node is attached to a processing channel
+    * @param checkpointInterval - checkpoint interval, 0 disables periodic checkpoints
+    */
+    void SetQueueCheckpointInterval(std::chrono::milliseconds checkpointInterval);
+
+    /** Enables delta-based replication of the subtask queue.
+    * Nodes that do not support queue deltas cannot follow a queue that is replicated with deltas,
+    * so it should be enabled only when all nodes of the grid support them.
+    * The method should be called before the node is attached to a processing channel
+    * @param isEnabled - delta replication flag, disabled by default
+    */
+    void SetDeltaReplicationEnabled(bool isEnabled);
+
 private:
     void Initialize(const std::string& processingQueueChannelId, size_t msSubscriptionWaitingDuration);
 
@@ -55,6 +97,13 @@ private:
 
     std::string m_nodeId;
     std::shared_ptr<ProcessingCore> m_processingCore;
+    std::shared_ptr<ProcessingExecutor> m_executor;
+    size_t m_maximalInFlightSubTaskCount;
+    size_t m_subTaskPrefetchDepth;
+    size_t m_duplicationBudget;
+    ProcessingBlockFilter m_localBlockFilter;
+    std::chrono::milliseconds m_checkpointInterval;
+    bool m_isDeltaReplicationEnabled;
     std::shared_ptr<SubTaskStateStorage> m_subTaskStateStorage;
     std::shared_ptr<SubTaskResultStorage> m_subTaskResultStorage;
 
@@ -1,4 +1,7 @@
 #include "processing_service.hpp"
+#include "processing_thread_pool_executor.hpp"
+
+#include <algorithm>
 
 namespace sgns::processing
 {
@@ -8,7 +11,8 @@ ProcessingServiceImpl::ProcessingServiceImpl(
     std::shared_ptr<SubTaskEnqueuer> subTaskEnqueuer,
     std::shared_ptr<SubTaskStateStorage> subTaskStateStorage,
     std::shared_ptr<SubTaskResultStorage> subTaskResultStorage,
-    std::shared_ptr<ProcessingCore> processingCore)
+    std::shared_ptr<ProcessingCore> processingCore,
+    std::shared_ptr<ProcessingExecutor> executor)
     : m_gossipPubSub(gossipPubSub)
     , m_context(gossipPubSub->GetAsioContext())
     , m_maximalNodesCount(maximalNodesCount)
@@ -16,10 +20,27 @@ ProcessingServiceImpl::ProcessingServiceImpl(
     , m_subTaskStateStorage(subTaskStateStorage)
     , m_subTaskResultStorage(subTaskResultStorage)
     , m_processingCore(processingCore)
+    , m_executor(std::move(executor))
+    , m_maximalInFlightSubTaskCount(1)
+    , m_subTaskPrefetchDepth(0)
+    , m_duplicationBudget(0)
+    , m_isDeltaReplicationEnabled(false)
     , m_timerChannelListRequestTimeout(*m_context.get())
     , m_channelListRequestTimeout(boost::posix_time::seconds(5))
+    , m_timerLoadReport(*m_context.get())
+    , m_loadReportInterval(boost::posix_time::seconds(1))
+    , m_lastExecutedSubTaskCount(0)
     , m_isStopped(true)
 {
+    if (!m_executor)
+    {
+        m_executor = std::make_shared<ProcessingThreadPoolExecutor>();
+    }
+}
+
+ProcessingServiceImpl::~ProcessingServiceImpl()
+{
+    StopProcessing();
 }
 
 void ProcessingServiceImpl::StartProcessing(const std::string& processingGridChannelId)
@@ -31,8 +52,15 @@ void ProcessingServiceImpl::StartProcessing(const std::string& processingGridCha
     }
 
     m_isStopped = false;
+    m_handlerGuard = std::make_shared<HandlerGuard>();
+    m_handlerGuard->service = this;
 
     Listen(processingGridChannelId);
+    if (IsLoadReportingEnabled())
+    {
+        m_lastLoadReportTime = std::chrono::steady_clock::now();
+        PublishLoadReport();
+    }
     SendChannelListRequest();
     m_logger->debug("[SERVICE_STARTED]");
 }
@@ -46,6 +74,12 @@ void ProcessingServiceImpl::StopProcessing()
 
     m_isStopped = true;
 
+    {
+        // Waits for a running load report handler, handlers that are already posted are skipped
+        std::lock_guard<std::mutex> guard(m_handlerGuard->mutex);
+        m_handlerGuard->service = nullptr;
+    }
+    m_timerLoadReport.cancel();
     m_gridChannel->Unsubscribe();
 
     {
@@ -68,12 +102,13 @@ void ProcessingServiceImpl::SendChannelListRequest()
     SGProcessing::GridChannelMessage gridMessage;
     auto channelRequest = gridMessage.mutable_processing_channel_request();
     channelRequest->set_environment("any");
+    channelRequest->set_node_id(m_gossipPubSub->GetLocalAddress());
 
     m_gridChannel->Publish(gridMessage.SerializeAsString());
     m_logger->debug("List of processing channels requested");
 
     m_timerChannelListRequestTimeout.expires_from_now(m_channelListRequestTimeout);
-    m_timerChannelListRequestTimeout.async_wait(std::bind(&ProcessingServiceImpl::HandleRequestTimeout, this));
+    m_timerChannelListRequestTimeout.async_wait(std::bind(&ProcessingServiceImpl::HandleRequestTimeout, this, std::placeholders::_1));
 }
 
 void ProcessingServiceImpl::OnMessage(boost::optional<const sgns::ipfs_pubsub::GossipPubSub::Message&> message)
@@ -94,7 +129,11 @@ void ProcessingServiceImpl::OnMessage(boost::optional<const sgns::ipfs_pubsub::G
             else if (gridMessage.has_processing_channel_request())
             {
                 // @todo chenk environment requirements
-                PublishLocalChannelList();
+                PublishLocalChannelList(gridMessage.processing_channel_request().node_id());
+            }
+            else if (gridMessage.has_service_load())
+            {
+                OnServiceLoadReceived(gridMessage.service_load());
             }
         }
     }
@@ -112,6 +151,7 @@ void ProcessingServiceImpl::OnQueueProcessingCompleted(
     
     if (!m_isStopped)
     {
+        UpdateLoadReport();
         SendChannelListRequest();
     }
     // @todo finalize task
@@ -132,6 +172,7 @@ void ProcessingServiceImpl::OnProcessingError(
 
     if (!m_isStopped)
     {
+        UpdateLoadReport();
         SendChannelListRequest();
     }
 }
@@ -145,20 +186,23 @@ void ProcessingServiceImpl::AcceptProcessingChannel(
     }
 
     std::scoped_lock lock(m_mutexNodes);
-    if (m_processingNodes.size() < m_maximalNodesCount)
-    {
-        auto node = std::make_shared<ProcessingNode>(
-            m_gossipPubSub,
-            m_subTaskStateStorage,
-            m_subTaskResultStorage,
-            m_processingCore,
-            std::bind(&ProcessingServiceImpl::OnQueueProcessingCompleted, 
-                this, processingQueuelId, std::placeholders::_1),
-            std::bind(&ProcessingServiceImpl::OnProcessingError,
-                this, processingQueuelId, std::placeholders::_1));
+    if (m_processingNodes.find(processingQueuelId) != m_processingNodes.end())
+    {
+        // The channel is already handled, responses are received from every channel host
+        return;
+    }
 
+    if (IsLoadReportingEnabled() && (m_processingNodes.size() < m_maximalNodesCount) && (GetFreeSlotCount() == 0))
+    {
+        // Busy services leave the channel to services with free executor slots
+        m_logger->debug("Processing channel skipped, no free slots. id:{}", processingQueuelId);
+    }
+    else if (m_processingNodes.size() < m_maximalNodesCount)
+    {
+        auto node = CreateProcessingNode(processingQueuelId);
         node->AttachTo(processingQueuelId);
         m_processingNodes[processingQueuelId] = node;
+        UpdateLoadReport();
     }
 
     if (m_processingNodes.size() == m_maximalNodesCount)
@@ -167,22 +211,61 @@ void ProcessingServiceImpl::AcceptProcessingChannel(
     }
 }
 
-void ProcessingServiceImpl::PublishLocalChannelList()
+std::shared_ptr<ProcessingNode> ProcessingServiceImpl::CreateProcessingNode(
+    const std::string& subTaskQueueId)
 {
-    std::scoped_lock lock(m_mutexNodes);
-    for (auto itNode = m_processingNodes.begin(); itNode != m_processingNodes.end(); ++itNode)
+    auto node = std::make_shared<ProcessingNode>(
+        m_gossipPubSub,
+        m_subTaskStateStorage,
+        m_subTaskResultStorage,
+        m_processingCore,
+        std::bind(&ProcessingServiceImpl::OnQueueProcessingCompleted,
+            this, subTaskQueueId, std::placeholders::_1),
+        std::bind(&ProcessingServiceImpl::OnProcessingError,
+            this, subTaskQueueId, std::placeholders::_1),
+        m_executor);
+    node->SetMaximalInFlightSubTaskCount(m_maximalInFlightSubTaskCount);
+    node->SetSubTaskPrefetchDepth(m_subTaskPrefetchDepth);
+    node->SetSpeculativeExecutionBudget(m_duplicationBudget);
+    node->SetDeltaReplicationEnabled(m_isDeltaReplicationEnabled);
+    return node;
+}
+
+void ProcessingServiceImpl::PublishLocalChannelList(const std::string& requestingNodeId)
+{
+    if (IsLoadReportingEnabled() && IsBusyService(requestingNodeId))
     {
-        // Only channel host answers to reduce a number of published messages
-        if (itNode->second->HasQueueOwnership())
-        {
-            SGProcessing::GridChannelMessage gridMessage;
-            auto channelResponse = gridMessage.mutable_processing_channel_response();
-            channelResponse->set_channel_id(itNode->first);
+        // A busy service skips received channels, publishing them would only add traffic
+        m_logger->debug("Channel list request skipped, the requesting service is busy. {}", requestingNodeId);
+        return;
+    }
 
-            m_gridChannel->Publish(gridMessage.SerializeAsString());
-            m_logger->debug("Channel published. {}", channelResponse->channel_id());
+    std::vector<std::pair<size_t, std::string>> channels;
+    {
+        std::scoped_lock lock(m_mutexNodes);
+        for (auto itNode = m_processingNodes.begin(); itNode != m_processingNodes.end(); ++itNode)
+        {
+            // Only channel host answers to reduce a number of published messages
+            if (itNode->second->HasQueueOwnership())
+            {
+                channels.emplace_back(itNode->second->GetInFlightSubTaskCount(), itNode->first);
+            }
         }
     }
+
+    // A requesting service accepts channels in the receiving order,
+    // channels which local nodes are the most loaded need help first
+    std::stable_sort(channels.begin(), channels.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+    for (const auto& [inFlightSubTaskCount, channelId] : channels)
+    {
+        SGProcessing::GridChannelMessage gridMessage;
+        auto channelResponse = gridMessage.mutable_processing_channel_response();
+        channelResponse->set_channel_id(channelId);
+
+        m_gridChannel->Publish(gridMessage.SerializeAsString());
+        m_logger->debug("Channel published. {}", channelResponse->channel_id());
+    }
 }
 
 size_t ProcessingServiceImpl::GetProcessingNodesCount() const
@@ -197,8 +280,44 @@ void ProcessingServiceImpl::SetChannelListRequestTimeout(
     m_channelListRequestTimeout = channelListRequestTimeout;
 }
 
-void ProcessingServiceImpl::HandleRequestTimeout()
+void ProcessingServiceImpl::SetLoadReportInterval(boost::posix_time::time_duration loadReportInterval)
 {
+    m_loadReportInterval = loadReportInterval;
+}
+
+void ProcessingServiceImpl::SetMaximalInFlightSubTaskCount(size_t maximalInFlightSubTaskCount)
+{
+    m_maximalInFlightSubTaskCount = maximalInFlightSubTaskCount;
+}
+
+void ProcessingServiceImpl::SetSubTaskPrefetchDepth(size_t subTaskPrefetchDepth)
+{
+    m_subTaskPrefetchDepth = subTaskPrefetchDepth;
+}
+
+void ProcessingServiceImpl::SetSpeculativeExecutionBudget(size_t duplicationBudget)
+{
+    m_duplicationBudget = duplicationBudget;
+}
+
+void ProcessingServiceImpl::SetDeltaReplicationEnabled(bool isEnabled)
+{
+    m_isDeltaReplicationEnabled = isEnabled;
+}
+
+std::shared_ptr<ProcessingExecutor> ProcessingServiceImpl::GetProcessingExecutor() const
+{
+    return m_executor;
+}
+
+void ProcessingServiceImpl::HandleRequestTimeout(const boost::system::error_code& error)
+{
+    if (error == boost::asio::error::operation_aborted)
+    {
+        // The timer was rescheduled, a request sent from the handler would cancel the new wait
+        return;
+    }
+
     m_logger->debug("QUEUE_REQUEST_TIMEOUT");
     m_timerChannelListRequestTimeout.expires_at(boost::posix_time::pos_infin);
 
@@ -210,20 +329,23 @@ void ProcessingServiceImpl::HandleRequestTimeout()
     std::scoped_lock lock(m_mutexNodes);
     while (m_processingNodes.size() < m_maximalNodesCount)
     {
+        if (IsLoadReportingEnabled())
+        {
+            auto freeSlotCount = GetFreeSlotCount();
+            if ((freeSlotCount == 0) || !IsLeastLoadedService(freeSlotCount, m_executor->GetQueueDepth()))
+            {
+                // New queues are created by less loaded services, the local one joins existent queues
+                m_logger->debug("QUEUE_CREATION_DEFERRED. Free slots: {}", freeSlotCount);
+                SendChannelListRequest();
+                break;
+            }
+        }
+
         std::string subTaskQueueId;
         std::list<SGProcessing::SubTask> subTasks;
         if (m_subTaskEnqueuer->EnqueueSubTasks(subTaskQueueId, subTasks))
         {
-            auto node = std::make_shared<ProcessingNode>(
-                m_gossipPubSub,
-                m_subTaskStateStorage,
-                m_subTaskResultStorage,
-                m_processingCore,
-                std::bind(&ProcessingServiceImpl::OnQueueProcessingCompleted, 
-                    this, subTaskQueueId, std::placeholders::_1),
-                std::bind(&ProcessingServiceImpl::OnProcessingError,
-                    this, subTaskQueueId, std::placeholders::_1)
-                );
+            auto node = CreateProcessingNode(subTaskQueueId);
 
             // @todo Figure out if the task is still available for other peers
             // @todo Check if it is better to call EnqueueSubTasks within host 
@@ -232,6 +354,7 @@ void ProcessingServiceImpl::HandleRequestTimeout()
 
             m_processingNodes[subTaskQueueId] = node;
             m_logger->debug("New processing channel created. {}", subTaskQueueId);
+            UpdateLoadReport();
         }
         else
         {
@@ -241,4 +364,165 @@ void ProcessingServiceImpl::HandleRequestTimeout()
         }
     }
 }
+
+void ProcessingServiceImpl::PublishLoadReport()
+{
+    if (m_isStopped)
+    {
+        return;
+    }
+
+    SGProcessing::GridChannelMessage gridMessage;
+    auto load = gridMessage.mutable_service_load();
+    load->set_node_id(m_gossipPubSub->GetLocalAddress());
+    {
+        std::scoped_lock lock(m_mutexNodes);
+        load->set_free_slot_count(static_cast<uint32_t>(GetFreeSlotCount()));
+    }
+    load->set_queue_depth(static_cast<uint32_t>(m_executor->GetQueueDepth()));
+
+    uint64_t executedSubTaskCount = 0;
+    for (const auto& workerStatistics : m_executor->GetWorkerStatistics())
+    {
+        executedSubTaskCount += workerStatistics.executedTaskCount;
+    }
+    {
+        std::scoped_lock lock(m_mutexServiceLoads);
+        auto now = std::chrono::steady_clock::now();
+        auto elapsedSeconds = std::chrono::duration<double>(now - m_lastLoadReportTime).count();
+        if (elapsedSeconds > 0)
+        {
+            load->set_subtask_throughput(
+                static_cast<float>((executedSubTaskCount - m_lastExecutedSubTaskCount) / elapsedSeconds));
+        }
+        m_lastExecutedSubTaskCount = executedSubTaskCount;
+        m_lastLoadReportTime = now;
+    }
+
+    m_gridChannel->Publish(gridMessage.SerializeAsString());
+    m_logger->trace("LOAD_REPORTED: free slots {}, queue depth {}, throughput {}",
+        load->free_slot_count(), load->queue_depth(), load->subtask_throughput());
+
+    m_timerLoadReport.expires_from_now(m_loadReportInterval);
+    m_timerLoadReport.async_wait(
+        [handlerGuard = std::weak_ptr<HandlerGuard>(m_handlerGuard)](const boost::system::error_code& error) {
+            if (!error)
+            {
+                PublishLoadReport(handlerGuard);
+            }
+        });
+}
+
+void ProcessingServiceImpl::PublishLoadReport(const std::weak_ptr<HandlerGuard>& handlerGuard)
+{
+    auto guard = handlerGuard.lock();
+    if (!guard)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(guard->mutex);
+    if (guard->service)
+    {
+        guard->service->PublishLoadReport();
+    }
+}
+
+void ProcessingServiceImpl::UpdateLoadReport()
+{
+    if (IsLoadReportingEnabled())
+    {
+        // The report is published once the nodes mutex is released
+        boost::asio::post(*m_context, [handlerGuard = std::weak_ptr<HandlerGuard>(m_handlerGuard)]() {
+            PublishLoadReport(handlerGuard);
+        });
+    }
+}
+
+void ProcessingServiceImpl::OnServiceLoadReceived(const SGProcessing::ProcessingServiceLoad& load)
+{
+    if (load.node_id() == m_gossipPubSub->GetLocalAddress())
+    {
+        return;
+    }
+
+    bool isNewService = false;
+    {
+        std::scoped_lock lock(m_mutexServiceLoads);
+        auto [itLoad, isInserted] = m_serviceLoads.insert_or_assign(
+            load.node_id(), ServiceLoad{ load, std::chrono::steady_clock::now() });
+        isNewService = isInserted;
+    }
+
+    if (isNewService)
+    {
+        // A service that started later missed the previous local report
+        UpdateLoadReport();
+    }
+}
+
+size_t ProcessingServiceImpl::GetFreeSlotCount() const
+{
+    size_t reservedSlotCount = 0;
+    for (const auto& [subTaskQueueId, node] : m_processingNodes)
+    {
+        // A node that has not grabbed subtasks yet is going to occupy a slot soon
+        reservedSlotCount += std::max<size_t>(node->GetInFlightSubTaskCount(), 1);
+    }
+
+    auto slotCount = m_executor->GetConcurrencyLimit();
+    size_t freeSlotCount = (slotCount > reservedSlotCount) ? (slotCount - reservedSlotCount) : 0;
+
+    // The service cannot process more subtasks than its nodes are allowed to
+    size_t freeNodeCount = (m_maximalNodesCount > m_processingNodes.size())
+        ? (m_maximalNodesCount - m_processingNodes.size()) : 0;
+    return std::min(freeSlotCount, freeNodeCount * m_maximalInFlightSubTaskCount);
+}
+
+std::chrono::steady_clock::time_point ProcessingServiceImpl::GetLoadReportExpirationTime() const
+{
+    // A service is considered as gone if several reports are missed
+    return std::chrono::steady_clock::now()
+        - std::chrono::milliseconds(3 * m_loadReportInterval.total_milliseconds());
+}
+
+bool ProcessingServiceImpl::IsBusyService(const std::string& nodeId)
+{
+    auto expirationTime = GetLoadReportExpirationTime();
+
+    std::scoped_lock lock(m_mutexServiceLoads);
+    auto it = m_serviceLoads.find(nodeId);
+    return (it != m_serviceLoads.end())
+        && (it->second.receivingTime >= expirationTime)
+        && (it->second.load.free_slot_count() == 0);
+}
+
+bool ProcessingServiceImpl::IsLeastLoadedService(size_t freeSlotCount, size_t queueDepth)
+{
+    auto expirationTime = GetLoadReportExpirationTime();
+
+    std::scoped_lock lock(m_mutexServiceLoads);
+    for (auto it = m_serviceLoads.begin(); it != m_serviceLoads.end();)
+    {
+        if (it->second.receivingTime < expirationTime)
+        {
+            it = m_serviceLoads.erase(it);
+            continue;
+        }
+
+        const auto& load = it->second.load;
+        if ((load.free_slot_count() > freeSlotCount)
+            || ((load.free_slot_count() == freeSlotCount) && (load.queue_depth() < queueDepth)))
+        {
+            return false;
+        }
+        ++it;
+    }
+    return true;
+}
+
+bool ProcessingServiceImpl::IsLoadReportingEnabled() const
+{
+    return (m_loadReportInterval.total_milliseconds() > 0);
+}
 }
@@ -14,6 +14,8 @@ public:
     /** Constructs a processing service.
     * @param gossipPubSub - pubsub service
     * @param maximalNodesCount - maximal number of processing nodes allowed to be handled by the service
+    * @param executor - executor shared by all processing nodes of the service.
+    * If not set a thread pool sized to the number of hardware threads is created
     */
     ProcessingServiceImpl(
         std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub> gossipPubSub, 
@@ -21,7 +23,10 @@ public:
         std::shared_ptr<SubTaskEnqueuer> subTaskEnqueuer,
         std::shared_ptr<SubTaskStateStorage> subTaskStateStorage,
         std::shared_ptr<SubTaskResultStorage> subTaskResultStorage,
-        std::shared_ptr<ProcessingCore> processingCore);
+        std::shared_ptr<ProcessingCore> processingCore,
+        std::shared_ptr<ProcessingExecutor> executor = nullptr);
+
+    ~ProcessingServiceImpl();
 
     void StartProcessing(const std::string& processingGridChannelId);
     void StopProcessing();
@@ -30,6 +35,40 @@ public:
 
     void SetChannelListRequestTimeout(
         boost::posix_time::time_duration channelListRequestTimeout);
+
+    /** Sets a maximal number of subtasks that are processed simultaneously by each processing node
+    * The value is applied to nodes that are created after the call
+    */
+    void SetMaximalInFlightSubTaskCount(size_t maximalInFlightSubTaskCount);
+
+    /** Sets a number of subtasks that each processing node grabs in advance
+    * The value is applied to nodes that are created after the call
+    */
+    void SetSubTaskPrefetchDepth(size_t subTaskPrefetchDepth);
+
+    /** Sets a number of subtask duplicates that each processing node may grab from a queue tail
+    * to mitigate stragglers, 0 disables speculative execution
+    * The value is applied to nodes that are created after the call
+    */
+    void SetSpeculativeExecutionBudget(size_t duplicationBudget);
+
+    /** Enables delta-based replication of subtask queues, disabled by default.
+    * Should be enabled only when all services of the grid support queue deltas.
+    * The value is applied to nodes that are created after the call
+    */
+    void SetDeltaReplicationEnabled(bool isEnabled);
+
+    /** Sets an interval of the service load reports publishing to the grid channel.
+    * Reports of other services are used to route new task queues to the least loaded services.
+    * A zero interval disables load reports and capacity-aware channel acceptance.
+    * The value is applied when the processing is started
+    */
+    void SetLoadReportInterval(boost::posix_time::time_duration loadReportInterval);
+
+    /** Returns the executor that runs subtasks of the service nodes.
+    * The executor reports queue depth and worker utilization
+    */
+    std::shared_ptr<ProcessingExecutor> GetProcessingExecutor() const;
 private:
     /** Listen to data feed channel.
     * @param dataChannelId - identifier of a data feed channel
@@ -47,9 +86,64 @@ private:
 
     void AcceptProcessingChannel(const std::string& channelId);
 
-    void PublishLocalChannelList();
+    std::shared_ptr<ProcessingNode> CreateProcessingNode(const std::string& subTaskQueueId);
+
+    /** Publishes channels hosted by the local service in response to a channel list request.
+    * Requests from services that reported no free slots are not answered.
+    * Channels of the most loaded local nodes are published first.
+    * @param requestingNodeId - id of the service that requested channels
+    */
+    void PublishLocalChannelList(const std::string& requestingNodeId);
+
+    void HandleRequestTimeout(const boost::system::error_code& error);
 
-    void HandleRequestTimeout();
+    /** Publishes the local service load and schedules the next report
+    */
+    void PublishLoadReport();
+
+    /** Service pointer shared with asio handlers.
+    * The pointer is reset under the mutex when the processing is stopped,
+    * so that no handler uses the service after StopProcessing returns
+    */
+    struct HandlerGuard
+    {
+        std::mutex mutex;
+        ProcessingServiceImpl* service = nullptr;
+    };
+
+    /** Publishes a load report from an asio handler unless the processing was stopped
+    * @param handlerGuard - guard of the service that scheduled the report
+    */
+    static void PublishLoadReport(const std::weak_ptr<HandlerGuard>& handlerGuard);
+
+    /** Publishes an out of schedule load report when the set of processing nodes changes
+    */
+    void UpdateLoadReport();
+    void OnServiceLoadReceived(const SGProcessing::ProcessingServiceLoad& load);
+
+    /** Returns a number of subtasks that can be additionally processed by the service.
+    * The method should be called under the nodes mutex
+    */
+    size_t GetFreeSlotCount() const;
+
+    /** Checks if no other service reported more free slots than the local one.
+    * Services with the same number of free slots are compared by executor queue depth.
+    * Outdated reports are ignored.
+    * @param freeSlotCount - number of local free slots
+    * @param queueDepth - local executor queue depth
+    */
+    bool IsLeastLoadedService(size_t freeSlotCount, size_t queueDepth);
+
+    /** Checks if a service reported no free slots recently
+    * @param nodeId - service id
+    */
+    bool IsBusyService(const std::string& nodeId);
+
+    /** Returns a time before which received load reports are considered as outdated
+    */
+    std::chrono::steady_clock::time_point GetLoadReportExpirationTime() const;
+
+    bool IsLoadReportingEnabled() const;
 
     std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub> m_gossipPubSub;
     std::shared_ptr<boost::asio::io_context> m_context;
@@ -59,6 +153,11 @@ private:
     std::shared_ptr<SubTaskStateStorage> m_subTaskStateStorage;
     std::shared_ptr<SubTaskResultStorage> m_subTaskResultStorage;
     std::shared_ptr<ProcessingCore> m_processingCore;
+    std::shared_ptr<ProcessingExecutor> m_executor;
+    size_t m_maximalInFlightSubTaskCount;
+    size_t m_subTaskPrefetchDepth;
+    size_t m_duplicationBudget;
+    bool m_isDeltaReplicationEnabled;
 
     std::unique_ptr<sgns::ipfs_pubsub::GossipPubSubTopic> m_gridChannel;
     std::map<std::string, std::shared_ptr<ProcessingNode>> m_processingNodes;
@@ -66,6 +165,20 @@ private:
     boost::asio::deadline_timer m_timerChannelListRequestTimeout;
     boost::posix_time::time_duration m_channelListRequestTimeout;
 
+    struct ServiceLoad
+    {
+        SGProcessing::ProcessingServiceLoad load;
+        std::chrono::steady_clock::time_point receivingTime;
+    };
+
+    boost::asio::deadline_timer m_timerLoadReport;
+    boost::posix_time::time_duration m_loadReportInterval;
+    std::map<std::string, ServiceLoad> m_serviceLoads;
+    uint64_t m_lastExecutedSubTaskCount;
+    std::chrono::steady_clock::time_point m_lastLoadReportTime;
+    std::mutex m_mutexServiceLoads;
+    std::shared_ptr<HandlerGuard> m_handlerGuard;
+
     std::atomic<bool> m_isStopped;
     mutable std::mutex m_mutexNodes;
 
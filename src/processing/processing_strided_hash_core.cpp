@@ -0,0 +1,234 @@
+#include "processing_strided_hash_core.hpp"
+
+#include <boost/functional/hash.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(SGNS_PROCESSING_SCALAR_HASH)
+// The scalar kernel is forced, it is used to check that all kernels produce identical hashes
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SGNS_PROCESSING_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SGNS_PROCESSING_SSE2
+#endif
+
+namespace sgns::processing
+{
+namespace
+{
+    // Number of 32-bit hash lanes. A line is processed by blocks of LANE_COUNT words
+    constexpr size_t LANE_COUNT = 8;
+    constexpr size_t BLOCK_SIZE = LANE_COUNT * sizeof(uint32_t);
+
+    constexpr uint32_t LANE_SEED = 0x811C9DC5u;
+    constexpr uint32_t LANE_SEED_STEP = 0x9E3779B9u;
+    constexpr uint32_t LANE_PRIME = 0x9E3779B1u;
+    constexpr uint32_t LANE_ROTATION = 13;
+    constexpr uint32_t FINAL_PRIME = 0x01000193u;
+
+    inline uint32_t RotateLeft(uint32_t value, uint32_t shift)
+    {
+        return (value << shift) | (value >> (32 - shift));
+    }
+
+    inline uint32_t LoadWord(const uint8_t* data)
+    {
+        // Little-endian words are used on all supported platforms
+        uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        return word;
+    }
+
+    /** Mixes full blocks of a line to the lane accumulators.
+    * Each kernel implements lanes[i] = rotl((lanes[i] ^ word[i]) * LANE_PRIME, LANE_ROTATION)
+    * @return number of processed bytes
+    */
+#if defined(SGNS_PROCESSING_AVX2)
+    const char* KERNEL_NAME = "avx2";
+
+    size_t ProcessBlocks(const uint8_t* line, size_t length, uint32_t* lanes)
+    {
+        __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+        const __m256i prime = _mm256_set1_epi32(static_cast<int>(LANE_PRIME));
+
+        size_t pos = 0;
+        for (; pos + BLOCK_SIZE <= length; pos += BLOCK_SIZE)
+        {
+            __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + pos));
+            acc = _mm256_mullo_epi32(_mm256_xor_si256(acc, words), prime);
+            acc = _mm256_or_si256(_mm256_slli_epi32(acc, LANE_ROTATION), _mm256_srli_epi32(acc, 32 - LANE_ROTATION));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        return pos;
+    }
+#elif defined(SGNS_PROCESSING_SSE2)
+    const char* KERNEL_NAME = "sse2";
+
+    inline __m128i MultiplyLow32(__m128i a, __m128i b)
+    {
+        // SSE2 has no 32-bit low multiplication, even and odd lanes are multiplied separately
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+        return _mm_unpacklo_epi32(
+            _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    inline __m128i MixWords(__m128i acc, __m128i words, __m128i prime)
+    {
+        acc = MultiplyLow32(_mm_xor_si128(acc, words), prime);
+        return _mm_or_si128(_mm_slli_epi32(acc, LANE_ROTATION), _mm_srli_epi32(acc, 32 - LANE_ROTATION));
+    }
+
+    size_t ProcessBlocks(const uint8_t* line, size_t length, uint32_t* lanes)
+    {
+        __m128i accLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+        __m128i accHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes + 4));
+        const __m128i prime = _mm_set1_epi32(static_cast<int>(LANE_PRIME));
+
+        size_t pos = 0;
+        for (; pos + BLOCK_SIZE <= length; pos += BLOCK_SIZE)
+        {
+            accLow = MixWords(accLow, _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + pos)), prime);
+            accHigh = MixWords(accHigh, _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + pos + 16)), prime);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), accLow);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes + 4), accHigh);
+        return pos;
+    }
+#else
+    const char* KERNEL_NAME = "scalar";
+
+    size_t ProcessBlocks(const uint8_t* line, size_t length, uint32_t* lanes)
+    {
+        size_t pos = 0;
+        for (; pos + BLOCK_SIZE <= length; pos += BLOCK_SIZE)
+        {
+            for (size_t laneIdx = 0; laneIdx < LANE_COUNT; ++laneIdx)
+            {
+                lanes[laneIdx] = RotateLeft(
+                    (lanes[laneIdx] ^ LoadWord(line + pos + laneIdx * sizeof(uint32_t))) * LANE_PRIME, LANE_ROTATION);
+            }
+        }
+        return pos;
+    }
+#endif
+
+    void ProcessLine(const uint8_t* line, size_t length, uint32_t* lanes)
+    {
+        size_t pos = ProcessBlocks(line, length, lanes);
+        if (pos < length)
+        {
+            // A line tail is zero-padded to a full block
+            uint8_t tail[BLOCK_SIZE] = {};
+            std::memcpy(tail, line + pos, length - pos);
+            ProcessBlocks(tail, BLOCK_SIZE, lanes);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ProcessingStridedHashCore::ProcessingStridedHashCore(std::string blockDirectory)
+    : m_blockDirectory(std::move(blockDirectory))
+{
+}
+
+void ProcessingStridedHashCore::ProcessSubTask(
+    const SGProcessing::SubTask& subTask, SGProcessing::SubTaskResult& result,
+    uint32_t initialHashCode)
+{
+    auto blockPath = m_blockDirectory + "/" + subTask.ipfsblock();
+
+    boost::interprocess::mapped_region region;
+    try
+    {
+        boost::interprocess::file_mapping blockFile(blockPath.c_str(), boost::interprocess::read_only);
+        region = boost::interprocess::mapped_region(blockFile, boost::interprocess::read_only);
+    }
+    catch (const boost::interprocess::interprocess_exception& ex)
+    {
+        throw std::runtime_error("Cannot map block '" + blockPath + "': " + ex.what());
+    }
+    m_logger->debug("[BLOCK_MAPPED] {}, {} bytes", blockPath, region.get_size());
+
+    auto data = static_cast<const uint8_t*>(region.get_address());
+    size_t subTaskResultHash = initialHashCode;
+    for (int chunkIdx = 0; chunkIdx < subTask.chunkstoprocess_size(); ++chunkIdx)
+    {
+        auto chunkHash = HashChunk(data, region.get_size(), subTask.chunkstoprocess(chunkIdx));
+        result.add_chunk_hashes(chunkHash);
+        boost::hash_combine(subTaskResultHash, chunkHash);
+    }
+
+    result.set_result_hash(subTaskResultHash);
+}
+
+uint32_t ProcessingStridedHashCore::HashChunk(
+    const uint8_t* data, size_t dataSize, const SGProcessing::ProcessingChunk& chunk)
+{
+    uint64_t lineLength = chunk.subchunk_width();
+    uint64_t lineCount = chunk.subchunk_height();
+    uint64_t subChunkCount = chunk.n_subchunks();
+
+    if ((lineLength > 0) && (lineCount > 0) && (subChunkCount > 0))
+    {
+        // The last byte of the chunk is a last byte of the last line of the last sub-block
+        uint64_t chunkEnd = chunk.offset()
+            + (subChunkCount - 1) * chunk.stride()
+            + (lineCount - 1) * chunk.line_stride()
+            + lineLength;
+        if (chunkEnd > dataSize)
+        {
+            throw std::runtime_error("Chunk '" + chunk.chunkid() + "' exceeds the block data");
+        }
+    }
+
+    alignas(32) uint32_t lanes[LANE_COUNT];
+    for (size_t laneIdx = 0; laneIdx < LANE_COUNT; ++laneIdx)
+    {
+        lanes[laneIdx] = LANE_SEED ^ static_cast<uint32_t>(laneIdx * LANE_SEED_STEP);
+    }
+
+    for (uint64_t subChunkIdx = 0; subChunkIdx < subChunkCount; ++subChunkIdx)
+    {
+        auto subChunk = data + chunk.offset() + subChunkIdx * chunk.stride();
+        for (uint64_t lineIdx = 0; lineIdx < lineCount; ++lineIdx)
+        {
+            ProcessLine(subChunk + lineIdx * chunk.line_stride(), lineLength, lanes);
+        }
+    }
+
+    // Lanes are folded together with the chunk shape, the shape distinguishes zero-padded line tails
+    uint32_t hash = LANE_SEED;
+    for (size_t laneIdx = 0; laneIdx < LANE_COUNT; ++laneIdx)
+    {
+        hash = (hash ^ lanes[laneIdx]) * FINAL_PRIME;
+    }
+    hash = (hash ^ chunk.subchunk_width()) * FINAL_PRIME;
+    hash = (hash ^ chunk.subchunk_height()) * FINAL_PRIME;
+    hash = (hash ^ chunk.n_subchunks()) * FINAL_PRIME;
+
+    // Final avalanche
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+const char* ProcessingStridedHashCore::GetKernelName()
+{
+    return KERNEL_NAME;
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
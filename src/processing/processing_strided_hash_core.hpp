@@ -0,0 +1,59 @@
+/**
+* Header file for the reference strided chunk processing core
+*/
+
+#ifndef SUPERGENIUS_PROCESSING_STRIDED_HASH_CORE_HPP
+#define SUPERGENIUS_PROCESSING_STRIDED_HASH_CORE_HPP
+
+#include <processing/processing_core.hpp>
+#include <base/logger.hpp>
+
+#include <string>
+
+namespace sgns::processing
+{
+/** Reference processing core that calculates chunk result hashes over a block data.
+* The subtask block is a file that is memory-mapped and read in place.
+* A chunk consists of n_subchunks sub-blocks, the sub-block i starts at (offset + i * stride)
+* and contains subchunk_height lines of subchunk_width bytes, the line j of the sub-block starts
+* at (j * line_stride) from the sub-block beginning.
+* The chunk hash is calculated by a lane-parallel kernel which is vectorized with AVX2 or SSE2
+* depending on the target instruction set. All kernels produce identical hashes, nodes built for different
+* instruction sets compare them during validation. SGNS_PROCESSING_SCALAR_HASH forces the scalar kernel.
+*/
+class ProcessingStridedHashCore : public ProcessingCore
+{
+public:
+    /** Creates a processing core
+    * @param blockDirectory - directory that contains block files named by subtask ipfsblock values
+    */
+    explicit ProcessingStridedHashCore(std::string blockDirectory);
+
+    /** ProcessingCore overrides
+    * @throws std::runtime_error if a block cannot be mapped or a chunk exceeds the block data
+    */
+    void ProcessSubTask(
+        const SGProcessing::SubTask& subTask, SGProcessing::SubTaskResult& result,
+        uint32_t initialHashCode) override;
+
+    /** Calculates a chunk hash
+    * @param data - block data
+    * @param dataSize - block data size
+    * @param chunk - chunk layout
+    * @return chunk hash
+    * @throws std::runtime_error if the chunk exceeds the block data
+    */
+    static uint32_t HashChunk(const uint8_t* data, size_t dataSize, const SGProcessing::ProcessingChunk& chunk);
+
+    /** Returns a name of the kernel that is used to calculate hashes
+    */
+    static const char* GetKernelName();
+
+private:
+    std::string m_blockDirectory;
+
+    base::Logger m_logger = base::createLogger("ProcessingStridedHashCore");
+};
+}
+
+#endif // SUPERGENIUS_PROCESSING_STRIDED_HASH_CORE_HPP
@@ -1,10 +1,13 @@
 #include "processing_subtask_enqueuer_impl.hpp"
 
+#include <algorithm>
+
 namespace sgns::processing
 {
 SubTaskEnqueuerImpl::SubTaskEnqueuerImpl(
     std::shared_ptr<ProcessingTaskQueue> taskQueue)
     : m_taskQueue(taskQueue)
+    , m_candidateTaskCount(16)
 {
 }
 
@@ -12,18 +15,47 @@ bool SubTaskEnqueuerImpl::EnqueueSubTasks(
     std::string& subTaskQueueId, 
     std::list<SGProcessing::SubTask>& subTasks)
 {
-    SGProcessing::Task task;
-    std::string taskKey;
-    if (m_taskQueue->GrabTask(taskKey, task))
+    std::list<ProcessingTaskScheduler::AvailableTask> availableTasks;
+    if (!m_taskQueue->GetAvailableTasks(m_candidateTaskCount, availableTasks))
+    {
+        return false;
+    }
+
+    auto now = std::chrono::system_clock::now();
+    m_scheduler.OrderTasks(availableTasks, now);
+
+    // A preferred task can be grabbed by another node in the meantime, the next one is tried then
+    for (const auto& [taskKey, availableTask] : availableTasks)
     {
-        subTaskQueueId = taskKey;
+        SGProcessing::Task task;
+        if (m_taskQueue->GrabTaskById(taskKey, task))
+        {
+            subTaskQueueId = taskKey;
 
-        m_taskQueue->GetSubTasks(taskKey, subTasks);
+            m_taskQueue->GetSubTasks(taskKey, subTasks);
+            m_scheduler.OnTaskGrabbed(task, subTasks.size(), now);
 
-        m_logger->debug("ENQUEUE_SUBTASKS: {}", subTasks.size());
-        return true;
+            m_logger->debug("ENQUEUE_SUBTASKS: {}, TENANT: {}, PRIORITY: {}",
+                subTasks.size(), task.tenant_id(), task.priority());
+            return true;
+        }
     }
     return false;
 }
 
-}
\ No newline at end of file
+void SubTaskEnqueuerImpl::SetCandidateTaskCount(size_t candidateTaskCount)
+{
+    m_candidateTaskCount = std::max<size_t>(candidateTaskCount, 1);
+}
+
+ProcessingTaskScheduler& SubTaskEnqueuerImpl::GetScheduler()
+{
+    return m_scheduler;
+}
+
+std::map<std::string, TenantStatistics> SubTaskEnqueuerImpl::GetTenantStatistics() const
+{
+    return m_scheduler.GetTenantStatistics();
+}
+
+}
@@ -4,7 +4,9 @@
 #include <base/logger.hpp>
 #include <processing/processing_subtask_enqueuer.hpp>
 #include <processing/processing_task_queue.hpp>
+#include <processing/processing_task_scheduler.hpp>
 #include <list>
+#include <map>
 #include <string>
 
 namespace sgns::processing
@@ -20,8 +22,24 @@ public:
         std::string& subTaskQueueId, 
         std::list<SGProcessing::SubTask>& subTasks) override;
 
+    /** Sets a number of available tasks the scheduler chooses from
+    * @param candidateTaskCount - number of tasks
+    */
+    void SetCandidateTaskCount(size_t candidateTaskCount);
+
+    /** Returns a scheduler that selects tasks to grab.
+    * Can be used to set tenant weights and a task aging interval.
+    */
+    ProcessingTaskScheduler& GetScheduler();
+
+    /** Returns statistics of tenants which tasks were grabbed by the enqueuer
+    */
+    std::map<std::string, TenantStatistics> GetTenantStatistics() const;
+
 private:
     std::shared_ptr<ProcessingTaskQueue> m_taskQueue;
+    ProcessingTaskScheduler m_scheduler;
+    size_t m_candidateTaskCount;
     sgns::base::Logger m_logger = sgns::base::createLogger("SubTaskEnqueuerImpl");
 
 };
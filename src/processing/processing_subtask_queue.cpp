@@ -1,15 +1,34 @@
 #include "processing_subtask_queue.hpp"
 
+#include <boost/optional.hpp>
+
 #include <numeric>
 #include <sstream>
 
 namespace sgns::processing
 {
+namespace
+{
+    std::vector<bool> GetItemEnabledStates(size_t itemCount, const std::vector<int>& enabledItemIndices)
+    {
+        std::vector<bool> isItemEnabled(itemCount, false);
+        for (auto itemIdx : enabledItemIndices)
+        {
+            if ((itemIdx >= 0) && (static_cast<size_t>(itemIdx) < itemCount))
+            {
+                isItemEnabled[itemIdx] = true;
+            }
+        }
+        return isItemEnabled;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ProcessingSubTaskQueue::ProcessingSubTaskQueue(
     const std::string& localNodeId)
     : m_localNodeId(localNodeId)
     , m_queue(nullptr)
+    , m_indexedItemUpdateCount(0)
 {
 }
 
@@ -17,7 +36,9 @@ void ProcessingSubTaskQueue::CreateQueue(
     SGProcessing::ProcessingQueue* queue, const std::vector<int>& enabledItemIndices)
 {
     m_queue = queue;
-    m_enabledItemIndices = enabledItemIndices;
+    m_isItemEnabled = GetItemEnabledStates(m_queue->items_size(), enabledItemIndices);
+    m_modifiedItemIndices.clear();
+    IndexItems();
     ChangeOwnershipTo(m_localNodeId);
 }
 
@@ -27,8 +48,23 @@ bool ProcessingSubTaskQueue::UpdateQueue(
     if (!m_queue
         || (m_queue->last_update_timestamp() <= queue->last_update_timestamp()))
     {
-        m_queue = queue;
-        m_enabledItemIndices = enabledItemIndices;
+        if (m_queue != queue)
+        {
+            // Local changes are replaced with the received queue snapshot
+            m_modifiedItemIndices.clear();
+        }
+
+        auto isItemEnabled = GetItemEnabledStates(queue->items_size(), enabledItemIndices);
+        if (m_queue && (m_queue->items_size() == queue->items_size()))
+        {
+            ReindexChangedItems(queue, std::move(isItemEnabled));
+        }
+        else
+        {
+            m_queue = queue;
+            m_isItemEnabled = std::move(isItemEnabled);
+            IndexItems();
+        }
         LogQueue();
         return true;
     }
@@ -38,25 +74,150 @@ bool ProcessingSubTaskQueue::UpdateQueue(
 bool ProcessingSubTaskQueue::LockItem(size_t& lockedItemIndex)
 {
     // The method has to be called in scoped lock of queue mutex
-    for (auto itemIdx : m_enabledItemIndices)
+    if (m_unlockedItems.empty())
+    {
+        return false;
+    }
+
+    // The first unlocked item with the lowest rank is taken to keep the queue processing order
+    auto itemIdx = m_unlockedItems.begin()->second;
+    auto timestamp = std::chrono::system_clock::now();
+
+    SetItemLock(itemIdx, m_localNodeId, timestamp.time_since_epoch().count());
+
+    m_queue->set_last_update_timestamp(timestamp.time_since_epoch().count());
+    m_modifiedItemIndices.insert(itemIdx);
+
+    LogQueue();
+
+    lockedItemIndex = itemIdx;
+    return true;
+}
+
+void ProcessingSubTaskQueue::IndexItems()
+{
+    m_unlockedItems.clear();
+    m_lockedItemsByTimestamp.clear();
+    m_lockedItemIndices.clear();
+    m_lockedItemIndicesByNode.clear();
+
+    for (int itemIdx = 0; itemIdx < m_queue->items_size(); ++itemIdx)
     {
-        if (m_queue->items(itemIdx).lock_node_id().empty())
+        AddItemToIndices(itemIdx);
+    }
+}
+
+void ProcessingSubTaskQueue::ReindexChangedItems(SGProcessing::ProcessingQueue* queue, std::vector<bool> isItemEnabled)
+{
+    // Indexed entries are removed while the current queue items still hold their lock states
+    std::vector<int> changedItemIndices;
+    for (int itemIdx = 0; itemIdx < queue->items_size(); ++itemIdx)
+    {
+        const auto& item = m_queue->items(itemIdx);
+        const auto& receivedItem = queue->items(itemIdx);
+        if ((m_isItemEnabled[itemIdx] != isItemEnabled[itemIdx])
+            || (item.lock_node_id() != receivedItem.lock_node_id())
+            || (item.lock_timestamp() != receivedItem.lock_timestamp()))
         {
-            auto timestamp = std::chrono::system_clock::now();
+            RemoveItemFromIndices(itemIdx);
+            changedItemIndices.push_back(itemIdx);
+        }
+    }
+
+    m_queue = queue;
+    m_isItemEnabled = std::move(isItemEnabled);
+    for (auto itemIdx : changedItemIndices)
+    {
+        AddItemToIndices(itemIdx);
+    }
+}
 
-            m_queue->mutable_items(itemIdx)->set_lock_node_id(m_localNodeId);
-            m_queue->mutable_items(itemIdx)->set_lock_timestamp(timestamp.time_since_epoch().count());
+void ProcessingSubTaskQueue::SetItemEnabled(size_t itemIdx, bool isEnabled)
+{
+    if (!m_queue || (itemIdx >= m_isItemEnabled.size()) || (m_isItemEnabled[itemIdx] == isEnabled))
+    {
+        return;
+    }
 
-            m_queue->set_last_update_timestamp(timestamp.time_since_epoch().count());
+    RemoveItemFromIndices(static_cast<int>(itemIdx));
+    m_isItemEnabled[itemIdx] = isEnabled;
+    AddItemToIndices(static_cast<int>(itemIdx));
+}
 
-            LogQueue();
+void ProcessingSubTaskQueue::SetItemLock(int itemIdx, const std::string& lockNodeId, int64_t lockTimestamp)
+{
+    RemoveItemFromIndices(itemIdx);
+    auto item = m_queue->mutable_items(itemIdx);
+    item->set_lock_node_id(lockNodeId);
+    item->set_lock_timestamp(lockTimestamp);
+    AddItemToIndices(itemIdx);
+}
 
-            lockedItemIndex = itemIdx;
-            return true;
+int ProcessingSubTaskQueue::GetItemRank(int itemIdx) const
+{
+    return (static_cast<size_t>(itemIdx) < m_itemRanks.size()) ? m_itemRanks[itemIdx] : 0;
+}
+
+void ProcessingSubTaskQueue::SetItemRanks(std::vector<int> itemRanks)
+{
+    std::vector<int> unlockedItemIndices;
+    unlockedItemIndices.reserve(m_unlockedItems.size());
+    for (const auto& [itemRank, itemIdx] : m_unlockedItems)
+    {
+        unlockedItemIndices.push_back(itemIdx);
+    }
+
+    m_itemRanks = std::move(itemRanks);
+
+    // Only unlocked items are ordered by rank
+    m_unlockedItems.clear();
+    for (auto itemIdx : unlockedItemIndices)
+    {
+        m_unlockedItems.emplace(GetItemRank(itemIdx), itemIdx);
+    }
+}
+
+void ProcessingSubTaskQueue::AddItemToIndices(int itemIdx)
+{
+    ++m_indexedItemUpdateCount;
+    const auto& item = m_queue->items(itemIdx);
+    if (item.lock_node_id().empty())
+    {
+        if (m_isItemEnabled[itemIdx])
+        {
+            m_unlockedItems.emplace(GetItemRank(itemIdx), itemIdx);
         }
+        return;
     }
 
-    return false;
+    m_lockedItemIndices.insert(itemIdx);
+    m_lockedItemIndicesByNode[item.lock_node_id()].insert(itemIdx);
+    if (m_isItemEnabled[itemIdx])
+    {
+        m_lockedItemsByTimestamp.emplace(item.lock_timestamp(), itemIdx);
+    }
+}
+
+void ProcessingSubTaskQueue::RemoveItemFromIndices(int itemIdx)
+{
+    const auto& item = m_queue->items(itemIdx);
+    if (item.lock_node_id().empty())
+    {
+        m_unlockedItems.erase({ GetItemRank(itemIdx), itemIdx });
+        return;
+    }
+
+    m_lockedItemIndices.erase(itemIdx);
+    auto itNodeItems = m_lockedItemIndicesByNode.find(item.lock_node_id());
+    if (itNodeItems != m_lockedItemIndicesByNode.end())
+    {
+        itNodeItems->second.erase(itemIdx);
+        if (itNodeItems->second.empty())
+        {
+            m_lockedItemIndicesByNode.erase(itNodeItems);
+        }
+    }
+    m_lockedItemsByTimestamp.erase({ item.lock_timestamp(), itemIdx });
 }
 
 bool ProcessingSubTaskQueue::GrabItem(size_t& grabbedItemIndex)
@@ -96,63 +257,41 @@ bool ProcessingSubTaskQueue::RollbackOwnership()
     }
 
     // Find the current queue owner
-    auto ownerNodeId = m_queue->owner_node_id();
-    int ownerNodeIdx = -1;
-    for (int itemIdx = 0; itemIdx < (int)m_queue->items_size(); ++itemIdx)
+    auto itOwnerItems = m_lockedItemIndicesByNode.find(m_queue->owner_node_id());
+
+    // The previous owner is a node that locked an item before the current owner did it.
+    // If the queue owner didn't lock any subtask the last locked item is checked
+    boost::optional<int> previousLockedItemIdx;
+    if (itOwnerItems != m_lockedItemIndicesByNode.end())
     {
-        if (m_queue->items(itemIdx).lock_node_id() == ownerNodeId)
+        // Loop cyclically over locked items in backward direction starting from item[ownerNodeIdx - 1]
+        // and excluding the item[ownerNodeIdx]
+        int ownerNodeIdx = *itOwnerItems->second.begin();
+        auto itOwnerItem = m_lockedItemIndices.find(ownerNodeIdx);
+        if (itOwnerItem != m_lockedItemIndices.begin())
         {
-            ownerNodeIdx = itemIdx;
-            break;
+            previousLockedItemIdx = *std::prev(itOwnerItem);
         }
-    }
-
-    if (ownerNodeIdx >= 0)
-    {
-        // Check if the local node is the previous queue owner
-        for (int idx = 1; idx < m_queue->items_size(); ++idx)
+        else if (*m_lockedItemIndices.rbegin() != ownerNodeIdx)
         {
-            // Loop cyclically over queue items in backward direction starting from item[ownerNodeIdx - 1]
-            // and excluding the item[ownerNodeIdx]
-            int itemIdx = (m_queue->items_size() + ownerNodeIdx - idx) % m_queue->items_size();
-            if (!m_queue->items(itemIdx).lock_node_id().empty())
-            {
-                if (m_queue->items(itemIdx).lock_node_id() == m_localNodeId)
-                {
-                    // The local node is the previous queue owner
-                    ChangeOwnershipTo(m_localNodeId);
-                    return true;
-                }
-                else
-                {
-                    // Another node should take the ownership
-                    return false;
-                }
-            }
+            previousLockedItemIdx = *m_lockedItemIndices.rbegin();
         }
     }
-    else
+    else if (!m_lockedItemIndices.empty())
+    {
+        previousLockedItemIdx = *m_lockedItemIndices.rbegin();
+    }
+
+    if (previousLockedItemIdx)
     {
-        // The queue owner didn't lock any subtask
-        // Find the last locked item
-        for (int idx = 1; idx <= m_queue->items_size(); ++idx)
+        if (m_queue->items(*previousLockedItemIdx).lock_node_id() == m_localNodeId)
         {
-            int itemIdx = (m_queue->items_size() - idx);
-            if (!m_queue->items(itemIdx).lock_node_id().empty())
-            {
-                if (m_queue->items(itemIdx).lock_node_id() == m_localNodeId)
-                {
-                    // The local node is the last locked item
-                    ChangeOwnershipTo(m_localNodeId);
-                    return true;
-                }
-                else
-                {
-                    // Another node should take the ownership
-                    return false;
-                }
-            }
+            // The local node is the previous queue owner
+            ChangeOwnershipTo(m_localNodeId);
+            return true;
         }
+        // Another node should take the ownership
+        return false;
     }
 
     // No locked items found
@@ -174,24 +313,24 @@ bool ProcessingSubTaskQueue::UnlockExpiredItems(std::chrono::system_clock::durat
     if (HasOwnership())
     {
         auto timestamp = std::chrono::system_clock::now();
-        for (auto itemIdx : m_enabledItemIndices)
+        // Locked items that no result was obtained for are checked starting from the earliest lock
+        // @todo replace the result channel with subtask id to identify a subtask that should be unlocked
+        while (!m_lockedItemsByTimestamp.empty())
         {
-            // Check if a subtask is locked, expired and no result was obtained for it
-            // @todo replace the result channel with subtask id to identify a subtask that should be unlocked
-            if (!m_queue->items(itemIdx).lock_node_id().empty())
+            auto [lockTimestamp, itemIdx] = *m_lockedItemsByTimestamp.begin();
+            auto expirationTime =
+                std::chrono::system_clock::time_point(
+                    std::chrono::system_clock::duration(lockTimestamp)) + expirationTimeout;
+            if (timestamp <= expirationTime)
             {
-                auto expirationTime =
-                    std::chrono::system_clock::time_point(
-                        std::chrono::system_clock::duration(m_queue->items(itemIdx).lock_timestamp())) + expirationTimeout;
-                if (timestamp > expirationTime)
-                {
-                    // Unlock the item
-                    m_queue->mutable_items(itemIdx)->set_lock_node_id("");
-                    m_queue->mutable_items(itemIdx)->set_lock_timestamp(0);
-                    unlocked = true;
-                    m_logger->debug("EXPIRED_SUBTASK_UNLOCKED {}", itemIdx);
-                }
+                break;
             }
+
+            // Unlock the item
+            SetItemLock(itemIdx, "", 0);
+            m_modifiedItemIndices.insert(itemIdx);
+            unlocked = true;
+            m_logger->debug("EXPIRED_SUBTASK_UNLOCKED {}", itemIdx);
         }
 
         if (unlocked)
@@ -203,22 +342,75 @@ bool ProcessingSubTaskQueue::UnlockExpiredItems(std::chrono::system_clock::durat
     return unlocked;
 }
 
+bool ProcessingSubTaskQueue::FindOldestRemotelyLockedItem(
+    size_t& itemIndex, const std::set<size_t>& excludedItemIndices) const
+{
+    // Only locked items that no result was obtained for are indexed
+    for (const auto& [lockTimestamp, itemIdx] : m_lockedItemsByTimestamp)
+    {
+        if ((m_queue->items(itemIdx).lock_node_id() != m_localNodeId)
+            && (excludedItemIndices.find(itemIdx) == excludedItemIndices.end()))
+        {
+            itemIndex = itemIdx;
+            return true;
+        }
+    }
+    return false;
+}
+
 std::chrono::system_clock::time_point ProcessingSubTaskQueue::GetLastLockTimestamp() const
 {
     std::chrono::system_clock::time_point lastLockTimestamp;
 
-    for (auto itemIdx : m_enabledItemIndices)
+    // Only locked items that no result was obtained for are indexed
+    if (!m_lockedItemsByTimestamp.empty())
+    {
+        lastLockTimestamp = std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(m_lockedItemsByTimestamp.rbegin()->first));
+    }
+
+    return lastLockTimestamp;
+}
+
+bool ProcessingSubTaskQueue::ApplyDelta(const SGProcessing::SubTaskQueueDelta& delta)
+{
+    if (!m_queue)
     {
-        // Check if an item is locked and no result was obtained for it
-        if (!m_queue->items(itemIdx).lock_node_id().empty())
+        return false;
+    }
+
+    for (const auto& itemDelta : delta.items())
+    {
+        if (itemDelta.item_idx() >= static_cast<uint32_t>(m_queue->items_size()))
         {
-            lastLockTimestamp = std::max(lastLockTimestamp,
-                std::chrono::system_clock::time_point(
-                    std::chrono::system_clock::duration(m_queue->items(itemIdx).lock_timestamp())));
+            m_logger->error("INVALID_DELTA_ITEM_INDEX {}", itemDelta.item_idx());
+            return false;
         }
     }
 
-    return lastLockTimestamp;
+    for (const auto& itemDelta : delta.items())
+    {
+        SetItemLock(static_cast<int>(itemDelta.item_idx()), itemDelta.lock_node_id(), itemDelta.lock_timestamp());
+    }
+
+    m_queue->set_owner_node_id(delta.owner_node_id());
+    m_queue->set_last_update_timestamp(delta.last_update_timestamp());
+    m_queue->set_version(delta.version());
+
+    LogQueue();
+    return true;
+}
+
+std::vector<size_t> ProcessingSubTaskQueue::TakeModifiedItemIndices()
+{
+    std::vector<size_t> modifiedItemIndices(m_modifiedItemIndices.begin(), m_modifiedItemIndices.end());
+    m_modifiedItemIndices.clear();
+    return modifiedItemIndices;
+}
+
+size_t ProcessingSubTaskQueue::GetIndexedItemUpdateCount() const
+{
+    return m_indexedItemUpdateCount;
 }
 
 void ProcessingSubTaskQueue::LogQueue() const
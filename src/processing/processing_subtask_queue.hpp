@@ -9,9 +9,15 @@
 #include <processing/proto/SGProcessing.pb.h>
 #include <base/logger.hpp>
 
+#include <map>
+#include <set>
+
 namespace sgns::processing
 {
 /** Distributed queue implementation
+* Lock states of protobuf queue items are mirrored to sorted indices
+* that allow to find a free item, the earliest expired lock and the previous queue owner
+* without a scan over all queue items.
 */
 class ProcessingSubTaskQueue
 {
@@ -47,33 +53,102 @@ public:
     */
     bool HasOwnership() const;
 
-    /** Updates the local queue with a snapshot that have the most recent timestamp
+    /** Updates the local queue with a snapshot that have the most recent timestamp.
+    * Only items which lock or enabled state differs from the indexed state are reindexed.
     * @param queue - the queue snapshot
     * @param enabledItemIndices - indexes of enabled items. Disabled items are considered as deleted.
     */
     bool UpdateQueue(SGProcessing::ProcessingQueue* queue, const std::vector<int>& enabledItemIndices);
 
+    /** Enables or disables a single queue item
+    * @param itemIdx - item index
+    * @param isEnabled - new item state. Disabled items are considered as deleted.
+    */
+    void SetItemEnabled(size_t itemIdx, bool isEnabled);
+
     /** Unlocks expired queue items
     * @param expirationTimeout - timeout applied to detect expired items
     * @return true if at least one item was unlocked
     */
     bool UnlockExpiredItems(std::chrono::system_clock::duration expirationTimeout);
 
+    /** Finds an item with the oldest lock that is held by another node
+    * @param itemIndex - found item index
+    * @param excludedItemIndices - items that should be skipped
+    * @return false if no such item found
+    */
+    bool FindOldestRemotelyLockedItem(size_t& itemIndex, const std::set<size_t>& excludedItemIndices) const;
+
     /** Returns the most recent item lock timestamp
     */
     std::chrono::system_clock::time_point GetLastLockTimestamp() const;
 
+    /** Applies lock and ownership changes received from the queue owner
+    * @param delta - queue changes
+    * @return false if the delta cannot be applied to the local queue
+    */
+    bool ApplyDelta(const SGProcessing::SubTaskQueueDelta& delta);
+
+    /** Sets item ranks that define an order of item grabbing.
+    * Unlocked items with lower ranks are grabbed first, items with equal ranks are grabbed in index order.
+    * Items without a rank have rank 0.
+    * @param itemRanks - ranks of queue items
+    */
+    void SetItemRanks(std::vector<int> itemRanks);
+
+    /** Returns indices of items which lock state was locally changed since the previous call
+    * @return list of changed item indices
+    */
+    std::vector<size_t> TakeModifiedItemIndices();
+
+    /** Returns a number of item index updates made since the queue is constructed
+    */
+    size_t GetIndexedItemUpdateCount() const;
+
 private:
     void ChangeOwnershipTo(const std::string& nodeId);
 
     bool LockItem(size_t& lockedItemIndex);
 
+    /** Rebuilds item indices from the protobuf queue items
+    */
+    void IndexItems();
+
+    /** Reindexes items which lock or enabled state differs in the passed queue and switches to it
+    * @param queue - queue of the same size as the current one
+    * @param isItemEnabled - enabled states of the passed queue items
+    */
+    void ReindexChangedItems(SGProcessing::ProcessingQueue* queue, std::vector<bool> isItemEnabled);
+
+    /** Changes an item lock and keeps item indices in sync with it
+    * @param itemIdx - item index
+    * @param lockNodeId - locking node id, empty string means that the item is unlocked
+    * @param lockTimestamp - lock timestamp
+    */
+    void SetItemLock(int itemIdx, const std::string& lockNodeId, int64_t lockTimestamp);
+
+    int GetItemRank(int itemIdx) const;
+    void AddItemToIndices(int itemIdx);
+    void RemoveItemFromIndices(int itemIdx);
+
     void LogQueue() const;
 
     std::string m_localNodeId;
     SGProcessing::ProcessingQueue* m_queue;
 
-    std::vector<int> m_enabledItemIndices;
+    std::set<size_t> m_modifiedItemIndices;
+
+    // Item indices
+    std::vector<bool> m_isItemEnabled;
+    std::vector<int> m_itemRanks;
+    // Enabled unlocked items ordered by item rank and index
+    std::set<std::pair<int, int>> m_unlockedItems;
+    // Enabled locked items ordered by lock timestamp
+    std::set<std::pair<int64_t, int>> m_lockedItemsByTimestamp;
+    // All locked items including the disabled ones
+    std::set<int> m_lockedItemIndices;
+    std::map<std::string, std::set<int>> m_lockedItemIndicesByNode;
+    size_t m_indexedItemUpdateCount;
 
     base::Logger m_logger = base::createLogger("ProcessingSubTaskQueue");
 };
@@ -35,6 +35,12 @@ public:
     */
     virtual void GrabSubTask(SubTaskGrabbedCallback onSubTaskGrabbedCallback) = 0;
 
+    /** Asynchronous getting of several subtasks from the queue
+    * @param subTaskCount - maximal number of subtasks to grab
+    * @param onSubTaskGrabbedCallback a callback that is called for each subtask grabbed by the local node
+    */
+    virtual void GrabSubTasks(size_t subTaskCount, SubTaskGrabbedCallback onSubTaskGrabbedCallback) = 0;
+
     /** Finalizes subtask execution
     * @param subTaskId - id of processed subtask
     * @param subTaskResult - result of subtask processing
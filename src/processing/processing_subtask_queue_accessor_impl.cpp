@@ -7,20 +7,29 @@ SubTaskQueueAccessorImpl::SubTaskQueueAccessorImpl(
     std::shared_ptr<ProcessingSubTaskQueueManager> subTaskQueueManager,
     std::shared_ptr<SubTaskStateStorage> subTaskStateStorage,
     std::shared_ptr<SubTaskResultStorage> subTaskResultStorage,
-    std::function<void(const SGProcessing::TaskResult&)> taskResultProcessingSink)
+    std::function<void(const SGProcessing::TaskResult&)> taskResultProcessingSink,
+    const std::string& resultChannelId)
     : m_gossipPubSub(gossipPubSub)
     , m_subTaskQueueManager(subTaskQueueManager)
     , m_subTaskStateStorage(subTaskStateStorage)
     , m_subTaskResultStorage(subTaskResultStorage)
     , m_taskResultProcessingSink(taskResultProcessingSink)
+    , m_isStorageSyncRequired(false)
+    , m_resultBatchSize(0)
+    , m_resultPublishingWindow(std::chrono::milliseconds(10))
+    , m_maximalResultBatchSize(64 * 1024)
+    , m_timerResultPublishing(*m_gossipPubSub->GetAsioContext())
 {
-    // @todo replace hardcoded channel identified with an input value
-    m_resultChannel = std::make_shared<ipfs_pubsub::GossipPubSubTopic>(m_gossipPubSub, "RESULT_CHANNEL_ID");
+    m_resultChannel = std::make_shared<ipfs_pubsub::GossipPubSubTopic>(m_gossipPubSub, resultChannelId);
     m_logger->debug("[CREATED] this: {}, thread_id {}", reinterpret_cast<size_t>(this), std::this_thread::get_id());
 }
 
 SubTaskQueueAccessorImpl::~SubTaskQueueAccessorImpl()
 {
+    {
+        std::lock_guard<std::mutex> guard(m_mutexResultBatch);
+        PublishResultBatch();
+    }
     m_logger->debug("[RELEASED] this: {}, thread_id {}", reinterpret_cast<size_t>(this), std::this_thread::get_id());
 }
 
@@ -77,7 +86,13 @@ void SubTaskQueueAccessorImpl::OnSubTaskQueueAssigned(
     const std::vector<std::string>& subTaskIds,
      std::function<void()> onSubTaskQueueConnectedEventSink)
 {
-    // @todo Consider possibility to use the received subTaskIds instead of m_subTaskQueueManager->GetQueueSnapshot() call
+    {
+        // Stored results are loaded once on the next subtask grabbing
+        std::lock_guard<std::mutex> guard(m_mutexResults);
+        m_subTaskIds = std::set<std::string>(subTaskIds.begin(), subTaskIds.end());
+        m_isStorageSyncRequired = true;
+    }
+
     // Call it asynchronously to prevent multiple mutex locks
     m_gossipPubSub->GetAsioContext()->post([onSubTaskQueueConnectedEventSink]() {
         onSubTaskQueueConnectedEventSink();
@@ -87,15 +102,27 @@ void SubTaskQueueAccessorImpl::OnSubTaskQueueAssigned(
 void SubTaskQueueAccessorImpl::GrabSubTask(SubTaskGrabbedCallback onSubTaskGrabbedCallback)
 {
     std::lock_guard<std::mutex> guard(m_mutexResults);
-    auto queue = m_subTaskQueueManager->GetQueueSnapshot();
+    SyncProcessedSubTasks();
+    m_subTaskQueueManager->GrabSubTask(onSubTaskGrabbedCallback);
+}
 
-    std::set<std::string> subTaskIds;
-    for (size_t itemIdx = 0; itemIdx < (size_t)queue->subtasks().items_size(); ++itemIdx)
+void SubTaskQueueAccessorImpl::GrabSubTasks(size_t subTaskCount, SubTaskGrabbedCallback onSubTaskGrabbedCallback)
+{
+    std::lock_guard<std::mutex> guard(m_mutexResults);
+    SyncProcessedSubTasks();
+    m_subTaskQueueManager->GrabSubTasks(subTaskCount, onSubTaskGrabbedCallback);
+}
+
+void SubTaskQueueAccessorImpl::SyncProcessedSubTasks()
+{
+    if (!m_isStorageSyncRequired)
     {
-        subTaskIds.insert(queue->subtasks().items(itemIdx).subtaskid());
+        // Results received from the result channel are already applied to the queue
+        return;
     }
+    m_isStorageSyncRequired = false;
 
-    UpdateResultsFromStorage(subTaskIds);
+    UpdateResultsFromStorage(m_subTaskIds);
 
     std::set<std::string> processedSubTaskIds;
     for (const auto& [subTaskId, result]: m_results)
@@ -107,13 +134,12 @@ void SubTaskQueueAccessorImpl::GrabSubTask(SubTaskGrabbedCallback onSubTaskGrabb
     if (m_subTaskQueueManager->IsProcessed())
     {
         std::set<std::string> invalidSubTaskIds;
+        auto queue = m_subTaskQueueManager->GetQueueSnapshot();
         if (!FinalizeQueueProcessing(queue->subtasks(), invalidSubTaskIds))
         {
-            m_subTaskQueueManager->ChangeSubTaskProcessingStates(processedSubTaskIds, false);
+            m_subTaskQueueManager->ChangeSubTaskProcessingStates(invalidSubTaskIds, false);
         }
     }
-
-    m_subTaskQueueManager->GrabSubTask(onSubTaskGrabbedCallback);
 }
 
 void SubTaskQueueAccessorImpl::CompleteSubTask(const std::string& subTaskId, const SGProcessing::SubTaskResult& subTaskResult)
@@ -122,19 +148,88 @@ void SubTaskQueueAccessorImpl::CompleteSubTask(const std::string& subTaskId, con
     m_subTaskStateStorage->ChangeSubTaskState(
         subTaskId, SGProcessing::SubTaskState::PROCESSED);
 
-    m_resultChannel->Publish(subTaskResult.SerializeAsString());
-    m_logger->debug("[RESULT_SENT]. ({}).", subTaskId);
+    std::lock_guard<std::mutex> guard(m_mutexResultBatch);
+    m_resultBatch.add_results()->CopyFrom(subTaskResult);
+    m_resultBatchSize += subTaskResult.ByteSizeLong();
+    m_logger->debug("[RESULT_ENQUEUED]. ({}).", subTaskId);
+
+    if ((m_resultPublishingWindow.count() == 0) || (m_resultBatchSize >= m_maximalResultBatchSize))
+    {
+        PublishResultBatch();
+    }
+    else if (m_resultBatch.results_size() == 1)
+    {
+        // The window is started by the first result in a batch
+        m_timerResultPublishing.expires_from_now(boost::posix_time::milliseconds(m_resultPublishingWindow.count()));
+        m_timerResultPublishing.async_wait(
+            [weakThis(weak_from_this())](const boost::system::error_code& ec) {
+                auto _this = weakThis.lock();
+                if (_this)
+                {
+                    _this->HandleResultPublishingTimeout(ec);
+                }
+            });
+    }
+}
+
+void SubTaskQueueAccessorImpl::SetResultBatchingParameters(
+    std::chrono::milliseconds resultPublishingWindow,
+    size_t maximalResultBatchSize)
+{
+    std::lock_guard<std::mutex> guard(m_mutexResultBatch);
+    m_resultPublishingWindow = resultPublishingWindow;
+    m_maximalResultBatchSize = maximalResultBatchSize;
+}
+
+void SubTaskQueueAccessorImpl::HandleResultPublishingTimeout(const boost::system::error_code& ec)
+{
+    if (ec != boost::asio::error::operation_aborted)
+    {
+        std::lock_guard<std::mutex> guard(m_mutexResultBatch);
+        PublishResultBatch();
+    }
 }
 
-void SubTaskQueueAccessorImpl::OnResultReceived(SGProcessing::SubTaskResult&& subTaskResult)
+void SubTaskQueueAccessorImpl::PublishResultBatch()
 {
-    std::string subTaskId = subTaskResult.subtaskid();
+    if (m_resultBatch.results_size() == 0)
+    {
+        return;
+    }
+
+    m_timerResultPublishing.expires_at(boost::posix_time::pos_infin);
+    if (m_resultBatch.results_size() == 1)
+    {
+        // A single result is published as SubTaskResult message that nodes without batch support receive
+        m_resultChannel->Publish(m_resultBatch.results(0).SerializeAsString());
+    }
+    else
+    {
+        m_resultChannel->Publish(m_resultBatch.SerializeAsString());
+    }
+    m_logger->debug("[RESULTS_SENT]. {} results, {} bytes.", m_resultBatch.results_size(), m_resultBatchSize);
+
+    m_resultBatch.Clear();
+    m_resultBatchSize = 0;
+}
 
+void SubTaskQueueAccessorImpl::OnResultsReceived(SGProcessing::SubTaskResultBatch&& resultBatch)
+{
     // Results accumulation
+    std::set<std::string> subTaskIds;
     std::lock_guard<std::mutex> guard(m_mutexResults);
-    m_results.emplace(subTaskId, std::move(subTaskResult));
+    for (auto& subTaskResult : *resultBatch.mutable_results())
+    {
+        auto subTaskId = subTaskResult.subtaskid();
+        // The first result wins, results of speculatively duplicated subtasks are dropped
+        if (!m_results.emplace(subTaskId, std::move(subTaskResult)).second)
+        {
+            m_logger->debug("[DUPLICATE_RESULT_DROPPED]. ({}).", subTaskId);
+        }
+        subTaskIds.insert(std::move(subTaskId));
+    }
 
-    m_subTaskQueueManager->ChangeSubTaskProcessingStates({ subTaskId }, true);
+    m_subTaskQueueManager->ChangeSubTaskProcessingStates(subTaskIds, true);
 
     // Task processing finished
     if (m_subTaskQueueManager->IsProcessed()) 
@@ -215,12 +310,27 @@ void SubTaskQueueAccessorImpl::OnResultChannelMessage(
     
     if (message)
     {
+        // A single SubTaskResult is parsed as a batch without results because its fields do not match
+        // the batch results field, published batches always contain results
+        SGProcessing::SubTaskResultBatch resultBatch;
+        if (resultBatch.ParseFromArray(message->data.data(), static_cast<int>(message->data.size()))
+            && resultBatch.results_size() > 0)
+        {
+            _this->m_logger->debug("[RESULTS_RECEIVED]. {} results.", resultBatch.results_size());
+
+            _this->OnResultsReceived(std::move(resultBatch));
+            return;
+        }
+
         SGProcessing::SubTaskResult result;
-        if (result.ParseFromArray(message->data.data(), static_cast<int>(message->data.size())))
+        if (result.ParseFromArray(message->data.data(), static_cast<int>(message->data.size()))
+            && !result.subtaskid().empty())
         {
             _this->m_logger->debug("[RESULT_RECEIVED]. ({}).", result.subtaskid());
 
-            _this->OnResultReceived(std::move(result));
+            resultBatch.Clear();
+            *resultBatch.add_results() = std::move(result);
+            _this->OnResultsReceived(std::move(resultBatch));
         }
     }
 }
@@ -29,13 +29,15 @@ public:
     * @param subTaskStateStorage - storage of subtask states
     * @param subTaskResultStorage - processing results storage
     * @param taskResultProcessingSink - a callback which is called when a task processing is completed
+    * @param resultChannelId - identifier of a channel that is used to exchange subtask results
     */
     SubTaskQueueAccessorImpl(
         std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub> gossipPubSub,
         std::shared_ptr<ProcessingSubTaskQueueManager> subTaskQueueManager,
         std::shared_ptr<SubTaskStateStorage> subTaskStateStorage,
         std::shared_ptr<SubTaskResultStorage> subTaskResultStorage,
-        std::function<void(const SGProcessing::TaskResult&)> taskResultProcessingSink);
+        std::function<void(const SGProcessing::TaskResult&)> taskResultProcessingSink,
+        const std::string& resultChannelId = "RESULT_CHANNEL_ID");
     virtual ~SubTaskQueueAccessorImpl();
     
 
@@ -44,6 +46,7 @@ public:
     void ConnectToSubTaskQueue(std::function<void()> onSubTaskQueueConnectedEventSink);
     void AssignSubTasks(std::list<SGProcessing::SubTask>& subTasks) override;
     void GrabSubTask(SubTaskGrabbedCallback onSubTaskGrabbedCallback) override;
+    void GrabSubTasks(size_t subTaskCount, SubTaskGrabbedCallback onSubTaskGrabbedCallback) override;
     void CompleteSubTask(const std::string& subTaskId, const SGProcessing::SubTaskResult& subTaskResult) override;
 
     /** Returns available results of subtask queue
@@ -51,12 +54,33 @@ public:
     */
     std::vector<std::tuple<std::string, SGProcessing::SubTaskResult>> GetResults() const;
 
+    /** Sets result batching parameters.
+    * Results completed within the publishing window are published to the result channel as a single message.
+    * A single result is published as SubTaskResult message, both messages are accepted from the channel.
+    * @param resultPublishingWindow - maximal delay of a result publishing, 0 disables batching
+    * @param maximalResultBatchSize - batch size in bytes that causes an immediate batch publishing
+    */
+    void SetResultBatchingParameters(
+        std::chrono::milliseconds resultPublishingWindow,
+        size_t maximalResultBatchSize);
+
 private:
-    void OnResultReceived(SGProcessing::SubTaskResult&& subTaskResult);
+    void OnResultsReceived(SGProcessing::SubTaskResultBatch&& resultBatch);
+
+    /** Publishes accumulated results. The method has to be called in scoped lock of result batch mutex
+    */
+    void PublishResultBatch();
+    void HandleResultPublishingTimeout(const boost::system::error_code& ec);
     void OnSubTaskQueueAssigned(
         const std::vector<std::string>& subTaskIds,
         std::function<void()> onSubTaskQueueConnectedEventSink);
     void UpdateResultsFromStorage(const std::set<std::string>& subTaskIds);
+
+    /** Loads results of the assigned queue from the result storage once the queue is assigned.
+    * Further results are received from the result channel, so the storage is not accessed on each grab.
+    * The method has to be called in scoped lock of results mutex
+    */
+    void SyncProcessedSubTasks();
     bool FinalizeQueueProcessing(
         const SGProcessing::SubTaskCollection& subTasks,
         std::set<std::string>& invalidSubTaskIds);
@@ -73,8 +97,17 @@ private:
 
     std::shared_ptr<sgns::ipfs_pubsub::GossipPubSubTopic> m_resultChannel;
 
+    std::mutex m_mutexResultBatch;
+    SGProcessing::SubTaskResultBatch m_resultBatch;
+    size_t m_resultBatchSize;
+    std::chrono::milliseconds m_resultPublishingWindow;
+    size_t m_maximalResultBatchSize;
+    boost::asio::deadline_timer m_timerResultPublishing;
+
     mutable std::mutex m_mutexResults;
     std::map<std::string, SGProcessing::SubTaskResult> m_results;
+    std::set<std::string> m_subTaskIds;
+    bool m_isStorageSyncRequired;
     ProcessingValidationCore m_validationCore;
 
     base::Logger m_logger = base::createLogger("ProcessingSubTaskQueueAccessorImpl");
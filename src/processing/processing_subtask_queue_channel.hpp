@@ -22,13 +22,26 @@ public:
 
     /** Sends a request for queue ownership
     * nodeId - requestor node id
+    * localBlockFilter - filter of blocks cached by the requestor node
     */
-    virtual void RequestQueueOwnership(const std::string& nodeId) = 0;
+    virtual void RequestQueueOwnership(
+        const std::string& nodeId, const SGProcessing::BlockFilter& localBlockFilter) = 0;
 
     /** Publishes queue to all queue consumers
     * queue = subtask queue
     */
     virtual void PublishQueue(std::shared_ptr<SGProcessing::SubTaskQueue> queue) = 0;
+
+    /** Publishes queue changes to all queue consumers
+    * delta - lock and ownership changes
+    */
+    virtual void PublishQueueDelta(const SGProcessing::SubTaskQueueDelta& delta) = 0;
+
+    /** Sends a request for full queue snapshot
+    * nodeId - requestor node id
+    * queueVersion - version of local queue copy
+    */
+    virtual void RequestQueueSnapshot(const std::string& nodeId, uint64_t queueVersion) = 0;
 };
 }
 #endif // SUPERGENIUS_PROCESSING_SUBTASK_QUEUE_CHANNEL_HPP
\ No newline at end of file
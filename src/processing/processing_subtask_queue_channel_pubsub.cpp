@@ -30,12 +30,17 @@ void ProcessingSubTaskQueueChannelPubSub::Listen(size_t msSubscriptionWaitingDur
     }
 }
 
-void ProcessingSubTaskQueueChannelPubSub::RequestQueueOwnership(const std::string& nodeId)
+void ProcessingSubTaskQueueChannelPubSub::RequestQueueOwnership(
+    const std::string& nodeId, const SGProcessing::BlockFilter& localBlockFilter)
 {
     // Send a request to grab a subtask queue
     SGProcessing::ProcessingChannelMessage message;
     auto request = message.mutable_subtask_queue_request();
     request->set_node_id(nodeId);
+    if (!localBlockFilter.bits().empty())
+    {
+        request->mutable_local_block_filter()->CopyFrom(localBlockFilter);
+    }
     m_processingQueueChannel->Publish(message.SerializeAsString());
 }
 
@@ -47,6 +52,22 @@ void ProcessingSubTaskQueueChannelPubSub::PublishQueue(std::shared_ptr<SGProcess
     message.release_subtask_queue();
 }
 
+void ProcessingSubTaskQueueChannelPubSub::PublishQueueDelta(const SGProcessing::SubTaskQueueDelta& delta)
+{
+    SGProcessing::ProcessingChannelMessage message;
+    message.mutable_subtask_queue_delta()->CopyFrom(delta);
+    m_processingQueueChannel->Publish(message.SerializeAsString());
+}
+
+void ProcessingSubTaskQueueChannelPubSub::RequestQueueSnapshot(const std::string& nodeId, uint64_t queueVersion)
+{
+    SGProcessing::ProcessingChannelMessage message;
+    auto request = message.mutable_subtask_queue_snapshot_request();
+    request->set_node_id(nodeId);
+    request->set_queue_version(queueVersion);
+    m_processingQueueChannel->Publish(message.SerializeAsString());
+}
+
 void ProcessingSubTaskQueueChannelPubSub::SetQueueRequestSink(QueueRequestSink queueRequestSink)
 {
     m_queueRequestSink = std::move(queueRequestSink);
@@ -57,6 +78,16 @@ void ProcessingSubTaskQueueChannelPubSub::SetQueueUpdateSink(QueueUpdateSink que
     m_queueUpdateSink = std::move(queueUpdateSink);
 }
 
+void ProcessingSubTaskQueueChannelPubSub::SetQueueDeltaSink(QueueDeltaSink queueDeltaSink)
+{
+    m_queueDeltaSink = std::move(queueDeltaSink);
+}
+
+void ProcessingSubTaskQueueChannelPubSub::SetQueueSnapshotRequestSink(QueueSnapshotRequestSink queueSnapshotRequestSink)
+{
+    m_queueSnapshotRequestSink = std::move(queueSnapshotRequestSink);
+}
+
 void ProcessingSubTaskQueueChannelPubSub::OnProcessingChannelMessage(
     std::weak_ptr<ProcessingSubTaskQueueChannelPubSub> weakThis,
     boost::optional<const sgns::ipfs_pubsub::GossipPubSub::Message&> message)
@@ -80,6 +111,14 @@ void ProcessingSubTaskQueueChannelPubSub::OnProcessingChannelMessage(
             {
                 _this->HandleSubTaskQueue(channelMesssage);
             }
+            else if (channelMesssage.has_subtask_queue_delta())
+            {
+                _this->HandleSubTaskQueueDelta(channelMesssage);
+            }
+            else if (channelMesssage.has_subtask_queue_snapshot_request())
+            {
+                _this->HandleSubTaskQueueSnapshotRequest(channelMesssage);
+            }
         }
     }
 }
@@ -100,5 +139,21 @@ void ProcessingSubTaskQueueChannelPubSub::HandleSubTaskQueue(SGProcessing::Proce
     }
 }
 
+void ProcessingSubTaskQueueChannelPubSub::HandleSubTaskQueueDelta(SGProcessing::ProcessingChannelMessage& channelMesssage)
+{
+    if (m_queueDeltaSink)
+    {
+        m_queueDeltaSink(channelMesssage.subtask_queue_delta());
+    }
+}
+
+void ProcessingSubTaskQueueChannelPubSub::HandleSubTaskQueueSnapshotRequest(SGProcessing::ProcessingChannelMessage& channelMesssage)
+{
+    if (m_queueSnapshotRequestSink)
+    {
+        m_queueSnapshotRequestSink(channelMesssage.subtask_queue_snapshot_request());
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 }
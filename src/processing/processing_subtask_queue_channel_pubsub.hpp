@@ -21,6 +21,8 @@ class ProcessingSubTaskQueueChannelPubSub : public ProcessingSubTaskQueueChannel
 public:
     typedef std::function<bool(const SGProcessing::SubTaskQueueRequest&)> QueueRequestSink;
     typedef std::function<bool(SGProcessing::SubTaskQueue*)> QueueUpdateSink;
+    typedef std::function<bool(const SGProcessing::SubTaskQueueDelta&)> QueueDeltaSink;
+    typedef std::function<bool(const SGProcessing::SubTaskQueueSnapshotRequest&)> QueueSnapshotRequestSink;
 
     /** Constructs subtask queue channel object
     * @param gossipPubSub - ipfs pubsub
@@ -34,8 +36,11 @@ public:
 
     /** ProcessingSubTaskQueueChannel overrides
     */
-    void RequestQueueOwnership(const std::string& nodeId) override;
+    void RequestQueueOwnership(
+        const std::string& nodeId, const SGProcessing::BlockFilter& localBlockFilter) override;
     void PublishQueue(std::shared_ptr<SGProcessing::SubTaskQueue> queue) override;
+    void PublishQueueDelta(const SGProcessing::SubTaskQueueDelta& delta) override;
+    void RequestQueueSnapshot(const std::string& nodeId, uint64_t queueVersion) override;
 
     /** Sets a handler for remote queue requests processing
     * @param queueRequestSink - request handler
@@ -46,6 +51,14 @@ public:
     */
     void SetQueueUpdateSink(QueueUpdateSink queueUpdateSink);
 
+    /** Sets a handler for remote queue deltas processing
+    */
+    void SetQueueDeltaSink(QueueDeltaSink queueDeltaSink);
+
+    /** Sets a handler for remote queue snapshot requests processing
+    */
+    void SetQueueSnapshotRequestSink(QueueSnapshotRequestSink queueSnapshotRequestSink);
+
     /** Starts a listening to pubsub channel
     */
     void Listen(size_t msSubscriptionWaitingDuration);
@@ -59,12 +72,16 @@ private:
 
     void HandleSubTaskQueueRequest(SGProcessing::ProcessingChannelMessage& channelMesssage);
     void HandleSubTaskQueue(SGProcessing::ProcessingChannelMessage& channelMesssage);
+    void HandleSubTaskQueueDelta(SGProcessing::ProcessingChannelMessage& channelMesssage);
+    void HandleSubTaskQueueSnapshotRequest(SGProcessing::ProcessingChannelMessage& channelMesssage);
 
     std::shared_ptr<sgns::ipfs_pubsub::GossipPubSub> m_gossipPubSub;
     std::shared_ptr<boost::asio::io_context> m_context;
 
     std::function<bool(const SGProcessing::SubTaskQueueRequest&)> m_queueRequestSink;
     std::function<bool(SGProcessing::SubTaskQueue*)> m_queueUpdateSink;
+    QueueDeltaSink m_queueDeltaSink;
+    QueueSnapshotRequestSink m_queueSnapshotRequestSink;
 
     base::Logger m_logger = base::createLogger("ProcessingSubTaskQueueChannelPubSub");
 };
@@ -2,6 +2,37 @@
 
 namespace sgns::processing
 {
+namespace
+{
+    // Queue item ranks that define the order of subtask grabbing
+    enum ItemRank
+    {
+        // The subtask block is cached by the local node
+        ITEM_RANK_LOCAL_BLOCK = 0,
+        // The subtask block is not advertised by any node
+        ITEM_RANK_UNCACHED_BLOCK = 1,
+        // The subtask block is cached by another node and should be left to it
+        ITEM_RANK_REMOTE_BLOCK = 2,
+    };
+
+    // Checkpoints are applied only to queues with the same subtasks in the same order
+    uint64_t HashSubTaskIds(const SGProcessing::SubTaskCollection& subTasks)
+    {
+        // FNV-1a, subtask ids are separated by a zero byte
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (const auto& subTask : subTasks.items())
+        {
+            for (auto ch : subTask.subtaskid())
+            {
+                hash ^= static_cast<uint8_t>(ch);
+                hash *= 0x100000001B3ull;
+            }
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ProcessingSubTaskQueueManager::ProcessingSubTaskQueueManager(
     std::shared_ptr<ProcessingSubTaskQueueChannel> queueChannel,
@@ -15,6 +46,14 @@ ProcessingSubTaskQueueManager::ProcessingSubTaskQueueManager(
     , m_dltGrabSubTaskTimeout(*m_context.get())
     , m_processingQueue(localNodeId)
     , m_processingTimeout(std::chrono::seconds(10))
+    , m_isDeltaReplicationEnabled(false)
+    , m_lastPublishedVersion(0)
+    , m_duplicationBudget(0)
+    , m_isItemRankingRequired(false)
+    , m_checkpointInterval(0)
+    , m_dltCheckpoint(*m_context.get())
+    , m_isCheckpointScheduled(false)
+    , m_isCheckpointRequired(false)
 {
 }
 
@@ -24,6 +63,43 @@ void ProcessingSubTaskQueueManager::SetProcessingTimeout(
     m_processingTimeout = processingTimeout;
 }
 
+void ProcessingSubTaskQueueManager::SetDeltaReplicationEnabled(bool isEnabled)
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    m_isDeltaReplicationEnabled = isEnabled;
+}
+
+void ProcessingSubTaskQueueManager::SetSpeculativeExecutionBudget(size_t duplicationBudget)
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    m_duplicationBudget = duplicationBudget;
+}
+
+size_t ProcessingSubTaskQueueManager::GetDuplicatedSubTaskCount() const
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    return m_duplicatedItemIndices.size();
+}
+
+void ProcessingSubTaskQueueManager::SetLocalBlockFilter(const ProcessingBlockFilter& localBlockFilter)
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    m_localBlockFilter = localBlockFilter;
+    m_localBlockFilter.ToMessage(m_localBlockFilterMessage);
+    m_isItemRankingRequired = true;
+}
+
+void ProcessingSubTaskQueueManager::SetCheckpointStorage(
+    std::shared_ptr<SubTaskStateStorage> checkpointStorage,
+    const std::string& queueId,
+    std::chrono::milliseconds checkpointInterval)
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    m_checkpointStorage = std::move(checkpointStorage);
+    m_checkpointQueueId = queueId;
+    m_checkpointInterval = checkpointInterval;
+}
+
 ProcessingSubTaskQueueManager::~ProcessingSubTaskQueueManager()
 {
     m_logger->debug("[RELEASED] this: {}", reinterpret_cast<size_t>(this));
@@ -47,10 +123,22 @@ bool ProcessingSubTaskQueueManager::CreateQueue(
         processingQueue->add_items();
     }
 
+    std::optional<SGProcessing::SubTaskQueueCheckpoint> checkpoint;
+    if (m_checkpointStorage)
+    {
+        checkpoint = m_checkpointStorage->LoadQueueCheckpoint(m_checkpointQueueId);
+    }
+
     std::unique_lock<std::mutex> guard(m_queueMutex);
     m_queue = std::move(queue);
+    IndexSubTasks();
 
     m_processedSubTaskIds = {};
+    if (checkpoint)
+    {
+        // A half-finished queue is resumed
+        RestoreCheckpoint(*checkpoint);
+    }
     // Map subtask IDs to subtask indices
     std::vector<int> unprocessedSubTaskIndices;
     for (int subTaskIdx = 0; subTaskIdx < m_queue->subtasks().items_size(); ++subTaskIdx)
@@ -63,11 +151,16 @@ bool ProcessingSubTaskQueueManager::CreateQueue(
     }
 
     m_processingQueue.CreateQueue(processingQueue, unprocessedSubTaskIndices);
+    m_isItemRankingRequired = true;
+    m_duplicatedItemIndices.clear();
 
     m_logger->debug("QUEUE_CREATED");
     LogQueue();
 
-    PublishSubTaskQueue();
+    // The queue subtasks are published once, further changes can be published as deltas
+    m_processingQueue.TakeModifiedItemIndices();
+    PublishSubTaskQueueSnapshot();
+    ScheduleCheckpoint();
 
     if (m_subTaskQueueAssignmentEventSink)
     {
@@ -103,8 +196,19 @@ bool ProcessingSubTaskQueueManager::UpdateQueue(SGProcessing::SubTaskQueue* pQue
 
         if (m_processingQueue.UpdateQueue(queue->mutable_processing_queue(), unprocessedSubTaskIndices))
         {
+            bool isQueueInitialized = (m_queue != nullptr);
+            if (!isQueueInitialized)
+            {
+                m_duplicatedItemIndices.clear();
+            }
             m_queue.swap(queue);
+            if (!isQueueInitialized)
+            {
+                IndexSubTasks();
+            }
+            m_isItemRankingRequired = true;
             LogQueue();
+            ScheduleCheckpoint();
             return true;
         }
     }
@@ -115,16 +219,19 @@ void ProcessingSubTaskQueueManager::ProcessPendingSubTaskGrabbing()
 {
     // The method has to be called in scoped lock of queue mutex
     m_dltGrabSubTaskTimeout.expires_at(boost::posix_time::pos_infin);
-    while (!m_onSubTaskGrabbedCallbacks.empty())
+    if (m_isItemRankingRequired)
+    {
+        RankQueueItems();
+    }
+
+    std::vector<size_t> grabbedItemIndices;
+    std::vector<size_t> duplicatedItemIndices;
+    while (grabbedItemIndices.size() + duplicatedItemIndices.size() < m_onSubTaskGrabbedCallbacks.size())
     {
         size_t itemIdx;
         if (m_processingQueue.GrabItem(itemIdx))
         {
-            LogQueue();
-            PublishSubTaskQueue();
-
-            m_onSubTaskGrabbedCallbacks.front()({ m_queue->subtasks().items(itemIdx) });
-            m_onSubTaskGrabbedCallbacks.pop_front();
+            grabbedItemIndices.push_back(itemIdx);
         }
         else
         {
@@ -132,11 +239,31 @@ void ProcessingSubTaskQueueManager::ProcessPendingSubTaskGrabbing()
             auto unlocked = m_processingQueue.UnlockExpiredItems(m_processingTimeout);
             if (!unlocked)
             {
-                break;
+                if (!GrabSubTaskDuplicate(itemIdx))
+                {
+                    break;
+                }
+                duplicatedItemIndices.push_back(itemIdx);
             }
         }
     }
 
+    if (!grabbedItemIndices.empty())
+    {
+        // All locks are published at once
+        LogQueue();
+        PublishSubTaskQueue();
+    }
+
+    // Duplicates do not change the queue and are passed after the locked subtasks
+    grabbedItemIndices.insert(grabbedItemIndices.end(), duplicatedItemIndices.begin(), duplicatedItemIndices.end());
+    for (auto itemIdx : grabbedItemIndices)
+    {
+        auto onSubTaskGrabbedCallback = std::move(m_onSubTaskGrabbedCallbacks.front());
+        m_onSubTaskGrabbedCallbacks.pop_front();
+        onSubTaskGrabbedCallback({ m_queue->subtasks().items(itemIdx) });
+    }
+
     if (!m_onSubTaskGrabbedCallbacks.empty())
     {
         if (m_processedSubTaskIds.size() <(size_t)m_queue->processing_queue().items_size())
@@ -172,6 +299,61 @@ void ProcessingSubTaskQueueManager::ProcessPendingSubTaskGrabbing()
     }
 }
 
+bool ProcessingSubTaskQueueManager::GrabSubTaskDuplicate(size_t& itemIdx)
+{
+    // The method has to be called in scoped lock of queue mutex
+    if (m_duplicatedItemIndices.size() >= m_duplicationBudget)
+    {
+        return false;
+    }
+
+    // A straggler is most likely a node that holds the oldest lock
+    if (!m_processingQueue.FindOldestRemotelyLockedItem(itemIdx, m_duplicatedItemIndices))
+    {
+        return false;
+    }
+
+    m_duplicatedItemIndices.insert(itemIdx);
+    m_logger->info("SUBTASK_DUPLICATED {} ({}), duplicates: {}/{}",
+        itemIdx, m_queue->subtasks().items(static_cast<int>(itemIdx)).subtaskid(),
+        m_duplicatedItemIndices.size(), m_duplicationBudget);
+    return true;
+}
+
+void ProcessingSubTaskQueueManager::RankQueueItems()
+{
+    // The method has to be called in scoped lock of queue mutex
+    m_isItemRankingRequired = false;
+    if (m_localBlockFilter.IsEmpty() && m_nodeBlockFilters.empty())
+    {
+        // Subtasks are grabbed in the queue order
+        m_processingQueue.SetItemRanks({});
+        return;
+    }
+
+    const auto& subTasks = m_queue->subtasks();
+    std::vector<int> itemRanks(subTasks.items_size(), ITEM_RANK_UNCACHED_BLOCK);
+    for (int itemIdx = 0; itemIdx < subTasks.items_size(); ++itemIdx)
+    {
+        const auto& blockId = subTasks.items(itemIdx).ipfsblock();
+        if (m_localBlockFilter.MayContain(blockId))
+        {
+            itemRanks[itemIdx] = ITEM_RANK_LOCAL_BLOCK;
+            continue;
+        }
+
+        for (const auto& [nodeId, nodeBlockFilter] : m_nodeBlockFilters)
+        {
+            if (nodeBlockFilter.MayContain(blockId))
+            {
+                itemRanks[itemIdx] = ITEM_RANK_REMOTE_BLOCK;
+                break;
+            }
+        }
+    }
+    m_processingQueue.SetItemRanks(std::move(itemRanks));
+}
+
 void ProcessingSubTaskQueueManager::HandleGrabSubTaskTimeout(const boost::system::error_code& ec)
 {
     if (ec != boost::asio::error::operation_aborted)
@@ -182,7 +364,7 @@ void ProcessingSubTaskQueueManager::HandleGrabSubTaskTimeout(const boost::system
         if (!m_onSubTaskGrabbedCallbacks.empty()
             && (m_processedSubTaskIds.size() < (size_t)m_queue->processing_queue().items_size()))
         {
-            GrabSubTasks();
+            GrabPendingSubTasks();
         }
     }
 }
@@ -191,19 +373,42 @@ void ProcessingSubTaskQueueManager::GrabSubTask(SubTaskGrabbedCallback onSubTask
 {
     std::lock_guard<std::mutex> guard(m_queueMutex);
     m_onSubTaskGrabbedCallbacks.push_back(std::move(onSubTaskGrabbedCallback));
-    GrabSubTasks();
+    GrabPendingSubTasks();
 }
 
-void ProcessingSubTaskQueueManager::GrabSubTasks()
+void ProcessingSubTaskQueueManager::GrabSubTasks(
+    size_t subTaskCount, SubTaskGrabbedCallback onSubTaskGrabbedCallback)
+{
+    if (subTaskCount == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    for (size_t callbackIdx = 0; callbackIdx < subTaskCount; ++callbackIdx)
+    {
+        m_onSubTaskGrabbedCallbacks.push_back(onSubTaskGrabbedCallback);
+    }
+    // A single ownership request is sent for the whole batch
+    GrabPendingSubTasks();
+}
+
+void ProcessingSubTaskQueueManager::GrabPendingSubTasks()
 {
     if (m_processingQueue.HasOwnership())
     {
         ProcessPendingSubTaskGrabbing();
     }
+    else if (m_isDeltaReplicationEnabled && !m_queue)
+    {
+        // Queue deltas cannot be applied without the queue snapshot.
+        // The ownership is requested once the snapshot is received
+        RequestSubTaskQueueSnapshot();
+    }
     else
     {
         // Send a request to grab a subtask queue
-        m_queueChannel->RequestQueueOwnership(m_localNodeId);
+        m_queueChannel->RequestQueueOwnership(m_localNodeId, m_localBlockFilterMessage);
     }
 }
 
@@ -214,6 +419,10 @@ bool ProcessingSubTaskQueueManager::MoveOwnershipTo(const std::string& nodeId)
     {
         LogQueue();
         PublishSubTaskQueue();
+        if (nodeId != m_localNodeId)
+        {
+            SaveCheckpoint();
+        }
         return true;
     }
     return false;
@@ -225,12 +434,51 @@ bool ProcessingSubTaskQueueManager::HasOwnership() const
     return m_processingQueue.HasOwnership();
 }
 
-void ProcessingSubTaskQueueManager::PublishSubTaskQueue() const
+void ProcessingSubTaskQueueManager::PublishSubTaskQueue()
+{
+    // The method has to be called in scoped lock of queue mutex
+    auto modifiedItemIndices = m_processingQueue.TakeModifiedItemIndices();
+    auto processingQueue = m_queue->mutable_processing_queue();
+    processingQueue->set_version(processingQueue->version() + 1);
+    m_lastPublishedVersion = processingQueue->version();
+    ScheduleCheckpoint();
+
+    if (!m_isDeltaReplicationEnabled)
+    {
+        PublishSubTaskQueueSnapshot();
+        return;
+    }
+
+    SGProcessing::SubTaskQueueDelta delta;
+    delta.set_version(processingQueue->version());
+    delta.set_last_update_timestamp(processingQueue->last_update_timestamp());
+    delta.set_owner_node_id(processingQueue->owner_node_id());
+    for (auto itemIdx : modifiedItemIndices)
+    {
+        const auto& item = processingQueue->items(static_cast<int>(itemIdx));
+        auto itemDelta = delta.add_items();
+        itemDelta->set_item_idx(static_cast<uint32_t>(itemIdx));
+        itemDelta->set_lock_node_id(item.lock_node_id());
+        itemDelta->set_lock_timestamp(item.lock_timestamp());
+    }
+
+    m_queueChannel->PublishQueueDelta(delta);
+    m_logger->debug("QUEUE_DELTA_PUBLISHED version: {}, items: {}", delta.version(), delta.items_size());
+}
+
+void ProcessingSubTaskQueueManager::PublishSubTaskQueueSnapshot() const
 {
     m_queueChannel->PublishQueue(m_queue);
     m_logger->debug("QUEUE_PUBLISHED");
 }
 
+void ProcessingSubTaskQueueManager::RequestSubTaskQueueSnapshot() const
+{
+    auto queueVersion = m_queue ? m_queue->processing_queue().version() : 0;
+    m_queueChannel->RequestQueueSnapshot(m_localNodeId, queueVersion);
+    m_logger->debug("QUEUE_SNAPSHOT_REQUESTED version: {}", queueVersion);
+}
+
 bool ProcessingSubTaskQueueManager::ProcessSubTaskQueueMessage(SGProcessing::SubTaskQueue* queue)
 {
     std::unique_lock<std::mutex> guard(m_queueMutex);
@@ -242,6 +490,12 @@ bool ProcessingSubTaskQueueManager::ProcessSubTaskQueueMessage(SGProcessing::Sub
     {
         ProcessPendingSubTaskGrabbing();
     }
+    else if (queueChanged && !queueInitilalized && m_isDeltaReplicationEnabled
+        && !m_onSubTaskGrabbedCallbacks.empty())
+    {
+        // Subtasks grabbing was postponed until the queue snapshot is received
+        GrabPendingSubTasks();
+    }
 
     if (m_subTaskQueueAssignmentEventSink)
     {
@@ -264,10 +518,35 @@ bool ProcessingSubTaskQueueManager::ProcessSubTaskQueueRequestMessage(
     const SGProcessing::SubTaskQueueRequest& request)
 {
     std::lock_guard<std::mutex> guard(m_queueMutex);
+    if (request.node_id() != m_localNodeId)
+    {
+        // Requestor block filters are kept to leave subtasks with their cached blocks to them
+        ProcessingBlockFilter nodeBlockFilter(request.local_block_filter());
+        auto itNodeBlockFilter = m_nodeBlockFilters.find(request.node_id());
+        if (nodeBlockFilter.IsEmpty())
+        {
+            if (itNodeBlockFilter != m_nodeBlockFilters.end())
+            {
+                m_nodeBlockFilters.erase(itNodeBlockFilter);
+                m_isItemRankingRequired = true;
+            }
+        }
+        else if ((itNodeBlockFilter == m_nodeBlockFilters.end()) || !(itNodeBlockFilter->second == nodeBlockFilter))
+        {
+            m_nodeBlockFilters.insert_or_assign(request.node_id(), std::move(nodeBlockFilter));
+            m_isItemRankingRequired = true;
+        }
+    }
+
     if (m_processingQueue.MoveOwnershipTo(request.node_id()))
     {
         LogQueue();
         PublishSubTaskQueue();
+        if (request.node_id() != m_localNodeId)
+        {
+            // The new owner can leave before it publishes the queue changes
+            SaveCheckpoint();
+        }
         return true;
     }
 
@@ -279,6 +558,60 @@ bool ProcessingSubTaskQueueManager::ProcessSubTaskQueueRequestMessage(
     return false;
 }
 
+bool ProcessingSubTaskQueueManager::ProcessSubTaskQueueDeltaMessage(
+    const SGProcessing::SubTaskQueueDelta& delta)
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    if (!m_queue)
+    {
+        RequestSubTaskQueueSnapshot();
+        return false;
+    }
+
+    auto queueVersion = m_queue->processing_queue().version();
+    if (delta.version() <= queueVersion)
+    {
+        // Outdated or own delta
+        return false;
+    }
+
+    if ((delta.version() != queueVersion + 1) || !m_processingQueue.ApplyDelta(delta))
+    {
+        m_logger->debug("QUEUE_VERSION_GAP local: {}, received: {}", queueVersion, delta.version());
+        RequestSubTaskQueueSnapshot();
+        return false;
+    }
+
+    // Outdated and rejected deltas do not cancel the timeout of a pending ownership request
+    m_dltQueueResponseTimeout.expires_at(boost::posix_time::pos_infin);
+    LogQueue();
+    ScheduleCheckpoint();
+    if (m_processingQueue.HasOwnership())
+    {
+        ProcessPendingSubTaskGrabbing();
+    }
+    return true;
+}
+
+bool ProcessingSubTaskQueueManager::ProcessSubTaskQueueSnapshotRequestMessage(
+    const SGProcessing::SubTaskQueueSnapshotRequest& request)
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    // Only the queue owner answers to reduce a number of published messages.
+    // If the requestor missed the delta that made it the owner, the node that published the delta answers.
+    bool isLastPublisher = m_queue
+        && (m_queue->processing_queue().version() == m_lastPublishedVersion)
+        && (m_lastPublishedVersion > request.queue_version());
+    if (m_processingQueue.HasOwnership() || isLastPublisher)
+    {
+        m_logger->debug("QUEUE_SNAPSHOT_REQUEST_RECEIVED node: {}, version: {}",
+            request.node_id(), request.queue_version());
+        PublishSubTaskQueueSnapshot();
+        return true;
+    }
+    return false;
+}
+
 void ProcessingSubTaskQueueManager::HandleQueueRequestTimeout(const boost::system::error_code& ec)
 {
     if (ec != boost::asio::error::operation_aborted)
@@ -325,19 +658,25 @@ void ProcessingSubTaskQueueManager::ChangeSubTaskProcessingStates(
         {
             m_processedSubTaskIds.erase(subTaskId);
         }
+
+        // Only items of the changed subtasks are reindexed
+        auto itSubTaskIdx = m_subTaskIndices.find(subTaskId);
+        if (itSubTaskIdx != m_subTaskIndices.end())
+        {
+            m_processingQueue.SetItemEnabled(itSubTaskIdx->second, !isProcessed);
+        }
     }
+    ScheduleCheckpoint();
+}
 
-    // Map subtask IDs to subtask indices
-    std::vector<int> unprocessedSubTaskIndices;
+void ProcessingSubTaskQueueManager::IndexSubTasks()
+{
+    // The method has to be called in scoped lock of queue mutex
+    m_subTaskIndices.clear();
     for (int subTaskIdx = 0; subTaskIdx < m_queue->subtasks().items_size(); ++subTaskIdx)
     {
-        const auto& subTaskId = m_queue->subtasks().items(subTaskIdx).subtaskid();
-        if (m_processedSubTaskIds.find(subTaskId) == m_processedSubTaskIds.end())
-        {
-            unprocessedSubTaskIndices.push_back(subTaskIdx);
-        }
+        m_subTaskIndices.emplace(m_queue->subtasks().items(subTaskIdx).subtaskid(), static_cast<size_t>(subTaskIdx));
     }
-    m_processingQueue.UpdateQueue(m_queue->mutable_processing_queue(), unprocessedSubTaskIndices);
 }
 
 bool ProcessingSubTaskQueueManager::IsProcessed() const
@@ -367,9 +706,135 @@ void ProcessingSubTaskQueueManager::SetSubTaskQueueAssignmentEventSink(
             guard.unlock();
             m_subTaskQueueAssignmentEventSink(subTaskIds);
         }
+        else if (m_isDeltaReplicationEnabled)
+        {
+            // Queue snapshots are not published on each change, so it should be requested
+            RequestSubTaskQueueSnapshot();
+        }
     }
 }
 
+void ProcessingSubTaskQueueManager::ScheduleCheckpoint()
+{
+    // The method has to be called in scoped lock of queue mutex
+    if (!m_checkpointStorage)
+    {
+        return;
+    }
+
+    m_isCheckpointRequired = true;
+    if (m_isCheckpointScheduled || (m_checkpointInterval.count() == 0))
+    {
+        return;
+    }
+
+    // Changes made within the interval are saved in a single checkpoint
+    m_isCheckpointScheduled = true;
+    m_dltCheckpoint.expires_from_now(boost::posix_time::milliseconds(m_checkpointInterval.count()));
+    m_dltCheckpoint.async_wait(std::bind(
+        &ProcessingSubTaskQueueManager::HandleCheckpointTimeout, this, std::placeholders::_1));
+}
+
+void ProcessingSubTaskQueueManager::HandleCheckpointTimeout(const boost::system::error_code& ec)
+{
+    if (ec != boost::asio::error::operation_aborted)
+    {
+        std::lock_guard<std::mutex> guard(m_queueMutex);
+        m_isCheckpointScheduled = false;
+        // Other nodes save their changes when the ownership is passed to them
+        if (m_processingQueue.HasOwnership())
+        {
+            SaveCheckpoint();
+        }
+    }
+}
+
+void ProcessingSubTaskQueueManager::SaveCheckpoint()
+{
+    // The method has to be called in scoped lock of queue mutex
+    if (!m_checkpointStorage || !m_queue || !m_isCheckpointRequired)
+    {
+        return;
+    }
+    m_isCheckpointRequired = false;
+
+    const auto& subTasks = m_queue->subtasks();
+    const auto& processingQueue = m_queue->processing_queue();
+
+    SGProcessing::SubTaskQueueCheckpoint checkpoint;
+    checkpoint.set_version(processingQueue.version());
+    checkpoint.set_timestamp(std::chrono::system_clock::now().time_since_epoch().count());
+    checkpoint.set_item_count(static_cast<uint32_t>(subTasks.items_size()));
+    checkpoint.set_subtask_ids_hash(HashSubTaskIds(subTasks));
+
+    // Processed items are stored as a bitset, locks are stored for unprocessed items only
+    std::string processedItems((subTasks.items_size() + 7) / 8, '\0');
+    for (int itemIdx = 0; itemIdx < subTasks.items_size(); ++itemIdx)
+    {
+        if (m_processedSubTaskIds.count(subTasks.items(itemIdx).subtaskid()) > 0)
+        {
+            processedItems[itemIdx / 8] |= static_cast<char>(1 << (itemIdx % 8));
+        }
+        else if (!processingQueue.items(itemIdx).lock_node_id().empty())
+        {
+            const auto& item = processingQueue.items(itemIdx);
+            auto lockedItem = checkpoint.add_locked_items();
+            lockedItem->set_item_idx(static_cast<uint32_t>(itemIdx));
+            lockedItem->set_lock_node_id(item.lock_node_id());
+            lockedItem->set_lock_timestamp(item.lock_timestamp());
+        }
+    }
+    checkpoint.set_processed_items(std::move(processedItems));
+
+    m_logger->debug("QUEUE_CHECKPOINT_SAVED version: {}, processed: {}, locked: {}",
+        checkpoint.version(), m_processedSubTaskIds.size(), checkpoint.locked_items_size());
+
+    // The storage is accessed out of the queue lock
+    m_context->post([checkpointStorage(m_checkpointStorage), queueId(m_checkpointQueueId), checkpoint]() {
+        checkpointStorage->SaveQueueCheckpoint(queueId, checkpoint);
+    });
+}
+
+bool ProcessingSubTaskQueueManager::RestoreCheckpoint(const SGProcessing::SubTaskQueueCheckpoint& checkpoint)
+{
+    // The method has to be called in scoped lock of queue mutex
+    const auto& subTasks = m_queue->subtasks();
+    if ((checkpoint.item_count() != static_cast<uint32_t>(subTasks.items_size()))
+        || (checkpoint.processed_items().size() != (checkpoint.item_count() + 7) / 8)
+        || (checkpoint.subtask_ids_hash() != HashSubTaskIds(subTasks)))
+    {
+        m_logger->info("QUEUE_CHECKPOINT_MISMATCH {}", m_checkpointQueueId);
+        return false;
+    }
+
+    const auto& processedItems = checkpoint.processed_items();
+    for (int itemIdx = 0; itemIdx < subTasks.items_size(); ++itemIdx)
+    {
+        if ((processedItems[itemIdx / 8] & (1 << (itemIdx % 8))) != 0)
+        {
+            m_processedSubTaskIds.insert(subTasks.items(itemIdx).subtaskid());
+        }
+    }
+
+    auto processingQueue = m_queue->mutable_processing_queue();
+    processingQueue->set_version(checkpoint.version());
+    for (const auto& lockedItem : checkpoint.locked_items())
+    {
+        // Subtasks locked by the local node before a restart are not processed anymore.
+        // Locks of other nodes are kept until they expire.
+        if ((lockedItem.item_idx() < checkpoint.item_count()) && (lockedItem.lock_node_id() != m_localNodeId))
+        {
+            auto item = processingQueue->mutable_items(static_cast<int>(lockedItem.item_idx()));
+            item->set_lock_node_id(lockedItem.lock_node_id());
+            item->set_lock_timestamp(lockedItem.lock_timestamp());
+        }
+    }
+
+    m_logger->info("QUEUE_RESTORED_FROM_CHECKPOINT version: {}, processed: {}, locked: {}",
+        checkpoint.version(), m_processedSubTaskIds.size(), checkpoint.locked_items_size());
+    return true;
+}
+
 void ProcessingSubTaskQueueManager::LogQueue() const
 {
     if (m_logger->level() <= spdlog::level::trace)
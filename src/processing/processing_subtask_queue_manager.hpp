@@ -6,14 +6,17 @@
 #ifndef SUPERGENIUS_PROCESSING_SUBTASK_QUEUE_MANAGER_HPP
 #define SUPERGENIUS_PROCESSING_SUBTASK_QUEUE_MANAGER_HPP
 
+#include <processing/processing_block_filter.hpp>
 #include <processing/processing_subtask_queue.hpp>
 #include <processing/processing_subtask_queue_channel.hpp>
+#include <processing/processing_subtask_state_storage.hpp>
 
 #include <processing/proto/SGProcessing.pb.h>
 
 #include <boost/asio.hpp>
 #include <boost/optional.hpp>
 #include <list>
+#include <unordered_map>
 
 namespace sgns::processing
 {
@@ -41,6 +44,48 @@ public:
     */
     void SetProcessingTimeout(const std::chrono::system_clock::duration& processingTimeout);
 
+    /** Enables delta-based queue replication.
+    * When enabled the full queue snapshot is published once the queue is created or a snapshot is requested.
+    * Queue changes are published as compact deltas that contain lock and ownership changes only.
+    * @param isEnabled - delta replication flag, disabled by default
+    */
+    void SetDeltaReplicationEnabled(bool isEnabled);
+
+    /** Enables speculative execution of subtasks at the queue tail.
+    * When no unlocked subtasks are left the local node grabs a duplicate of a subtask
+    * with the oldest lock held by another node instead of waiting for the lock expiration.
+    * The subtask lock is not changed, the first received result of the subtask is used.
+    * @param duplicationBudget - maximal number of subtask duplicates grabbed from a queue, 0 disables the mode
+    */
+    void SetSpeculativeExecutionBudget(size_t duplicationBudget);
+
+    /** Returns a number of subtask duplicates grabbed from the current queue by the local node
+    */
+    size_t GetDuplicatedSubTaskCount() const;
+
+    /** Sets a filter of blocks that are cached by the local node.
+    * The filter is advertised in queue ownership requests.
+    * When the local node grabs subtasks, subtasks with locally cached blocks are taken first,
+    * subtasks which blocks are cached by other requestors are taken last.
+    * @param localBlockFilter - filter of locally cached block ids
+    */
+    void SetLocalBlockFilter(const ProcessingBlockFilter& localBlockFilter);
+
+    /** Enables durable checkpoints of the queue state.
+    * Processed items and item locks are saved in a compact form when the local node passes
+    * the queue ownership to another node and periodically while the local node owns the queue.
+    * A queue that is created from the same subtasks is resumed from the latest checkpoint,
+    * so that processed subtasks are not grabbed again.
+    * The method should be called before the queue is created.
+    * @param checkpointStorage - storage of queue checkpoints
+    * @param queueId - id the queue checkpoints are saved with
+    * @param checkpointInterval - maximal delay of saving queue changes, 0 disables periodic checkpoints
+    */
+    void SetCheckpointStorage(
+        std::shared_ptr<SubTaskStateStorage> checkpointStorage,
+        const std::string& queueId,
+        std::chrono::milliseconds checkpointInterval);
+
     /** Create a subtask queue by splitting the task to subtasks using the processing code
     * @param subTasks - a list of subtasks that should be added to the queue
     * in subtasks to allow a validation
@@ -53,6 +98,13 @@ public:
     */
     void GrabSubTask(SubTaskGrabbedCallback onSubTaskGrabbedCallback);
 
+    /** Asynchronous getting of several subtasks from the queue.
+    * The subtasks are locked within a single queue ownership tenure and the queue changes are published once.
+    * @param subTaskCount - maximal number of subtasks to grab
+    * @param onSubTaskGrabbedCallback a callback that is called for each subtask that is locked by the local node
+    */
+    void GrabSubTasks(size_t subTaskCount, SubTaskGrabbedCallback onSubTaskGrabbedCallback);
+
     /** Transfer the queue ownership to another processing node
     * @param nodeId - processing node ID that the ownership should be transferred
     */
@@ -75,6 +127,22 @@ public:
     */
     bool ProcessSubTaskQueueRequestMessage(const SGProcessing::SubTaskQueueRequest& request);
 
+    /** Applies queue changes received from the queue owner
+    * The method should be called from a processing channel message handler
+    * If a version gap is detected a full queue snapshot is requested
+    * @param delta - queue changes
+    * @return true if the delta is applied
+    */
+    bool ProcessSubTaskQueueDeltaMessage(const SGProcessing::SubTaskQueueDelta& delta);
+
+    /** Publishes the full queue snapshot if the local node owns the queue or it published the latest queue changes.
+    * The previous owner answers when the requestor missed a delta that passed the ownership to it.
+    * The method should be called from a processing channel message handler
+    * @param request - snapshot request
+    * @return true if the snapshot is published
+    */
+    bool ProcessSubTaskQueueSnapshotRequestMessage(const SGProcessing::SubTaskQueueSnapshotRequest& request);
+
     /** Returns the current local queue snapshot
     * @return the queue snapshot
     */
@@ -101,11 +169,23 @@ private:
     */
     bool UpdateQueue(SGProcessing::SubTaskQueue* queue);
 
+    /** Maps subtask ids to queue item indices. Queue subtasks are not changed after the queue creation
+    */
+    void IndexSubTasks();
+
     void HandleQueueRequestTimeout(const boost::system::error_code& ec);
-    void PublishSubTaskQueue() const;
+    void PublishSubTaskQueue();
+    void PublishSubTaskQueueSnapshot() const;
+    void RequestSubTaskQueueSnapshot() const;
     void ProcessPendingSubTaskGrabbing();
-    void GrabSubTasks();
+    void GrabPendingSubTasks();
+    bool GrabSubTaskDuplicate(size_t& itemIdx);
+    void RankQueueItems();
     void HandleGrabSubTaskTimeout(const boost::system::error_code& ec);
+    void ScheduleCheckpoint();
+    void HandleCheckpointTimeout(const boost::system::error_code& ec);
+    void SaveCheckpoint();
+    bool RestoreCheckpoint(const SGProcessing::SubTaskQueueCheckpoint& checkpoint);
     void LogQueue() const;
 
     std::shared_ptr<ProcessingSubTaskQueueChannel> m_queueChannel;
@@ -118,6 +198,7 @@ private:
 
     std::function<void(const std::vector<std::string>&)> m_subTaskQueueAssignmentEventSink;
     std::set<std::string> m_processedSubTaskIds;
+    std::unordered_map<std::string, size_t> m_subTaskIndices;
 
     boost::asio::deadline_timer m_dltQueueResponseTimeout;
     boost::posix_time::time_duration m_queueResponseTimeout;
@@ -126,6 +207,25 @@ private:
 
     ProcessingSubTaskQueue m_processingQueue;
     std::chrono::system_clock::duration m_processingTimeout;
+    bool m_isDeltaReplicationEnabled;
+    // Version of the latest queue changes published by the local node
+    uint64_t m_lastPublishedVersion;
+    size_t m_duplicationBudget;
+    std::set<size_t> m_duplicatedItemIndices;
+
+    // Block filters used to rank queue items by data locality
+    ProcessingBlockFilter m_localBlockFilter;
+    SGProcessing::BlockFilter m_localBlockFilterMessage;
+    std::map<std::string, ProcessingBlockFilter> m_nodeBlockFilters;
+    bool m_isItemRankingRequired;
+
+    std::shared_ptr<SubTaskStateStorage> m_checkpointStorage;
+    std::string m_checkpointQueueId;
+    std::chrono::milliseconds m_checkpointInterval;
+    boost::asio::deadline_timer m_dltCheckpoint;
+    bool m_isCheckpointScheduled;
+    // Set when the queue is changed after the last saved checkpoint
+    bool m_isCheckpointRequired;
 
     base::Logger m_logger = base::createLogger("ProcessingSubTaskQueueManager");
 };
@@ -29,6 +29,19 @@ public:
     * @return subtask state, std::nullopt if no state exists for a passed subtask id
     */
     virtual std::optional<SGProcessing::SubTaskState> GetSubTaskState(const std::string& subTaskId) = 0;
+
+    /** Saves a subtask queue checkpoint replacing the previous one
+    * @param queueId - queue id
+    * @param checkpoint - queue checkpoint
+    */
+    virtual void SaveQueueCheckpoint(
+        const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint) = 0;
+
+    /** Returns the latest subtask queue checkpoint
+    * @param queueId - queue id
+    * @return queue checkpoint, std::nullopt if no checkpoint was saved for a passed queue id
+    */
+    virtual std::optional<SGProcessing::SubTaskQueueCheckpoint> LoadQueueCheckpoint(const std::string& queueId) = 0;
 };
 }
 
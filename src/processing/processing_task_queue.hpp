@@ -10,6 +10,8 @@
 
 #include <optional>
 #include <list>
+#include <string>
+#include <utility>
 class ProcessingTaskQueue
 {
 /** Distributed task queue interface
@@ -40,6 +42,24 @@ public:
     */
     virtual bool GrabTask(std::string& taskId, SGProcessing::Task& task) = 0;
 
+    /** Returns tasks that are available for grabbing without locking them.
+    * Allows a caller to choose a task to grab by its own policy.
+    * @param maxTaskCount - maximal number of returned tasks. An implementation can return
+    * the next task of each tenant over the limit, so that tenants with many tasks do not hide other tenants
+    * @param tasks - list of pairs (task id, task)
+    * @return false if there are no available tasks
+    */
+    virtual bool GetAvailableTasks(
+        size_t maxTaskCount,
+        std::list<std::pair<std::string, SGProcessing::Task>>& tasks) = 0;
+
+    /** Grabs a task returned by GetAvailableTasks
+    * @param taskId - task id
+    * @return task
+    * @return false if the task is already grabbed or completed
+    */
+    virtual bool GrabTaskById(const std::string& taskId, SGProcessing::Task& task) = 0;
+
     /** Handles task completion
     * @param taskId - task id
     * @param task result
@@ -0,0 +1,449 @@
+#include "processing_task_queue_globaldb.hpp"
+
+#include <boost/format.hpp>
+
+#include <random>
+#include <set>
+
+namespace sgns::processing
+{
+namespace
+{
+    const std::string PENDING_TASKS_NAMESPACE = "tasks/pending";
+    const std::string TASK_LOCKS_NAMESPACE = "tasks/locks";
+    const std::string TASK_RESULTS_NAMESPACE = "tasks/results";
+    const std::string SUBTASKS_NAMESPACE = "subtasks";
+    // Common prefix of the pending tasks, locks and results namespaces
+    const std::string TASKS_NAMESPACE = "tasks";
+    // Maximal number of changes waiting for the index update, the index is rebuilt if more changes are received
+    const size_t MAX_WATCHED_CHANGE_COUNT = 4096;
+
+    sgns::crdt::HierarchicalKey GetTaskKey(const std::string& taskNamespace, const std::string& taskId)
+    {
+        return sgns::crdt::HierarchicalKey((boost::format("%s/%s") % taskNamespace % taskId).str());
+    }
+
+    /** Extracts a task id from a database key
+    * @param key - database key
+    * @param taskNamespace - expected task namespace
+    * @param taskId - extracted task id
+    * @return false if the key does not belong to the namespace
+    */
+    bool ParseTaskKey(const std::string& key, const std::string& taskNamespace, std::string& taskId)
+    {
+        auto namespaceKey = GetTaskKey(taskNamespace, std::string()).GetKey() + "/";
+        if ((key.size() <= namespaceKey.size()) || (key.compare(0, namespaceKey.size(), namespaceKey) != 0))
+        {
+            return false;
+        }
+        taskId = key.substr(namespaceKey.size());
+        return true;
+    }
+
+    uint64_t GenerateClaimPosition()
+    {
+        std::random_device rd;
+        return (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ProcessingTaskQueueGlobalDB::ProcessingTaskQueueGlobalDB(std::shared_ptr<sgns::crdt::GlobalDB> db)
+    : m_db(std::move(db))
+    , m_processingTimeout(std::chrono::seconds(10))
+    , m_index(GenerateClaimPosition())
+    , m_isIndexSynchronized(false)
+    , m_watchedChanges(std::make_shared<WatchedChanges>())
+{
+    // Changes are collected by the watch handler and applied when the index is used
+    m_watchId = m_db->Watch(TASKS_NAMESPACE,
+        [watchedChanges = m_watchedChanges](
+            const std::vector<sgns::crdt::GlobalDB::KeyChange>& changes, bool isTruncated)
+        {
+            std::lock_guard<std::mutex> guard(watchedChanges->mutex);
+            if (isTruncated || (watchedChanges->changes.size() + changes.size() > MAX_WATCHED_CHANGE_COUNT))
+            {
+                watchedChanges->isTruncated = true;
+                watchedChanges->changes.clear();
+                return;
+            }
+            if (!watchedChanges->isTruncated)
+            {
+                watchedChanges->changes.insert(watchedChanges->changes.end(), changes.begin(), changes.end());
+            }
+        });
+}
+
+ProcessingTaskQueueGlobalDB::~ProcessingTaskQueueGlobalDB()
+{
+    m_db->Unwatch(m_watchId);
+}
+
+void ProcessingTaskQueueGlobalDB::EnqueueTask(
+    const SGProcessing::Task& task,
+    const std::list<SGProcessing::SubTask>& subTasks)
+{
+    const auto& taskId = task.ipfs_block_id();
+
+    // The task and its subtasks are published as a single delta
+    auto transaction = m_db->BeginTransaction();
+    for (auto& subTask : subTasks)
+    {
+        sgns::base::Buffer subTaskData;
+        subTaskData.put(subTask.SerializeAsString());
+        transaction->AddToDelta(
+            sgns::crdt::HierarchicalKey(
+                (boost::format("%s/%s/%s") % SUBTASKS_NAMESPACE % taskId % subTask.subtaskid()).str()),
+            subTaskData);
+    }
+
+    // Enqueue time is used to age waiting tasks when a task to grab is selected
+    SGProcessing::Task queuedTask(task);
+    if (queuedTask.enqueue_timestamp() == 0)
+    {
+        queuedTask.set_enqueue_timestamp(std::chrono::system_clock::now().time_since_epoch().count());
+    }
+
+    sgns::base::Buffer taskData;
+    taskData.put(queuedTask.SerializeAsString());
+    transaction->AddToDelta(GetTaskKey(PENDING_TASKS_NAMESPACE, taskId), taskData);
+
+    auto res = transaction->PublishDelta();
+    if (res.has_failure())
+    {
+        m_logger->error("Unable to enqueue task {}", taskId);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(m_indexMutex);
+    AddPendingTaskToIndex(queuedTask);
+    m_logger->debug("TASK_ENQUEUED: {}, SUBTASKS: {}", taskId, subTasks.size());
+}
+
+bool ProcessingTaskQueueGlobalDB::GetSubTasks(
+    const std::string& taskId,
+    std::list<SGProcessing::SubTask>& subTasks)
+{
+    m_logger->debug("SUBTASKS_REQUESTED. TaskId: {}", taskId);
+    auto querySubTasks = m_db->QueryKeyValues((boost::format("%s/%s") % SUBTASKS_NAMESPACE % taskId).str(),
+        [this, &subTasks](const sgns::base::Buffer& key, const sgns::base::Buffer& value)
+        {
+            SGProcessing::SubTask subTask;
+            if (subTask.ParseFromArray(value.data(), value.size()))
+            {
+                subTasks.push_back(std::move(subTask));
+            }
+            else
+            {
+                m_logger->debug("Unable to parse a subtask");
+            }
+            return true;
+        });
+    if (querySubTasks.has_failure())
+    {
+        m_logger->info("Unable list subtasks from CRDT datastore");
+        return false;
+    }
+
+    m_logger->debug("SUBTASKS_FOUND {}", subTasks.size());
+    return !subTasks.empty();
+}
+
+bool ProcessingTaskQueueGlobalDB::GrabTask(std::string& taskId, SGProcessing::Task& task)
+{
+    std::lock_guard<std::mutex> guard(m_indexMutex);
+
+    auto now = std::chrono::system_clock::now();
+    RefreshIndex(now);
+
+    std::string candidateTaskId;
+    while (m_index.GetNextUnlockedTask(candidateTaskId))
+    {
+        // Each check either grabs the candidate or removes it from unlocked tasks.
+        if (!ReadAvailableTask(candidateTaskId, now, task))
+        {
+            continue;
+        }
+
+        if (!LockAvailableTask(candidateTaskId, now))
+        {
+            return false;
+        }
+        taskId = candidateTaskId;
+        return true;
+    }
+    return false;
+}
+
+bool ProcessingTaskQueueGlobalDB::GetAvailableTasks(
+    size_t maxTaskCount,
+    std::list<std::pair<std::string, SGProcessing::Task>>& tasks)
+{
+    std::lock_guard<std::mutex> guard(m_indexMutex);
+
+    auto now = std::chrono::system_clock::now();
+    RefreshIndex(now);
+
+    std::set<std::string> checkedTaskIds;
+    std::list<std::string> candidateTaskIds;
+    while (m_index.GetUnlockedTasks(maxTaskCount, candidateTaskIds))
+    {
+        // Outdated candidates are removed from unlocked tasks by the checks,
+        // the index is listed again to replace them with next unlocked tasks.
+        // Heads of tenant and priority groups are listed over the limit and are not dropped
+        bool isIndexChanged = false;
+        for (const auto& candidateTaskId : candidateTaskIds)
+        {
+            if (!checkedTaskIds.insert(candidateTaskId).second)
+            {
+                continue;
+            }
+
+            SGProcessing::Task task;
+            if (ReadAvailableTask(candidateTaskId, now, task))
+            {
+                tasks.emplace_back(candidateTaskId, std::move(task));
+            }
+            else
+            {
+                isIndexChanged = true;
+            }
+        }
+
+        if (!isIndexChanged || (tasks.size() >= maxTaskCount))
+        {
+            break;
+        }
+        candidateTaskIds.clear();
+    }
+    return !tasks.empty();
+}
+
+bool ProcessingTaskQueueGlobalDB::GrabTaskById(const std::string& taskId, SGProcessing::Task& task)
+{
+    std::lock_guard<std::mutex> guard(m_indexMutex);
+
+    auto now = std::chrono::system_clock::now();
+    return ReadAvailableTask(taskId, now, task) && LockAvailableTask(taskId, now);
+}
+
+bool ProcessingTaskQueueGlobalDB::CompleteTask(const std::string& taskId, const SGProcessing::TaskResult& result)
+{
+    sgns::base::Buffer data;
+    data.put(result.SerializeAsString());
+
+    auto transaction = m_db->BeginTransaction();
+    transaction->AddToDelta(GetTaskKey(TASK_RESULTS_NAMESPACE, taskId), data);
+    transaction->RemoveFromDelta(GetTaskKey(TASK_LOCKS_NAMESPACE, taskId));
+    transaction->RemoveFromDelta(GetTaskKey(PENDING_TASKS_NAMESPACE, taskId));
+
+    auto res = transaction->PublishDelta();
+    if (res.has_failure())
+    {
+        m_logger->error("Unable to complete task {}", taskId);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(m_indexMutex);
+    m_index.CompleteTask(taskId);
+    m_logger->debug("TASK_COMPLETED: {}", taskId);
+    return true;
+}
+
+void ProcessingTaskQueueGlobalDB::SetProcessingTimeout(std::chrono::system_clock::duration processingTimeout)
+{
+    m_processingTimeout = processingTimeout;
+}
+
+void ProcessingTaskQueueGlobalDB::RefreshIndex(std::chrono::system_clock::time_point now)
+{
+    std::vector<sgns::crdt::GlobalDB::KeyChange> changes;
+    {
+        std::lock_guard<std::mutex> guard(m_watchedChanges->mutex);
+        if (m_watchedChanges->isTruncated)
+        {
+            // Dropped changes can only be recovered by a rescan
+            m_isIndexSynchronized = false;
+            m_watchedChanges->isTruncated = false;
+        }
+        changes.swap(m_watchedChanges->changes);
+    }
+
+    if (!m_isIndexSynchronized)
+    {
+        // Changes that are received during the rescan are applied again by the next refresh,
+        // the index updates are idempotent
+        m_isIndexSynchronized = SyncIndex();
+    }
+    else
+    {
+        for (const auto& change : changes)
+        {
+            ApplyTaskChange(change);
+        }
+    }
+
+    auto expiredLockCount = m_index.ExpireLocks((now - m_processingTimeout).time_since_epoch().count());
+    if (expiredLockCount > 0)
+    {
+        m_logger->debug("TASK_LOCKS_EXPIRED: {}", expiredLockCount);
+    }
+}
+
+void ProcessingTaskQueueGlobalDB::ApplyTaskChange(const sgns::crdt::GlobalDB::KeyChange& change)
+{
+    std::string taskId;
+    if (ParseTaskKey(change.key, PENDING_TASKS_NAMESPACE, taskId))
+    {
+        SGProcessing::Task task;
+        if (change.isRemoved)
+        {
+            m_index.RemoveTask(taskId);
+        }
+        else if (task.ParseFromArray(change.value.data(), change.value.size()))
+        {
+            AddPendingTaskToIndex(task);
+        }
+    }
+    else if (ParseTaskKey(change.key, TASK_LOCKS_NAMESPACE, taskId))
+    {
+        // Locks are removed together with pending tasks when the tasks are completed
+        SGProcessing::TaskLock lock;
+        if (!change.isRemoved && lock.ParseFromArray(change.value.data(), change.value.size()))
+        {
+            m_index.LockTask(taskId, lock.lock_timestamp());
+        }
+    }
+    else if (ParseTaskKey(change.key, TASK_RESULTS_NAMESPACE, taskId) && !change.isRemoved)
+    {
+        m_index.CompleteTask(taskId);
+    }
+}
+
+void ProcessingTaskQueueGlobalDB::AddPendingTaskToIndex(const SGProcessing::Task& task)
+{
+    m_index.AddPendingTask(task.ipfs_block_id(), task.tenant_id(), task.priority(), task.enqueue_timestamp());
+}
+
+bool ProcessingTaskQueueGlobalDB::ReadAvailableTask(
+    const std::string& taskId, std::chrono::system_clock::time_point now, SGProcessing::Task& task)
+{
+    // The index can be outdated, the task state is checked in the database.
+    ProcessingTaskQueueIndex::Timestamp lockTimestamp;
+    if (ReadTaskLock(taskId, lockTimestamp)
+        && (std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(lockTimestamp)) + m_processingTimeout > now))
+    {
+        m_logger->debug("TASK_PREVIOUSLY_LOCKED {}", taskId);
+        m_index.LockTask(taskId, lockTimestamp);
+        return false;
+    }
+
+    auto taskData = m_db->Get(GetTaskKey(PENDING_TASKS_NAMESPACE, taskId));
+    if (taskData.has_failure())
+    {
+        // The task was completed by another node
+        m_logger->debug("TASK_NOT_PENDING {}", taskId);
+        m_index.RemoveTask(taskId);
+        return false;
+    }
+
+    if (!task.ParseFromArray(taskData.value().data(), taskData.value().size()))
+    {
+        m_logger->debug("Unable to parse a task {}", taskId);
+        m_index.RemoveTask(taskId);
+        return false;
+    }
+    return true;
+}
+
+bool ProcessingTaskQueueGlobalDB::LockAvailableTask(
+    const std::string& taskId, std::chrono::system_clock::time_point now)
+{
+    ProcessingTaskQueueIndex::Timestamp lockTimestamp = now.time_since_epoch().count();
+    if (!LockTask(taskId, lockTimestamp))
+    {
+        m_logger->debug("Unable to lock a task {}", taskId);
+        return false;
+    }
+
+    m_index.LockTask(taskId, lockTimestamp);
+    m_logger->debug("TASK_LOCKED {}", taskId);
+    return true;
+}
+
+bool ProcessingTaskQueueGlobalDB::SyncIndex()
+{
+    // Only pending tasks and active locks are read, completed tasks are moved out of the namespaces.
+    // Entries are streamed into the index without collecting them
+    m_index.ClearPendingTasks();
+    auto queryTasks = m_db->QueryKeyValues(PENDING_TASKS_NAMESPACE,
+        [this](const sgns::base::Buffer& key, const sgns::base::Buffer& value)
+        {
+            SGProcessing::Task task;
+            if (task.ParseFromArray(value.data(), value.size()))
+            {
+                AddPendingTaskToIndex(task);
+            }
+            return true;
+        });
+    if (queryTasks.has_failure())
+    {
+        m_logger->info("Unable list tasks from CRDT datastore");
+        return false;
+    }
+
+    auto queryLocks = m_db->QueryKeyValues(TASK_LOCKS_NAMESPACE,
+        [this](const sgns::base::Buffer& key, const sgns::base::Buffer& value)
+        {
+            SGProcessing::TaskLock lock;
+            if (lock.ParseFromArray(value.data(), value.size()))
+            {
+                m_index.LockTask(lock.task_id(), lock.lock_timestamp());
+            }
+            return true;
+        });
+    if (queryLocks.has_failure())
+    {
+        m_logger->info("Unable list task locks from CRDT datastore");
+        return false;
+    }
+
+    m_logger->debug("TASK_INDEX_SYNCHRONIZED. UNLOCKED: {}, LOCKED: {}",
+        m_index.GetUnlockedTaskCount(), m_index.GetLockedTaskCount());
+    return true;
+}
+
+bool ProcessingTaskQueueGlobalDB::ReadTaskLock(
+    const std::string& taskId, ProcessingTaskQueueIndex::Timestamp& lockTimestamp)
+{
+    auto lockData = m_db->Get(GetTaskKey(TASK_LOCKS_NAMESPACE, taskId));
+    if (lockData.has_failure())
+    {
+        return false;
+    }
+
+    SGProcessing::TaskLock lock;
+    if (!lock.ParseFromArray(lockData.value().data(), lockData.value().size()))
+    {
+        return false;
+    }
+    lockTimestamp = lock.lock_timestamp();
+    return true;
+}
+
+bool ProcessingTaskQueueGlobalDB::LockTask(const std::string& taskId, ProcessingTaskQueueIndex::Timestamp lockTimestamp)
+{
+    SGProcessing::TaskLock lock;
+    lock.set_task_id(taskId);
+    lock.set_lock_timestamp(lockTimestamp);
+
+    sgns::base::Buffer lockData;
+    lockData.put(lock.SerializeAsString());
+
+    auto res = m_db->Put(GetTaskKey(TASK_LOCKS_NAMESPACE, taskId), lockData);
+    return !res.has_failure();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,130 @@
+/**
+* Header file for the task queue implementation that stores tasks in GlobalDB
+*/
+
+#ifndef SUPERGENIUS_PROCESSING_TASK_QUEUE_GLOBALDB_HPP
+#define SUPERGENIUS_PROCESSING_TASK_QUEUE_GLOBALDB_HPP
+
+#include <processing/processing_task_queue.hpp>
+#include <processing/processing_task_queue_index.hpp>
+
+#include <crdt/globaldb/globaldb.hpp>
+#include <base/logger.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace sgns::processing
+{
+/** Distributed task queue that stores tasks in GlobalDB.
+* Pending tasks, task locks and task results are kept in separate key namespaces
+* so that the queue state is read without visiting completed tasks.
+* A local index of the namespaces is used to grab tasks in O(log n). The index is
+* updated by local operations and by database change notifications to pick up
+* tasks and locks added by other nodes. The namespaces are rescanned only if notifications
+* were dropped. Task locks are claimed without coordination,
+* a claimed task is checked against the database before it is locked.
+*/
+class ProcessingTaskQueueGlobalDB : public ProcessingTaskQueue
+{
+public:
+    /** Creates a task queue
+    * @param db - CRDT database that is shared between processing nodes
+    */
+    ProcessingTaskQueueGlobalDB(std::shared_ptr<sgns::crdt::GlobalDB> db);
+
+    ~ProcessingTaskQueueGlobalDB() override;
+
+    /** ProcessingTaskQueue overrides
+    */
+    void EnqueueTask(
+        const SGProcessing::Task& task,
+        const std::list<SGProcessing::SubTask>& subTasks) override;
+
+    bool GetSubTasks(
+        const std::string& taskId,
+        std::list<SGProcessing::SubTask>& subTasks) override;
+
+    bool GrabTask(std::string& taskId, SGProcessing::Task& task) override;
+
+    bool GetAvailableTasks(
+        size_t maxTaskCount,
+        std::list<std::pair<std::string, SGProcessing::Task>>& tasks) override;
+
+    bool GrabTaskById(const std::string& taskId, SGProcessing::Task& task) override;
+
+    bool CompleteTask(const std::string& taskId, const SGProcessing::TaskResult& result) override;
+
+    /** Sets a duration after which a task lock expires and the task can be grabbed by another node
+    * @param processingTimeout - lock expiration timeout
+    */
+    void SetProcessingTimeout(std::chrono::system_clock::duration processingTimeout);
+
+private:
+    /** Task namespace changes received from the database and not applied to the index yet.
+    * The changes are shared with the watch handler which can be called after the queue is destroyed
+    */
+    struct WatchedChanges
+    {
+        std::mutex mutex;
+        std::vector<sgns::crdt::GlobalDB::KeyChange> changes;
+        bool isTruncated = false;
+    };
+
+    /** Rebuilds pending and locked tasks index from the database namespaces
+    */
+    bool SyncIndex();
+
+    /** Applies watched changes to the index, rebuilds the index if the changes were truncated
+    * and releases expired locks
+    * @param now - current time
+    */
+    void RefreshIndex(std::chrono::system_clock::time_point now);
+
+    /** Applies a single task namespace change to the index
+    * @param change - changed key and its value
+    */
+    void ApplyTaskChange(const sgns::crdt::GlobalDB::KeyChange& change);
+
+    /** Adds a pending task to the index with its tenant and priority
+    * @param task - pending task
+    */
+    void AddPendingTaskToIndex(const SGProcessing::Task& task);
+
+    /** Checks a task state in the database and reads the task if it can be grabbed.
+    * Outdated index records of the task are updated.
+    * @param taskId - task id
+    * @param now - current time
+    * @param task - read task
+    * @return false if the task is locked or not pending
+    */
+    bool ReadAvailableTask(
+        const std::string& taskId, std::chrono::system_clock::time_point now, SGProcessing::Task& task);
+
+    bool LockAvailableTask(const std::string& taskId, std::chrono::system_clock::time_point now);
+
+    /** Reads a task lock from the database
+    * @param taskId - task id
+    * @param lockTimestamp - lock timestamp
+    * @return false if the task is not locked
+    */
+    bool ReadTaskLock(const std::string& taskId, ProcessingTaskQueueIndex::Timestamp& lockTimestamp);
+
+    bool LockTask(const std::string& taskId, ProcessingTaskQueueIndex::Timestamp lockTimestamp);
+
+    std::shared_ptr<sgns::crdt::GlobalDB> m_db;
+    std::chrono::system_clock::duration m_processingTimeout;
+
+    ProcessingTaskQueueIndex m_index;
+    bool m_isIndexSynchronized;
+    std::mutex m_indexMutex;
+
+    std::shared_ptr<WatchedChanges> m_watchedChanges;
+    uint64_t m_watchId;
+
+    sgns::base::Logger m_logger = sgns::base::createLogger("ProcessingTaskQueueGlobalDB");
+};
+}
+
+#endif // SUPERGENIUS_PROCESSING_TASK_QUEUE_GLOBALDB_HPP
@@ -0,0 +1,234 @@
+#include "processing_task_queue_index.hpp"
+
+namespace sgns::processing
+{
+////////////////////////////////////////////////////////////////////////////////
+ProcessingTaskQueueIndex::ProcessingTaskQueueIndex(uint64_t claimPosition)
+    : m_claimPosition(claimPosition)
+{
+}
+
+ProcessingTaskQueueIndex::HashedTaskId ProcessingTaskQueueIndex::HashTaskId(const std::string& taskId)
+{
+    // FNV-1a is used to get the same order on all nodes.
+    // Sequential task ids differ in last characters only, the final mix spreads them over the whole range
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (auto ch : taskId)
+    {
+        hash ^= static_cast<uint8_t>(ch);
+        hash *= 0x100000001B3ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return { hash, taskId };
+}
+
+void ProcessingTaskQueueIndex::AddPendingTask(
+    const std::string& taskId, const std::string& tenantId, int32_t priority, Timestamp enqueueTimestamp)
+{
+    if ((m_completedTasks.count(taskId) > 0) || (m_taskLocks.count(taskId) > 0))
+    {
+        return;
+    }
+
+    // The task can be added again with updated attributes
+    EraseUnlockedTask(taskId);
+    m_pendingTaskAttributes[taskId] = { { tenantId, priority }, enqueueTimestamp };
+    InsertUnlockedTask(taskId);
+}
+
+void ProcessingTaskQueueIndex::InsertUnlockedTask(const std::string& taskId)
+{
+    auto itAttributes = m_pendingTaskAttributes.find(taskId);
+    if (itAttributes == m_pendingTaskAttributes.end())
+    {
+        return;
+    }
+
+    m_unlockedTasks.insert(HashTaskId(taskId));
+    m_unlockedTaskGroups[itAttributes->second.groupId].insert({ itAttributes->second.enqueueTimestamp, taskId });
+}
+
+bool ProcessingTaskQueueIndex::EraseUnlockedTask(const std::string& taskId)
+{
+    if (m_unlockedTasks.erase(HashTaskId(taskId)) == 0)
+    {
+        return false;
+    }
+
+    const auto& attributes = m_pendingTaskAttributes.at(taskId);
+    auto itGroup = m_unlockedTaskGroups.find(attributes.groupId);
+    itGroup->second.erase({ attributes.enqueueTimestamp, taskId });
+    if (itGroup->second.empty())
+    {
+        m_unlockedTaskGroups.erase(itGroup);
+    }
+    return true;
+}
+
+void ProcessingTaskQueueIndex::LockTask(const std::string& taskId, Timestamp lockTimestamp)
+{
+    auto itLock = m_taskLocks.find(taskId);
+    if (itLock != m_taskLocks.end())
+    {
+        // Lock is prolonged
+        m_taskLocksByTimestamp.erase({ itLock->second, taskId });
+        itLock->second = lockTimestamp;
+        m_taskLocksByTimestamp.insert({ lockTimestamp, taskId });
+        return;
+    }
+
+    if (EraseUnlockedTask(taskId))
+    {
+        m_taskLocks.emplace(taskId, lockTimestamp);
+        m_taskLocksByTimestamp.insert({ lockTimestamp, taskId });
+    }
+}
+
+void ProcessingTaskQueueIndex::CompleteTask(const std::string& taskId)
+{
+    RemoveTask(taskId);
+    m_completedTasks.insert(taskId);
+}
+
+void ProcessingTaskQueueIndex::RemoveTask(const std::string& taskId)
+{
+    auto itLock = m_taskLocks.find(taskId);
+    if (itLock != m_taskLocks.end())
+    {
+        m_taskLocksByTimestamp.erase({ itLock->second, taskId });
+        m_taskLocks.erase(itLock);
+    }
+    else
+    {
+        EraseUnlockedTask(taskId);
+    }
+    m_pendingTaskAttributes.erase(taskId);
+}
+
+size_t ProcessingTaskQueueIndex::ExpireLocks(Timestamp expirationTimestamp)
+{
+    size_t expiredLockCount = 0;
+    // Locks are ordered by timestamp so only expired ones are visited
+    while (!m_taskLocksByTimestamp.empty()
+        && (m_taskLocksByTimestamp.begin()->first <= expirationTimestamp))
+    {
+        auto taskId = m_taskLocksByTimestamp.begin()->second;
+        UnlockTask(taskId);
+        ++expiredLockCount;
+    }
+    return expiredLockCount;
+}
+
+void ProcessingTaskQueueIndex::UnlockTask(const std::string& taskId)
+{
+    auto itLock = m_taskLocks.find(taskId);
+    if (itLock != m_taskLocks.end())
+    {
+        m_taskLocksByTimestamp.erase({ itLock->second, taskId });
+        m_taskLocks.erase(itLock);
+        InsertUnlockedTask(taskId);
+    }
+}
+
+bool ProcessingTaskQueueIndex::GetNextUnlockedTask(std::string& taskId) const
+{
+    if (m_unlockedTasks.empty())
+    {
+        return false;
+    }
+
+    auto it = m_unlockedTasks.lower_bound({ m_claimPosition, std::string() });
+    if (it == m_unlockedTasks.end())
+    {
+        // Wrap around
+        it = m_unlockedTasks.begin();
+    }
+    taskId = it->second;
+    return true;
+}
+
+bool ProcessingTaskQueueIndex::GetUnlockedTasks(size_t maxTaskCount, std::list<std::string>& taskIds) const
+{
+    // Group heads take their slots first, the rest of slots are filled in the claim order
+    std::set<std::string> headTaskIds;
+    for (const auto& [groupId, groupTasks] : m_unlockedTaskGroups)
+    {
+        headTaskIds.insert(groupTasks.begin()->second);
+    }
+    size_t otherTaskCount = (maxTaskCount > headTaskIds.size()) ? (maxTaskCount - headTaskIds.size()) : 0;
+
+    std::set<std::string> listedHeadTaskIds;
+    auto listTask = [&](const std::string& taskId) {
+        if (headTaskIds.count(taskId) > 0)
+        {
+            listedHeadTaskIds.insert(taskId);
+            taskIds.push_back(taskId);
+        }
+        else if (otherTaskCount > 0)
+        {
+            --otherTaskCount;
+            taskIds.push_back(taskId);
+        }
+        return (otherTaskCount > 0);
+    };
+
+    auto itStart = m_unlockedTasks.lower_bound({ m_claimPosition, std::string() });
+    bool isListing = (otherTaskCount > 0);
+    for (auto it = itStart; isListing && (it != m_unlockedTasks.end()); ++it)
+    {
+        isListing = listTask(it->second);
+    }
+    // Wrap around
+    for (auto it = m_unlockedTasks.begin(); isListing && (it != itStart); ++it)
+    {
+        isListing = listTask(it->second);
+    }
+
+    for (const auto& headTaskId : headTaskIds)
+    {
+        if (listedHeadTaskIds.count(headTaskId) == 0)
+        {
+            taskIds.push_back(headTaskId);
+        }
+    }
+    return !taskIds.empty();
+}
+
+void ProcessingTaskQueueIndex::ClearPendingTasks()
+{
+    m_unlockedTasks.clear();
+    m_pendingTaskAttributes.clear();
+    m_unlockedTaskGroups.clear();
+    m_taskLocks.clear();
+    m_taskLocksByTimestamp.clear();
+}
+
+bool ProcessingTaskQueueIndex::IsTaskLocked(const std::string& taskId) const
+{
+    return (m_taskLocks.count(taskId) > 0);
+}
+
+bool ProcessingTaskQueueIndex::IsTaskCompleted(const std::string& taskId) const
+{
+    return (m_completedTasks.count(taskId) > 0);
+}
+
+size_t ProcessingTaskQueueIndex::GetUnlockedTaskCount() const
+{
+    return m_unlockedTasks.size();
+}
+
+size_t ProcessingTaskQueueIndex::GetLockedTaskCount() const
+{
+    return m_taskLocks.size();
+}
+
+size_t ProcessingTaskQueueIndex::GetCompletedTaskCount() const
+{
+    return m_completedTasks.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
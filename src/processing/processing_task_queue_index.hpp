@@ -0,0 +1,134 @@
+/**
+* Header file for the local index of a distributed task queue
+*/
+
+#ifndef SUPERGENIUS_PROCESSING_TASK_QUEUE_INDEX_HPP
+#define SUPERGENIUS_PROCESSING_TASK_QUEUE_INDEX_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+namespace sgns::processing
+{
+/** Secondary index of pending, locked and completed tasks.
+* The index is kept by each node in memory so that a next unlocked task is found
+* and expired locks are released in O(log n) instead of scanning the task storage.
+* Unlocked tasks are ordered by a hash of task id. Each node starts searching from
+* its own claim position, so nodes that grab tasks concurrently pick different tasks
+* without coordination.
+* Unlocked tasks are additionally grouped by tenant and priority, the oldest task of each group
+* is always listed as a grabbing candidate so a tenant with many tasks does not hide other tenants.
+*/
+class ProcessingTaskQueueIndex
+{
+public:
+    /** Lock timestamp in system clock ticks, the same units as TaskLock::lock_timestamp
+    */
+    using Timestamp = int64_t;
+
+    /** Creates an empty index
+    * @param claimPosition - a position in the hash ordered list of unlocked tasks to search from
+    */
+    explicit ProcessingTaskQueueIndex(uint64_t claimPosition = 0);
+
+    /** Adds a pending task to the index.
+    * Completed tasks are ignored.
+    * @param taskId - task id
+    * @param tenantId - id of the tenant that owns the task
+    * @param priority - task priority
+    * @param enqueueTimestamp - time when the task was enqueued
+    */
+    void AddPendingTask(
+        const std::string& taskId,
+        const std::string& tenantId = std::string(),
+        int32_t priority = 0,
+        Timestamp enqueueTimestamp = 0);
+
+    /** Marks a pending task as locked.
+    * Locks of tasks that are not pending are ignored.
+    * @param taskId - task id
+    * @param lockTimestamp - time when the lock was set
+    */
+    void LockTask(const std::string& taskId, Timestamp lockTimestamp);
+
+    /** Moves a task to completed ones
+    * @param taskId - task id
+    */
+    void CompleteTask(const std::string& taskId);
+
+    /** Removes a task which is not available in the queue anymore.
+    * Unlike completion it allows the task to be added again.
+    * @param taskId - task id
+    */
+    void RemoveTask(const std::string& taskId);
+
+    /** Unlocks tasks which locks were set not later than the expiration timestamp
+    * @param expirationTimestamp - locks older than the timestamp are released
+    * @return number of released locks
+    */
+    size_t ExpireLocks(Timestamp expirationTimestamp);
+
+    /** Finds an unlocked task starting from the claim position
+    * @param taskId - found task id
+    * @return false if there are no unlocked tasks
+    */
+    bool GetNextUnlockedTask(std::string& taskId) const;
+
+    /** Lists unlocked tasks starting from the claim position.
+    * The oldest task of each tenant and priority is listed even if it is far from the claim position,
+    * so the list can be longer than maxTaskCount if there are more tenant and priority groups.
+    * @param maxTaskCount - maximal number of listed tasks
+    * @param taskIds - found task ids in the grabbing order followed by the group heads
+    * @return false if there are no unlocked tasks
+    */
+    bool GetUnlockedTasks(size_t maxTaskCount, std::list<std::string>& taskIds) const;
+
+    /** Removes pending and locked tasks keeping the completed ones
+    */
+    void ClearPendingTasks();
+
+    bool IsTaskLocked(const std::string& taskId) const;
+    bool IsTaskCompleted(const std::string& taskId) const;
+
+    size_t GetUnlockedTaskCount() const;
+    size_t GetLockedTaskCount() const;
+    size_t GetCompletedTaskCount() const;
+
+private:
+    using HashedTaskId = std::pair<uint64_t, std::string>;
+    using TaskGroupId = std::pair<std::string, int32_t>;
+
+    struct TaskAttributes
+    {
+        TaskGroupId groupId;
+        Timestamp enqueueTimestamp = 0;
+    };
+
+    static HashedTaskId HashTaskId(const std::string& taskId);
+
+    void UnlockTask(const std::string& taskId);
+
+    /** Adds a pending task to unlocked tasks and to its tenant and priority group
+    */
+    void InsertUnlockedTask(const std::string& taskId);
+
+    /** Removes a task from unlocked tasks and from its tenant and priority group
+    * @return false if the task was not unlocked
+    */
+    bool EraseUnlockedTask(const std::string& taskId);
+
+    uint64_t m_claimPosition;
+
+    std::set<HashedTaskId> m_unlockedTasks;
+    std::map<std::string, TaskAttributes> m_pendingTaskAttributes;
+    std::map<TaskGroupId, std::set<std::pair<Timestamp, std::string>>> m_unlockedTaskGroups;
+    std::map<std::string, Timestamp> m_taskLocks;
+    std::set<std::pair<Timestamp, std::string>> m_taskLocksByTimestamp;
+    std::set<std::string> m_completedTasks;
+};
+}
+
+#endif // SUPERGENIUS_PROCESSING_TASK_QUEUE_INDEX_HPP
@@ -0,0 +1,155 @@
+#include "processing_task_scheduler.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+namespace sgns::processing
+{
+namespace
+{
+    std::chrono::system_clock::duration GetWaitTime(
+        const SGProcessing::Task& task, std::chrono::system_clock::time_point now)
+    {
+        auto enqueueTime = std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(task.enqueue_timestamp()));
+        return std::max(now - enqueueTime, std::chrono::system_clock::duration::zero());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::chrono::system_clock::duration TenantStatistics::GetAverageWaitTime() const
+{
+    if (waitTimeSampleCount == 0)
+    {
+        return std::chrono::system_clock::duration::zero();
+    }
+    return totalWaitTime / waitTimeSampleCount;
+}
+
+double TenantStatistics::GetSubTaskThroughput() const
+{
+    auto duration = std::chrono::duration<double>(lastGrabTime - firstGrabTime).count();
+    if (duration <= 0)
+    {
+        return 0;
+    }
+    return grabbedSubTaskCount / duration;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ProcessingTaskScheduler::ProcessingTaskScheduler()
+    : m_virtualTime(0)
+    , m_agingInterval(std::chrono::seconds(10))
+{
+}
+
+void ProcessingTaskScheduler::SetTenantWeight(const std::string& tenantId, double weight)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (weight > 0)
+    {
+        m_tenants[tenantId].weight = weight;
+    }
+}
+
+void ProcessingTaskScheduler::SetAgingInterval(std::chrono::system_clock::duration agingInterval)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_agingInterval = agingInterval;
+}
+
+void ProcessingTaskScheduler::OrderTasks(
+    std::list<AvailableTask>& tasks, std::chrono::system_clock::time_point now) const
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    // Sort keys are calculated once per task: (tenant start time, -aged priority, enqueue timestamp, task id)
+    using SortKey = std::tuple<double, double, int64_t, std::string>;
+    std::vector<std::pair<SortKey, std::list<AvailableTask>::iterator>> orderedTasks;
+    orderedTasks.reserve(tasks.size());
+    for (auto it = tasks.begin(); it != tasks.end(); ++it)
+    {
+        const auto& task = it->second;
+        orderedTasks.push_back({
+            SortKey(GetTenantStartTime(task.tenant_id()), -GetAgedPriority(task, now),
+                task.enqueue_timestamp(), it->first),
+            it });
+    }
+
+    std::sort(orderedTasks.begin(), orderedTasks.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+    for (auto& orderedTask : orderedTasks)
+    {
+        tasks.splice(tasks.end(), tasks, orderedTask.second);
+    }
+}
+
+void ProcessingTaskScheduler::OnTaskGrabbed(
+    const SGProcessing::Task& task, size_t subTaskCount, std::chrono::system_clock::time_point now)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto startTime = GetTenantStartTime(task.tenant_id());
+    auto& tenant = m_tenants[task.tenant_id()];
+    m_virtualTime = std::max(m_virtualTime, startTime);
+    // A task without subtasks is still charged to avoid free grabbing
+    tenant.virtualTime = startTime + std::max<size_t>(subTaskCount, 1) / tenant.weight;
+
+    auto& statistics = tenant.statistics;
+    if (statistics.grabbedTaskCount == 0)
+    {
+        statistics.firstGrabTime = now;
+    }
+    statistics.lastGrabTime = now;
+    ++statistics.grabbedTaskCount;
+    statistics.grabbedSubTaskCount += subTaskCount;
+    if (task.enqueue_timestamp() > 0)
+    {
+        auto waitTime = GetWaitTime(task, now);
+        statistics.totalWaitTime += waitTime;
+        statistics.maxWaitTime = std::max(statistics.maxWaitTime, waitTime);
+        ++statistics.waitTimeSampleCount;
+    }
+}
+
+std::map<std::string, TenantStatistics> ProcessingTaskScheduler::GetTenantStatistics() const
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    std::map<std::string, TenantStatistics> statistics;
+    for (const auto& [tenantId, tenant] : m_tenants)
+    {
+        if (tenant.statistics.grabbedTaskCount > 0)
+        {
+            statistics.emplace(tenantId, tenant.statistics);
+        }
+    }
+    return statistics;
+}
+
+double ProcessingTaskScheduler::GetTenantStartTime(const std::string& tenantId) const
+{
+    auto it = m_tenants.find(tenantId);
+    if (it == m_tenants.end())
+    {
+        return m_virtualTime;
+    }
+    return std::max(it->second.virtualTime, m_virtualTime);
+}
+
+double ProcessingTaskScheduler::GetAgedPriority(
+    const SGProcessing::Task& task, std::chrono::system_clock::time_point now) const
+{
+    double priority = task.priority();
+    if ((task.enqueue_timestamp() > 0) && (m_agingInterval.count() > 0))
+    {
+        priority += std::chrono::duration<double>(GetWaitTime(task, now)).count()
+            / std::chrono::duration<double>(m_agingInterval).count();
+    }
+    return priority;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,104 @@
+/**
+* Header file for the task scheduler that shares processing nodes between tenants
+*/
+
+#ifndef SUPERGENIUS_PROCESSING_TASK_SCHEDULER_HPP
+#define SUPERGENIUS_PROCESSING_TASK_SCHEDULER_HPP
+
+#include <processing/proto/SGProcessing.pb.h>
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace sgns::processing
+{
+/** Per-tenant statistics of grabbed tasks
+*/
+struct TenantStatistics
+{
+    size_t grabbedTaskCount = 0;
+    size_t grabbedSubTaskCount = 0;
+    /** Sum and maximum of times between task enqueuing and grabbing.
+    * Tasks without an enqueue timestamp are not taken into account.
+    */
+    std::chrono::system_clock::duration totalWaitTime = std::chrono::system_clock::duration::zero();
+    std::chrono::system_clock::duration maxWaitTime = std::chrono::system_clock::duration::zero();
+    size_t waitTimeSampleCount = 0;
+    std::chrono::system_clock::time_point firstGrabTime;
+    std::chrono::system_clock::time_point lastGrabTime;
+
+    /** Returns an average task wait time
+    */
+    std::chrono::system_clock::duration GetAverageWaitTime() const;
+
+    /** Returns a number of grabbed subtasks per second between the first and the last grabbing
+    */
+    double GetSubTaskThroughput() const;
+};
+
+/** Selects a task to grab among available tasks.
+* Tenants share the node by weighted fair share: each tenant has a virtual time which advances
+* by a number of grabbed subtasks divided by the tenant weight, a tenant with the least virtual time
+* is served first. A tenant that was idle starts from the current virtual time so it does not
+* accumulate a credit while it has no tasks.
+* Tasks of the same tenant are ordered by priority that grows with a task wait time,
+* so low priority tasks are not starved by a stream of high priority ones.
+* The share is kept by each node for tasks it grabs.
+*/
+class ProcessingTaskScheduler
+{
+public:
+    using AvailableTask = std::pair<std::string, SGProcessing::Task>;
+
+    ProcessingTaskScheduler();
+
+    /** Sets a tenant weight. Tenants have weight 1 by default.
+    * @param tenantId - tenant id
+    * @param weight - relative share of the tenant, should be positive
+    */
+    void SetTenantWeight(const std::string& tenantId, double weight);
+
+    /** Sets a wait time that increases a task priority by 1
+    * @param agingInterval - aging interval
+    */
+    void SetAgingInterval(std::chrono::system_clock::duration agingInterval);
+
+    /** Orders available tasks by grabbing preference
+    * @param tasks - tasks to order
+    * @param now - current time
+    */
+    void OrderTasks(std::list<AvailableTask>& tasks, std::chrono::system_clock::time_point now) const;
+
+    /** Charges a tenant for a grabbed task
+    * @param task - grabbed task
+    * @param subTaskCount - number of task subtasks
+    * @param now - current time
+    */
+    void OnTaskGrabbed(const SGProcessing::Task& task, size_t subTaskCount, std::chrono::system_clock::time_point now);
+
+    /** Returns statistics of tenants which tasks were grabbed
+    */
+    std::map<std::string, TenantStatistics> GetTenantStatistics() const;
+
+private:
+    struct TenantState
+    {
+        double weight = 1.0;
+        double virtualTime = 0.0;
+        TenantStatistics statistics;
+    };
+
+    double GetTenantStartTime(const std::string& tenantId) const;
+    double GetAgedPriority(const SGProcessing::Task& task, std::chrono::system_clock::time_point now) const;
+
+    std::map<std::string, TenantState> m_tenants;
+    double m_virtualTime;
+    std::chrono::system_clock::duration m_agingInterval;
+    mutable std::mutex m_mutex;
+};
+}
+
+#endif // SUPERGENIUS_PROCESSING_TASK_SCHEDULER_HPP
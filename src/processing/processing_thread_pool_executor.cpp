@@ -0,0 +1,225 @@
+#include "processing_thread_pool_executor.hpp"
+
+#include <algorithm>
+
+namespace sgns::processing
+{
+////////////////////////////////////////////////////////////////////////////////
+ProcessingThreadPoolExecutor::ProcessingThreadPoolExecutor(size_t workerCount)
+    : m_state(std::make_shared<State>())
+    , m_nextWorkerIdx(0)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    m_state->startTime = std::chrono::steady_clock::now();
+    for (size_t workerIdx = 0; workerIdx < workerCount; ++workerIdx)
+    {
+        m_state->workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (size_t workerIdx = 0; workerIdx < workerCount; ++workerIdx)
+    {
+        m_threads.emplace_back(&ProcessingThreadPoolExecutor::WorkerLoop, m_state, workerIdx);
+    }
+    m_logger->debug("[CREATED] this: {}, workers: {}", reinterpret_cast<size_t>(this), workerCount);
+}
+
+ProcessingThreadPoolExecutor::~ProcessingThreadPoolExecutor()
+{
+    Shutdown();
+    m_logger->debug("[RELEASED] this: {}", reinterpret_cast<size_t>(this));
+}
+
+void ProcessingThreadPoolExecutor::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_state->mutex);
+        m_state->isStopped = true;
+    }
+    m_state->cvTaskAvailable.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        if (!thread.joinable())
+        {
+            continue;
+        }
+
+        if (thread.get_id() == std::this_thread::get_id())
+        {
+            // The pool is released from its own task.
+            // The worker keeps the shared state and exits once the queues are empty
+            thread.detach();
+        }
+        else
+        {
+            thread.join();
+        }
+    }
+}
+
+bool ProcessingThreadPoolExecutor::Submit(Task task)
+{
+    auto& workers = m_state->workers;
+    {
+        // The state is checked, the task is placed to a worker queue and counted in one critical section,
+        // so Shutdown cannot stop workers between the check and the counting.
+        // The pool mutex is always locked before a worker mutex
+        std::lock_guard<std::mutex> guard(m_state->mutex);
+        if (m_state->isStopped)
+        {
+            return false;
+        }
+
+        auto& worker = *workers[m_nextWorkerIdx++ % workers.size()];
+        {
+            std::lock_guard<std::mutex> workerGuard(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        // The task is counted after it is placed to a queue.
+        // That guarantees that a worker that reserved a task always finds one
+        ++m_state->pendingTaskCount;
+    }
+    m_state->cvTaskAvailable.notify_one();
+    return true;
+}
+
+void ProcessingThreadPoolExecutor::Drain()
+{
+    if (IsWorkerThread())
+    {
+        // A task cannot wait for itself
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    m_state->cvIdle.wait(lock, [this]() {
+        return (m_state->pendingTaskCount == 0) && (m_state->activeTaskCount == 0);
+    });
+}
+
+size_t ProcessingThreadPoolExecutor::GetConcurrencyLimit() const
+{
+    return m_state->workers.size();
+}
+
+size_t ProcessingThreadPoolExecutor::GetQueueDepth() const
+{
+    std::lock_guard<std::mutex> guard(m_state->mutex);
+    return m_state->pendingTaskCount;
+}
+
+std::vector<ProcessingExecutor::WorkerStatistics> ProcessingThreadPoolExecutor::GetWorkerStatistics() const
+{
+    auto uptimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_state->startTime).count();
+
+    std::vector<WorkerStatistics> statistics;
+    for (const auto& worker : m_state->workers)
+    {
+        WorkerStatistics workerStatistics;
+        workerStatistics.executedTaskCount = worker->executedTaskCount;
+        if (uptimeNs > 0)
+        {
+            workerStatistics.utilization = std::min(
+                1.0, static_cast<double>(worker->busyTimeNs) / static_cast<double>(uptimeNs));
+        }
+        statistics.push_back(workerStatistics);
+    }
+    return statistics;
+}
+
+bool ProcessingThreadPoolExecutor::IsWorkerThread() const
+{
+    auto threadId = std::this_thread::get_id();
+    return std::any_of(m_threads.begin(), m_threads.end(),
+        [&threadId](const std::thread& thread) { return thread.get_id() == threadId; });
+}
+
+ProcessingExecutor::Task ProcessingThreadPoolExecutor::TakeTask(State& state, size_t workerIdx)
+{
+    // The method is called when a task is reserved by the worker, so the loop always ends
+    auto workerCount = state.workers.size();
+    while (true)
+    {
+        {
+            // Own queue is processed in FIFO order
+            auto& worker = *state.workers[workerIdx];
+            std::lock_guard<std::mutex> guard(worker.mutex);
+            if (!worker.tasks.empty())
+            {
+                auto task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+                return task;
+            }
+        }
+
+        for (size_t idx = 1; idx < workerCount; ++idx)
+        {
+            // Steal from the back of a victim queue
+            auto& victim = *state.workers[(workerIdx + idx) % workerCount];
+            std::lock_guard<std::mutex> guard(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                auto task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                return task;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void ProcessingThreadPoolExecutor::WorkerLoop(std::shared_ptr<State> state, size_t workerIdx)
+{
+    auto& worker = *state->workers[workerIdx];
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->cvTaskAvailable.wait(lock, [&state]() {
+                return state->isStopped || (state->pendingTaskCount > 0);
+            });
+
+            if (state->pendingTaskCount == 0)
+            {
+                // The pool is stopped and all tasks are executed
+                break;
+            }
+
+            // Reserve a task
+            --state->pendingTaskCount;
+            ++state->activeTaskCount;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        {
+            auto task = TakeTask(*state, workerIdx);
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                // Errors are handled by task owners, a worker should not be stopped by them
+            }
+            // The task is destroyed within the scope to release captured objects before the accounting
+        }
+        worker.busyTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+        ++worker.executedTaskCount;
+
+        {
+            std::lock_guard<std::mutex> guard(state->mutex);
+            --state->activeTaskCount;
+        }
+        state->cvIdle.notify_all();
+    }
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,87 @@
+/**
+* Header file for work-stealing thread pool executor
+*/
+
+#ifndef SUPERGENIUS_PROCESSING_THREAD_POOL_EXECUTOR_HPP
+#define SUPERGENIUS_PROCESSING_THREAD_POOL_EXECUTOR_HPP
+
+#include <processing/processing_executor.hpp>
+#include <base/logger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace sgns::processing
+{
+/** Executor that runs tasks on a fixed number of worker threads.
+* Each worker has its own task queue. Tasks are distributed between queues in round-robin order,
+* an idle worker steals tasks from queues of other workers.
+*/
+class ProcessingThreadPoolExecutor : public ProcessingExecutor
+{
+public:
+    /** Creates a thread pool and starts worker threads
+    * @param workerCount - number of worker threads, if 0 the number of hardware threads is used
+    */
+    explicit ProcessingThreadPoolExecutor(size_t workerCount = 0);
+
+    /** Stops the pool. Already submitted tasks are executed before worker threads exit
+    */
+    ~ProcessingThreadPoolExecutor() override;
+
+    /** ProcessingExecutor overrides
+    */
+    bool Submit(Task task) override;
+    void Drain() override;
+    size_t GetConcurrencyLimit() const override;
+    size_t GetQueueDepth() const override;
+    std::vector<WorkerStatistics> GetWorkerStatistics() const override;
+
+    /** Rejects new tasks and waits for submitted ones to be executed
+    */
+    void Shutdown();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<uint64_t> busyTimeNs = 0;
+        std::atomic<uint64_t> executedTaskCount = 0;
+    };
+
+    /** The state is shared with worker threads to keep it alive when the pool is destroyed
+    * from one of its own tasks
+    */
+    struct State
+    {
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::chrono::steady_clock::time_point startTime;
+
+        mutable std::mutex mutex;
+        std::condition_variable cvTaskAvailable;
+        std::condition_variable cvIdle;
+        size_t pendingTaskCount = 0;
+        size_t activeTaskCount = 0;
+        bool isStopped = false;
+    };
+
+    static void WorkerLoop(std::shared_ptr<State> state, size_t workerIdx);
+    static Task TakeTask(State& state, size_t workerIdx);
+
+    bool IsWorkerThread() const;
+
+    std::shared_ptr<State> m_state;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_nextWorkerIdx;
+
+    base::Logger m_logger = base::createLogger("ProcessingThreadPoolExecutor");
+};
+}
+
+#endif // SUPERGENIUS_PROCESSING_THREAD_POOL_EXECUTOR_HPP
@@ -1,10 +1,58 @@
 #include "processing_validation_core.hpp"
 
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
 namespace sgns::processing
 {
+namespace
+{
+    /** Chunk identity. Chunks are compared by their serialized data,
+    * the precalculated fingerprint is used as a hash to avoid data rehashing
+    */
+    struct ChunkKey
+    {
+        size_t fingerprint;
+        std::string_view data;
+
+        bool operator==(const ChunkKey& other) const
+        {
+            return (fingerprint == other.fingerprint) && (data == other.data);
+        }
+    };
+
+    struct ChunkKeyHash
+    {
+        size_t operator()(const ChunkKey& key) const
+        {
+            return key.fingerprint;
+        }
+    };
+
+    /** Result hashes of a chunk that is processed by several subtasks
+    */
+    struct ChunkResultHashes
+    {
+        uint32_t firstHash;
+        bool areHashesEqual;
+    };
+}
+
 ////////////////////////////////////////////////////////////////////////////////
-ProcessingValidationCore::ProcessingValidationCore()
+ProcessingValidationCore::ProcessingValidationCore(size_t threadCount)
+    : m_threadCount(threadCount)
+    , m_parallelChunkCountThreshold(4096)
 {
+    if (m_threadCount == 0)
+    {
+        m_threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+}
+
+void ProcessingValidationCore::SetParallelChunkCountThreshold(size_t parallelChunkCountThreshold)
+{
+    m_parallelChunkCountThreshold = parallelChunkCountThreshold;
 }
 
 bool ProcessingValidationCore::ValidateResults(
@@ -15,7 +63,10 @@ bool ProcessingValidationCore::ValidateResults(
     bool areResultsValid = true;
     // Compare result hashes for each chunk
     // If a chunk hashes didn't match each other add the all subtasks with invalid hashes to VALID ITEMS LIST
-    std::map<std::string, std::vector<uint32_t>> chunks;
+    std::vector<int> subTaskIndices;
+    std::vector<const SGProcessing::SubTaskResult*> subTaskResults;
+    std::vector<size_t> chunkOffsets;
+    size_t chunkCount = 0;
     for (int itemIdx = 0; itemIdx < subTasks.items_size(); ++itemIdx)
     {
         const auto& subTask = subTasks.items(itemIdx);
@@ -29,13 +80,10 @@ bool ProcessingValidationCore::ValidateResults(
             }
             else
             {
-                for (int chunkIdx = 0; chunkIdx < subTask.chunkstoprocess_size(); ++chunkIdx)
-                {
-                    auto it = chunks.insert(std::make_pair(
-                        subTask.chunkstoprocess(chunkIdx).SerializeAsString(), std::vector<uint32_t>()));
-
-                    it.first->second.push_back(itResult->second.chunk_hashes(chunkIdx));
-                }
+                subTaskIndices.push_back(itemIdx);
+                subTaskResults.push_back(&itResult->second);
+                chunkOffsets.push_back(chunkCount);
+                chunkCount += subTask.chunkstoprocess_size();
             }
         }
         else
@@ -46,48 +94,109 @@ bool ProcessingValidationCore::ValidateResults(
         }
     }
 
-    for (int itemIdx = 0; itemIdx < subTasks.items_size(); ++itemIdx)
+    // Each chunk is serialized once
+    std::vector<std::string> serializedChunks(chunkCount);
+    std::vector<size_t> chunkFingerprints(chunkCount);
+    size_t threadCount = (chunkCount >= m_parallelChunkCountThreshold)
+        ? std::min(m_threadCount, subTaskIndices.size())
+        : 1;
+    if (threadCount > 1)
     {
-        const auto& subTask = subTasks.items(itemIdx);
-        if ((invalidSubTaskIds.find(subTask.subtaskid()) == invalidSubTaskIds.end())
-            && !CheckSubTaskResultHashes(subTask, chunks))
+        // Subtasks are partitioned to ranges with similar chunk counts
+        std::vector<std::thread> threads;
+        size_t beginIdx = 0;
+        for (size_t threadIdx = 0; threadIdx < threadCount; ++threadIdx)
         {
-            invalidSubTaskIds.insert(subTask.subtaskid());
+            size_t chunkRangeEnd = chunkCount * (threadIdx + 1) / threadCount;
+            size_t endIdx = beginIdx;
+            while ((endIdx < subTaskIndices.size()) && (chunkOffsets[endIdx] < chunkRangeEnd))
+            {
+                ++endIdx;
+            }
+
+            if (endIdx > beginIdx)
+            {
+                threads.emplace_back(&ProcessingValidationCore::FingerprintChunks,
+                    std::cref(subTasks), std::cref(subTaskIndices), std::cref(chunkOffsets),
+                    beginIdx, endIdx, std::ref(serializedChunks), std::ref(chunkFingerprints));
+            }
+            beginIdx = endIdx;
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
         }
     }
+    else
+    {
+        FingerprintChunks(subTasks, subTaskIndices, chunkOffsets,
+            0, subTaskIndices.size(), serializedChunks, chunkFingerprints);
+    }
 
-    if (!invalidSubTaskIds.empty())
+    std::unordered_map<ChunkKey, ChunkResultHashes, ChunkKeyHash> chunks;
+    chunks.reserve(chunkCount);
+    std::vector<const ChunkResultHashes*> chunkResultHashes(chunkCount);
+    for (size_t idx = 0; idx < subTaskIndices.size(); ++idx)
     {
-        areResultsValid = false;
+        const auto& result = *subTaskResults[idx];
+        for (int chunkIdx = 0; chunkIdx < result.chunk_hashes_size(); ++chunkIdx)
+        {
+            auto chunkPos = chunkOffsets[idx] + chunkIdx;
+            auto hash = result.chunk_hashes(chunkIdx);
+            auto it = chunks.emplace(
+                ChunkKey{ chunkFingerprints[chunkPos], serializedChunks[chunkPos] },
+                ChunkResultHashes{ hash, true });
+            if (!it.second && (it.first->second.firstHash != hash))
+            {
+                it.first->second.areHashesEqual = false;
+            }
+            chunkResultHashes[chunkPos] = &it.first->second;
+        }
     }
-    return areResultsValid;
-}
 
-bool ProcessingValidationCore::CheckSubTaskResultHashes(
-    const SGProcessing::SubTask& subTask,
-    const std::map<std::string, std::vector<uint32_t>>& chunks) const
-{
-    for (int chunkIdx = 0; chunkIdx < subTask.chunkstoprocess_size(); ++chunkIdx)
+    for (size_t idx = 0; idx < subTaskIndices.size(); ++idx)
     {
-        const auto& chunk = subTask.chunkstoprocess(chunkIdx);
-        auto it = chunks.find(chunk.SerializeAsString());
-        if (it != chunks.end())
+        const auto& subTask = subTasks.items(subTaskIndices[idx]);
+        for (int chunkIdx = 0; chunkIdx < subTask.chunkstoprocess_size(); ++chunkIdx)
         {
             // Check duplicated chunks only
-            if ((it->second.size() >= 2)
-                && !std::equal(it->second.begin() + 1, it->second.end(), it->second.begin()))
+            if (!chunkResultHashes[chunkOffsets[idx] + chunkIdx]->areHashesEqual)
             {
-                m_logger->debug("INVALID_CHUNK_RESULT_HASH [{}, {}]", subTask.subtaskid(), chunk.chunkid());
-                return false;
+                m_logger->debug("INVALID_CHUNK_RESULT_HASH [{}, {}]",
+                    subTask.subtaskid(), subTask.chunkstoprocess(chunkIdx).chunkid());
+                invalidSubTaskIds.insert(subTask.subtaskid());
+                break;
             }
         }
-        else
+    }
+
+    if (!invalidSubTaskIds.empty())
+    {
+        areResultsValid = false;
+    }
+    return areResultsValid;
+}
+
+void ProcessingValidationCore::FingerprintChunks(
+    const SGProcessing::SubTaskCollection& subTasks,
+    const std::vector<int>& subTaskIndices,
+    const std::vector<size_t>& chunkOffsets,
+    size_t beginIdx,
+    size_t endIdx,
+    std::vector<std::string>& serializedChunks,
+    std::vector<size_t>& chunkFingerprints)
+{
+    for (size_t idx = beginIdx; idx < endIdx; ++idx)
+    {
+        const auto& subTask = subTasks.items(subTaskIndices[idx]);
+        for (int chunkIdx = 0; chunkIdx < subTask.chunkstoprocess_size(); ++chunkIdx)
         {
-            m_logger->debug("NO_CHUNK_RESULT_FOUND [{}, {}]", subTask.subtaskid(), chunk.chunkid());
-            return false;
+            auto chunkPos = chunkOffsets[idx] + chunkIdx;
+            subTask.chunkstoprocess(chunkIdx).SerializeToString(&serializedChunks[chunkPos]);
+            chunkFingerprints[chunkPos] = std::hash<std::string_view>{}(serializedChunks[chunkPos]);
         }
     }
-    return true;
 }
 
 }
@@ -21,7 +21,11 @@ namespace sgns::processing
 class ProcessingValidationCore
 {
 public:
-    ProcessingValidationCore();
+    /** Creates a validator
+    * @param threadCount - maximal number of threads used to fingerprint chunks of large queues.
+    * If 0 the number of hardware threads is used
+    */
+    ProcessingValidationCore(size_t threadCount = 0);
 
     /** Checks if check result hashes are valid.
     * If invalid chunk hashes found corresponding subtasks are invalidated and returned to processing queue
@@ -32,10 +36,28 @@ public:
         const std::map<std::string, SGProcessing::SubTaskResult>& results,
         std::set<std::string>& invalidSubTaskIds);
 
+    /** Sets a minimal number of chunks that are fingerprinted in parallel
+    * @param parallelChunkCountThreshold - number of chunks
+    */
+    void SetParallelChunkCountThreshold(size_t parallelChunkCountThreshold);
+
 private:
-    bool CheckSubTaskResultHashes(
-        const SGProcessing::SubTask& subTask,
-        const std::map<std::string, std::vector<uint32_t>>& chunks) const;
+    /** Serializes chunks of subtasks with indices from [beginIdx, endIdx) range and calculates their fingerprints
+    * @param subTasks - subtask collection
+    * @param subTaskIndices - indices of subtasks with valid results
+    * @param chunkOffsets - index of the first chunk of each subtask in the output vectors
+    */
+    static void FingerprintChunks(
+        const SGProcessing::SubTaskCollection& subTasks,
+        const std::vector<int>& subTaskIndices,
+        const std::vector<size_t>& chunkOffsets,
+        size_t beginIdx,
+        size_t endIdx,
+        std::vector<std::string>& serializedChunks,
+        std::vector<size_t>& chunkFingerprints);
+
+    size_t m_threadCount;
+    size_t m_parallelChunkCountThreshold;
 
     base::Logger m_logger = base::createLogger("ProcessingValidationCore");
 };
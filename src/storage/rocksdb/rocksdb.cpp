@@ -15,6 +15,28 @@ namespace sgns::storage
 {
   using BlockBasedTableOptions = ::ROCKSDB_NAMESPACE::BlockBasedTableOptions;
 
+  namespace
+  {
+    /**
+     * @brief Returns the least key which is greater than all keys with the prefix
+     * or an empty buffer if there is no such key
+     */
+    Buffer prefixUpperBound(const Buffer &keyPrefix)
+    {
+      Buffer upperBound(keyPrefix);
+      for (size_t size = upperBound.size(); size > 0; --size)
+      {
+        if (upperBound[size - 1] != 0xFF)
+        {
+          ++upperBound[size - 1];
+          upperBound.resize(size);
+          return upperBound;
+        }
+      }
+      return Buffer();
+    }
+  }
+
   outcome::result<std::shared_ptr<rocksdb>> rocksdb::create(
       std::string_view path, Options options) 
   {
@@ -65,6 +87,11 @@ namespace sgns::storage
     return std::make_unique<Batch>(*this);
   }
 
+  std::unique_ptr<BufferBatch> rocksdb::batch(const WriteOptions &wo) 
+  {
+    return std::make_unique<Batch>(*this, wo);
+  }
+
   void rocksdb::setReadOptions(ReadOptions ro) 
   {
     ro_ = ro;
@@ -94,32 +121,64 @@ namespace sgns::storage
     return error_as_result<Buffer>(status, logger_);
   }
 
-  outcome::result<rocksdb::QueryResult> rocksdb::query(const Buffer& keyPrefix) const
+  std::unique_ptr<rocksdb::Cursor> rocksdb::rangeCursor(const Buffer &lowerBound, const Buffer &upperBound) const
   {
     ReadOptions read_options = ro_;
-    read_options.auto_prefix_mode = true; //Adaptive Prefix Mode
+    read_options.auto_prefix_mode = true; //Adaptive Prefix Mode, prefix filters are used within the upper bound
 
-    auto strKeyPrefix = std::string(keyPrefix.toString());
+    auto cursor = std::make_unique<Cursor>(db_, read_options, upperBound);
+    cursor->seek(lowerBound);
+    return cursor;
+  }
 
-    Buffer key;
-    Buffer value;
+  std::unique_ptr<rocksdb::Cursor> rocksdb::prefixCursor(const Buffer &keyPrefix) const
+  {
+    return rangeCursor(keyPrefix, prefixUpperBound(keyPrefix));
+  }
 
+  outcome::result<rocksdb::QueryResult> rocksdb::query(const Buffer& keyPrefix) const
+  {
     QueryResult results;
-    auto iter = db_->NewIterator(read_options);
-    auto slicePrefix = make_slice(keyPrefix);
-    for (iter->Seek(slicePrefix); iter->Valid() && iter->key().starts_with(slicePrefix); iter->Next())
+    auto queryResult = query(keyPrefix,
+        [&results](gsl::span<const uint8_t> key, gsl::span<const uint8_t> value)
+        {
+          results.emplace(Buffer(key), Buffer(value));
+          return true;
+        });
+    if (queryResult.has_failure())
     {
-      key.clear();
-      key.put(iter->key().ToString());
-
-      value.clear();
-      value.put(iter->value().ToString());
-      results[key] = value;
+      return queryResult.error();
     }
-    delete iter;
     return results;
   }
 
+  outcome::result<Buffer> rocksdb::query(const Buffer &keyPrefix, const QueryCallback &callback,
+                                         size_t limit, const Buffer &startKey) const
+  {
+    auto cursor = prefixCursor(keyPrefix);
+    if (keyPrefix < startKey)
+    {
+      cursor->seek(startKey);
+    }
+
+    size_t count = 0;
+    for (; cursor->isValid(); cursor->next())
+    {
+      if (limit > 0 && count == limit)
+      {
+        return Buffer(cursor->keyView());
+      }
+      ++count;
+
+      if (!callback(cursor->keyView(), cursor->valueView()))
+      {
+        cursor->next();
+        return cursor->isValid() ? Buffer(cursor->keyView()) : Buffer();
+      }
+    }
+    return Buffer();
+  }
+
   bool rocksdb::contains(const Buffer &key) const 
   {
     // here we interpret all kinds of errors as "not found".
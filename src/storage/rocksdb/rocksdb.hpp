@@ -9,6 +9,8 @@
 #include <rocksdb/options.h>
 #include <rocksdb/write_batch.h>
 
+#include <functional>
+
 #include "base/logger.hpp"
 #include "storage/buffer_map_types.hpp"
 
@@ -33,6 +35,13 @@ namespace sgns::storage
     using Slice = ::ROCKSDB_NAMESPACE::Slice;
     using QueryResult = std::map<Buffer, Buffer>;
 
+    /**
+     * @brief Receives key-value pairs of a query without copying them.
+     * The views are valid only during the call.
+     * @return true to continue the query, false to stop it
+     */
+    using QueryCallback = std::function<bool(gsl::span<const uint8_t> key, gsl::span<const uint8_t> value)>;
+
     ~rocksdb() override = default;
 
     /**
@@ -66,10 +75,51 @@ namespace sgns::storage
 
     std::unique_ptr<BufferBatch> batch() override;
 
+    /**
+     * @brief Returns new batch that is committed with the given write options
+     * instead of the ones set by @see rocksdb#setWriteOptions
+     * @param wo options used to commit the batch
+     */
+    std::unique_ptr<BufferBatch> batch(const WriteOptions &wo);
+
     outcome::result<Buffer> get(const Buffer &key) const override;
 
+    /**
+     * @brief Returns new cursor over keys in range [lowerBound, upperBound)
+     * positioned at the lower bound. Keys beyond the upper bound are not read.
+     * @param lowerBound inclusive lower bound of keys
+     * @param upperBound exclusive upper bound of keys, empty buffer means no bound
+     * @return cursor which is invalid if the range is empty
+     */
+    std::unique_ptr<Cursor> rangeCursor(const Buffer &lowerBound, const Buffer &upperBound) const;
+
+    /**
+     * @brief Returns new cursor over keys that start with the prefix
+     * positioned at the first of them.
+     * @param keyPrefix prefix of keys
+     * @return cursor which becomes invalid after the last key with the prefix
+     */
+    std::unique_ptr<Cursor> prefixCursor(const Buffer &keyPrefix) const;
+
+    /**
+     * @brief Copies key-value pairs which keys start with the prefix into a map.
+     * Use the callback version for large prefixes to avoid holding the result in memory.
+     * @param keyPrefix prefix of keys
+     * @return ordered key-value pairs
+     */
     outcome::result<QueryResult> query(const Buffer& keyPrefix) const;
 
+    /**
+     * @brief Streams key-value pairs which keys start with the prefix in the key order.
+     * @param keyPrefix prefix of keys
+     * @param callback receives views of pairs
+     * @param limit maximum number of pairs to pass to the callback, 0 means no limit
+     * @param startKey key to continue a paginated query from, empty buffer means the prefix start
+     * @return key to continue the query from or an empty buffer if all pairs were passed
+     */
+    outcome::result<Buffer> query(const Buffer &keyPrefix, const QueryCallback &callback,
+                                  size_t limit = 0, const Buffer &startKey = Buffer()) const;
+
     bool contains(const Buffer &key) const override;
 
     bool empty() const override;
@@ -7,7 +7,9 @@
 namespace sgns::storage 
 {
 
-  rocksdb::Batch::Batch(rocksdb &db) : db_(db) {}
+  rocksdb::Batch::Batch(rocksdb &db) : db_(db), wo_(db.wo_) {}
+
+  rocksdb::Batch::Batch(rocksdb &db, const WriteOptions &wo) : db_(db), wo_(wo) {}
 
   outcome::result<void> rocksdb::Batch::put(const Buffer &key,
                                             const Buffer &value) 
@@ -30,7 +32,7 @@ namespace sgns::storage
 
   outcome::result<void> rocksdb::Batch::commit() 
   {
-    auto status = db_.db_->Write(db_.wo_, &batch_);
+    auto status = db_.db_->Write(wo_, &batch_);
     if (status.ok()) 
     {
       return outcome::success();
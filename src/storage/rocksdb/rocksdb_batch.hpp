@@ -18,6 +18,8 @@ namespace sgns::storage
    public:
     explicit Batch(rocksdb &db);
 
+    Batch(rocksdb &db, const WriteOptions &wo);
+
     outcome::result<void> put(const Buffer &key, const Buffer &value) override;
     outcome::result<void> put(const Buffer &key, Buffer &&value) override;
 
@@ -29,6 +31,7 @@ namespace sgns::storage
 
    private:
     rocksdb &db_;
+    WriteOptions wo_;
     ::ROCKSDB_NAMESPACE::WriteBatch batch_;
   };
 
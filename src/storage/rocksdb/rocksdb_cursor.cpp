@@ -10,6 +10,17 @@ namespace sgns::storage
   rocksdb::Cursor::Cursor(std::shared_ptr<Iterator> it)
       : i_(std::move(it)) {}
 
+  rocksdb::Cursor::Cursor(const std::shared_ptr<DB> &db, ReadOptions ro, Buffer upperBound)
+      : upper_bound_(std::move(upperBound))
+  {
+    if (!upper_bound_.empty())
+    {
+      upper_bound_slice_ = make_slice(upper_bound_);
+      ro.iterate_upper_bound = &upper_bound_slice_;
+    }
+    i_ = std::shared_ptr<Iterator>(db->NewIterator(ro));
+  }
+
   outcome::result<void> rocksdb::Cursor::seekToFirst() 
   {
     i_->SeekToFirst();
@@ -55,4 +66,14 @@ namespace sgns::storage
     return make_buffer(i_->value());
   }
 
+  gsl::span<const uint8_t> rocksdb::Cursor::keyView() const
+  {
+    return make_span(i_->key());
+  }
+
+  gsl::span<const uint8_t> rocksdb::Cursor::valueView() const
+  {
+    return make_span(i_->value());
+  }
+
 }  // namespace sgns::storage
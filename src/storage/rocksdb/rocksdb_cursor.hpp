@@ -19,6 +19,15 @@ namespace sgns::storage
 
     explicit Cursor(std::shared_ptr<Iterator> it);
 
+    /**
+     * @brief Creates a cursor which does not read keys beyond the upper bound.
+     * The bound is owned by the cursor as rocksdb refers to it while iterating.
+     * @param db database to iterate
+     * @param ro read options
+     * @param upperBound exclusive upper bound of keys, empty buffer means no bound
+     */
+    Cursor(const std::shared_ptr<DB> &db, ReadOptions ro, Buffer upperBound);
+
     outcome::result<void> seekToFirst() override;
 
     outcome::result<void> seek(const Buffer &key) override;
@@ -35,7 +44,21 @@ namespace sgns::storage
 
     outcome::result<Buffer> value() const override;
 
+    /**
+     * @brief Getter for key without copying.
+     * @return view of the key which is valid until the cursor is moved
+     */
+    gsl::span<const uint8_t> keyView() const;
+
+    /**
+     * @brief Getter for value without copying.
+     * @return view of the value which is valid until the cursor is moved
+     */
+    gsl::span<const uint8_t> valueView() const;
+
    private:
+    Buffer upper_bound_;
+    Slice upper_bound_slice_;
     std::shared_ptr<Iterator> i_;
   };
 
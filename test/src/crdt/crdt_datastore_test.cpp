@@ -10,6 +10,12 @@
 #include <string>
 #include <boost/asio/error.hpp>
 #include <thread>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
 #include <crdt/proto/bcast.pb.h>
 
 namespace sgns::crdt
@@ -90,7 +96,12 @@ namespace sgns::crdt
       if (!buff.empty())
       {
         const std::string bCastData(buff.toString());
+        std::lock_guard lock(mutex_);
         listOfBroadcasts_.push(bCastData);
+        if (newBroadcastHandler_)
+        {
+          newBroadcastHandler_();
+        }
       }
       return outcome::success();
     }
@@ -101,6 +112,7 @@ namespace sgns::crdt
     */
     virtual outcome::result<base::Buffer> Next() override
     {
+      std::lock_guard lock(mutex_);
       if (listOfBroadcasts_.empty())
       {
         //Broadcaster::ErrorCode::ErrNoMoreBroadcast
@@ -115,7 +127,225 @@ namespace sgns::crdt
       return buffer;
     }
 
+    virtual void SetNewBroadcastHandler(std::function<void()> handler) override
+    {
+      std::lock_guard lock(mutex_);
+      newBroadcastHandler_ = std::move(handler);
+    }
+
     std::queue<std::string> listOfBroadcasts_;
+    std::function<void()> newBroadcastHandler_;
+    std::mutex mutex_;
+  };
+
+  /** DAG syncer of a replica that shares a node storage with other replicas.
+  * Nodes added by other replicas can be fetched but are not known blocks of the replica.
+  * Fetching can be delayed to simulate network latency
+  */
+  class ReplicaDagSyncer : public CustomDagSyncer
+  {
+  public:
+    ReplicaDagSyncer(std::shared_ptr<IpfsDatastore> service)
+      : CustomDagSyncer(service)
+    {
+    }
+
+    outcome::result<bool> HasBlock(const CID& cid) const override
+    {
+      std::lock_guard lock(mutex_);
+      return knownBlocks_.count(cid.toString().value()) > 0;
+    }
+
+    outcome::result<void> addNode(std::shared_ptr<const IPLDNode> node) override
+    {
+      {
+        std::lock_guard lock(mutex_);
+        knownBlocks_.insert(node->getCID().toString().value());
+      }
+      return CustomDagSyncer::addNode(node);
+    }
+
+    outcome::result<void> removeNode(const CID& cid) override
+    {
+      {
+        std::lock_guard lock(mutex_);
+        knownBlocks_.erase(cid.toString().value());
+      }
+      return CustomDagSyncer::removeNode(cid);
+    }
+
+    outcome::result<std::shared_ptr<IPLDNode>> getNode(const CID& cid) const override
+    {
+      ++fetchedNodeCount_;
+      {
+        std::unique_lock lock(fetchGateMutex_);
+        fetchGateCondition_.wait(lock, [this] { return !isFetchBlocked_; });
+      }
+      if (fetchLatency_.count() > 0)
+      {
+        std::this_thread::sleep_for(fetchLatency_);
+      }
+      return CustomDagSyncer::getNode(cid);
+    }
+
+    /** Holds fetches until UnblockFetches() is called */
+    void BlockFetches()
+    {
+      std::lock_guard lock(fetchGateMutex_);
+      isFetchBlocked_ = true;
+    }
+
+    void UnblockFetches()
+    {
+      {
+        std::lock_guard lock(fetchGateMutex_);
+        isFetchBlocked_ = false;
+      }
+      fetchGateCondition_.notify_all();
+    }
+
+    /** Number of nodes fetched by the replica */
+    mutable std::atomic<size_t> fetchedNodeCount_ = 0;
+
+    /** Delay of each node fetch */
+    std::chrono::microseconds fetchLatency_ = std::chrono::microseconds(0);
+
+  private:
+    std::set<std::string> knownBlocks_;
+    mutable std::mutex mutex_;
+    mutable std::mutex fetchGateMutex_;
+    mutable std::condition_variable fetchGateCondition_;
+    bool isFetchBlocked_ = false;
+  };
+
+  /** DAG syncer that holds a known block check of one node after a number of checks of the node,
+  * so the state of the replica can be changed while its DAG walk is at the node
+  */
+  class HeldBlockDagSyncer : public ReplicaDagSyncer
+  {
+  public:
+    HeldBlockDagSyncer(std::shared_ptr<IpfsDatastore> service, const CID& heldCid, size_t passedCheckCount)
+      : ReplicaDagSyncer(service)
+      , heldCid_(heldCid)
+      , passedCheckCount_(passedCheckCount)
+    {
+    }
+
+    outcome::result<bool> HasBlock(const CID& cid) const override
+    {
+      if (cid == heldCid_)
+      {
+        std::unique_lock lock(holdMutex_);
+        if (checkCount_++ == passedCheckCount_)
+        {
+          isHolding_ = true;
+          holdCondition_.notify_all();
+          holdCondition_.wait(lock, [this] { return isReleased_; });
+        }
+      }
+      return ReplicaDagSyncer::HasBlock(cid);
+    }
+
+    /** Waits until the check of the node is held
+    * @return true if the check is held before the timeout
+    */
+    bool WaitForHold(std::chrono::milliseconds timeout)
+    {
+      std::unique_lock lock(holdMutex_);
+      return holdCondition_.wait_for(lock, timeout, [this] { return isHolding_; });
+    }
+
+    /** Releases the held check, later checks are not held */
+    void Release()
+    {
+      {
+        std::lock_guard lock(holdMutex_);
+        isReleased_ = true;
+      }
+      holdCondition_.notify_all();
+    }
+
+  private:
+    CID heldCid_;
+    size_t passedCheckCount_;
+    mutable size_t checkCount_ = 0;
+    mutable bool isHolding_ = false;
+    bool isReleased_ = false;
+    mutable std::mutex holdMutex_;
+    mutable std::condition_variable holdCondition_;
+  };
+
+  std::shared_ptr<rocksdb> CreateReplicaDataStore(const std::string& databasePath)
+  {
+    fs::remove_all(databasePath);
+    rocksdb::Options options;
+    options.create_if_missing = true;  // intentionally
+    return rocksdb::create(databasePath, options).value();
+  }
+
+  /** Broadcaster that delivers broadcasts to a connected replica in the same process
+  */
+  class LoopbackBroadcaster : public Broadcaster
+  {
+  public:
+    void Connect(const std::shared_ptr<LoopbackBroadcaster>& peer)
+    {
+      peer_ = peer;
+    }
+
+    outcome::result<void> Broadcast(const base::Buffer& buff) override
+    {
+      auto peer = peer_.lock();
+      if (peer != nullptr && !buff.empty())
+      {
+        peer->Receive(std::string(buff.toString()));
+      }
+      return outcome::success();
+    }
+
+    outcome::result<base::Buffer> Next() override
+    {
+      ++nextCallCount_;
+      std::lock_guard lock(mutex_);
+      if (receivedBroadcasts_.empty())
+      {
+        return outcome::failure(boost::system::error_code{});
+      }
+
+      base::Buffer buffer;
+      buffer.put(receivedBroadcasts_.front());
+      receivedBroadcasts_.pop();
+      return buffer;
+    }
+
+    void SetNewBroadcastHandler(std::function<void()> handler) override
+    {
+      std::lock_guard lock(mutex_);
+      newBroadcastHandler_ = std::move(handler);
+    }
+
+    /** Number of broadcasts received from the peer */
+    std::atomic<size_t> receivedCount_ = 0;
+
+    /** Number of Next() calls including the ones that found no broadcast */
+    std::atomic<size_t> nextCallCount_ = 0;
+
+  private:
+    void Receive(const std::string& data)
+    {
+      std::lock_guard lock(mutex_);
+      ++receivedCount_;
+      receivedBroadcasts_.push(data);
+      if (newBroadcastHandler_)
+      {
+        newBroadcastHandler_();
+      }
+    }
+
+    std::weak_ptr<LoopbackBroadcaster> peer_;
+    std::queue<std::string> receivedBroadcasts_;
+    std::function<void()> newBroadcastHandler_;
+    std::mutex mutex_;
   };
 
   class CrdtDatastoreTest : public ::testing::Test
@@ -172,6 +402,22 @@ namespace sgns::crdt
 
   }
 
+  /**
+   * @given Fallback options of the datastore
+   * @when They are verified
+   * @then They are valid, keep the fallback rebroadcast interval and have no hooks
+   */
+  TEST(CrdtDatastoreOptionsTest, FallbackOptions)
+  {
+    auto options = CrdtDatastore::FallbackOptions();
+    EXPECT_OUTCOME_EQ(options->Verify(), CrdtOptions::VerifyErrorCode::Success);
+    EXPECT_EQ(options->rebroadcastIntervalMilliseconds, 100);
+    EXPECT_EQ(options->keyFilterBitCount, 0);
+    EXPECT_EQ(options->valueCacheSize, 0);
+    EXPECT_EQ(options->putHookFunc, nullptr);
+    EXPECT_EQ(options->deleteHookFunc, nullptr);
+  }
+
   TEST_F(CrdtDatastoreTest, TestDeltaFunctions)
   {
     auto newKey1 = HierarchicalKey("NewKey1");
@@ -236,4 +482,577 @@ namespace sgns::crdt
     EXPECT_OUTCOME_EQ(crdtDatastore_->HasKey(newKey5), false);
   }
   
-}
\ No newline at end of file
+
+  /**
+   * @given Transaction that puts the same key twice and removes a key it has put
+   * @when The transaction is published
+   * @then The last put value is stored and the removed key is absent
+   */
+  TEST_F(CrdtDatastoreTest, TestTransactionDuplicateKeys)
+  {
+    auto newKey1 = HierarchicalKey("DuplicateKey1");
+    auto newKey2 = HierarchicalKey("DuplicateKey2");
+    CrdtBuffer buffer1, buffer2, buffer3;
+    buffer1.put("Data1");
+    buffer2.put("Data2");
+    buffer3.put("Data3");
+
+    auto transaction = crdtDatastore_->BeginTransaction();
+    EXPECT_OUTCOME_TRUE_1(transaction->AddToDelta(newKey1, buffer2));
+    EXPECT_OUTCOME_TRUE(singleKeySize, transaction->AddToDelta(newKey2, buffer3));
+    EXPECT_OUTCOME_TRUE_1(transaction->AddToDelta(newKey1, buffer1));
+    EXPECT_OUTCOME_TRUE(deltaSize, transaction->RemoveFromDelta(newKey2));
+    EXPECT_LT(deltaSize, singleKeySize);
+    EXPECT_OUTCOME_TRUE_1(transaction->PublishDelta());
+
+    EXPECT_OUTCOME_TRUE(valueBuffer, crdtDatastore_->GetKey(newKey1));
+    EXPECT_EQ(valueBuffer.toString(), buffer1.toString());
+    EXPECT_OUTCOME_EQ(crdtDatastore_->HasKey(newKey2), false);
+  }
+
+  /**
+   * @given Transaction of 10k keys
+   * @when Every key is put again with a value of the same size and every tenth key is removed
+   * @then The returned delta size does not change on repeated puts, decreases on removals
+   * and the published transaction stores the last values of the remaining keys
+   */
+  TEST_F(CrdtDatastoreTest, TransactionOfManyKeys)
+  {
+    constexpr size_t keyCount = 10000;
+    CrdtBuffer firstBuffer, lastBuffer;
+    firstBuffer.put(std::string(100, 'a'));
+    lastBuffer.put(std::string(100, 'b'));
+
+    auto transaction = crdtDatastore_->BeginTransaction();
+    int deltaSize = 0;
+    for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+    {
+      EXPECT_OUTCOME_TRUE(newDeltaSize, transaction->AddToDelta(HierarchicalKey("/key/" + std::to_string(keyIdx)), firstBuffer));
+      EXPECT_GT(newDeltaSize, deltaSize);
+      deltaSize = newDeltaSize;
+    }
+
+    // Repeated puts replace the elements in place
+    for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+    {
+      EXPECT_OUTCOME_EQ(transaction->AddToDelta(HierarchicalKey("/key/" + std::to_string(keyIdx)), lastBuffer), deltaSize);
+    }
+
+    for (size_t keyIdx = 0; keyIdx < keyCount; keyIdx += 10)
+    {
+      EXPECT_OUTCOME_TRUE(newDeltaSize, transaction->RemoveFromDelta(HierarchicalKey("/key/" + std::to_string(keyIdx))));
+      EXPECT_LT(newDeltaSize, deltaSize);
+      deltaSize = newDeltaSize;
+    }
+    EXPECT_OUTCOME_TRUE_1(transaction->PublishDelta());
+
+    for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+    {
+      auto key = HierarchicalKey("/key/" + std::to_string(keyIdx));
+      if (keyIdx % 10 == 0)
+      {
+        EXPECT_OUTCOME_EQ(crdtDatastore_->HasKey(key), false);
+      }
+      else
+      {
+        EXPECT_OUTCOME_TRUE(valueBuffer, crdtDatastore_->GetKey(key));
+        EXPECT_EQ(valueBuffer.toString(), lastBuffer.toString());
+      }
+    }
+  }
+
+  /**
+   * @given Two replicas connected by an in-process broadcaster
+   * @when Keys are put to one replica
+   * @then The keys are added on another replica, which reads the broadcaster
+   * only when it is notified about new broadcasts instead of polling it
+   */
+  TEST(CrdtDatastoreReplicationTest, PropagationIsEventDriven)
+  {
+    constexpr size_t keyCount = 20;
+
+    std::mutex addedKeysMutex;
+    std::condition_variable addedKeysCondition;
+    std::set<std::string> addedKeys;
+    auto joinOptions = CrdtOptions::DefaultOptions();
+    joinOptions->putHookFunc = [&](const std::string& key, const Buffer&)
+    {
+      std::lock_guard lock(addedKeysMutex);
+      addedKeys.insert(key);
+      addedKeysCondition.notify_all();
+    };
+
+    auto nodeStorage = std::make_shared<InMemoryDatastore>();
+    std::vector<std::shared_ptr<LoopbackBroadcaster>> broadcasters;
+    std::vector<std::shared_ptr<CrdtDatastore>> replicas;
+    for (size_t replicaIdx = 0; replicaIdx < 2; ++replicaIdx)
+    {
+      broadcasters.push_back(std::make_shared<LoopbackBroadcaster>());
+      replicas.push_back(std::make_shared<CrdtDatastore>(
+        CreateReplicaDataStore("supergenius_crdt_datastore_replica_test_" + std::to_string(replicaIdx)),
+        HierarchicalKey("/namespace"), std::make_shared<ReplicaDagSyncer>(nodeStorage), broadcasters.back(),
+        replicaIdx == 0 ? CrdtOptions::DefaultOptions() : joinOptions));
+    }
+    broadcasters[0]->Connect(broadcasters[1]);
+    broadcasters[1]->Connect(broadcasters[0]);
+
+    for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+    {
+      CrdtBuffer buffer;
+      buffer.put("Data" + std::to_string(keyIdx));
+      EXPECT_OUTCOME_TRUE_1(replicas[0]->PutKey(HierarchicalKey("Key" + std::to_string(keyIdx)), buffer));
+    }
+
+    {
+      // The timeout only bounds a failing test, propagation is not timed
+      std::unique_lock lock(addedKeysMutex);
+      ASSERT_TRUE(addedKeysCondition.wait_for(lock, std::chrono::seconds(5),
+        [&] { return addedKeys.size() >= keyCount; }));
+    }
+
+    for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+    {
+      EXPECT_OUTCOME_TRUE(valueBuffer, replicas[1]->GetKey(HierarchicalKey("Key" + std::to_string(keyIdx))));
+      EXPECT_EQ(valueBuffer.toString(), "Data" + std::to_string(keyIdx));
+    }
+
+    // The startup and each notification drain the received broadcasts and end with one empty Next() call
+    EXPECT_GE(broadcasters[1]->receivedCount_.load(), keyCount);
+    EXPECT_LE(broadcasters[1]->nextCallCount_.load(), 2 * broadcasters[1]->receivedCount_.load() + 1);
+
+    replicas.clear();
+  }
+
+  /**
+   * @given A replica with a long history of updates and removals
+   * @when A new replica joins with and without the history compacted into a snapshot
+   * @then With the snapshot the new replica fetches only the snapshot and the deltas above it
+   * and gets the same state, although nodes below the snapshot were removed
+   */
+  TEST(CrdtDatastoreReplicationTest, SnapshotJoin)
+  {
+    constexpr size_t historySize = 300;
+    constexpr size_t keyCount = 50;
+
+    // Returns a number of nodes fetched by a new replica
+    auto joinReplicas = [](bool isCompacted)
+    {
+      auto nodeStorage = std::make_shared<InMemoryDatastore>();
+      auto sourceBroadcaster = std::make_shared<LoopbackBroadcaster>();
+      auto sourceReplica = std::make_shared<CrdtDatastore>(
+        CreateReplicaDataStore("supergenius_crdt_datastore_snapshot_test_0"), HierarchicalKey("/namespace"),
+        std::make_shared<ReplicaDagSyncer>(nodeStorage), sourceBroadcaster, CrdtOptions::DefaultOptions());
+
+      for (size_t updateIdx = 0; updateIdx < historySize; ++updateIdx)
+      {
+        CrdtBuffer buffer;
+        buffer.put("Data" + std::to_string(updateIdx));
+        EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("Key" + std::to_string(updateIdx % keyCount)), buffer));
+      }
+      EXPECT_OUTCOME_TRUE_1(sourceReplica->DeleteKey(HierarchicalKey("Key0")));
+
+      if (isCompacted)
+      {
+        EXPECT_OUTCOME_TRUE_1(sourceReplica->CompactDAG(true));
+        EXPECT_EQ(sourceReplica->GetSnapshotHeight(), historySize + 2);
+      }
+
+      auto joinDataStore = CreateReplicaDataStore("supergenius_crdt_datastore_snapshot_test_1");
+      auto joinBroadcaster = std::make_shared<LoopbackBroadcaster>();
+      auto joinDagSyncer = std::make_shared<ReplicaDagSyncer>(nodeStorage);
+      auto joinReplica = std::make_shared<CrdtDatastore>(joinDataStore, HierarchicalKey("/namespace"),
+        joinDagSyncer, joinBroadcaster, CrdtOptions::DefaultOptions());
+      sourceBroadcaster->Connect(joinBroadcaster);
+      joinBroadcaster->Connect(sourceBroadcaster);
+
+      // The new replica learns the heads from the next update and is joined when the walk
+      // of the DAG reaches its bottom and the head is stored. The timeout only bounds a failing test
+      auto startTime = std::chrono::steady_clock::now();
+      CrdtBuffer lastBuffer;
+      lastBuffer.put("LastData");
+      EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("LastKey"), lastBuffer));
+
+      Buffer headsPrefix;
+      headsPrefix.put("/namespace/h/");
+      bool isJoined = false;
+      while (!isJoined && (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(30)))
+      {
+        auto headsResult = joinDataStore->query(headsPrefix);
+        isJoined = !headsResult.has_failure() && !headsResult.value().empty();
+        std::this_thread::yield();
+      }
+      EXPECT_TRUE(isJoined);
+
+      for (size_t keyIdx = 1; keyIdx < keyCount; ++keyIdx)
+      {
+        EXPECT_OUTCOME_TRUE(valueBuffer, joinReplica->GetKey(HierarchicalKey("Key" + std::to_string(keyIdx))));
+        EXPECT_EQ(valueBuffer.toString(), "Data" + std::to_string(historySize - keyCount + keyIdx));
+      }
+      EXPECT_OUTCOME_EQ(joinReplica->HasKey(HierarchicalKey("Key0")), false);
+      EXPECT_OUTCOME_EQ(joinReplica->HasKey(HierarchicalKey("LastKey")), true);
+      if (isCompacted)
+      {
+        EXPECT_EQ(joinReplica->GetSnapshotHeight(), historySize + 2);
+      }
+
+      joinReplica = nullptr;
+      sourceReplica = nullptr;
+      return joinDagSyncer->fetchedNodeCount_.load();
+    };
+
+    EXPECT_GT(joinReplicas(false), historySize);
+    // The last update and the snapshot
+    EXPECT_EQ(joinReplicas(true), 2);
+  }
+
+  /**
+   * @given A replica with a history of updates and removals and a new replica that walks the history
+   * @when The first replica compacts its DAG while the walk of the new replica is in progress
+   * @then The new replica does not compact its DAG during the walk
+   * and both replicas converge to the same state
+   */
+  TEST(CrdtDatastoreReplicationTest, SnapshotDuringWalkConverges)
+  {
+    constexpr size_t historySize = 100;
+    constexpr size_t keyCount = 20;
+
+    auto nodeStorage = std::make_shared<InMemoryDatastore>();
+    auto sourceBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto sourceReplica = std::make_shared<CrdtDatastore>(
+      CreateReplicaDataStore("supergenius_crdt_datastore_snapshot_walk_test_0"), HierarchicalKey("/namespace"),
+      std::make_shared<ReplicaDagSyncer>(nodeStorage), sourceBroadcaster, CrdtOptions::DefaultOptions());
+
+    for (size_t updateIdx = 0; updateIdx < historySize; ++updateIdx)
+    {
+      CrdtBuffer buffer;
+      buffer.put("Data" + std::to_string(updateIdx));
+      EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("Key" + std::to_string(updateIdx % keyCount)), buffer));
+    }
+    EXPECT_OUTCOME_TRUE_1(sourceReplica->DeleteKey(HierarchicalKey("Key0")));
+
+    auto joinBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto joinDagSyncer = std::make_shared<ReplicaDagSyncer>(nodeStorage);
+    joinDagSyncer->BlockFetches();
+    auto joinReplica = std::make_shared<CrdtDatastore>(
+      CreateReplicaDataStore("supergenius_crdt_datastore_snapshot_walk_test_1"), HierarchicalKey("/namespace"),
+      joinDagSyncer, joinBroadcaster, CrdtOptions::DefaultOptions());
+    sourceBroadcaster->Connect(joinBroadcaster);
+    joinBroadcaster->Connect(sourceBroadcaster);
+
+    // The new replica learns the heads from the next update and starts the walk by fetching them
+    CrdtBuffer lastBuffer;
+    lastBuffer.put("LastData");
+    EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("LastKey"), lastBuffer));
+
+    auto startTime = std::chrono::steady_clock::now();
+    while (joinDagSyncer->fetchedNodeCount_ == 0 && (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(5)))
+    {
+      std::this_thread::yield();
+    }
+    EXPECT_GT(joinDagSyncer->fetchedNodeCount_.load(), 0);
+    EXPECT_OUTCOME_FALSE_1(joinReplica->CompactDAG());
+
+    // The snapshot is processed by the new replica concurrently with the rest of the walk
+    joinDagSyncer->fetchLatency_ = std::chrono::microseconds(100);
+    joinDagSyncer->UnblockFetches();
+    EXPECT_OUTCOME_TRUE_1(sourceReplica->CompactDAG());
+
+    std::vector<HierarchicalKey> keys;
+    for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+    {
+      keys.push_back(HierarchicalKey("Key" + std::to_string(keyIdx)));
+    }
+    keys.push_back(HierarchicalKey("LastKey"));
+
+    auto isConverged = [&]()
+    {
+      if (joinReplica->GetSnapshotHeight() != sourceReplica->GetSnapshotHeight())
+      {
+        return false;
+      }
+      for (const auto& key : keys)
+      {
+        auto sourceValueResult = sourceReplica->GetKey(key);
+        auto joinValueResult = joinReplica->GetKey(key);
+        if (sourceValueResult.has_failure() != joinValueResult.has_failure() || (!sourceValueResult.has_failure()
+          && sourceValueResult.value().toString() != joinValueResult.value().toString()))
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    // The timeout only bounds a failing test
+    startTime = std::chrono::steady_clock::now();
+    bool isReplicaConverged = false;
+    while (!isReplicaConverged && (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(30)))
+    {
+      isReplicaConverged = isConverged();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(isReplicaConverged);
+    EXPECT_OUTCOME_EQ(joinReplica->HasKey(HierarchicalKey("Key0")), false);
+    for (size_t keyIdx = 1; keyIdx < keyCount; ++keyIdx)
+    {
+      EXPECT_OUTCOME_TRUE(valueBuffer, joinReplica->GetKey(HierarchicalKey("Key" + std::to_string(keyIdx))));
+      EXPECT_EQ(valueBuffer.toString(), "Data" + std::to_string(historySize - keyCount + keyIdx));
+    }
+    EXPECT_OUTCOME_TRUE(lastValueBuffer, joinReplica->GetKey(HierarchicalKey("LastKey")));
+    EXPECT_EQ(lastValueBuffer.toString(), "LastData");
+
+    joinReplica = nullptr;
+    sourceReplica = nullptr;
+  }
+
+  /**
+   * @given Two replicas with a common history and a replica that compacts a longer history and removes its nodes
+   * @when The other replica publishes an update that links a node deep below the snapshot
+   * @then The compacting replica stops the walk at the removed node instead of fetching it
+   */
+  TEST(CrdtDatastoreReplicationTest, ConcurrentBranchStopsAtRemovedNodes)
+  {
+    constexpr size_t commonKeyCount = 5;
+    constexpr size_t keyCount = 10;
+
+    // Polls a condition, the timeout only bounds a failing test
+    auto waitFor = [](const std::function<bool()>& aCondition)
+    {
+      auto startTime = std::chrono::steady_clock::now();
+      while (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(10))
+      {
+        if (aCondition())
+        {
+          return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return false;
+    };
+
+    auto nodeStorage = std::make_shared<InMemoryDatastore>();
+    auto sourceDataStore = CreateReplicaDataStore("supergenius_crdt_datastore_removed_nodes_test_0");
+    auto sourceBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto sourceDagSyncer = std::make_shared<ReplicaDagSyncer>(nodeStorage);
+    auto sourceReplica = std::make_shared<CrdtDatastore>(sourceDataStore, HierarchicalKey("/namespace"),
+      sourceDagSyncer, sourceBroadcaster, CrdtOptions::DefaultOptions());
+
+    auto branchDataStore = CreateReplicaDataStore("supergenius_crdt_datastore_removed_nodes_test_1");
+    auto branchBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto branchReplica = std::make_shared<CrdtDatastore>(branchDataStore, HierarchicalKey("/namespace"),
+      std::make_shared<ReplicaDagSyncer>(nodeStorage), branchBroadcaster, CrdtOptions::DefaultOptions());
+    sourceBroadcaster->Connect(branchBroadcaster);
+
+    for (size_t keyIdx = 1; keyIdx <= keyCount; ++keyIdx)
+    {
+      CrdtBuffer buffer;
+      buffer.put("Data" + std::to_string(keyIdx));
+      EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("Key" + std::to_string(keyIdx)), buffer));
+
+      if (keyIdx == commonKeyCount)
+      {
+        // The branch replica walks the common history, its only head is the node of the last common update
+        Buffer headsPrefix;
+        headsPrefix.put("/namespace/h/");
+        auto sourceHeadsResult = sourceDataStore->query(headsPrefix);
+        ASSERT_FALSE(sourceHeadsResult.has_failure());
+        EXPECT_TRUE(waitFor([&]() {
+          auto branchHeadsResult = branchDataStore->query(headsPrefix);
+          return !branchHeadsResult.has_failure() && branchHeadsResult.value() == sourceHeadsResult.value(); }));
+        sourceBroadcaster->Connect(nullptr);
+      }
+    }
+
+    EXPECT_OUTCOME_TRUE_1(sourceReplica->CompactDAG(true));
+    auto fetchedNodeCount = sourceDagSyncer->fetchedNodeCount_.load();
+
+    // The branch update links the last common node, which was removed by the compaction
+    branchBroadcaster->Connect(sourceBroadcaster);
+    CrdtBuffer branchBuffer;
+    branchBuffer.put("BranchData");
+    EXPECT_OUTCOME_TRUE_1(branchReplica->PutKey(HierarchicalKey("BranchKey"), branchBuffer));
+
+    // The branch root becomes a head next to the snapshot when the walk stops at the compacted node
+    Buffer headsPrefix;
+    headsPrefix.put("/namespace/h/");
+    EXPECT_TRUE(waitFor([&]() {
+      auto headsResult = sourceDataStore->query(headsPrefix);
+      return !headsResult.has_failure() && headsResult.value().size() == 2; }));
+    EXPECT_EQ(sourceDagSyncer->fetchedNodeCount_.load(), fetchedNodeCount + 1);
+
+    EXPECT_OUTCOME_TRUE(branchValueBuffer, sourceReplica->GetKey(HierarchicalKey("BranchKey")));
+    EXPECT_EQ(branchValueBuffer.toString(), "BranchData");
+    for (size_t keyIdx = 1; keyIdx <= keyCount; ++keyIdx)
+    {
+      EXPECT_OUTCOME_TRUE(valueBuffer, sourceReplica->GetKey(HierarchicalKey("Key" + std::to_string(keyIdx))));
+      EXPECT_EQ(valueBuffer.toString(), "Data" + std::to_string(keyIdx));
+    }
+
+    branchReplica = nullptr;
+    sourceReplica = nullptr;
+  }
+
+  /**
+   * @given A replica with a long history of updates
+   * @when A new replica catches up with the history fetching nodes in parallel and ahead of the walk
+   * @then The new replica has the latest state and no fetched nodes are left when the walk ends
+   */
+  TEST(CrdtDatastoreReplicationTest, CatchUpWithPrefetching)
+  {
+    constexpr size_t historySize = 1000;
+    constexpr size_t keyCount = 100;
+
+    auto nodeStorage = std::make_shared<InMemoryDatastore>();
+    auto sourceBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto sourceReplica = std::make_shared<CrdtDatastore>(
+      CreateReplicaDataStore("supergenius_crdt_datastore_catch_up_test_0"), HierarchicalKey("/namespace"),
+      std::make_shared<ReplicaDagSyncer>(nodeStorage), sourceBroadcaster, CrdtOptions::DefaultOptions());
+
+    for (size_t updateIdx = 0; updateIdx < historySize; ++updateIdx)
+    {
+      CrdtBuffer buffer;
+      buffer.put("Data" + std::to_string(updateIdx));
+      EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("Key" + std::to_string(updateIdx % keyCount)), buffer));
+    }
+
+    auto joinDataStore = CreateReplicaDataStore("supergenius_crdt_datastore_catch_up_test_1");
+    auto joinBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto joinDagSyncer = std::make_shared<ReplicaDagSyncer>(nodeStorage);
+    auto joinReplica = std::make_shared<CrdtDatastore>(joinDataStore, HierarchicalKey("/namespace"),
+      joinDagSyncer, joinBroadcaster, CrdtOptions::DefaultOptions());
+    sourceBroadcaster->Connect(joinBroadcaster);
+    joinBroadcaster->Connect(sourceBroadcaster);
+
+    CrdtBuffer lastBuffer;
+    lastBuffer.put("LastData");
+    EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("LastKey"), lastBuffer));
+
+    // The walk ends after the head is stored, the timeout only bounds a failing test
+    Buffer headsPrefix;
+    headsPrefix.put("/namespace/h/");
+    auto isCaughtUp = [&]()
+    {
+      auto headsResult = joinDataStore->query(headsPrefix);
+      return !headsResult.has_failure() && !headsResult.value().empty() && joinReplica->GetFetchRequestCount() == 0;
+    };
+    auto startTime = std::chrono::steady_clock::now();
+    bool isReplicaCaughtUp = false;
+    while (!isReplicaCaughtUp && (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(30)))
+    {
+      isReplicaCaughtUp = isCaughtUp();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(isReplicaCaughtUp);
+    EXPECT_GT(joinDagSyncer->fetchedNodeCount_.load(), historySize);
+    for (size_t keyIdx = 0; keyIdx < keyCount; ++keyIdx)
+    {
+      EXPECT_OUTCOME_TRUE(valueBuffer, joinReplica->GetKey(HierarchicalKey("Key" + std::to_string(keyIdx))));
+      EXPECT_EQ(valueBuffer.toString(), "Data" + std::to_string(historySize - keyCount + keyIdx));
+    }
+    EXPECT_OUTCOME_TRUE(lastValueBuffer, joinReplica->GetKey(HierarchicalKey("LastKey")));
+    EXPECT_EQ(lastValueBuffer.toString(), "LastData");
+
+    joinReplica = nullptr;
+    sourceReplica = nullptr;
+  }
+
+  /**
+   * @given A new replica that walks a DAG and fetches nodes ahead of the walk
+   * @when A node fetched ahead is compacted into a snapshot before the walk reaches it and the walk stops there
+   * @then Nodes fetched ahead of the stopped walk are evicted when the walk ends
+   */
+  TEST(CrdtDatastoreReplicationTest, StoppedWalkEvictsFetchedNodes)
+  {
+    constexpr size_t compactedKeyCount = 12;
+    constexpr size_t keyCount = 30;
+
+    auto putKeys = [](const std::shared_ptr<CrdtDatastore>& aReplica, size_t aFirstKeyIdx, size_t aLastKeyIdx)
+    {
+      for (size_t keyIdx = aFirstKeyIdx; keyIdx <= aLastKeyIdx; ++keyIdx)
+      {
+        CrdtBuffer buffer;
+        buffer.put("Data" + std::to_string(keyIdx));
+        EXPECT_OUTCOME_TRUE_1(aReplica->PutKey(HierarchicalKey("Key" + std::to_string(keyIdx)), buffer));
+      }
+    };
+
+    // Polls a condition, the timeout only bounds a failing test
+    auto waitFor = [](const std::function<bool()>& aCondition)
+    {
+      auto startTime = std::chrono::steady_clock::now();
+      while (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(10))
+      {
+        if (aCondition())
+        {
+          return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return false;
+    };
+
+    auto nodeStorage = std::make_shared<InMemoryDatastore>();
+    auto sourceDataStore = CreateReplicaDataStore("supergenius_crdt_datastore_stopped_walk_test_0");
+    auto sourceBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto sourceReplica = std::make_shared<CrdtDatastore>(sourceDataStore, HierarchicalKey("/namespace"),
+      std::make_shared<ReplicaDagSyncer>(nodeStorage), sourceBroadcaster, CrdtOptions::DefaultOptions());
+
+    // The compacting replica gets the first updates only
+    auto compactingBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto compactingReplica = std::make_shared<CrdtDatastore>(
+      CreateReplicaDataStore("supergenius_crdt_datastore_stopped_walk_test_1"), HierarchicalKey("/namespace"),
+      std::make_shared<ReplicaDagSyncer>(nodeStorage), compactingBroadcaster, CrdtOptions::DefaultOptions());
+    sourceBroadcaster->Connect(compactingBroadcaster);
+    putKeys(sourceReplica, 1, compactedKeyCount);
+
+    // The only head of the source replica is the node of the last compacted update
+    Buffer headsPrefix;
+    headsPrefix.put("/namespace/h/");
+    auto headsResult = sourceDataStore->query(headsPrefix);
+    ASSERT_FALSE(headsResult.has_failure());
+    ASSERT_EQ(headsResult.value().size(), 1);
+    auto strHeadKey = std::string(headsResult.value().begin()->first.toString());
+    auto compactedHeadResult = CID::fromString(strHeadKey.substr(headsPrefix.size()));
+    ASSERT_FALSE(compactedHeadResult.has_failure());
+    auto compactedHead = compactedHeadResult.value();
+
+    EXPECT_TRUE(waitFor([&]() {
+      return !compactingReplica->GetKey(HierarchicalKey("Key" + std::to_string(compactedKeyCount))).has_failure(); }));
+    sourceBroadcaster->Connect(nullptr);
+    putKeys(sourceReplica, compactedKeyCount + 1, keyCount);
+
+    // The first check of the compacted head is done when it is fetched ahead of the walk,
+    // the second one is held when the walk reaches the node above it
+    auto joinBroadcaster = std::make_shared<LoopbackBroadcaster>();
+    auto joinDagSyncer = std::make_shared<HeldBlockDagSyncer>(nodeStorage, compactedHead, 1);
+    auto joinReplica = std::make_shared<CrdtDatastore>(
+      CreateReplicaDataStore("supergenius_crdt_datastore_stopped_walk_test_2"), HierarchicalKey("/namespace"),
+      joinDagSyncer, joinBroadcaster, CrdtOptions::DefaultOptions());
+    sourceBroadcaster->Connect(joinBroadcaster);
+
+    CrdtBuffer lastBuffer;
+    lastBuffer.put("LastData");
+    EXPECT_OUTCOME_TRUE_1(sourceReplica->PutKey(HierarchicalKey("LastKey"), lastBuffer));
+    EXPECT_TRUE(joinDagSyncer->WaitForHold(std::chrono::seconds(10)));
+    EXPECT_GT(joinReplica->GetFetchRequestCount(), 0);
+
+    // The snapshot of the compacting replica stops the walk at the compacted head
+    compactingBroadcaster->Connect(joinBroadcaster);
+    EXPECT_TRUE(waitFor([&]() { return !compactingReplica->CompactDAG().has_failure(); }));
+    EXPECT_TRUE(waitFor([&]() { return joinReplica->GetSnapshotHeight() > 0; }));
+    joinDagSyncer->Release();
+
+    EXPECT_TRUE(waitFor([&]() { return joinReplica->GetFetchRequestCount() == 0; }));
+    for (size_t keyIdx = 1; keyIdx <= keyCount; ++keyIdx)
+    {
+      EXPECT_OUTCOME_TRUE(valueBuffer, joinReplica->GetKey(HierarchicalKey("Key" + std::to_string(keyIdx))));
+      EXPECT_EQ(valueBuffer.toString(), "Data" + std::to_string(keyIdx));
+    }
+    EXPECT_OUTCOME_TRUE(lastValueBuffer, joinReplica->GetKey(HierarchicalKey("LastKey")));
+    EXPECT_EQ(lastValueBuffer.toString(), "LastData");
+
+    joinReplica = nullptr;
+    compactingReplica = nullptr;
+    sourceReplica = nullptr;
+  }
+}
@@ -131,4 +131,67 @@ namespace sgns::crdt
     EXPECT_TRUE(maxHeight == height1);
 
   }
-}
\ No newline at end of file
+
+  /**
+   * @given Heads set of 10k heads
+   * @when Heads are looked up, the highest head is replaced by a lower one and the set is reloaded
+   * @then Every head has its height, the maximum height is recalculated
+   * and the reloaded set lists the same heads
+   */
+  TEST(CrdtHeadsTest, TestManyHeads)
+  {
+    const std::string strNamespace = "/namespace";
+    const auto hKey = HierarchicalKey(strNamespace);
+    const uint32_t headCount = 10000;
+
+    auto createCid = [](uint32_t index)
+    {
+      std::vector<uint8_t> digest(32, 0);
+      for (size_t byteIdx = 0; byteIdx < sizeof(index); ++byteIdx)
+      {
+        digest[byteIdx] = static_cast<uint8_t>(index >> (8 * byteIdx));
+      }
+      return CID(CID::Version::V1, CID::Multicodec::SHA2_256, Multihash::create(HashType::sha256, digest).value());
+    };
+
+    std::string databasePath = "supergenius_crdt_heads_test_many_heads";
+    fs::remove_all(databasePath);
+
+    rocksdb::Options options;
+    options.create_if_missing = true;  // intentionally
+    auto dataStore = rocksdb::create(databasePath, options).value();
+
+    CrdtHeads crdtHeads(dataStore, hKey);
+    std::vector<CID> cids;
+    for (uint32_t headIdx = 0; headIdx < headCount; ++headIdx)
+    {
+      cids.push_back(createCid(headIdx));
+      EXPECT_OUTCOME_TRUE_1(crdtHeads.Add(cids.back(), headIdx));
+    }
+
+    for (uint32_t headIdx = 0; headIdx < headCount; ++headIdx)
+    {
+      EXPECT_OUTCOME_EQ(crdtHeads.IsHead(cids[headIdx]), true);
+      EXPECT_OUTCOME_EQ(crdtHeads.GetHeadHeight(cids[headIdx]), headIdx);
+    }
+    EXPECT_OUTCOME_EQ(crdtHeads.IsHead(createCid(headCount)), false);
+
+    // The highest head is replaced by a lower one, so the maximum height is recalculated
+    EXPECT_OUTCOME_TRUE_1(crdtHeads.Replace(cids.back(), createCid(headCount), 0));
+    EXPECT_OUTCOME_EQ(crdtHeads.IsHead(cids.back()), false);
+    std::vector<CID> heads;
+    uint64_t maxHeight = 0;
+    EXPECT_OUTCOME_TRUE_1(crdtHeads.GetList(heads, maxHeight));
+    EXPECT_EQ(heads.size(), headCount);
+    EXPECT_EQ(maxHeight, headCount - 2);
+
+    // The cached set matches the stored one
+    CrdtHeads reloadedHeads(dataStore, hKey);
+    std::vector<CID> reloadedList;
+    uint64_t reloadedMaxHeight = 0;
+    EXPECT_OUTCOME_TRUE_1(reloadedHeads.GetList(reloadedList, reloadedMaxHeight));
+    EXPECT_EQ(reloadedList.size(), headCount);
+    EXPECT_EQ(reloadedMaxHeight, maxHeight);
+    EXPECT_OUTCOME_EQ(reloadedHeads.GetHeadHeight(createCid(headCount)), 0);
+  }
+}
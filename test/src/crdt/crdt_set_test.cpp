@@ -4,6 +4,9 @@
 #include <outcome/outcome.hpp>
 #include <testutil/outcome.hpp>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <map>
+#include <tuple>
 
 
 namespace sgns::crdt
@@ -266,4 +269,268 @@ namespace sgns::crdt
     }
 
   }
-}
\ No newline at end of file
+
+  /**
+   * @given CRDT set with nested keys and a tombstoned key
+   * @when Elements are queried by prefix with and without offset and limit
+   * @then Only keys that are not tombstoned are returned in the key order
+   */
+  TEST(CrdtSetTest, TestQueryElements)
+  {
+    const std::string strNamespace = "/namespace";
+    const uint64_t priority = 11;
+
+    // Remove leftover database 
+    std::string databasePath = "supergenius_crdt_set_test_query";
+    fs::remove_all(databasePath);
+
+    // Create new database
+    rocksdb::Options options;
+    options.create_if_missing = true;  // intentionally
+    auto dataStoreResult = rocksdb::create(databasePath, options);
+    auto dataStore = dataStoreResult.value();
+
+    // Create CrdtSet 
+    auto crdtSet = CrdtSet(dataStore, HierarchicalKey(strNamespace));
+
+    std::vector<CrdtSet::Element> elements;
+    for (const auto& key : { "a", "a/b", "c", "d" })
+    {
+      CrdtSet::Element element;
+      element.set_key(key);
+      element.set_value(std::string("value_") + key);
+      elements.push_back(element);
+    }
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutElems(elements, "ID123", priority));
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutTombs({ elements[2] }));
+
+    EXPECT_OUTCOME_TRUE(queryResult, crdtSet.QueryElements("", CrdtSet::QuerySuffix::QUERY_VALUESUFFIX));
+    std::vector<std::string> values;
+    for (const auto& [key, value] : queryResult)
+    {
+      values.push_back(std::string(value.toString()));
+    }
+    EXPECT_EQ(values, std::vector<std::string>({ "value_a/b", "value_a", "value_d" }));
+
+    EXPECT_OUTCOME_TRUE(prefixQueryResult, crdtSet.QueryElements("a", CrdtSet::QuerySuffix::QUERY_VALUESUFFIX));
+    EXPECT_EQ(prefixQueryResult.size(), 2);
+
+    values.clear();
+    auto collectValues = [&values](const Buffer& key, const Buffer& value)
+    {
+      values.push_back(std::string(value.toString()));
+      return true;
+    };
+    EXPECT_OUTCOME_TRUE_1(crdtSet.QueryElements("", CrdtSet::QuerySuffix::QUERY_VALUESUFFIX, collectValues, 1, 1));
+    EXPECT_EQ(values, std::vector<std::string>({ "value_a" }));
+
+    // The query is stopped by the callback
+    size_t callbackCount = 0;
+    EXPECT_OUTCOME_TRUE_1(crdtSet.QueryElements("", CrdtSet::QuerySuffix::QUERY_ALL,
+      [&callbackCount](const Buffer& key, const Buffer& value)
+      {
+        ++callbackCount;
+        return false;
+      }));
+    EXPECT_EQ(callbackCount, 1);
+  }
+
+  /**
+   * @given Deltas that update and remove a set of keys with repeated priorities
+   * @when The deltas are merged one by one and in groups with one write batch
+   * @then Both sets have the same values and hook calls
+   */
+  TEST(CrdtSetTest, TestMergeDeltas)
+  {
+    constexpr size_t deltaCount = 5000;
+    constexpr size_t keyCount = 100;
+    constexpr size_t groupSize = 64;
+
+    std::vector<std::pair<std::shared_ptr<CrdtSet::Delta>, std::string>> deltas;
+    for (size_t deltaIdx = 0; deltaIdx < deltaCount; ++deltaIdx)
+    {
+      auto delta = std::make_shared<CrdtSet::Delta>();
+      delta->set_priority(deltaIdx / 200 + 1);
+      auto element = delta->add_elements();
+      element->set_key("key" + std::to_string(deltaIdx % keyCount));
+      element->set_value("value" + std::to_string(deltaIdx));
+      if (deltaIdx % 50 == 0 && deltaIdx >= keyCount)
+      {
+        auto tombstone = delta->add_tombstones();
+        tombstone->set_key("key" + std::to_string((deltaIdx + 1) % keyCount));
+        tombstone->set_id("ID" + std::to_string(deltaIdx + 1 - keyCount));
+      }
+      deltas.emplace_back(delta, "ID" + std::to_string(deltaIdx));
+    }
+
+    // Returns values of the set and hook calls
+    auto mergeDeltas = [&deltas](const std::string& databasePath, size_t mergeGroupSize)
+    {
+      fs::remove_all(databasePath);
+      rocksdb::Options options;
+      options.create_if_missing = true;  // intentionally
+      auto dataStore = rocksdb::create(databasePath, options).value();
+
+      std::vector<std::string> hookCalls;
+      auto crdtSet = CrdtSet(dataStore, HierarchicalKey("/namespace"),
+        [&hookCalls](const std::string& k, const Buffer& v) { hookCalls.push_back(k + "=" + std::string(v.toString())); },
+        [&hookCalls](const std::string& k) { hookCalls.push_back(k); });
+
+      for (size_t deltaIdx = 0; deltaIdx < deltas.size(); deltaIdx += mergeGroupSize)
+      {
+        if (mergeGroupSize == 1)
+        {
+          EXPECT_OUTCOME_TRUE_1(crdtSet.Merge(deltas[deltaIdx].first, deltas[deltaIdx].second));
+          continue;
+        }
+        std::vector<std::pair<std::shared_ptr<CrdtSet::Delta>, std::string>> group(deltas.begin() + deltaIdx,
+          deltas.begin() + std::min(deltaIdx + mergeGroupSize, deltas.size()));
+        EXPECT_OUTCOME_TRUE_1(crdtSet.MergeDeltas(group));
+      }
+
+      std::vector<std::string> values;
+      EXPECT_OUTCOME_TRUE(queryResult, crdtSet.QueryElements("", CrdtSet::QuerySuffix::QUERY_VALUESUFFIX));
+      for (const auto& [key, value] : queryResult)
+      {
+        values.push_back(std::string(key.toString()) + "=" + std::string(value.toString()));
+      }
+      return std::make_tuple(values, hookCalls);
+    };
+
+    auto [singleValues, singleHookCalls] = mergeDeltas("supergenius_crdt_set_test_merge_single", 1);
+    auto [groupValues, groupHookCalls] = mergeDeltas("supergenius_crdt_set_test_merge_group", groupSize);
+
+    EXPECT_EQ(groupValues.size(), keyCount);
+    EXPECT_EQ(groupValues, singleValues);
+    EXPECT_EQ(groupHookCalls, singleHookCalls);
+  }
+
+  /**
+   * @given CRDT set with the key filter and a value cache of two values
+   * @when Missing, cached and updated keys are read
+   * @then Missing keys are answered by the filter, repeated reads by the cache
+   * and updated or removed keys are read from the datastore
+   */
+  TEST(CrdtSetTest, TestCache)
+  {
+    std::string databasePath = "supergenius_crdt_set_test_cache";
+    fs::remove_all(databasePath);
+    rocksdb::Options options;
+    options.create_if_missing = true;  // intentionally
+    auto dataStore = rocksdb::create(databasePath, options).value();
+
+    auto crdtSet = CrdtSet(dataStore, HierarchicalKey("/namespace"));
+    std::vector<CrdtSet::Element> elements;
+    for (const auto& key : { "k1", "k2", "k3" })
+    {
+      CrdtSet::Element element;
+      element.set_key(key);
+      element.set_value(std::string("value_") + key);
+      elements.push_back(element);
+    }
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutElems(elements, "ID1", 1));
+
+    // Keys stored before the cache is enabled are added to the filter
+    EXPECT_OUTCOME_TRUE_1(crdtSet.EnableCache(1 << 16, 2));
+    EXPECT_FALSE(crdtSet.GetElement("missing").has_value());
+    EXPECT_OUTCOME_EQ(crdtSet.IsValueInSet("missing"), false);
+    for (size_t readIdx = 0; readIdx < 2; ++readIdx)
+    {
+      EXPECT_OUTCOME_TRUE(value1, crdtSet.GetElement("k1"));
+      EXPECT_EQ(value1.toString(), "value_k1");
+      EXPECT_OUTCOME_TRUE(value2, crdtSet.GetElement("k2"));
+      EXPECT_EQ(value2.toString(), "value_k2");
+    }
+    auto statistics = crdtSet.GetCacheStatistics();
+    EXPECT_EQ(statistics.lookupCount, 6);
+    EXPECT_EQ(statistics.filterNegativeCount, 2);
+    EXPECT_EQ(statistics.cacheHitCount, 2);
+
+    // The least recently used value is evicted
+    EXPECT_OUTCOME_TRUE_1(crdtSet.GetElement("k3"));
+    EXPECT_OUTCOME_TRUE_1(crdtSet.GetElement("k1"));
+    EXPECT_EQ(crdtSet.GetCacheStatistics().cacheHitCount, 2);
+
+    // Updated and removed keys are not answered from the cache
+    std::vector<CrdtSet::Element> updatedElements = { elements[0] };
+    updatedElements[0].set_value("value_k1_updated");
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutElems(updatedElements, "ID2", 2));
+    EXPECT_OUTCOME_TRUE(updatedValue, crdtSet.GetElement("k1"));
+    EXPECT_EQ(updatedValue.toString(), "value_k1_updated");
+
+    EXPECT_OUTCOME_TRUE_1(crdtSet.GetElement("k3"));
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutTombs({ elements[2] }));
+    EXPECT_FALSE(crdtSet.GetElement("k3").has_value());
+    EXPECT_OUTCOME_EQ(crdtSet.IsValueInSet("k3"), false);
+
+    statistics = crdtSet.GetCacheStatistics();
+    EXPECT_EQ(statistics.lookupCount, 12);
+    EXPECT_EQ(statistics.cacheHitCount, 3);
+    EXPECT_DOUBLE_EQ(statistics.GetHitRate(), 5.0 / 12);
+  }
+
+  /**
+   * @given CRDT set where a key was updated with different priorities and another key was removed
+   * @when A snapshot delta is created and merged into an empty set
+   * @then Snapshot elements keep their IDs and get the value and priority of their key,
+   * and the new set has the same values and creates the same snapshot
+   */
+  TEST(CrdtSetTest, TestSnapshotDelta)
+  {
+    auto createSet = [](const std::string& databasePath)
+    {
+      fs::remove_all(databasePath);
+      rocksdb::Options options;
+      options.create_if_missing = true;  // intentionally
+      return CrdtSet(rocksdb::create(databasePath, options).value(), HierarchicalKey("/namespace"));
+    };
+
+    // Values and priorities by element key and ID
+    using SnapshotElements = std::map<std::pair<std::string, std::string>, std::pair<std::string, uint64_t>>;
+    auto getSnapshotElements = [](CrdtSet& crdtSet)
+    {
+      SnapshotElements snapshotElements;
+      auto snapshotResult = crdtSet.CreateSnapshotDelta();
+      EXPECT_FALSE(snapshotResult.has_failure());
+      if (!snapshotResult.has_failure())
+      {
+        EXPECT_TRUE(snapshotResult.value()->snapshot());
+        for (const auto& elem : snapshotResult.value()->elements())
+        {
+          snapshotElements[{ elem.key(), elem.id() }] = { elem.value(), elem.priority() };
+        }
+      }
+      return snapshotElements;
+    };
+
+    auto crdtSet = createSet("supergenius_crdt_set_test_snapshot_0");
+    std::vector<CrdtSet::Element> elements(1);
+    elements[0].set_key("k1");
+    elements[0].set_value("v1");
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutElems(elements, "ID1", 1));
+
+    elements.resize(2);
+    elements[0].set_value("v2");
+    elements[1].set_key("k2");
+    elements[1].set_value("w2");
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutElems(elements, "ID2", 2));
+    EXPECT_OUTCOME_TRUE_1(crdtSet.PutTombs({ elements[1] }));
+
+    SnapshotElements expectedElements;
+    expectedElements[{ "k1", "ID1" }] = { "v2", 2 };
+    expectedElements[{ "k1", "ID2" }] = { "v2", 2 };
+    EXPECT_EQ(getSnapshotElements(crdtSet), expectedElements);
+
+    EXPECT_OUTCOME_TRUE(snapshot, crdtSet.CreateSnapshotDelta());
+    ASSERT_EQ(snapshot->tombstones_size(), 1);
+    EXPECT_EQ(snapshot->tombstones(0).key(), "k2");
+    EXPECT_EQ(snapshot->tombstones(0).id(), "ID2");
+
+    auto joinedSet = createSet("supergenius_crdt_set_test_snapshot_1");
+    EXPECT_OUTCOME_TRUE_1(joinedSet.Merge(snapshot, "SNAPSHOT"));
+    EXPECT_OUTCOME_TRUE(value, joinedSet.GetElement("k1"));
+    EXPECT_EQ(value.toString(), "v2");
+    EXPECT_OUTCOME_EQ(joinedSet.IsValueInSet("k2"), false);
+    EXPECT_EQ(getSnapshotElements(joinedSet), expectedElements);
+  }
+}
@@ -0,0 +1,139 @@
+#include <crdt/globaldb/key_change_feed.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/format.hpp>
+
+namespace sgns::crdt
+{
+  using sgns::base::Buffer;
+
+  namespace
+  {
+    /** Runs handlers posted to the context until there are no more of them */
+    void RunPendingHandlers(boost::asio::io_context& context)
+    {
+      context.restart();
+      context.run();
+    }
+  }
+
+  /**
+   * @given Key change feed with subscriptions to different prefixes
+   * @when Keys are put and removed
+   * @then Each subscription receives changes of matching keys only in the change order
+   */
+  TEST(KeyChangeFeedTest, TestPrefixWatch)
+  {
+    auto context = std::make_shared<boost::asio::io_context>();
+    auto feed = std::make_shared<KeyChangeFeed>(context);
+
+    std::vector<KeyChangeFeed::KeyChange> taskChanges;
+    std::vector<KeyChangeFeed::KeyChange> allChanges;
+    feed->Watch("tasks", [&taskChanges](const std::vector<KeyChangeFeed::KeyChange>& changes, bool isTruncated)
+      {
+        EXPECT_FALSE(isTruncated);
+        taskChanges.insert(taskChanges.end(), changes.begin(), changes.end());
+      });
+    auto allWatchId = feed->Watch("", [&allChanges](const std::vector<KeyChangeFeed::KeyChange>& changes, bool)
+      {
+        allChanges.insert(allChanges.end(), changes.begin(), changes.end());
+      });
+
+    Buffer value;
+    value.put("value");
+    feed->OnKeyChanged("/tasks/1", &value);
+    feed->OnKeyChanged("/results/1", &value);
+    feed->OnKeyChanged("/tasks/1", nullptr);
+    RunPendingHandlers(*context);
+
+    ASSERT_EQ(taskChanges.size(), 2);
+    EXPECT_EQ(taskChanges[0].key, "/tasks/1");
+    EXPECT_FALSE(taskChanges[0].isRemoved);
+    EXPECT_EQ(taskChanges[0].value, value);
+    EXPECT_TRUE(taskChanges[1].isRemoved);
+    EXPECT_LT(taskChanges[0].resumeToken, taskChanges[1].resumeToken);
+    EXPECT_EQ(allChanges.size(), 3);
+
+    // Unwatched subscription doesn't receive changes
+    feed->Unwatch(allWatchId);
+    feed->OnKeyChanged("/tasks/2", &value);
+    RunPendingHandlers(*context);
+    EXPECT_EQ(taskChanges.size(), 3);
+    EXPECT_EQ(allChanges.size(), 3);
+  }
+
+  /**
+   * @given Subscription with a limited number of pending changes
+   * @when More changes are made than the subscription can hold before delivery
+   * @then The latest changes are delivered in a batch marked as truncated
+   */
+  TEST(KeyChangeFeedTest, TestTruncatedDelivery)
+  {
+    auto context = std::make_shared<boost::asio::io_context>();
+    auto feed = std::make_shared<KeyChangeFeed>(context);
+
+    std::vector<KeyChangeFeed::KeyChange> receivedChanges;
+    bool isReceivedTruncated = false;
+    feed->Watch("", [&](const std::vector<KeyChangeFeed::KeyChange>& changes, bool isTruncated)
+      {
+        receivedChanges.insert(receivedChanges.end(), changes.begin(), changes.end());
+        isReceivedTruncated = isReceivedTruncated || isTruncated;
+      }, 0, 3);
+
+    Buffer value;
+    for (size_t keyIdx = 0; keyIdx < 10; ++keyIdx)
+    {
+      feed->OnKeyChanged((boost::format("/key/%d") % keyIdx).str(), &value);
+    }
+    RunPendingHandlers(*context);
+
+    EXPECT_TRUE(isReceivedTruncated);
+    ASSERT_EQ(receivedChanges.size(), 3);
+    EXPECT_EQ(receivedChanges[0].key, "/key/7");
+    EXPECT_EQ(receivedChanges[2].key, "/key/9");
+  }
+
+  /**
+   * @given Key change feed with journaled changes
+   * @when A subscription is resumed after a known change or from a token older than the journal
+   * @then Journaled changes after the token are replayed, a too old token marks the delivery truncated
+   */
+  TEST(KeyChangeFeedTest, TestResumeWatch)
+  {
+    auto context = std::make_shared<boost::asio::io_context>();
+    auto feed = std::make_shared<KeyChangeFeed>(context, 5);
+
+    Buffer value;
+    for (size_t keyIdx = 0; keyIdx < 8; ++keyIdx)
+    {
+      feed->OnKeyChanged((boost::format("/key/%d") % keyIdx).str(), &value);
+    }
+    EXPECT_EQ(feed->GetLastResumeToken(), 8);
+
+    std::vector<uint64_t> resumedTokens;
+    bool isResumedTruncated = false;
+    feed->Watch("key", [&](const std::vector<KeyChangeFeed::KeyChange>& changes, bool isTruncated)
+      {
+        for (const auto& change : changes)
+        {
+          resumedTokens.push_back(change.resumeToken);
+        }
+        isResumedTruncated = isResumedTruncated || isTruncated;
+      }, 5);
+    RunPendingHandlers(*context);
+    EXPECT_FALSE(isResumedTruncated);
+    EXPECT_EQ(resumedTokens, std::vector<uint64_t>({ 6, 7, 8 }));
+
+    bool isOldTokenTruncated = false;
+    size_t oldTokenChangeCount = 0;
+    feed->Watch("key", [&](const std::vector<KeyChangeFeed::KeyChange>& changes, bool isTruncated)
+      {
+        oldTokenChangeCount += changes.size();
+        isOldTokenTruncated = isOldTokenTruncated || isTruncated;
+      }, 1);
+    RunPendingHandlers(*context);
+    EXPECT_TRUE(isOldTokenTruncated);
+    EXPECT_EQ(oldTokenChangeCount, 5);
+  }
+}
@@ -0,0 +1,69 @@
+#include <processing/processing_block_filter.hpp>
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+using namespace sgns::processing;
+
+/**
+ * @given A filter with added block ids
+ * @when The filter is serialized and restored from the message
+ * @then The restored filter contains the same block ids.
+ */
+TEST(ProcessingBlockFilterTest, MessageRoundTrip)
+{
+    ProcessingBlockFilter filter;
+    filter.Add("BLOCK_1");
+    filter.Add("BLOCK_2");
+
+    SGProcessing::BlockFilter message;
+    filter.ToMessage(message);
+
+    ProcessingBlockFilter receivedFilter(message);
+    EXPECT_EQ(filter, receivedFilter);
+    EXPECT_TRUE(receivedFilter.MayContain("BLOCK_1"));
+    EXPECT_TRUE(receivedFilter.MayContain("BLOCK_2"));
+}
+
+/**
+ * @given A received filter with a huge hash count
+ * @when The filter is created from the message
+ * @then The hash count is clamped and added block ids are still found.
+ */
+TEST(ProcessingBlockFilterTest, HashCountIsClamped)
+{
+    ProcessingBlockFilter filter(8192, ProcessingBlockFilter::MAX_HASH_COUNT);
+    filter.Add("BLOCK_1");
+
+    SGProcessing::BlockFilter message;
+    filter.ToMessage(message);
+    message.set_hash_count(std::numeric_limits<uint32_t>::max());
+
+    ProcessingBlockFilter receivedFilter(message);
+    EXPECT_EQ(filter, receivedFilter);
+    EXPECT_TRUE(receivedFilter.MayContain("BLOCK_1"));
+}
+
+/**
+ * @given Received filters without bits, without hashes, with all bits set and larger than the limit
+ * @when Filters are created from the messages
+ * @then The filters are rejected and match no block ids.
+ */
+TEST(ProcessingBlockFilterTest, InconsistentFiltersAreRejected)
+{
+    std::vector<SGProcessing::BlockFilter> messages(4);
+    messages[0].set_hash_count(4);
+    messages[1].set_bits(std::string(1024, '\x01'));
+    messages[2].set_bits(std::string(1024, '\xFF'));
+    messages[2].set_hash_count(4);
+    messages[3].set_bits(std::string(ProcessingBlockFilter::MAX_BYTE_COUNT + 1, '\x01'));
+    messages[3].set_hash_count(4);
+
+    for (auto& message : messages)
+    {
+        ProcessingBlockFilter receivedFilter(message);
+        EXPECT_TRUE(receivedFilter.IsEmpty());
+        EXPECT_FALSE(receivedFilter.MayContain("BLOCK_1"));
+    }
+}
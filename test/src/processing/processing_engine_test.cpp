@@ -1,5 +1,6 @@
 #include <processing/processing_engine.hpp>
 #include <processing/processing_subtask_queue_accessor.hpp>
+#include <processing/processing_thread_pool_executor.hpp>
 
 #include <gtest/gtest.h>
 
@@ -11,6 +12,7 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
+#include <atomic>
 #include <functional>
 
 using namespace sgns::processing;
@@ -54,11 +56,25 @@ namespace
             }
         }
 
+        void GrabSubTasks(size_t subTaskCount, SubTaskGrabbedCallback onSubTaskGrabbedCallback) override
+        {
+            m_context.post([this, subTaskCount, onSubTaskGrabbedCallback]() {
+                m_grabbedSubTaskBatchSizes.push_back(subTaskCount);
+                for (size_t subTaskIdx = 0; (subTaskIdx < subTaskCount) && !m_subTasks.empty(); ++subTaskIdx)
+                {
+                    onSubTaskGrabbedCallback(m_subTasks.front());
+                    m_subTasks.pop_front();
+                }
+            });
+        }
+
         void CompleteSubTask(const std::string& subTaskId, const SGProcessing::SubTaskResult& subTaskResult) override
         {
             // Do nothing
         }
 
+        std::vector<size_t> m_grabbedSubTaskBatchSizes;
+
     private:
         std::list<SGProcessing::SubTask> m_subTasks;
 
@@ -127,6 +143,78 @@ namespace
     private:
         size_t m_processingMillisec;
     };
+
+    class ConcurrencyTrackingProcessingCore : public ProcessingCore
+    {
+    public:
+        ConcurrencyTrackingProcessingCore(size_t processingMillisec)
+            : m_processingMillisec(processingMillisec)
+        {
+        }
+
+        void ProcessSubTask(
+            const SGProcessing::SubTask& subTask, SGProcessing::SubTaskResult& result,
+            uint32_t initialHashCode) override
+        {
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                ++m_activeCount;
+                m_maximalActiveCount = std::max(m_maximalActiveCount, m_activeCount);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(m_processingMillisec));
+
+            std::lock_guard<std::mutex> guard(m_mutex);
+            --m_activeCount;
+            ++m_processedCount;
+        }
+
+        size_t GetProcessedCount() const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            return m_processedCount;
+        }
+
+        size_t GetMaximalActiveCount() const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            return m_maximalActiveCount;
+        }
+
+    private:
+        size_t m_processingMillisec;
+        mutable std::mutex m_mutex;
+        size_t m_activeCount = 0;
+        size_t m_maximalActiveCount = 0;
+        size_t m_processedCount = 0;
+    };
+    class FailingProcessingCore : public ProcessingCore
+    {
+    public:
+        void ProcessSubTask(
+            const SGProcessing::SubTask& subTask, SGProcessing::SubTaskResult& result,
+            uint32_t initialHashCode) override
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_processedSubTaskIds.push_back(subTask.subtaskid());
+            if (m_processedSubTaskIds.size() <= m_failedSubTaskCount)
+            {
+                throw std::runtime_error("Subtask processing failed");
+            }
+        }
+
+        std::vector<std::string> GetProcessedSubTaskIds() const
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            return m_processedSubTaskIds;
+        }
+
+        size_t m_failedSubTaskCount = 0;
+
+    private:
+        mutable std::mutex m_mutex;
+        std::vector<std::string> m_processedSubTaskIds;
+    };
 }
 
 const std::string logger_config(R"(
@@ -255,3 +343,137 @@ TEST_F(ProcessingEngineTest, SharedSubTaskProcessing)
     EXPECT_EQ(static_cast<uint32_t>(std::hash<std::string>{}(nodeId1)), processingCore->m_initialHashes[0]);
     EXPECT_EQ(static_cast<uint32_t>(std::hash<std::string>{}(nodeId2)), processingCore->m_initialHashes[1]);
 }
+
+/**
+ * @given A queue containing 4 subtasks and an executor with 2 workers
+ * @when Processing is started with 2 in-flight subtasks allowed
+ * @then Subtasks are processed in parallel without exceeding the executor concurrency limit.
+ * No subtasks are being processed once the processing is stopped.
+ */
+TEST_F(ProcessingEngineTest, ParallelSubTaskProcessing)
+{
+    boost::asio::io_context context;
+
+    auto processingCore = std::make_shared<ConcurrencyTrackingProcessingCore>(300);
+    auto executor = std::make_shared<ProcessingThreadPoolExecutor>(2);
+
+    auto engine = std::make_shared<ProcessingEngine>("NODE_1", processingCore, executor);
+    engine->SetMaximalInFlightSubTaskCount(2);
+
+    auto subTaskQueueAccessor = std::make_shared<SubTaskQueueAccessorMock>(context);
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 4; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subTask;
+        subTask.set_subtaskid("SUBTASK_ID" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subTask));
+    }
+    subTaskQueueAccessor->AssignSubTasks(subTasks);
+
+    std::thread contextThread([&context]() { context.run(); });
+    engine->StartQueueProcessing(subTaskQueueAccessor);
+
+    // Sequential processing would take 1200ms
+    std::this_thread::sleep_for(std::chrono::milliseconds(900));
+    engine->StopQueueProcessing();
+
+    context.stop();
+    contextThread.join();
+
+    EXPECT_EQ(4, processingCore->GetProcessedCount());
+    EXPECT_EQ(2, processingCore->GetMaximalActiveCount());
+    EXPECT_EQ(0, engine->GetInFlightSubTaskCount());
+    EXPECT_EQ(0, executor->GetQueueDepth());
+    ASSERT_EQ(2, executor->GetWorkerStatistics().size());
+}
+
+/**
+ * @given A queue containing 3 subtasks
+ * @when Processing is started with 1 in-flight subtask and prefetch depth 2
+ * @then All subtasks are grabbed by a single request.
+ * Subtasks that wait for the processing slot are held by the engine and processed sequentially.
+ */
+TEST_F(ProcessingEngineTest, SubTaskPrefetching)
+{
+    boost::asio::io_context context;
+
+    auto processingCore = std::make_shared<ConcurrencyTrackingProcessingCore>(200);
+
+    auto engine = std::make_shared<ProcessingEngine>("NODE_1", processingCore);
+    engine->SetSubTaskPrefetchDepth(2);
+
+    auto subTaskQueueAccessor = std::make_shared<SubTaskQueueAccessorMock>(context);
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 3; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subTask;
+        subTask.set_subtaskid("SUBTASK_ID" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subTask));
+    }
+    subTaskQueueAccessor->AssignSubTasks(subTasks);
+
+    std::thread contextThread([&context]() { context.run(); });
+    engine->StartQueueProcessing(subTaskQueueAccessor);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(2, engine->GetPrefetchedSubTaskCount());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+    engine->StopQueueProcessing();
+
+    context.stop();
+    contextThread.join();
+
+    EXPECT_EQ(3, processingCore->GetProcessedCount());
+    EXPECT_EQ(1, processingCore->GetMaximalActiveCount());
+    EXPECT_EQ(0, engine->GetPrefetchedSubTaskCount());
+    ASSERT_LE(1, subTaskQueueAccessor->m_grabbedSubTaskBatchSizes.size());
+    EXPECT_EQ(3, subTaskQueueAccessor->m_grabbedSubTaskBatchSizes[0]);
+}
+
+/**
+ * @given A queue containing 4 subtasks and a processing core that fails the first 2 subtasks
+ * @when Processing is started with 1 in-flight subtask and no prefetching
+ * @then Processing errors are reported and processing slots of the failed subtasks are released.
+ * The remaining subtasks are grabbed and processed.
+ */
+TEST_F(ProcessingEngineTest, FailedSubTasksReleaseSlots)
+{
+    boost::asio::io_context context;
+
+    auto processingCore = std::make_shared<FailingProcessingCore>();
+    processingCore->m_failedSubTaskCount = 2;
+
+    auto engine = std::make_shared<ProcessingEngine>("NODE_1", processingCore);
+    std::atomic<size_t> errorCount = 0;
+    engine->SetProcessingErrorSink([&errorCount](const std::string&) { ++errorCount; });
+
+    auto subTaskQueueAccessor = std::make_shared<SubTaskQueueAccessorMock>(context);
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 4; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subTask;
+        subTask.set_subtaskid("SUBTASK_ID" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subTask));
+    }
+    subTaskQueueAccessor->AssignSubTasks(subTasks);
+
+    std::thread contextThread([&context]() { context.run(); });
+    engine->StartQueueProcessing(subTaskQueueAccessor);
+
+    auto startTime = std::chrono::steady_clock::now();
+    while ((processingCore->GetProcessedSubTaskIds().size() < 4)
+        && (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(5)))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    engine->StopQueueProcessing();
+
+    context.stop();
+    contextThread.join();
+
+    EXPECT_EQ(2, errorCount);
+    EXPECT_EQ(std::vector<std::string>({ "SUBTASK_ID1", "SUBTASK_ID2", "SUBTASK_ID3", "SUBTASK_ID4" }),
+        processingCore->GetProcessedSubTaskIds());
+    EXPECT_EQ(0, engine->GetInFlightSubTaskCount());
+}
@@ -1,12 +1,17 @@
 
 #include <processing/processing_service.hpp>
 #include <processing/processing_subtask_enqueuer_impl.hpp>
+#include <processing/processing_thread_pool_executor.hpp>
 
 #include <libp2p/log/configurator.hpp>
 #include <libp2p/log/logger.hpp>
 
 #include <gtest/gtest.h>
 
+#include <boost/format.hpp>
+#include <algorithm>
+#include <atomic>
+
 using namespace sgns::processing;
 
 namespace
@@ -19,6 +24,12 @@ public:
     {
         return std::nullopt;
     }
+    void SaveQueueCheckpoint(
+        const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint) override {}
+    std::optional<SGProcessing::SubTaskQueueCheckpoint> LoadQueueCheckpoint(const std::string& queueId) override
+    {
+        return std::nullopt;
+    }
 };
 
 class SubTaskResultStorageMock : public SubTaskResultStorage
@@ -58,11 +69,246 @@ public:
         return false;
     }
 
+    bool GetAvailableTasks(
+        size_t maxTaskCount,
+        std::list<std::pair<std::string, SGProcessing::Task>>& tasks) override
+    {
+        return false;
+    }
+
+    bool GrabTaskById(const std::string& taskKey, SGProcessing::Task& task) override
+    {
+        return false;
+    }
+
     bool CompleteTask(const std::string& taskKey, const SGProcessing::TaskResult& task) override
     {
         return false;
     }
 };
+
+/** Task queue that is shared by all services of a simulation
+*/
+class SharedTaskQueue : public ProcessingTaskQueue
+{
+public:
+    void EnqueueTask(
+        const SGProcessing::Task& task,
+        const std::list<SGProcessing::SubTask>& subTasks) override
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_tasks.push_back({ task, subTasks });
+    }
+
+    bool GetSubTasks(
+        const std::string& taskId,
+        std::list<SGProcessing::SubTask>& subTasks) override
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_grabbedSubTasks.find(taskId);
+        if (it == m_grabbedSubTasks.end())
+        {
+            return false;
+        }
+        subTasks = it->second;
+        return true;
+    }
+
+    bool GrabTask(std::string& taskKey, SGProcessing::Task& task) override
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_tasks.empty())
+        {
+            return false;
+        }
+        task = m_tasks.front().first;
+        taskKey = task.ipfs_block_id();
+        m_grabbedSubTasks[taskKey] = m_tasks.front().second;
+        m_tasks.pop_front();
+        return true;
+    }
+
+    bool GetAvailableTasks(
+        size_t maxTaskCount,
+        std::list<std::pair<std::string, SGProcessing::Task>>& tasks) override
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        for (auto it = m_tasks.begin(); (it != m_tasks.end()) && (tasks.size() < maxTaskCount); ++it)
+        {
+            tasks.emplace_back(it->first.ipfs_block_id(), it->first);
+        }
+        return !tasks.empty();
+    }
+
+    bool GrabTaskById(const std::string& taskKey, SGProcessing::Task& task) override
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = std::find_if(m_tasks.begin(), m_tasks.end(),
+            [&taskKey](const auto& queuedTask) { return queuedTask.first.ipfs_block_id() == taskKey; });
+        if (it == m_tasks.end())
+        {
+            return false;
+        }
+        task = it->first;
+        m_grabbedSubTasks[taskKey] = it->second;
+        m_tasks.erase(it);
+        return true;
+    }
+
+    bool CompleteTask(const std::string& taskKey, const SGProcessing::TaskResult& task) override
+    {
+        return true;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::list<std::pair<SGProcessing::Task, std::list<SGProcessing::SubTask>>> m_tasks;
+    std::map<std::string, std::list<SGProcessing::SubTask>> m_grabbedSubTasks;
+};
+
+/** Processing core that simulates a fixed subtask processing time
+* and counts unique processed subtasks
+*/
+class SleepingProcessingCore : public ProcessingCore
+{
+public:
+    SleepingProcessingCore(size_t processingMillisec)
+        : m_processingMillisec(processingMillisec)
+    {
+    }
+
+    void ProcessSubTask(
+        const SGProcessing::SubTask& subTask, SGProcessing::SubTaskResult& result,
+        uint32_t initialHashCode) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_processingMillisec));
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_processedSubTaskIds.insert(subTask.subtaskid());
+    }
+
+    size_t GetProcessedSubTaskCount()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_processedSubTaskIds.size();
+    }
+
+private:
+    size_t m_processingMillisec;
+    std::mutex m_mutex;
+    std::set<std::string> m_processedSubTaskIds;
+};
+
+/** Subtask enqueuer that counts subtask queues created by a service
+*/
+class CountingSubTaskEnqueuer : public SubTaskEnqueuer
+{
+public:
+    CountingSubTaskEnqueuer(std::shared_ptr<SubTaskEnqueuer> enqueuer)
+        : m_enqueuer(std::move(enqueuer))
+        , m_enqueuedQueueCount(0)
+    {
+    }
+
+    bool EnqueueSubTasks(
+        std::string& subTaskQueueId,
+        std::list<SGProcessing::SubTask>& subTasks) override
+    {
+        if (!m_enqueuer->EnqueueSubTasks(subTaskQueueId, subTasks))
+        {
+            return false;
+        }
+        ++m_enqueuedQueueCount;
+        return true;
+    }
+
+    size_t GetEnqueuedQueueCount() const
+    {
+        return m_enqueuedQueueCount;
+    }
+
+private:
+    std::shared_ptr<SubTaskEnqueuer> m_enqueuer;
+    std::atomic<size_t> m_enqueuedQueueCount;
+};
+
+/** Runs tasks on 2 services with 4 and 1 executor workers
+* @param loadReportInterval - load report interval, zero disables load-aware routing
+* @return numbers of subtask queues created by the services
+*/
+std::vector<size_t> ProcessTasks(boost::posix_time::time_duration loadReportInterval)
+{
+    const size_t taskCount = 8;
+    const size_t subTaskCount = 4;
+
+    auto taskQueue = std::make_shared<SharedTaskQueue>();
+    for (size_t taskIdx = 0; taskIdx < taskCount; ++taskIdx)
+    {
+        SGProcessing::Task task;
+        task.set_ipfs_block_id((boost::format("TASK_%1%") % taskIdx).str());
+        std::list<SGProcessing::SubTask> subTasks;
+        for (size_t subTaskIdx = 0; subTaskIdx < subTaskCount; ++subTaskIdx)
+        {
+            SGProcessing::SubTask subTask;
+            subTask.set_subtaskid((boost::format("TASK_%1%_SUBTASK_%2%") % taskIdx % subTaskIdx).str());
+            subTasks.push_back(std::move(subTask));
+        }
+        taskQueue->EnqueueTask(task, subTasks);
+    }
+    auto enqueuer = std::make_shared<SubTaskEnqueuerImpl>(taskQueue);
+    auto processingCore = std::make_shared<SleepingProcessingCore>(100);
+
+    auto pubs1 = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();
+    pubs1->Start(40001, {});
+    auto pubs2 = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();
+    pubs2->Start(40001, { pubs1->GetLocalAddress() });
+
+    std::vector<std::unique_ptr<ProcessingServiceImpl>> services;
+    std::vector<std::shared_ptr<CountingSubTaskEnqueuer>> serviceEnqueuers;
+    // A fast host with 4 workers and a slow host with a single worker
+    for (auto [pubs, workerCount] : { std::make_pair(pubs1, 4), std::make_pair(pubs2, 1) })
+    {
+        serviceEnqueuers.push_back(std::make_shared<CountingSubTaskEnqueuer>(enqueuer));
+        auto service = std::make_unique<ProcessingServiceImpl>(
+            pubs,
+            4,
+            serviceEnqueuers.back(),
+            std::make_shared<SubTaskStateStorageMock>(),
+            std::make_shared<SubTaskResultStorageMock>(),
+            processingCore,
+            std::make_shared<ProcessingThreadPoolExecutor>(workerCount));
+        service->SetChannelListRequestTimeout(boost::posix_time::milliseconds(200));
+        service->SetLoadReportInterval(loadReportInterval);
+        services.push_back(std::move(service));
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (auto& service : services)
+    {
+        service->StartProcessing("GRID_CHANNEL_ID");
+    }
+
+    while ((processingCore->GetProcessedSubTaskCount() < taskCount * subTaskCount)
+        && (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(30)))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    pubs1->Stop();
+    pubs2->Stop();
+    for (auto& service : services)
+    {
+        service->StopProcessing();
+    }
+
+    EXPECT_EQ(processingCore->GetProcessedSubTaskCount(), taskCount * subTaskCount);
+
+    std::vector<size_t> enqueuedQueueCounts;
+    for (auto& serviceEnqueuer : serviceEnqueuers)
+    {
+        enqueuedQueueCounts.push_back(serviceEnqueuer->GetEnqueuedQueueCount());
+    }
+    return enqueuedQueueCounts;
+}
 }
 
 const std::string logger_config(R"(
@@ -179,3 +425,17 @@ TEST_F(ProcessingServiceTest, DISABLED_NoProcessingSlotsAvailable)
 
     EXPECT_EQ(processingService.GetProcessingNodesCount(), 0);
 }
+
+/**
+ * @given 2 services with 4 and 1 executor workers sharing a task queue
+ * @when Tasks are processed with load reports
+ * @then All subtasks are processed and the loaded single worker service hosts fewer task queues.
+ */
+TEST_F(ProcessingServiceTest, LoadAwareTaskRouting)
+{
+    auto enqueuedQueueCounts = ProcessTasks(boost::posix_time::milliseconds(100));
+
+    ASSERT_EQ(enqueuedQueueCounts.size(), 2);
+    EXPECT_EQ(enqueuedQueueCounts[0] + enqueuedQueueCounts[1], 8);
+    EXPECT_LT(enqueuedQueueCounts[1], enqueuedQueueCounts[0]);
+}
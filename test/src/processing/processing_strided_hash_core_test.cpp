@@ -0,0 +1,203 @@
+#include <processing/processing_strided_hash_core.hpp>
+
+#include <libp2p/log/configurator.hpp>
+#include <libp2p/log/logger.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <random>
+
+using namespace sgns::processing;
+
+namespace
+{
+    namespace fs = boost::filesystem;
+
+    std::vector<uint8_t> CreateBlockData(size_t dataSize)
+    {
+        std::mt19937 generator(42);
+        std::vector<uint8_t> data(dataSize);
+        for (auto& value : data)
+        {
+            value = static_cast<uint8_t>(generator());
+        }
+        return data;
+    }
+
+    SGProcessing::ProcessingChunk CreateChunk(
+        uint32_t offset, uint32_t width, uint32_t height, uint32_t lineStride, uint32_t stride, uint32_t subChunkCount)
+    {
+        SGProcessing::ProcessingChunk chunk;
+        chunk.set_chunkid("CHUNK_" + std::to_string(offset));
+        chunk.set_offset(offset);
+        chunk.set_subchunk_width(width);
+        chunk.set_subchunk_height(height);
+        chunk.set_line_stride(lineStride);
+        chunk.set_stride(stride);
+        chunk.set_n_subchunks(subChunkCount);
+        return chunk;
+    }
+
+    /** Copies strided chunk lines to a contiguous buffer
+    */
+    std::vector<uint8_t> GatherChunkData(const std::vector<uint8_t>& data, const SGProcessing::ProcessingChunk& chunk)
+    {
+        std::vector<uint8_t> chunkData;
+        for (size_t subChunkIdx = 0; subChunkIdx < chunk.n_subchunks(); ++subChunkIdx)
+        {
+            for (size_t lineIdx = 0; lineIdx < chunk.subchunk_height(); ++lineIdx)
+            {
+                auto line = data.begin() + chunk.offset() + subChunkIdx * chunk.stride() + lineIdx * chunk.line_stride();
+                chunkData.insert(chunkData.end(), line, line + chunk.subchunk_width());
+            }
+        }
+        return chunkData;
+    }
+}
+
+const std::string logger_config(R"(
+# ----------------
+sinks:
+  - name: console
+    type: console
+    color: true
+groups:
+  - name: processing_strided_hash_core_test
+    sink: console
+    level: info
+    children:
+      - name: libp2p
+      - name: Gossip
+# ----------------
+  )");
+
+class ProcessingStridedHashCoreTest : public ::testing::Test
+{
+public:
+    virtual void SetUp() override
+    {
+        // prepare log system
+        auto logging_system = std::make_shared<soralog::LoggingSystem>(
+            std::make_shared<soralog::ConfiguratorFromYAML>(
+                // Original LibP2P logging config
+                std::make_shared<libp2p::log::Configurator>(),
+                // Additional logging config for application
+                logger_config));
+        logging_system->configure();
+
+        libp2p::log::setLoggingSystem(logging_system);
+        libp2p::log::setLevelOfGroup("processing_strided_hash_core_test", soralog::Level::DEBUG);
+    }
+};
+
+/**
+ * @given A block data and a strided chunk
+ * @when The chunk hash is calculated for the strided layout and for a contiguous copy of the chunk lines
+ * @then Hashes are equal, i.e. the hash depends on the chunk content and shape only.
+ * A modified chunk byte or a different chunk shape changes the hash.
+ */
+TEST_F(ProcessingStridedHashCoreTest, ChunkHashDependsOnContent)
+{
+    auto data = CreateBlockData(64 * 1024);
+
+    // 3 tiles of 7 lines of 45 bytes, a line width is not a multiple of the kernel block size
+    auto chunk = CreateChunk(100, 45, 7, 256, 4096, 3);
+    auto chunkData = GatherChunkData(data, chunk);
+    auto contiguousChunk = CreateChunk(0, 45, 7, 45, 45 * 7, 3);
+
+    auto chunkHash = ProcessingStridedHashCore::HashChunk(data.data(), data.size(), chunk);
+    EXPECT_EQ(chunkHash, ProcessingStridedHashCore::HashChunk(chunkData.data(), chunkData.size(), contiguousChunk));
+
+    // The last byte of the last line
+    data[100 + 2 * 4096 + 6 * 256 + 44] ^= 1;
+    EXPECT_NE(chunkHash, ProcessingStridedHashCore::HashChunk(data.data(), data.size(), chunk));
+
+    auto reshapedChunk = CreateChunk(0, 45 * 7, 1, 45 * 7, 45 * 7, 3);
+    EXPECT_NE(chunkHash, ProcessingStridedHashCore::HashChunk(chunkData.data(), chunkData.size(), reshapedChunk));
+}
+
+/**
+ * @given A fixed block data and fixed chunk layouts with full blocks and zero-padded line tails
+ * @when Chunk hashes are calculated by the kernel selected for the build
+ * @then Hashes are equal to the known answers, so every kernel produces the same hashes.
+ * The test is built with the default, the AVX2 and the forced scalar kernels.
+ */
+TEST_F(ProcessingStridedHashCoreTest, KernelKnownAnswer)
+{
+#if defined(SGNS_PROCESSING_TEST_HASH_KERNEL)
+    EXPECT_STREQ(SGNS_PROCESSING_TEST_HASH_KERNEL, ProcessingStridedHashCore::GetKernelName());
+#endif
+
+    std::vector<uint8_t> data(16 * 1024);
+    for (size_t byteIdx = 0; byteIdx < data.size(); ++byteIdx)
+    {
+        data[byteIdx] = static_cast<uint8_t>(byteIdx * 131 + (byteIdx >> 8) * 7);
+    }
+
+    EXPECT_EQ(0x0679FD85u,
+        ProcessingStridedHashCore::HashChunk(data.data(), data.size(), CreateChunk(100, 45, 7, 256, 4096, 3)));
+    EXPECT_EQ(0x99CEF965u,
+        ProcessingStridedHashCore::HashChunk(data.data(), data.size(), CreateChunk(0, 64, 4, 128, 1024, 2)));
+    EXPECT_EQ(0x69A7F33Eu,
+        ProcessingStridedHashCore::HashChunk(data.data(), data.size(), CreateChunk(3, 5, 2, 11, 40, 1)));
+}
+
+/**
+ * @given A block data
+ * @when A chunk exceeds the block data
+ * @then An exception is thrown.
+ */
+TEST_F(ProcessingStridedHashCoreTest, ChunkOutOfBlock)
+{
+    auto data = CreateBlockData(4096);
+
+    EXPECT_NO_THROW(ProcessingStridedHashCore::HashChunk(data.data(), data.size(), CreateChunk(0, 64, 4, 1024, 64, 16)));
+    EXPECT_THROW(
+        ProcessingStridedHashCore::HashChunk(data.data(), data.size(), CreateChunk(0, 64, 4, 1024, 64, 17)),
+        std::runtime_error);
+    EXPECT_THROW(
+        ProcessingStridedHashCore::HashChunk(data.data(), data.size(), CreateChunk(4000, 97, 1, 97, 97, 1)),
+        std::runtime_error);
+}
+
+/**
+ * @given A block file and a subtask with chunks
+ * @when The subtask is processed
+ * @then The block file is mapped and chunk hashes match hashes calculated over the block data.
+ */
+TEST_F(ProcessingStridedHashCoreTest, ProcessSubTask)
+{
+    auto blockDirectory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(blockDirectory);
+
+    auto data = CreateBlockData(16 * 1024);
+    {
+        std::ofstream blockFile((blockDirectory / "BLOCK_1").string(), std::ios::binary);
+        blockFile.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    SGProcessing::SubTask subTask;
+    subTask.set_ipfsblock("BLOCK_1");
+    *subTask.add_chunkstoprocess() = CreateChunk(0, 64, 64, 128, 64, 2);
+    *subTask.add_chunkstoprocess() = CreateChunk(8192, 8192, 1, 8192, 8192, 1);
+
+    ProcessingStridedHashCore processingCore(blockDirectory.string());
+    SGProcessing::SubTaskResult result;
+    processingCore.ProcessSubTask(subTask, result, 0);
+
+    ASSERT_EQ(2, result.chunk_hashes_size());
+    for (int chunkIdx = 0; chunkIdx < subTask.chunkstoprocess_size(); ++chunkIdx)
+    {
+        EXPECT_EQ(
+            ProcessingStridedHashCore::HashChunk(data.data(), data.size(), subTask.chunkstoprocess(chunkIdx)),
+            result.chunk_hashes(chunkIdx));
+    }
+
+    subTask.set_ipfsblock("BLOCK_2");
+    EXPECT_THROW(processingCore.ProcessSubTask(subTask, result, 0), std::runtime_error);
+
+    fs::remove_all(blockDirectory);
+}
@@ -24,6 +24,12 @@ namespace
         {
             return std::nullopt;
         }
+        void SaveQueueCheckpoint(
+            const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint) override {}
+        std::optional<SGProcessing::SubTaskQueueCheckpoint> LoadQueueCheckpoint(const std::string& queueId) override
+        {
+            return std::nullopt;
+        }
     };
 
     class SubTaskResultStorageMock : public SubTaskResultStorage
@@ -37,6 +43,29 @@ namespace
 
     };
 
+    class CountingSubTaskResultStorageMock : public SubTaskResultStorage
+    {
+    public:
+        void AddSubTaskResult(const SGProcessing::SubTaskResult& subTaskResult) override {}
+        void RemoveSubTaskResult(const std::string& subTaskId) override {}
+        void GetSubTaskResults(
+            const std::set<std::string>& subTaskIds,
+            std::vector<SGProcessing::SubTaskResult>& results) override
+        {
+            ++m_requestCount;
+            for (const auto& result : m_results)
+            {
+                if (subTaskIds.find(result.subtaskid()) != subTaskIds.end())
+                {
+                    results.push_back(result);
+                }
+            }
+        }
+
+        std::vector<SGProcessing::SubTaskResult> m_results;
+        std::atomic<size_t> m_requestCount = 0;
+    };
+
     class ProcessingCoreImpl : public ProcessingCore
     {
     public:
@@ -193,6 +222,78 @@ TEST_F(SubTaskQueueAccessorImplTest, SubscribtionToResultChannel)
     EXPECT_EQ("SUBTASK_ID", std::get<0>(subTaskQueueAccessor->GetResults()[0]));
 }
 
+/**
+ * @given A node is subscribed to result channel
+ * @when A batch of results is published to the channel
+ * @then The node receives all results of the batch
+ */
+TEST_F(SubTaskQueueAccessorImplTest, SubscribtionToResultChannelBatch)
+{
+    auto pubs1 = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();;
+    pubs1->Start(40001, {});
+
+    auto pubs2 = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();;
+    pubs2->Start(40001, { pubs1->GetLocalAddress() });
+
+    sgns::ipfs_pubsub::GossipPubSubTopic resultChannel(pubs1, "RESULT_CHANNEL_ID");
+    resultChannel.Subscribe([](boost::optional<const sgns::ipfs_pubsub::GossipPubSub::Message&> message)
+        {
+        });
+
+    auto queueChannel = std::make_shared<ProcessingSubTaskQueueChannelPubSub>(pubs1, "QUEUE_CHANNEL_ID");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    auto processingCore = std::make_shared<ProcessingCoreImpl>(0);
+
+    auto nodeId = "NODE_1";
+    auto engine = std::make_shared<ProcessingEngine>(nodeId, processingCore);
+
+    auto queue = std::make_unique<SGProcessing::SubTaskQueue>();
+    queue->mutable_processing_queue()->set_owner_node_id("DIFFERENT_NODE_ID");
+
+    auto item = queue->mutable_processing_queue()->add_items();
+    queue->mutable_processing_queue()->add_items();
+    auto subTask = queue->mutable_subtasks()->add_items();
+    subTask->set_subtaskid("SUBTASK_ID1");
+    subTask = queue->mutable_subtasks()->add_items();
+    subTask->set_subtaskid("SUBTASK_ID2");
+
+    auto processingQueueManager = std::make_shared<ProcessingSubTaskQueueManager>(
+        queueChannel, pubs1->GetAsioContext(), nodeId);
+    // The local queue wrapper doesn't own the queue
+    processingQueueManager->ProcessSubTaskQueueMessage(queue.release());
+
+    auto subTaskQueueAccessor = std::make_shared<SubTaskQueueAccessorImpl>(
+        pubs1, 
+        processingQueueManager,
+        std::make_shared<SubTaskStateStorageMock>(),
+        std::make_shared<SubTaskResultStorageMock>(),
+        [](const SGProcessing::TaskResult&) {});
+
+    subTaskQueueAccessor->ConnectToSubTaskQueue([&]() {
+        engine->StartQueueProcessing(subTaskQueueAccessor);
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    // Publish results to the results channel
+    SGProcessing::SubTaskResultBatch resultBatch;
+    resultBatch.add_results()->set_subtaskid("SUBTASK_ID1");
+    resultBatch.add_results()->set_subtaskid("SUBTASK_ID2");
+    resultChannel.Publish(resultBatch.SerializeAsString());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    pubs1->Stop();
+    pubs2->Stop();
+
+    auto results = subTaskQueueAccessor->GetResults();
+    ASSERT_EQ(2, results.size());
+    EXPECT_EQ("SUBTASK_ID1", std::get<0>(results[0]));
+    EXPECT_EQ("SUBTASK_ID2", std::get<0>(results[1]));
+}
+
 /**
  * @given A queue containing 2 subtasks
  * @when Subtasks are finished and chunk hashes are valid
@@ -384,3 +485,118 @@ TEST_F(SubTaskQueueAccessorImplTest, InvalidSubTasksRestart)
     ASSERT_TRUE(processingQueueManager2->HasOwnership());
     ASSERT_TRUE(isTaskFinalized2);
 }
+
+/**
+ * @given A subtask queue accessor with result batching enabled
+ * @when Several subtasks are completed within the publishing window
+ * @then The results are published to the queue result channel as a single message.
+ */
+TEST_F(SubTaskQueueAccessorImplTest, ResultBatchPublishing)
+{
+    auto pubs1 = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();;
+    pubs1->Start(40001, {});
+
+    std::mutex resultBatchesMutex;
+    std::vector<SGProcessing::SubTaskResultBatch> resultBatches;
+    sgns::ipfs_pubsub::GossipPubSubTopic resultChannel(pubs1, "QUEUE_CHANNEL_ID_RESULTS");
+    resultChannel.Subscribe([&](boost::optional<const sgns::ipfs_pubsub::GossipPubSub::Message&> message)
+        {
+            if (message)
+            {
+                SGProcessing::SubTaskResultBatch resultBatch;
+                resultBatch.ParseFromArray(message->data.data(), static_cast<int>(message->data.size()));
+                std::lock_guard<std::mutex> guard(resultBatchesMutex);
+                resultBatches.push_back(std::move(resultBatch));
+            }
+        });
+
+    auto queueChannel = std::make_shared<ProcessingSubTaskQueueChannelPubSub>(pubs1, "QUEUE_CHANNEL_ID");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    auto processingQueueManager = std::make_shared<ProcessingSubTaskQueueManager>(
+        queueChannel, pubs1->GetAsioContext(), "NODE_1");
+
+    auto subTaskQueueAccessor = std::make_shared<SubTaskQueueAccessorImpl>(
+        pubs1,
+        processingQueueManager,
+        std::make_shared<SubTaskStateStorageMock>(),
+        std::make_shared<SubTaskResultStorageMock>(),
+        [](const SGProcessing::TaskResult&) {},
+        "QUEUE_CHANNEL_ID_RESULTS");
+    subTaskQueueAccessor->SetResultBatchingParameters(std::chrono::milliseconds(200), 64 * 1024);
+
+    for (size_t subTaskIdx = 0; subTaskIdx < 3; ++subTaskIdx)
+    {
+        SGProcessing::SubTaskResult result;
+        result.set_subtaskid("SUBTASK_ID" + std::to_string(subTaskIdx + 1));
+        subTaskQueueAccessor->CompleteSubTask(result.subtaskid(), result);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    pubs1->Stop();
+
+    std::lock_guard<std::mutex> guard(resultBatchesMutex);
+    ASSERT_EQ(1, resultBatches.size());
+    ASSERT_EQ(3, resultBatches[0].results_size());
+    EXPECT_EQ("SUBTASK_ID1", resultBatches[0].results(0).subtaskid());
+    EXPECT_EQ("SUBTASK_ID3", resultBatches[0].results(2).subtaskid());
+}
+
+/**
+ * @given A subtask queue which results are partially stored in the result storage
+ * @when Subtasks are grabbed several times
+ * @then The result storage is requested only once after the queue is assigned.
+ * Subtasks with stored results are not grabbed.
+ */
+TEST_F(SubTaskQueueAccessorImplTest, StoredResultsLoadedOnce)
+{
+    auto pubs1 = std::make_shared<sgns::ipfs_pubsub::GossipPubSub>();;
+    pubs1->Start(40001, {});
+
+    auto queueChannel = std::make_shared<ProcessingSubTaskQueueChannelPubSub>(pubs1, "QUEUE_CHANNEL_ID");
+
+    auto processingQueueManager = std::make_shared<ProcessingSubTaskQueueManager>(
+        queueChannel, pubs1->GetAsioContext(), "NODE_1");
+
+    auto resultStorage = std::make_shared<CountingSubTaskResultStorageMock>();
+    {
+        SGProcessing::SubTaskResult result;
+        result.set_subtaskid("SUBTASK_ID1");
+        resultStorage->m_results.push_back(result);
+    }
+
+    auto subTaskQueueAccessor = std::make_shared<SubTaskQueueAccessorImpl>(
+        pubs1,
+        processingQueueManager,
+        std::make_shared<SubTaskStateStorageMock>(),
+        resultStorage,
+        [](const SGProcessing::TaskResult&) {});
+    subTaskQueueAccessor->ConnectToSubTaskQueue([]() {});
+
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 4; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subTask;
+        subTask.set_subtaskid("SUBTASK_ID" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subTask));
+    }
+    subTaskQueueAccessor->AssignSubTasks(subTasks);
+
+    std::vector<std::string> grabbedSubTaskIds;
+    for (size_t grabIdx = 0; grabIdx < 3; ++grabIdx)
+    {
+        subTaskQueueAccessor->GrabSubTask([&grabbedSubTaskIds](boost::optional<const SGProcessing::SubTask&> subTask) {
+            if (subTask)
+            {
+                grabbedSubTaskIds.push_back(subTask->subtaskid());
+            }
+        });
+    }
+
+    pubs1->Stop();
+
+    EXPECT_EQ(1, resultStorage->m_requestCount);
+    EXPECT_EQ(std::vector<std::string>({ "SUBTASK_ID2", "SUBTASK_ID3", "SUBTASK_ID4" }), grabbedSubTaskIds);
+}
@@ -71,11 +71,11 @@ TEST_F(ProcessingSubTaskChannelPubSubTest, RequestTransmittingOnSinglePubSubHost
     queueChannel2->Listen(100);
 
     std::string nodeId1 = "NODE1_ID";
-    queueChannel1->RequestQueueOwnership(nodeId1);
+    queueChannel1->RequestQueueOwnership(nodeId1, {});
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
     std::string nodeId2 = "NODE2_ID";
-    queueChannel2->RequestQueueOwnership(nodeId2);
+    queueChannel2->RequestQueueOwnership(nodeId2, {});
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
     pubs1->Stop();
@@ -121,11 +121,11 @@ TEST_F(ProcessingSubTaskChannelPubSubTest, RequestTransmittingOnDifferentPubSubH
     queueChannel2->Listen(100);
 
     std::string nodeId1 = "NODE1_ID";
-    queueChannel1->RequestQueueOwnership(nodeId1);
+    queueChannel1->RequestQueueOwnership(nodeId1, {});
     std::this_thread::sleep_for(std::chrono::milliseconds(1500));
 
     std::string nodeId2 = "NODE2_ID";
-    queueChannel2->RequestQueueOwnership(nodeId2);
+    queueChannel2->RequestQueueOwnership(nodeId2, {});
     std::this_thread::sleep_for(std::chrono::milliseconds(1500));
 
     pubs1->Stop();
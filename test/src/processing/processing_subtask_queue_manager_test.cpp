@@ -16,14 +16,26 @@ namespace
     {
     public:
         typedef std::function<void(const std::string& nodeId)> QueueOwnershipRequestSink;
+        typedef std::function<void(const SGProcessing::SubTaskQueueRequest& request)> QueueRequestSink;
         typedef std::function<void(std::shared_ptr<SGProcessing::SubTaskQueue> queue)> QueuePublishingSink;
+        typedef std::function<void(const SGProcessing::SubTaskQueueDelta& delta)> QueueDeltaPublishingSink;
+        typedef std::function<void(const std::string& nodeId, uint64_t queueVersion)> QueueSnapshotRequestSink;
 
-        void RequestQueueOwnership(const std::string& nodeId) override
+        void RequestQueueOwnership(
+            const std::string& nodeId, const SGProcessing::BlockFilter& localBlockFilter) override
         {
             if (queueOwnershipRequestSink)
             {
                 queueOwnershipRequestSink(nodeId);
             }
+
+            if (queueRequestSink)
+            {
+                SGProcessing::SubTaskQueueRequest request;
+                request.set_node_id(nodeId);
+                request.mutable_local_block_filter()->CopyFrom(localBlockFilter);
+                queueRequestSink(request);
+            }
         }
 
         void PublishQueue(std::shared_ptr<SGProcessing::SubTaskQueue> queue) override
@@ -34,8 +46,55 @@ namespace
             }
         }
 
+        void PublishQueueDelta(const SGProcessing::SubTaskQueueDelta& delta) override
+        {
+            if (queueDeltaPublishingSink)
+            {
+                queueDeltaPublishingSink(delta);
+            }
+        }
+
+        void RequestQueueSnapshot(const std::string& nodeId, uint64_t queueVersion) override
+        {
+            if (queueSnapshotRequestSink)
+            {
+                queueSnapshotRequestSink(nodeId, queueVersion);
+            }
+        }
+
         QueueOwnershipRequestSink queueOwnershipRequestSink;
+        QueueRequestSink queueRequestSink;
         QueuePublishingSink queuePublishingSink;
+        QueueDeltaPublishingSink queueDeltaPublishingSink;
+        QueueSnapshotRequestSink queueSnapshotRequestSink;
+    };
+
+    class SubTaskStateStorageImpl : public SubTaskStateStorage
+    {
+    public:
+        void ChangeSubTaskState(const std::string& subTaskId, SGProcessing::SubTaskState::Type state) override {}
+        std::optional<SGProcessing::SubTaskState> GetSubTaskState(const std::string& subTaskId) override
+        {
+            return std::nullopt;
+        }
+
+        void SaveQueueCheckpoint(
+            const std::string& queueId, const SGProcessing::SubTaskQueueCheckpoint& checkpoint) override
+        {
+            checkpoints[queueId] = checkpoint;
+        }
+
+        std::optional<SGProcessing::SubTaskQueueCheckpoint> LoadQueueCheckpoint(const std::string& queueId) override
+        {
+            auto itCheckpoint = checkpoints.find(queueId);
+            if (itCheckpoint == checkpoints.end())
+            {
+                return std::nullopt;
+            }
+            return itCheckpoint->second;
+        }
+
+        std::map<std::string, SGProcessing::SubTaskQueueCheckpoint> checkpoints;
     };
 }
 
@@ -484,3 +543,476 @@ TEST_F(ProcessingSubTaskQueueManagerTest, TaskSplitSucceeded)
     // Create the queue on node1
     ASSERT_TRUE(queueManager1.CreateQueue(subTasks));
 }
+
+/**
+ * @given Subtask queue with delta replication enabled
+ * @when A subtask is grabbed by the queue owner
+ * @then The full queue is published once on queue creation.
+ * The subtask lock is published as a delta that contains the locked item only.
+ */
+TEST_F(ProcessingSubTaskQueueManagerTest, DeltaReplication)
+{
+    auto context = std::make_shared<boost::asio::io_context>();
+
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 3; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subtask;
+        subtask.set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subtask));
+    }
+
+    std::vector<SGProcessing::SubTaskQueue> queueSnapshotSet;
+    std::vector<SGProcessing::SubTaskQueueDelta> queueDeltas;
+    auto queueChannel1 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    queueChannel1->queuePublishingSink = [&queueSnapshotSet](std::shared_ptr<SGProcessing::SubTaskQueue> queue) {
+        queueSnapshotSet.push_back(*queue);
+    };
+    queueChannel1->queueDeltaPublishingSink = [&queueDeltas](const SGProcessing::SubTaskQueueDelta& delta) {
+        queueDeltas.push_back(delta);
+    };
+
+    auto nodeId1 = "NODE1_ID";
+    ProcessingSubTaskQueueManager queueManager1(queueChannel1, context, nodeId1);
+    queueManager1.SetDeltaReplicationEnabled(true);
+    queueManager1.CreateQueue(subTasks);
+
+    auto queueChannel2 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    auto nodeId2 = "NODE2_ID";
+    ProcessingSubTaskQueueManager queueManager2(queueChannel2, context, nodeId2);
+    queueManager2.SetDeltaReplicationEnabled(true);
+
+    ASSERT_EQ(1, queueSnapshotSet.size());
+    auto pQueue = std::make_unique<SGProcessing::SubTaskQueue>();
+    pQueue->CopyFrom(queueSnapshotSet[0]);
+    queueManager2.ProcessSubTaskQueueMessage(pQueue.release());
+
+    queueManager1.GrabSubTask([](boost::optional<const SGProcessing::SubTask&> subtask) {});
+
+    ASSERT_EQ(1, queueSnapshotSet.size());
+    ASSERT_EQ(1, queueDeltas.size());
+    EXPECT_EQ(1, queueDeltas[0].version());
+    EXPECT_EQ(nodeId1, queueDeltas[0].owner_node_id());
+    ASSERT_EQ(1, queueDeltas[0].items_size());
+    EXPECT_EQ(0, queueDeltas[0].items(0).item_idx());
+    EXPECT_EQ(nodeId1, queueDeltas[0].items(0).lock_node_id());
+
+    ASSERT_TRUE(queueManager2.ProcessSubTaskQueueDeltaMessage(queueDeltas[0]));
+    auto queue2 = queueManager2.GetQueueSnapshot();
+    EXPECT_EQ(1, queue2->processing_queue().version());
+    EXPECT_EQ(nodeId1, queue2->processing_queue().items(0).lock_node_id());
+    EXPECT_EQ("", queue2->processing_queue().items(1).lock_node_id());
+}
+
+/**
+ * @given Subtask queue with delta replication enabled
+ * @when A queue delta is missed by a node
+ * @then The node requests the full queue snapshot and the queue owner publishes it.
+ */
+TEST_F(ProcessingSubTaskQueueManagerTest, DeltaVersionGap)
+{
+    auto context = std::make_shared<boost::asio::io_context>();
+
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 3; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subtask;
+        subtask.set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subtask));
+    }
+
+    std::vector<SGProcessing::SubTaskQueue> queueSnapshotSet;
+    std::vector<SGProcessing::SubTaskQueueDelta> queueDeltas;
+    auto queueChannel1 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    queueChannel1->queuePublishingSink = [&queueSnapshotSet](std::shared_ptr<SGProcessing::SubTaskQueue> queue) {
+        queueSnapshotSet.push_back(*queue);
+    };
+    queueChannel1->queueDeltaPublishingSink = [&queueDeltas](const SGProcessing::SubTaskQueueDelta& delta) {
+        queueDeltas.push_back(delta);
+    };
+
+    ProcessingSubTaskQueueManager queueManager1(queueChannel1, context, "NODE1_ID");
+    queueManager1.SetDeltaReplicationEnabled(true);
+    queueManager1.CreateQueue(subTasks);
+
+    std::vector<uint64_t> requestedSnapshotVersions;
+    auto queueChannel2 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    queueChannel2->queueSnapshotRequestSink =
+        [&requestedSnapshotVersions](const std::string& nodeId, uint64_t queueVersion) {
+            requestedSnapshotVersions.push_back(queueVersion);
+        };
+    ProcessingSubTaskQueueManager queueManager2(queueChannel2, context, "NODE2_ID");
+    queueManager2.SetDeltaReplicationEnabled(true);
+
+    auto pQueue = std::make_unique<SGProcessing::SubTaskQueue>();
+    pQueue->CopyFrom(queueSnapshotSet[0]);
+    queueManager2.ProcessSubTaskQueueMessage(pQueue.release());
+
+    queueManager1.GrabSubTask([](boost::optional<const SGProcessing::SubTask&> subtask) {});
+    queueManager1.GrabSubTask([](boost::optional<const SGProcessing::SubTask&> subtask) {});
+    ASSERT_EQ(2, queueDeltas.size());
+
+    // The first delta is missed
+    ASSERT_FALSE(queueManager2.ProcessSubTaskQueueDeltaMessage(queueDeltas[1]));
+    ASSERT_EQ(1, requestedSnapshotVersions.size());
+    EXPECT_EQ(0, requestedSnapshotVersions[0]);
+
+    SGProcessing::SubTaskQueueSnapshotRequest request;
+    request.set_node_id("NODE2_ID");
+    request.set_queue_version(requestedSnapshotVersions[0]);
+    ASSERT_TRUE(queueManager1.ProcessSubTaskQueueSnapshotRequestMessage(request));
+    ASSERT_EQ(2, queueSnapshotSet.size());
+    EXPECT_EQ(2, queueSnapshotSet[1].processing_queue().version());
+}
+
+/**
+ * @given Subtask queue with delta replication enabled
+ * @when A node misses the delta that passes the queue ownership to it
+ * @then The previous owner answers the node snapshot request and the node takes the ownership.
+ * Nodes that did not publish the latest queue changes do not answer.
+ */
+TEST_F(ProcessingSubTaskQueueManagerTest, MissedOwnershipTransferDelta)
+{
+    auto context = std::make_shared<boost::asio::io_context>();
+
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 3; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subtask;
+        subtask.set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subtask));
+    }
+
+    std::vector<SGProcessing::SubTaskQueue> queueSnapshotSet;
+    std::vector<SGProcessing::SubTaskQueueDelta> queueDeltas;
+    auto queueChannel1 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    queueChannel1->queuePublishingSink = [&queueSnapshotSet](std::shared_ptr<SGProcessing::SubTaskQueue> queue) {
+        queueSnapshotSet.push_back(*queue);
+    };
+    queueChannel1->queueDeltaPublishingSink = [&queueDeltas](const SGProcessing::SubTaskQueueDelta& delta) {
+        queueDeltas.push_back(delta);
+    };
+
+    ProcessingSubTaskQueueManager queueManager1(queueChannel1, context, "NODE1_ID");
+    queueManager1.SetDeltaReplicationEnabled(true);
+    queueManager1.CreateQueue(subTasks);
+    ASSERT_EQ(1, queueSnapshotSet.size());
+
+    auto queueChannel2 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    ProcessingSubTaskQueueManager queueManager2(queueChannel2, context, "NODE2_ID");
+    queueManager2.SetDeltaReplicationEnabled(true);
+
+    auto queueChannel3 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    ProcessingSubTaskQueueManager queueManager3(queueChannel3, context, "NODE3_ID");
+    queueManager3.SetDeltaReplicationEnabled(true);
+
+    for (auto queueManager : { &queueManager2, &queueManager3 })
+    {
+        auto pQueue = std::make_unique<SGProcessing::SubTaskQueue>();
+        pQueue->CopyFrom(queueSnapshotSet[0]);
+        queueManager->ProcessSubTaskQueueMessage(pQueue.release());
+    }
+
+    // The ownership delta is received by node3 only
+    SGProcessing::SubTaskQueueRequest ownershipRequest;
+    ownershipRequest.set_node_id("NODE2_ID");
+    ASSERT_TRUE(queueManager1.ProcessSubTaskQueueRequestMessage(ownershipRequest));
+    ASSERT_EQ(1, queueDeltas.size());
+    EXPECT_EQ("NODE2_ID", queueDeltas[0].owner_node_id());
+    ASSERT_TRUE(queueManager3.ProcessSubTaskQueueDeltaMessage(queueDeltas[0]));
+    EXPECT_FALSE(queueManager2.HasOwnership());
+
+    SGProcessing::SubTaskQueueSnapshotRequest snapshotRequest;
+    snapshotRequest.set_node_id("NODE2_ID");
+    snapshotRequest.set_queue_version(0);
+    EXPECT_FALSE(queueManager3.ProcessSubTaskQueueSnapshotRequestMessage(snapshotRequest));
+    ASSERT_TRUE(queueManager1.ProcessSubTaskQueueSnapshotRequestMessage(snapshotRequest));
+    ASSERT_EQ(2, queueSnapshotSet.size());
+    EXPECT_EQ(1, queueSnapshotSet[1].processing_queue().version());
+
+    auto pQueue = std::make_unique<SGProcessing::SubTaskQueue>();
+    pQueue->CopyFrom(queueSnapshotSet[1]);
+    ASSERT_TRUE(queueManager2.ProcessSubTaskQueueMessage(pQueue.release()));
+    EXPECT_TRUE(queueManager2.HasOwnership());
+}
+
+/**
+ * @given Subtask queue owned by the local node
+ * @when A batch of subtasks is grabbed
+ * @then Each grabbed subtask is passed to the callback.
+ * The queue is published once for the whole batch.
+ */
+TEST_F(ProcessingSubTaskQueueManagerTest, GrabSubTasksBatch)
+{
+    auto context = std::make_shared<boost::asio::io_context>();
+
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 3; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subtask;
+        subtask.set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx + 1));
+        subTasks.push_back(std::move(subtask));
+    }
+
+    std::vector<SGProcessing::SubTaskQueue> queueSnapshotSet;
+    auto queueChannel = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    queueChannel->queuePublishingSink = [&queueSnapshotSet](std::shared_ptr<SGProcessing::SubTaskQueue> queue) {
+        queueSnapshotSet.push_back(*queue);
+    };
+
+    ProcessingSubTaskQueueManager queueManager(queueChannel, context, "NODE1_ID");
+    queueManager.CreateQueue(subTasks);
+    ASSERT_EQ(1, queueSnapshotSet.size());
+
+    std::vector<std::string> grabbedSubTaskIds;
+    queueManager.GrabSubTasks(2, [&grabbedSubTaskIds](boost::optional<const SGProcessing::SubTask&> subtask) {
+        if (subtask)
+        {
+            grabbedSubTaskIds.push_back(subtask->subtaskid());
+        }
+    });
+
+    ASSERT_EQ(2, grabbedSubTaskIds.size());
+    EXPECT_EQ("SUBTASK_1", grabbedSubTaskIds[0]);
+    EXPECT_EQ("SUBTASK_2", grabbedSubTaskIds[1]);
+
+    ASSERT_EQ(2, queueSnapshotSet.size());
+    EXPECT_EQ("NODE1_ID", queueSnapshotSet[1].processing_queue().items(0).lock_node_id());
+    EXPECT_EQ("NODE1_ID", queueSnapshotSet[1].processing_queue().items(1).lock_node_id());
+    EXPECT_EQ("", queueSnapshotSet[1].processing_queue().items(2).lock_node_id());
+}
+
+/**
+ * @given 2 nodes that cache different halves of subtask blocks
+ * @when The nodes grab subtasks in turn with and without advertised block filters
+ * @then With block filters each node grabs subtasks which blocks it caches and no block data is fetched.
+ * Without block filters subtasks are grabbed in the queue order and half of blocks are fetched.
+ */
+TEST_F(ProcessingSubTaskQueueManagerTest, DataLocalityAwareGrabbing)
+{
+    const size_t blockSize = 1024 * 1024;
+    std::vector<std::set<std::string>> cachedBlocks = {
+        { "BLOCK_0", "BLOCK_1", "BLOCK_2", "BLOCK_3" },
+        { "BLOCK_4", "BLOCK_5", "BLOCK_6", "BLOCK_7" } };
+
+    // Returns a number of bytes that were fetched by nodes to process grabbed subtasks
+    auto processQueue = [&](bool isLocalityEnabled) {
+        auto context = std::make_shared<boost::asio::io_context>();
+        std::vector<std::shared_ptr<ProcessingSubTaskQueueChannelImpl>> queueChannels;
+        std::vector<std::shared_ptr<ProcessingSubTaskQueueManager>> queueManagers;
+        for (size_t nodeIdx = 0; nodeIdx < 2; ++nodeIdx)
+        {
+            queueChannels.push_back(std::make_shared<ProcessingSubTaskQueueChannelImpl>());
+            queueManagers.push_back(std::make_shared<ProcessingSubTaskQueueManager>(
+                queueChannels.back(), context, "NODE" + std::to_string(nodeIdx + 1) + "_ID"));
+
+            if (isLocalityEnabled)
+            {
+                ProcessingBlockFilter localBlockFilter;
+                for (const auto& blockId : cachedBlocks[nodeIdx])
+                {
+                    localBlockFilter.Add(blockId);
+                }
+                queueManagers.back()->SetLocalBlockFilter(localBlockFilter);
+            }
+        }
+
+        // Each node channel delivers messages to the other node
+        for (size_t nodeIdx = 0; nodeIdx < 2; ++nodeIdx)
+        {
+            auto otherQueueManager = queueManagers[1 - nodeIdx];
+            queueChannels[nodeIdx]->queueRequestSink =
+                [context, otherQueueManager](const SGProcessing::SubTaskQueueRequest& request) {
+                    context->post([otherQueueManager, request]() {
+                        otherQueueManager->ProcessSubTaskQueueRequestMessage(request);
+                    });
+                };
+            queueChannels[nodeIdx]->queuePublishingSink =
+                [context, otherQueueManager](std::shared_ptr<SGProcessing::SubTaskQueue> queue) {
+                    auto queueSnapshot = std::make_shared<SGProcessing::SubTaskQueue>(*queue);
+                    context->post([otherQueueManager, queueSnapshot]() {
+                        auto pQueue = std::make_unique<SGProcessing::SubTaskQueue>(*queueSnapshot);
+                        otherQueueManager->ProcessSubTaskQueueMessage(pQueue.release());
+                    });
+                };
+        }
+
+        std::list<SGProcessing::SubTask> subTasks;
+        for (size_t subTaskIdx = 0; subTaskIdx < 8; ++subTaskIdx)
+        {
+            SGProcessing::SubTask subtask;
+            subtask.set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx));
+            subtask.set_ipfsblock("BLOCK_" + std::to_string(subTaskIdx));
+            subtask.set_datalen(blockSize);
+            subTasks.push_back(std::move(subtask));
+        }
+        queueManagers[0]->CreateQueue(subTasks);
+
+        size_t fetchedByteCount = 0;
+        for (size_t grabIdx = 0; grabIdx < 8; ++grabIdx)
+        {
+            auto nodeIdx = grabIdx % 2;
+            queueManagers[nodeIdx]->GrabSubTask(
+                [&fetchedByteCount, &cachedBlocks, nodeIdx](boost::optional<const SGProcessing::SubTask&> subtask) {
+                    ASSERT_TRUE(subtask);
+                    if (cachedBlocks[nodeIdx].count(subtask->ipfsblock()) == 0)
+                    {
+                        fetchedByteCount += subtask->datalen();
+                    }
+                });
+            context->run();
+            context->restart();
+        }
+        return fetchedByteCount;
+    };
+
+    auto fetchedByteCount = processQueue(false);
+    auto localityAwareFetchedByteCount = processQueue(true);
+
+    EXPECT_EQ(4 * blockSize, fetchedByteCount);
+    EXPECT_EQ(0, localityAwareFetchedByteCount);
+}
+
+/**
+ * @given A queue which subtasks are locked by node2 and speculative execution enabled on node1
+ * @when Node1 grabs subtasks after the queue is drained
+ * @then Node1 gets a duplicate of the subtask with the oldest lock without waiting for the lock expiration.
+ * Subtask locks are not changed and no more duplicates are grabbed once the budget is exhausted.
+ */
+TEST_F(ProcessingSubTaskQueueManagerTest, SpeculativeDuplicateGrabbing)
+{
+    auto context = std::make_shared<boost::asio::io_context>();
+    auto queueChannel1 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    auto queueChannel2 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    auto queueManager1 = std::make_shared<ProcessingSubTaskQueueManager>(queueChannel1, context, "NODE1_ID");
+    auto queueManager2 = std::make_shared<ProcessingSubTaskQueueManager>(queueChannel2, context, "NODE2_ID");
+    queueManager1->SetSpeculativeExecutionBudget(1);
+
+    std::vector<std::pair<std::shared_ptr<ProcessingSubTaskQueueChannelImpl>, std::shared_ptr<ProcessingSubTaskQueueManager>>>
+        channels = { { queueChannel1, queueManager2 }, { queueChannel2, queueManager1 } };
+    for (auto& [queueChannel, otherQueueManager] : channels)
+    {
+        queueChannel->queueRequestSink =
+            [context, otherQueueManager = otherQueueManager](const SGProcessing::SubTaskQueueRequest& request) {
+                context->post([otherQueueManager, request]() {
+                    otherQueueManager->ProcessSubTaskQueueRequestMessage(request);
+                });
+            };
+        queueChannel->queuePublishingSink =
+            [context, otherQueueManager = otherQueueManager](std::shared_ptr<SGProcessing::SubTaskQueue> queue) {
+                auto queueSnapshot = std::make_shared<SGProcessing::SubTaskQueue>(*queue);
+                context->post([otherQueueManager, queueSnapshot]() {
+                    auto pQueue = std::make_unique<SGProcessing::SubTaskQueue>(*queueSnapshot);
+                    otherQueueManager->ProcessSubTaskQueueMessage(pQueue.release());
+                });
+            };
+    }
+
+    std::list<SGProcessing::SubTask> subTasks;
+    for (size_t subTaskIdx = 0; subTaskIdx < 2; ++subTaskIdx)
+    {
+        SGProcessing::SubTask subtask;
+        subtask.set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx));
+        subTasks.push_back(std::move(subtask));
+    }
+    queueManager1->CreateQueue(subTasks);
+
+    // Node2 locks all subtasks
+    queueManager2->GrabSubTasks(2, [](boost::optional<const SGProcessing::SubTask&> subtask) {});
+    context->run();
+    context->restart();
+
+    std::vector<std::string> duplicatedSubTaskIds;
+    auto onSubTaskGrabbed = [&duplicatedSubTaskIds](boost::optional<const SGProcessing::SubTask&> subtask) {
+        ASSERT_TRUE(subtask);
+        duplicatedSubTaskIds.push_back(subtask->subtaskid());
+    };
+
+    queueManager1->GrabSubTask(onSubTaskGrabbed);
+    context->run();
+    context->restart();
+
+    ASSERT_EQ(std::vector<std::string>({ "SUBTASK_0" }), duplicatedSubTaskIds);
+    EXPECT_EQ(1, queueManager1->GetDuplicatedSubTaskCount());
+
+    auto queue = queueManager1->GetQueueSnapshot();
+    EXPECT_EQ("NODE2_ID", queue->processing_queue().items(0).lock_node_id());
+    EXPECT_EQ("NODE2_ID", queue->processing_queue().items(1).lock_node_id());
+
+    // The duplication budget is exhausted, the grabbing waits for the lock expiration
+    queueManager1->GrabSubTask(onSubTaskGrabbed);
+    context->run_for(std::chrono::milliseconds(100));
+
+    EXPECT_EQ(1, duplicatedSubTaskIds.size());
+    EXPECT_EQ(1, queueManager1->GetDuplicatedSubTaskCount());
+}
+
+/**
+ * @given A queue with processed and locked subtasks
+ * @when The queue owner passes the ownership and a new node creates the queue from the same subtasks
+ * @then The queue checkpoint is saved on the ownership change.
+ * The new queue is resumed from the checkpoint, processed and remotely locked subtasks are not grabbed.
+ */
+TEST_F(ProcessingSubTaskQueueManagerTest, QueueCheckpointing)
+{
+    auto context = std::make_shared<boost::asio::io_context>();
+    auto checkpointStorage = std::make_shared<SubTaskStateStorageImpl>();
+
+    auto createSubTasks = []() {
+        std::list<SGProcessing::SubTask> subTasks;
+        for (size_t subTaskIdx = 0; subTaskIdx < 3; ++subTaskIdx)
+        {
+            SGProcessing::SubTask subtask;
+            subtask.set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx));
+            subTasks.push_back(std::move(subtask));
+        }
+        return subTasks;
+    };
+
+    auto queueChannel1 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    ProcessingSubTaskQueueManager queueManager1(queueChannel1, context, "NODE1_ID");
+    queueManager1.SetCheckpointStorage(checkpointStorage, "QUEUE_ID", std::chrono::milliseconds(0));
+
+    auto subTasks1 = createSubTasks();
+    queueManager1.CreateQueue(subTasks1);
+    queueManager1.GrabSubTask([](boost::optional<const SGProcessing::SubTask&> subtask) {});
+    queueManager1.ChangeSubTaskProcessingStates({ "SUBTASK_0" }, true);
+    queueManager1.GrabSubTask([](boost::optional<const SGProcessing::SubTask&> subtask) {});
+
+    SGProcessing::SubTaskQueueRequest request;
+    request.set_node_id("NODE2_ID");
+    ASSERT_TRUE(queueManager1.ProcessSubTaskQueueRequestMessage(request));
+    context->run();
+    context->restart();
+
+    ASSERT_EQ(1, checkpointStorage->checkpoints.count("QUEUE_ID"));
+    const auto& checkpoint = checkpointStorage->checkpoints["QUEUE_ID"];
+    EXPECT_EQ(3, checkpoint.item_count());
+    EXPECT_EQ(1, checkpoint.processed_items().size());
+    ASSERT_EQ(1, checkpoint.locked_items_size());
+    EXPECT_EQ(1, checkpoint.locked_items(0).item_idx());
+    EXPECT_EQ("NODE1_ID", checkpoint.locked_items(0).lock_node_id());
+
+    // A node that joins after all previous nodes left creates the queue again
+    auto queueChannel3 = std::make_shared<ProcessingSubTaskQueueChannelImpl>();
+    ProcessingSubTaskQueueManager queueManager3(queueChannel3, context, "NODE3_ID");
+    queueManager3.SetCheckpointStorage(checkpointStorage, "QUEUE_ID", std::chrono::milliseconds(0));
+
+    auto subTasks3 = createSubTasks();
+    queueManager3.CreateQueue(subTasks3);
+
+    std::vector<std::string> grabbedSubTaskIds;
+    queueManager3.GrabSubTasks(3, [&grabbedSubTaskIds](boost::optional<const SGProcessing::SubTask&> subtask) {
+        if (subtask)
+        {
+            grabbedSubTaskIds.push_back(subtask->subtaskid());
+        }
+    });
+    context->run_for(std::chrono::milliseconds(100));
+
+    EXPECT_EQ(std::vector<std::string>({ "SUBTASK_2" }), grabbedSubTaskIds);
+    EXPECT_FALSE(queueManager3.IsProcessed());
+
+    queueManager3.ChangeSubTaskProcessingStates({ "SUBTASK_1", "SUBTASK_2" }, true);
+    EXPECT_TRUE(queueManager3.IsProcessed());
+}
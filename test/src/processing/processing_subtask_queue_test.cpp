@@ -0,0 +1,186 @@
+#include <processing/processing_subtask_queue.hpp>
+
+#include <libp2p/log/configurator.hpp>
+#include <libp2p/log/logger.hpp>
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+using namespace sgns::processing;
+
+namespace
+{
+    void CreateProcessingQueue(SGProcessing::ProcessingQueue& queue, size_t itemCount)
+    {
+        for (size_t itemIdx = 0; itemIdx < itemCount; ++itemIdx)
+        {
+            queue.add_items();
+        }
+    }
+
+    std::vector<int> GetAllItemIndices(size_t itemCount)
+    {
+        std::vector<int> itemIndices(itemCount);
+        std::iota(itemIndices.begin(), itemIndices.end(), 0);
+        return itemIndices;
+    }
+}
+
+const std::string logger_config(R"(
+# ----------------
+sinks:
+  - name: console
+    type: console
+    color: true
+groups:
+  - name: processing_subtask_queue_test
+    sink: console
+    level: info
+    children:
+      - name: libp2p
+      - name: Gossip
+# ----------------
+  )");
+
+class ProcessingSubTaskQueueTest : public ::testing::Test
+{
+public:
+    virtual void SetUp() override
+    {
+        // prepare log system
+        auto logging_system = std::make_shared<soralog::LoggingSystem>(
+            std::make_shared<soralog::ConfiguratorFromYAML>(
+                // Original LibP2P logging config
+                std::make_shared<libp2p::log::Configurator>(),
+                // Additional logging config for application
+                logger_config));
+        logging_system->configure();
+
+        libp2p::log::setLoggingSystem(logging_system);
+        libp2p::log::setLevelOfGroup("processing_subtask_queue_test", soralog::Level::DEBUG);
+    }
+};
+
+/**
+ * @given A queue with disabled items
+ * @when Items are grabbed
+ * @then Enabled items are locked in index order, disabled items are skipped.
+ */
+TEST_F(ProcessingSubTaskQueueTest, GrabEnabledItems)
+{
+    SGProcessing::ProcessingQueue queue;
+    CreateProcessingQueue(queue, 4);
+
+    ProcessingSubTaskQueue processingQueue("NODE1_ID");
+    processingQueue.CreateQueue(&queue, { 1, 3 });
+
+    size_t itemIdx;
+    ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    EXPECT_EQ(1, itemIdx);
+    ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    EXPECT_EQ(3, itemIdx);
+    EXPECT_FALSE(processingQueue.GrabItem(itemIdx));
+
+    EXPECT_EQ("", queue.items(0).lock_node_id());
+    EXPECT_EQ("NODE1_ID", queue.items(1).lock_node_id());
+    EXPECT_EQ("NODE1_ID", queue.items(3).lock_node_id());
+}
+
+/**
+ * @given A queue with locked items
+ * @when Expired items are unlocked
+ * @then Only items with expired locks become available for grabbing.
+ * The last lock timestamp is the timestamp of the most recent remaining lock.
+ */
+TEST_F(ProcessingSubTaskQueueTest, UnlockExpiredItems)
+{
+    SGProcessing::ProcessingQueue queue;
+    CreateProcessingQueue(queue, 3);
+
+    ProcessingSubTaskQueue processingQueue("NODE1_ID");
+    processingQueue.CreateQueue(&queue, GetAllItemIndices(3));
+
+    size_t itemIdx;
+    ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    processingQueue.TakeModifiedItemIndices();
+
+    ASSERT_TRUE(processingQueue.UnlockExpiredItems(std::chrono::milliseconds(100)));
+    EXPECT_EQ(std::vector<size_t>({ 0 }), processingQueue.TakeModifiedItemIndices());
+    EXPECT_EQ("", queue.items(0).lock_node_id());
+    EXPECT_EQ(
+        std::chrono::system_clock::time_point(std::chrono::system_clock::duration(queue.items(2).lock_timestamp())),
+        processingQueue.GetLastLockTimestamp());
+
+    ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    EXPECT_EQ(0, itemIdx);
+}
+
+/**
+ * @given A queue which items were locked by several nodes
+ * @when The queue owner is not responding and nodes roll back the ownership
+ * @then Only the node that locked an item before the current owner takes the ownership.
+ */
+TEST_F(ProcessingSubTaskQueueTest, RollbackOwnership)
+{
+    SGProcessing::ProcessingQueue queue;
+    CreateProcessingQueue(queue, 4);
+    queue.mutable_items(0)->set_lock_node_id("NODE2_ID");
+    queue.mutable_items(1)->set_lock_node_id("NODE1_ID");
+    queue.mutable_items(2)->set_lock_node_id("NODE3_ID");
+    queue.set_owner_node_id("NODE3_ID");
+
+    ProcessingSubTaskQueue processingQueue2("NODE2_ID");
+    ASSERT_TRUE(processingQueue2.UpdateQueue(&queue, GetAllItemIndices(4)));
+    EXPECT_FALSE(processingQueue2.RollbackOwnership());
+    EXPECT_EQ("NODE3_ID", queue.owner_node_id());
+
+    ProcessingSubTaskQueue processingQueue1("NODE1_ID");
+    ASSERT_TRUE(processingQueue1.UpdateQueue(&queue, GetAllItemIndices(4)));
+    EXPECT_TRUE(processingQueue1.RollbackOwnership());
+    EXPECT_EQ("NODE1_ID", queue.owner_node_id());
+}
+
+/**
+ * @given A queue of 1000 items
+ * @when Items are grabbed, a snapshot with a few changed items is received and item states are changed
+ * @then Only grabbed and changed items are reindexed.
+ */
+TEST_F(ProcessingSubTaskQueueTest, IncrementalIndexing)
+{
+    const size_t itemCount = 1000;
+    SGProcessing::ProcessingQueue queue;
+    CreateProcessingQueue(queue, itemCount);
+
+    ProcessingSubTaskQueue processingQueue("NODE1_ID");
+    processingQueue.CreateQueue(&queue, GetAllItemIndices(itemCount));
+    EXPECT_EQ(itemCount, processingQueue.GetIndexedItemUpdateCount());
+
+    size_t itemIdx;
+    for (size_t lockIdx = 0; lockIdx < 10; ++lockIdx)
+    {
+        ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    }
+    EXPECT_EQ(itemCount + 10, processingQueue.GetIndexedItemUpdateCount());
+
+    // A snapshot where another node locked 2 more items
+    SGProcessing::ProcessingQueue receivedQueue(queue);
+    for (int lockedItemIdx : { 10, 11 })
+    {
+        receivedQueue.mutable_items(lockedItemIdx)->set_lock_node_id("NODE2_ID");
+        receivedQueue.mutable_items(lockedItemIdx)->set_lock_timestamp(queue.last_update_timestamp());
+    }
+    ASSERT_TRUE(processingQueue.UpdateQueue(&receivedQueue, GetAllItemIndices(itemCount)));
+    EXPECT_EQ(itemCount + 12, processingQueue.GetIndexedItemUpdateCount());
+
+    // The processed item is not grabbed anymore
+    processingQueue.SetItemEnabled(12, false);
+    processingQueue.SetItemEnabled(12, false);
+    EXPECT_EQ(itemCount + 13, processingQueue.GetIndexedItemUpdateCount());
+
+    ASSERT_TRUE(processingQueue.GrabItem(itemIdx));
+    EXPECT_EQ(13, itemIdx);
+}
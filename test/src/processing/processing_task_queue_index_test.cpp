@@ -0,0 +1,210 @@
+#include <processing/processing_task_queue_index.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+
+using namespace sgns::processing;
+
+namespace
+{
+    std::string GetTaskId(size_t taskIdx)
+    {
+        return "IPFS_BLOCK_ID_" + std::to_string(taskIdx);
+    }
+}
+
+class ProcessingTaskQueueIndexTest : public ::testing::Test
+{
+};
+
+/**
+ * @given An index with pending tasks
+ * @when Tasks are locked and completed
+ * @then Locked and completed tasks are not returned as unlocked ones,
+ * completed tasks are not added again.
+ */
+TEST_F(ProcessingTaskQueueIndexTest, GrabUnlockedTasks)
+{
+    ProcessingTaskQueueIndex index;
+    index.AddPendingTask("TASK_1");
+    index.AddPendingTask("TASK_2");
+
+    std::string taskId1;
+    ASSERT_TRUE(index.GetNextUnlockedTask(taskId1));
+    index.LockTask(taskId1, 100);
+    EXPECT_TRUE(index.IsTaskLocked(taskId1));
+
+    std::string taskId2;
+    ASSERT_TRUE(index.GetNextUnlockedTask(taskId2));
+    EXPECT_NE(taskId1, taskId2);
+    index.CompleteTask(taskId2);
+
+    std::string taskId;
+    EXPECT_FALSE(index.GetNextUnlockedTask(taskId));
+
+    // A stale pending record of the completed task is ignored
+    index.AddPendingTask(taskId2);
+    EXPECT_FALSE(index.GetNextUnlockedTask(taskId));
+    EXPECT_EQ(index.GetLockedTaskCount(), 1);
+    EXPECT_EQ(index.GetCompletedTaskCount(), 1);
+}
+
+/**
+ * @given An index with tasks locked at different time
+ * @when Locks are expired by a timestamp
+ * @then Only tasks with older locks become unlocked, prolonged locks are kept.
+ */
+TEST_F(ProcessingTaskQueueIndexTest, ExpireLocks)
+{
+    ProcessingTaskQueueIndex index;
+    index.AddPendingTask("TASK_1");
+    index.AddPendingTask("TASK_2");
+    index.AddPendingTask("TASK_3");
+    index.LockTask("TASK_1", 100);
+    index.LockTask("TASK_2", 200);
+    index.LockTask("TASK_3", 100);
+    // Lock prolongation
+    index.LockTask("TASK_3", 300);
+
+    EXPECT_EQ(index.ExpireLocks(150), 1);
+    EXPECT_FALSE(index.IsTaskLocked("TASK_1"));
+    EXPECT_TRUE(index.IsTaskLocked("TASK_2"));
+    EXPECT_TRUE(index.IsTaskLocked("TASK_3"));
+
+    std::string taskId;
+    ASSERT_TRUE(index.GetNextUnlockedTask(taskId));
+    EXPECT_EQ(taskId, "TASK_1");
+}
+
+/**
+ * @given Indices with different claim positions
+ * @when Next unlocked tasks are requested
+ * @then Different nodes start grabbing from different tasks.
+ */
+TEST_F(ProcessingTaskQueueIndexTest, ClaimPositionsSpreadGrabbing)
+{
+    ProcessingTaskQueueIndex index1(0);
+    ProcessingTaskQueueIndex index2(0x8000000000000000ull);
+    for (size_t taskIdx = 0; taskIdx < 100; ++taskIdx)
+    {
+        index1.AddPendingTask(GetTaskId(taskIdx));
+        index2.AddPendingTask(GetTaskId(taskIdx));
+    }
+
+    std::string taskId1, taskId2;
+    ASSERT_TRUE(index1.GetNextUnlockedTask(taskId1));
+    ASSERT_TRUE(index2.GetNextUnlockedTask(taskId2));
+    EXPECT_NE(taskId1, taskId2);
+}
+
+/**
+ * @given An index with unlocked, locked and completed tasks
+ * @when Unlocked tasks are listed
+ * @then Only unlocked tasks are listed starting from the next one to grab, the list is limited.
+ */
+TEST_F(ProcessingTaskQueueIndexTest, ListUnlockedTasks)
+{
+    ProcessingTaskQueueIndex index(0x8000000000000000ull);
+    for (size_t taskIdx = 0; taskIdx < 10; ++taskIdx)
+    {
+        index.AddPendingTask(GetTaskId(taskIdx));
+    }
+    index.LockTask(GetTaskId(0), 100);
+    index.CompleteTask(GetTaskId(1));
+
+    std::list<std::string> taskIds;
+    ASSERT_TRUE(index.GetUnlockedTasks(100, taskIds));
+    EXPECT_EQ(taskIds.size(), 8);
+    EXPECT_EQ(std::count(taskIds.begin(), taskIds.end(), GetTaskId(0)), 0);
+    EXPECT_EQ(std::count(taskIds.begin(), taskIds.end(), GetTaskId(1)), 0);
+
+    std::string nextTaskId;
+    ASSERT_TRUE(index.GetNextUnlockedTask(nextTaskId));
+    EXPECT_EQ(taskIds.front(), nextTaskId);
+
+    taskIds.clear();
+    ASSERT_TRUE(index.GetUnlockedTasks(3, taskIds));
+    EXPECT_EQ(taskIds.size(), 3);
+}
+
+/**
+ * @given An index where almost all tasks are already locked or completed
+ * @when Remaining tasks are grabbed one by one
+ * @then Each grab returns a distinct unlocked task until no unlocked tasks are left.
+ */
+TEST_F(ProcessingTaskQueueIndexTest, GrabbingSkipsUnavailableTasks)
+{
+    const size_t taskCount = 1000;
+    const size_t grabbedTaskCount = 50;
+    ProcessingTaskQueueIndex index(0x5A5A5A5A5A5A5A5Aull);
+    for (size_t taskIdx = 0; taskIdx < taskCount; ++taskIdx)
+    {
+        index.AddPendingTask(GetTaskId(taskIdx));
+    }
+
+    std::string taskId;
+    for (size_t taskIdx = 0; taskIdx < taskCount - grabbedTaskCount; ++taskIdx)
+    {
+        ASSERT_TRUE(index.GetNextUnlockedTask(taskId));
+        if (taskIdx % 2 == 0)
+        {
+            index.CompleteTask(taskId);
+        }
+        else
+        {
+            index.LockTask(taskId, static_cast<ProcessingTaskQueueIndex::Timestamp>(taskIdx));
+        }
+    }
+
+    std::set<std::string> grabbedTaskIds;
+    for (size_t grabIdx = 0; grabIdx < grabbedTaskCount; ++grabIdx)
+    {
+        ASSERT_TRUE(index.GetNextUnlockedTask(taskId));
+        EXPECT_FALSE(index.IsTaskLocked(taskId));
+        EXPECT_FALSE(index.IsTaskCompleted(taskId));
+        EXPECT_TRUE(grabbedTaskIds.insert(taskId).second);
+        index.LockTask(taskId, static_cast<ProcessingTaskQueueIndex::Timestamp>(taskCount + grabIdx));
+    }
+
+    EXPECT_FALSE(index.GetNextUnlockedTask(taskId));
+    EXPECT_EQ(index.GetUnlockedTaskCount(), 0);
+    EXPECT_EQ(index.GetLockedTaskCount(), (taskCount - grabbedTaskCount) / 2 + grabbedTaskCount);
+}
+
+/**
+ * @given An index with 1000 tasks of one tenant and a single task of another tenant
+ * @when A few unlocked tasks are listed
+ * @then The oldest task of each tenant and priority is listed and the list is limited.
+ */
+TEST_F(ProcessingTaskQueueIndexTest, ListTenantHeads)
+{
+    ProcessingTaskQueueIndex index(0x5A5A5A5A5A5A5A5Aull);
+    for (size_t taskIdx = 0; taskIdx < 1000; ++taskIdx)
+    {
+        index.AddPendingTask(GetTaskId(taskIdx), "BATCH", taskIdx % 2,
+            static_cast<ProcessingTaskQueueIndex::Timestamp>(taskIdx));
+    }
+    index.AddPendingTask("INTERACTIVE", "INTERACTIVE", 0, 2000);
+
+    std::list<std::string> taskIds;
+    ASSERT_TRUE(index.GetUnlockedTasks(4, taskIds));
+    EXPECT_EQ(taskIds.size(), 4);
+    EXPECT_EQ(std::count(taskIds.begin(), taskIds.end(), "INTERACTIVE"), 1);
+    EXPECT_EQ(std::count(taskIds.begin(), taskIds.end(), GetTaskId(0)), 1);
+    EXPECT_EQ(std::count(taskIds.begin(), taskIds.end(), GetTaskId(1)), 1);
+
+    // The next oldest task becomes the group head when the head is locked
+    index.LockTask(GetTaskId(0), 100);
+    taskIds.clear();
+    ASSERT_TRUE(index.GetUnlockedTasks(2, taskIds));
+    EXPECT_EQ(taskIds.size(), 3);
+    EXPECT_EQ(std::count(taskIds.begin(), taskIds.end(), GetTaskId(2)), 1);
+
+    // Unlocked task returns to its group
+    index.ExpireLocks(100);
+    taskIds.clear();
+    ASSERT_TRUE(index.GetUnlockedTasks(3, taskIds));
+    EXPECT_EQ(std::count(taskIds.begin(), taskIds.end(), GetTaskId(0)), 1);
+}
@@ -0,0 +1,260 @@
+#include <processing/processing_task_scheduler.hpp>
+#include <processing/processing_subtask_enqueuer_impl.hpp>
+#include <processing/processing_task_queue_index.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+
+using namespace sgns::processing;
+
+namespace
+{
+    ProcessingTaskScheduler::AvailableTask CreateTask(
+        const std::string& taskId, const std::string& tenantId, int priority,
+        std::chrono::system_clock::time_point enqueueTime)
+    {
+        SGProcessing::Task task;
+        task.set_ipfs_block_id(taskId);
+        task.set_tenant_id(tenantId);
+        task.set_priority(priority);
+        task.set_enqueue_timestamp(enqueueTime.time_since_epoch().count());
+        return { taskId, task };
+    }
+
+    /** Grabs available tasks one by one in the scheduler order
+    * @return tenant ids of grabbed tasks in the grabbing order
+    */
+    std::vector<std::string> GrabTasks(
+        ProcessingTaskScheduler& scheduler,
+        std::list<ProcessingTaskScheduler::AvailableTask> tasks,
+        size_t grabbedTaskCount,
+        size_t subTaskCount,
+        std::chrono::system_clock::time_point now)
+    {
+        std::vector<std::string> tenantIds;
+        while (!tasks.empty() && (tenantIds.size() < grabbedTaskCount))
+        {
+            scheduler.OrderTasks(tasks, now);
+            scheduler.OnTaskGrabbed(tasks.front().second, subTaskCount, now);
+            tenantIds.push_back(tasks.front().second.tenant_id());
+            tasks.pop_front();
+        }
+        return tenantIds;
+    }
+
+    /** In-memory task queue that lists available tasks by a task queue index
+    */
+    class IndexedTaskQueue : public ProcessingTaskQueue
+    {
+    public:
+        IndexedTaskQueue()
+            : m_index(0x5A5A5A5A5A5A5A5Aull)
+        {
+        }
+
+        void EnqueueTask(
+            const SGProcessing::Task& task,
+            const std::list<SGProcessing::SubTask>& subTasks) override
+        {
+            m_tasks[task.ipfs_block_id()] = { task, subTasks };
+            m_index.AddPendingTask(task.ipfs_block_id(), task.tenant_id(), task.priority(), task.enqueue_timestamp());
+        }
+
+        bool GetSubTasks(
+            const std::string& taskId,
+            std::list<SGProcessing::SubTask>& subTasks) override
+        {
+            subTasks = m_tasks.at(taskId).second;
+            return true;
+        }
+
+        bool GrabTask(std::string& taskId, SGProcessing::Task& task) override
+        {
+            return m_index.GetNextUnlockedTask(taskId) && GrabTaskById(taskId, task);
+        }
+
+        bool GetAvailableTasks(
+            size_t maxTaskCount,
+            std::list<std::pair<std::string, SGProcessing::Task>>& tasks) override
+        {
+            std::list<std::string> taskIds;
+            m_index.GetUnlockedTasks(maxTaskCount, taskIds);
+            for (const auto& taskId : taskIds)
+            {
+                tasks.emplace_back(taskId, m_tasks.at(taskId).first);
+            }
+            return !tasks.empty();
+        }
+
+        bool GrabTaskById(const std::string& taskId, SGProcessing::Task& task) override
+        {
+            if (m_index.IsTaskLocked(taskId) || m_index.IsTaskCompleted(taskId))
+            {
+                return false;
+            }
+            m_index.LockTask(taskId, 1);
+            task = m_tasks.at(taskId).first;
+            return true;
+        }
+
+        bool CompleteTask(const std::string& taskId, const SGProcessing::TaskResult& result) override
+        {
+            m_index.CompleteTask(taskId);
+            return true;
+        }
+
+    private:
+        ProcessingTaskQueueIndex m_index;
+        std::map<std::string, std::pair<SGProcessing::Task, std::list<SGProcessing::SubTask>>> m_tasks;
+    };
+}
+
+class ProcessingTaskSchedulerTest : public ::testing::Test
+{
+};
+
+/**
+ * @given A large batch of tasks of one tenant enqueued before a few tasks of another tenant
+ * @when Tasks are grabbed in the scheduler order
+ * @then The tenants are served alternately while both have tasks.
+ */
+TEST_F(ProcessingTaskSchedulerTest, FairShareBetweenTenants)
+{
+    auto now = std::chrono::system_clock::now();
+    std::list<ProcessingTaskScheduler::AvailableTask> tasks;
+    for (size_t taskIdx = 0; taskIdx < 20; ++taskIdx)
+    {
+        tasks.push_back(CreateTask(
+            (boost::format("BATCH_%d") % taskIdx).str(), "BATCH", 0, now - std::chrono::seconds(1)));
+    }
+    for (size_t taskIdx = 0; taskIdx < 3; ++taskIdx)
+    {
+        tasks.push_back(CreateTask((boost::format("INTERACTIVE_%d") % taskIdx).str(), "INTERACTIVE", 0, now));
+    }
+
+    ProcessingTaskScheduler scheduler;
+    auto tenantIds = GrabTasks(scheduler, tasks, 6, 10, now);
+
+    ASSERT_EQ(tenantIds.size(), 6);
+    EXPECT_EQ(std::count(tenantIds.begin(), tenantIds.end(), "INTERACTIVE"), 3);
+    for (size_t idx = 1; idx < tenantIds.size(); ++idx)
+    {
+        EXPECT_NE(tenantIds[idx], tenantIds[idx - 1]);
+    }
+}
+
+/**
+ * @given Two tenants with weights 2 and 1 having enough tasks of the same size
+ * @when Tasks are grabbed in the scheduler order
+ * @then Tasks are grabbed in proportion to the tenant weights.
+ * A tenant that appears later does not get a credit for its idle time.
+ */
+TEST_F(ProcessingTaskSchedulerTest, WeightedFairShare)
+{
+    auto now = std::chrono::system_clock::now();
+    std::list<ProcessingTaskScheduler::AvailableTask> tasks;
+    for (size_t taskIdx = 0; taskIdx < 30; ++taskIdx)
+    {
+        tasks.push_back(CreateTask((boost::format("A_%d") % taskIdx).str(), "A", 0, now));
+        tasks.push_back(CreateTask((boost::format("B_%d") % taskIdx).str(), "B", 0, now));
+    }
+
+    ProcessingTaskScheduler scheduler;
+    scheduler.SetTenantWeight("A", 2);
+    auto tenantIds = GrabTasks(scheduler, tasks, 30, 4, now);
+    EXPECT_EQ(std::count(tenantIds.begin(), tenantIds.end(), "A"), 20);
+    EXPECT_EQ(std::count(tenantIds.begin(), tenantIds.end(), "B"), 10);
+
+    // A new tenant shares the node with others instead of taking it until its virtual time catches up
+    tasks.clear();
+    for (size_t taskIdx = 0; taskIdx < 10; ++taskIdx)
+    {
+        tasks.push_back(CreateTask((boost::format("B_%d") % (30 + taskIdx)).str(), "B", 0, now));
+        tasks.push_back(CreateTask((boost::format("C_%d") % taskIdx).str(), "C", 0, now));
+    }
+    tenantIds = GrabTasks(scheduler, tasks, 10, 4, now);
+    EXPECT_EQ(std::count(tenantIds.begin(), tenantIds.end(), "C"), 5);
+}
+
+/**
+ * @given Tasks of a single tenant with different priorities and wait times
+ * @when Tasks are ordered
+ * @then A higher priority task goes first unless a lower priority one waits long enough to outrun it.
+ */
+TEST_F(ProcessingTaskSchedulerTest, PriorityAging)
+{
+    auto now = std::chrono::system_clock::now();
+    ProcessingTaskScheduler scheduler;
+    scheduler.SetAgingInterval(std::chrono::seconds(10));
+
+    std::list<ProcessingTaskScheduler::AvailableTask> tasks;
+    tasks.push_back(CreateTask("LOW", "TENANT", 0, now - std::chrono::seconds(15)));
+    tasks.push_back(CreateTask("HIGH", "TENANT", 2, now));
+    scheduler.OrderTasks(tasks, now);
+    EXPECT_EQ(tasks.front().first, "HIGH");
+
+    tasks.push_back(CreateTask("AGED", "TENANT", 0, now - std::chrono::seconds(25)));
+    scheduler.OrderTasks(tasks, now);
+    EXPECT_EQ(tasks.front().first, "AGED");
+    EXPECT_EQ(tasks.back().first, "LOW");
+}
+
+/**
+ * @given Tasks of two tenants that waited different times
+ * @when The tasks are grabbed
+ * @then Per-tenant grabbed task counts and wait times are reported.
+ */
+TEST_F(ProcessingTaskSchedulerTest, TenantStatistics)
+{
+    auto now = std::chrono::system_clock::now();
+    ProcessingTaskScheduler scheduler;
+    scheduler.OnTaskGrabbed(CreateTask("A_1", "A", 0, now - std::chrono::seconds(1)).second, 5, now);
+    scheduler.OnTaskGrabbed(CreateTask("A_2", "A", 0, now - std::chrono::seconds(3)).second, 5,
+        now + std::chrono::seconds(1));
+    scheduler.OnTaskGrabbed(CreateTask("B_1", "B", 0, now).second, 2, now);
+
+    auto statistics = scheduler.GetTenantStatistics();
+    ASSERT_EQ(statistics.size(), 2);
+    EXPECT_EQ(statistics["A"].grabbedTaskCount, 2);
+    EXPECT_EQ(statistics["A"].grabbedSubTaskCount, 10);
+    EXPECT_EQ(statistics["A"].GetAverageWaitTime(), std::chrono::milliseconds(2500));
+    EXPECT_EQ(statistics["A"].maxWaitTime, std::chrono::seconds(4));
+    EXPECT_DOUBLE_EQ(statistics["A"].GetSubTaskThroughput(), 10);
+    EXPECT_EQ(statistics["B"].grabbedTaskCount, 1);
+    EXPECT_EQ(statistics["B"].maxWaitTime, std::chrono::seconds(0));
+}
+
+/**
+ * @given A queue with 500 tasks of one tenant enqueued before a single task of another tenant
+ * @when Tasks are grabbed by an enqueuer that chooses from a small number of candidates
+ * @then The single task is grabbed within 2 grabs.
+ */
+TEST_F(ProcessingTaskSchedulerTest, SingleTaskTenantIsNotStarved)
+{
+    auto now = std::chrono::system_clock::now();
+    auto taskQueue = std::make_shared<IndexedTaskQueue>();
+    std::list<SGProcessing::SubTask> subTasks(4);
+    for (size_t taskIdx = 0; taskIdx < 500; ++taskIdx)
+    {
+        taskQueue->EnqueueTask(CreateTask(
+            (boost::format("BATCH_%d") % taskIdx).str(), "BATCH", 0, now - std::chrono::seconds(1)).second, subTasks);
+    }
+    taskQueue->EnqueueTask(CreateTask("INTERACTIVE", "INTERACTIVE", 0, now).second, subTasks);
+
+    SubTaskEnqueuerImpl enqueuer(taskQueue);
+    enqueuer.SetCandidateTaskCount(4);
+
+    size_t grabCount = 0;
+    std::string subTaskQueueId;
+    while ((grabCount < 10) && (subTaskQueueId != "INTERACTIVE"))
+    {
+        std::list<SGProcessing::SubTask> enqueuedSubTasks;
+        ASSERT_TRUE(enqueuer.EnqueueSubTasks(subTaskQueueId, enqueuedSubTasks));
+        ++grabCount;
+    }
+    EXPECT_EQ(subTaskQueueId, "INTERACTIVE");
+    EXPECT_LE(grabCount, 2);
+}
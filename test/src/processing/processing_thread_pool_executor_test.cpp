@@ -0,0 +1,56 @@
+#include <processing/processing_thread_pool_executor.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace sgns::processing;
+
+/**
+ * @given A thread pool executor and threads that submit tasks to it
+ * @when The executor is shut down while the tasks are being submitted
+ * @then Every accepted task is executed before Shutdown returns
+ * and Drain does not wait for rejected tasks.
+ */
+TEST(ProcessingThreadPoolExecutorTest, ConcurrentSubmitAndShutdown)
+{
+    for (size_t attemptIdx = 0; attemptIdx < 100; ++attemptIdx)
+    {
+        ProcessingThreadPoolExecutor executor(2);
+        std::atomic<size_t> acceptedTaskCount = 0;
+        std::atomic<size_t> executedTaskCount = 0;
+        std::atomic<bool> isStarted = false;
+
+        std::vector<std::thread> submitThreads;
+        for (size_t threadIdx = 0; threadIdx < 4; ++threadIdx)
+        {
+            submitThreads.emplace_back([&]() {
+                while (!isStarted)
+                {
+                    std::this_thread::yield();
+                }
+                for (size_t taskIdx = 0; taskIdx < 100; ++taskIdx)
+                {
+                    if (executor.Submit([&executedTaskCount]() { ++executedTaskCount; }))
+                    {
+                        ++acceptedTaskCount;
+                    }
+                }
+            });
+        }
+
+        isStarted = true;
+        std::this_thread::yield();
+        executor.Shutdown();
+        for (auto& thread : submitThreads)
+        {
+            thread.join();
+        }
+
+        EXPECT_EQ(acceptedTaskCount.load(), executedTaskCount.load());
+        EXPECT_EQ(0, executor.GetQueueDepth());
+        executor.Drain();
+    }
+}
@@ -0,0 +1,135 @@
+#include <processing/processing_validation_core.hpp>
+
+#include <libp2p/log/configurator.hpp>
+#include <libp2p/log/logger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace sgns::processing;
+
+namespace
+{
+    /** Creates subtasks where each chunk is processed by 2 subtasks.
+    * A result hash of each invalidChunkStep-th chunk doesn't match between its subtasks
+    */
+    void CreateSubTasks(
+        size_t subTaskCount,
+        size_t chunksPerSubTask,
+        size_t invalidChunkStep,
+        SGProcessing::SubTaskCollection& subTasks,
+        std::map<std::string, SGProcessing::SubTaskResult>& results)
+    {
+        for (size_t subTaskIdx = 0; subTaskIdx < subTaskCount; ++subTaskIdx)
+        {
+            auto subTask = subTasks.add_items();
+            subTask->set_subtaskid("SUBTASK_" + std::to_string(subTaskIdx));
+
+            SGProcessing::SubTaskResult result;
+            result.set_subtaskid(subTask->subtaskid());
+            for (size_t idx = 0; idx < chunksPerSubTask; ++idx)
+            {
+                // Neighbour subtasks share their chunks
+                size_t chunkIdx = (subTaskIdx / 2) * chunksPerSubTask + idx;
+                auto chunk = subTask->add_chunkstoprocess();
+                chunk->set_chunkid("CHUNK_" + std::to_string(chunkIdx));
+                chunk->set_offset(chunkIdx);
+                chunk->set_subchunk_width(10);
+                chunk->set_subchunk_height(10);
+
+                bool isInvalid = (invalidChunkStep > 0) && (subTaskIdx % 2 == 1) && (chunkIdx % invalidChunkStep == 0);
+                result.add_chunk_hashes(isInvalid ? chunkIdx + 1 : chunkIdx);
+            }
+            results.emplace(result.subtaskid(), std::move(result));
+        }
+    }
+}
+
+const std::string logger_config(R"(
+# ----------------
+sinks:
+  - name: console
+    type: console
+    color: true
+groups:
+  - name: processing_validation_core_test
+    sink: console
+    level: info
+    children:
+      - name: libp2p
+      - name: Gossip
+# ----------------
+  )");
+
+class ProcessingValidationCoreTest : public ::testing::Test
+{
+public:
+    virtual void SetUp() override
+    {
+        // prepare log system
+        auto logging_system = std::make_shared<soralog::LoggingSystem>(
+            std::make_shared<soralog::ConfiguratorFromYAML>(
+                // Original LibP2P logging config
+                std::make_shared<libp2p::log::Configurator>(),
+                // Additional logging config for application
+                logger_config));
+        logging_system->configure();
+
+        libp2p::log::setLoggingSystem(logging_system);
+        libp2p::log::setLevelOfGroup("processing_validation_core_test", soralog::Level::DEBUG);
+    }
+};
+
+/**
+ * @given Subtasks with duplicated chunks and mismatched chunk result hashes
+ * @when Results are validated sequentially and in parallel
+ * @then Both validations find the same invalid subtasks.
+ */
+TEST_F(ProcessingValidationCoreTest, ParallelValidationMatchesSequential)
+{
+    SGProcessing::SubTaskCollection subTasks;
+    std::map<std::string, SGProcessing::SubTaskResult> results;
+    CreateSubTasks(100, 10, 97, subTasks, results);
+    // A subtask without results
+    results.erase("SUBTASK_50");
+
+    ProcessingValidationCore sequentialValidationCore(1);
+    std::set<std::string> sequentialInvalidSubTaskIds;
+    ASSERT_FALSE(sequentialValidationCore.ValidateResults(subTasks, results, sequentialInvalidSubTaskIds));
+
+    ProcessingValidationCore parallelValidationCore(4);
+    parallelValidationCore.SetParallelChunkCountThreshold(0);
+    std::set<std::string> parallelInvalidSubTaskIds;
+    ASSERT_FALSE(parallelValidationCore.ValidateResults(subTasks, results, parallelInvalidSubTaskIds));
+
+    // Chunks 0, 97, ..., 485 have mismatched hashes in subtask pairs (0, 1), (18, 19), ..., (96, 97)
+    std::set<std::string> expectedInvalidSubTaskIds({ "SUBTASK_50" });
+    for (size_t chunkIdx = 0; chunkIdx < 500; chunkIdx += 97)
+    {
+        auto subTaskIdx = (chunkIdx / 10) * 2;
+        expectedInvalidSubTaskIds.insert("SUBTASK_" + std::to_string(subTaskIdx));
+        expectedInvalidSubTaskIds.insert("SUBTASK_" + std::to_string(subTaskIdx + 1));
+    }
+    EXPECT_EQ(expectedInvalidSubTaskIds, sequentialInvalidSubTaskIds);
+    EXPECT_EQ(expectedInvalidSubTaskIds, parallelInvalidSubTaskIds);
+}
+
+/**
+ * @given A queue with 20000 chunks and valid results
+ * @when Results are validated sequentially and in parallel
+ * @then Results are valid.
+ */
+TEST_F(ProcessingValidationCoreTest, LargeQueueValidation)
+{
+    SGProcessing::SubTaskCollection subTasks;
+    std::map<std::string, SGProcessing::SubTaskResult> results;
+    CreateSubTasks(2000, 10, 0, subTasks, results);
+
+    for (size_t threadCount : { 1, 4 })
+    {
+        ProcessingValidationCore validationCore(threadCount);
+
+        std::set<std::string> invalidSubTaskIds;
+        EXPECT_TRUE(validationCore.ValidateResults(subTasks, results, invalidSubTaskIds));
+        EXPECT_TRUE(invalidSubTaskIds.empty());
+    }
+}
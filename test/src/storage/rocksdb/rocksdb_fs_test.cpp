@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <boost/filesystem.hpp>
 #include "storage/rocksdb/rocksdb.hpp"
+#include "storage/rocksdb/rocksdb_cursor.hpp"
 #include "storage/database_error.hpp"
 #include "testutil/outcome.hpp"
 
@@ -92,4 +93,68 @@ namespace sgns::storage
     EXPECT_TRUE(queryResult.size() == numberOfDataset);
 
   }
+
+  /**
+   * @given database with keys of several prefixes
+   * @when prefix is queried page by page and iterated with a prefix cursor
+   * @then all keys with the prefix are returned once in the key order and other keys are not read
+   */
+  TEST_F(rocksdb_Open, QueryDBPages) {
+    rocksdb::Options options;
+    options.create_if_missing = true;  // intentionally
+
+    EXPECT_OUTCOME_TRUE_2(db, rocksdb::create(getPathString(), options));
+
+    Buffer key, value;
+    for (const auto& str : {"/a/0", "/a/1", "/a/2", "/a/3", "/a/4", "/ab", "/b/0"})
+    {
+      key.clear();
+      key.put(str);
+      value.clear();
+      value.put(std::string("value") + str);
+      EXPECT_OUTCOME_TRUE_1(db->put(key, value));
+    }
+
+    Buffer prefix;
+    prefix.put("/a/");
+    std::vector<std::string> keys;
+    auto collectKeys = [&keys](gsl::span<const uint8_t> key, gsl::span<const uint8_t> value)
+    {
+      keys.emplace_back(key.begin(), key.end());
+      return true;
+    };
+
+    Buffer startKey;
+    size_t pageCount = 0;
+    do
+    {
+      EXPECT_OUTCOME_TRUE(nextKey, db->query(prefix, collectKeys, 2, startKey));
+      startKey = nextKey;
+      ++pageCount;
+    } while (!startKey.empty());
+
+    EXPECT_EQ(pageCount, 3);
+    EXPECT_EQ(keys, std::vector<std::string>({"/a/0", "/a/1", "/a/2", "/a/3", "/a/4"}));
+
+    // The query is stopped by the callback
+    size_t callbackCount = 0;
+    EXPECT_OUTCOME_TRUE(nextKey, db->query(prefix,
+        [&callbackCount](gsl::span<const uint8_t> key, gsl::span<const uint8_t> value)
+        {
+          ++callbackCount;
+          return false;
+        }));
+    EXPECT_EQ(callbackCount, 1);
+    EXPECT_EQ(std::string(nextKey.toString()), "/a/1");
+
+    size_t cursorCount = 0;
+    for (auto cursor = db->prefixCursor(prefix); cursor->isValid(); cursor->next())
+    {
+      auto valueView = cursor->valueView();
+      EXPECT_EQ(std::string(valueView.begin(), valueView.end()),
+                "value" + std::string(cursor->keyView().begin(), cursor->keyView().end()));
+      ++cursorCount;
+    }
+    EXPECT_EQ(cursorCount, 5);
+  }
 }
\ No newline at end of file